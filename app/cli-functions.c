@@ -547,6 +547,9 @@ static struct cli_map set_map[] = {
     {80, "set %P tos %d"},
     {90, "set %P vxlan %h %d %d"},
     {100, "set %P latsampler %|simple|poisson %d %d %s"},
+    {110, "set %P imix %|simple|tolly"},
+    {111, "set %P imix %|table|genome %s"},
+    {112, "set %P imix show"},
     {-1, NULL}
 };
 // clang format on
@@ -601,9 +604,15 @@ static const char *set_help[] = {
     "set <portlist> vxlan <flags> <group id> <vxlan_id> - Set the vxlan values",
     "set <portlist> latsampler [simple|poisson] <num-samples> <rate> <outfile>	- Set latency "
     "sampler parameters",
-    "		num-samples: number of samples.",
+    "		num-samples: number of samples, 0 to sample until stopped.",
     "		rate: sampling rate i.e., samples per second.",
-    "		outfile: path to output file to dump all sampled latencies",
+    "		outfile: path to output file, CSV or binary records if it ends in .bin",
+    "set <portlist> imix simple|tolly   - Use a standard IMIX, simple is 64:7,594:4,1518:1",
+    "set <portlist> imix table <list>   - Use an IMIX of size:weight pairs e.g. 64:7,594:4,1518:1",
+    "set <portlist> imix genome <str>   - Use an RFC 6985 IMIX genome e.g. aaaaaaadddg, in order",
+    "                                     a=64 b=128 c=256 d=512 e=1024 f=1280 g=1518 h=2112",
+    "                                     i=9000 z=MTU",
+    "set <portlist> imix show           - Show the IMIX, 'enable <portlist> imix' to send it",
     "set ports_per_page <value>         - Set ports per page value 1 - 6",
     CLI_HELP_PAUSE,
     NULL};
@@ -806,6 +815,15 @@ set_cmd(int argc, char **argv)
         u2 = strtol(argv[5], NULL, 0);
         foreach_port(portlist, single_set_latsampler_params(pinfo, argv[3], u1, u2, argv[6]));
         break;
+    case 110:
+        foreach_port(portlist, pktgen_imix_set(pinfo, argv[3], NULL));
+        break;
+    case 111:
+        foreach_port(portlist, pktgen_imix_set(pinfo, argv[3], argv[4]));
+        break;
+    case 112:
+        foreach_port(portlist, pktgen_imix_show(pinfo));
+        break;
     default:
         return cli_cmd_error("Command invalid", "Set", argc, argv);
     }
@@ -820,6 +838,9 @@ static struct cli_map pcap_map[] = {
     {20, "pcap show"},
     {21, "pcap show all"},
     {30, "pcap filter %P %s"},
+    {40, "pcap %P timing %|on|off"},
+    {50, "pcap %P speed %s"},
+    {60, "pcap %P format %|pcap|nsec|pcapng"},
     {-1, NULL}
 };
 // clang-format on
@@ -830,6 +851,11 @@ static const char *pcap_help[] = {
     "pcap <index>                       - Move the PCAP file index to the given packet number,\n   "
     "    0 - rewind, -1 - end of file",
     "pcap filter <portlist> <string>    - PCAP filter string to filter packets on receive",
+    "    only matching packets are captured and dumped, quote the string, off removes it",
+    "pcap <portlist> timing on|off      - Replay the PCAP file at its capture times",
+    "pcap <portlist> speed <x>|top      - Scale the capture times, 2 is twice as fast,\n   "
+    "    top sends the file as fast as the port can",
+    "pcap <portlist> format <fmt>       - Write captures as pcap, nsec (ns pcap) or pcapng",
     CLI_HELP_PAUSE,
     NULL};
 
@@ -842,6 +868,9 @@ pcap_cmd(int argc, char **argv)
     uint32_t value;
     portlist_t portlist;
     port_info_t *pinfo;
+    double speed;
+    char *end;
+    int ret = 0;
 
     m = cli_mapping(pcap_map, argc, argv);
     if (!m)
@@ -879,7 +908,31 @@ pcap_cmd(int argc, char **argv)
         break;
     case 30:
         portlist_parse(argv[2], pktgen.nb_ports, &portlist);
-        foreach_port(portlist, pcap_filter(pinfo, argv[3]));
+        foreach_port(portlist, ret |= pcap_filter(pinfo, argv[3]));
+        if (ret)
+            return cli_cmd_error("PCAP filter failed", "PCAP", argc, argv);
+        break;
+    case 40:
+        portlist_parse(argv[1], pktgen.nb_ports, &portlist);
+        foreach_port(portlist, ret |= pktgen_pcap_timing(pinfo, estate(argv[3])));
+        if (ret)
+            return cli_cmd_error("PCAP timing failed", "PCAP", argc, argv);
+        break;
+    case 50:
+        speed = 0.0;
+        if (strcmp(argv[3], "top")) {
+            speed = strtod(argv[3], &end);
+            if (end == argv[3] || *end != '\0')
+                return cli_cmd_error("PCAP speed is invalid", "PCAP", argc, argv);
+        }
+        portlist_parse(argv[1], pktgen.nb_ports, &portlist);
+        foreach_port(portlist, ret |= pktgen_pcap_speed(pinfo, speed));
+        if (ret)
+            return cli_cmd_error("PCAP speed failed", "PCAP", argc, argv);
+        break;
+    case 60:
+        portlist_parse(argv[1], pktgen.nb_ports, &portlist);
+        foreach_port(portlist, ret |= pktgen_pcap_format(pinfo, argv[3]));
         break;
     default:
         return cli_cmd_error("PCAP command invalid", "PCAP", argc, argv);
@@ -912,7 +965,7 @@ static const char *start_help[] = {
     "    type - request | gratuitous | req | grat",
     "start <portlist> latsampler        - Start latency sampler, make sure to set sampling "
     "parameters before starting",
-    "stop <portlist> latsampler        	- Stop latency sampler, dumps to file if specified",
+    "stop <portlist> latsampler        	- Stop latency sampler and close its output file",
     CLI_HELP_PAUSE,
     NULL};
 
@@ -1024,7 +1077,10 @@ theme_cmd(int argc, char **argv)
     "rate|"     /* 15 */ \
     "rnd_s_ip|" /* 16 */ \
     "rnd_s_pt|" /* 17 */ \
-    "lat"       /* 18 */
+    "lat|"      /* 18 */ \
+    "imix|"     /* 19 */ \
+    "streams|"  /* 20 */ \
+    "signature" /* 21 */
 
 // clang-format off
 static struct cli_map enable_map[] = {
@@ -1063,6 +1119,9 @@ static const char *enable_help[] = {
     "current working directory.",
     "enable|disable <portlist> bonding  - Enable call TX with zero packets for bonding driver",
     "enable|disable <portlist> vxlan    - Send VxLAN packets",
+    "enable|disable <portlist> imix     - Send single packets with the 'set <portlist> imix' sizes",
+    "enable|disable <portlist> streams  - Send the streams set with the 'stream' command",
+    "enable|disable <portlist> signature - Sign sent packets and analyze the signed ones received",
     "enable|disable mac_from_arp        - Enable/disable MAC address from ARP packet",
     "enable|disable clock_gettime       - Enable/disable use of new clock_gettime() instead of rdtsc()",
     "enable|disable screen              - Enable/disable updating the screen and unlock/lock window",
@@ -1153,6 +1212,15 @@ en_dis_cmd(int argc, char **argv)
         case 18: // lat type alias latency
             foreach_port(portlist, enable_latency(pinfo, state));
             break;
+        case 19: // imix
+            foreach_port(portlist, enable_imix(pinfo, state));
+            break;
+        case 20: // streams
+            foreach_port(portlist, enable_streams(pinfo, state));
+            break;
+        case 21: // signature
+            foreach_port(portlist, enable_signature(pinfo, state));
+            break;
         default:
             return cli_cmd_error("Enable/Disable invalid command", "Enable", argc, argv);
         }
@@ -1975,6 +2043,9 @@ bonding_cmd(int argc, char **argv)
 static struct cli_map latency_map[] = {
     {10, "latency %P rate %u"},
     {20, "latency %P entropy %u"},
+    {25, "latency %P probes %u"},
+    {27, "latency %P timestamp %|hw|sw"},
+    {30, "latency percentiles %s"},
     {-1, NULL}
 };
 
@@ -1983,6 +2054,10 @@ static const char *latency_help[] = {
     "latency <portlist> rate <value>      - Rate in milli-seconds to send a latency packet",
     "latency <portlist> entropy <value>   - Entropy value to adjust the src-port by (SPORT + (i % N)) (default: 1)",
     "                                       e.eg. latency 0 entropy 16",
+    "latency <portlist> probes <value>    - Max latency probes per TX burst, used to catch up at high rates (default: 1)",
+    "latency <portlist> timestamp hw|sw   - Use NIC RX timestamps (needs --hw-tstamp) or the TSC (default: sw)",
+    "latency percentiles <list>           - Latency percentiles to report, up to 6 values (default: 50,90,99,99.9,99.99)",
+    "                                       e.g. latency percentiles 50,99,99.9,99.99,99.999",
     CLI_HELP_PAUSE,
     NULL
 };
@@ -1999,6 +2074,13 @@ latency_cmd(int argc, char **argv)
     if (!m)
         return cli_cmd_error("Latency invalid command", "Latency", argc, argv);
 
+    if (m->index == 30) {
+        if (latency_set_percentiles(argv[2]) < 0)
+            return cli_cmd_error("Latency invalid percentile list", "Latency", argc, argv);
+        pktgen_update_display();
+        return 0;
+    }
+
     portlist_parse(argv[1], pktgen.nb_ports, &portlist);
 
     value = atoi(argv[3]);
@@ -2010,6 +2092,12 @@ latency_cmd(int argc, char **argv)
     case 20:
         foreach_port(portlist, latency_set_entropy(pinfo, (uint16_t)value));
         break;
+    case 25:
+        foreach_port(portlist, latency_set_probes(pinfo, value));
+        break;
+    case 27:
+        foreach_port(portlist, latency_set_tstamp(pinfo, !strcmp(argv[3], "hw")));
+        break;
     default:
         return cli_cmd_error("Latency invalid command", "Latency", argc, argv);
     }
@@ -2018,6 +2106,355 @@ latency_cmd(int argc, char **argv)
     return 0;
 }
 
+// clang-format off
+static struct cli_map rate_map[] = {
+    {10, "rate %P profile clear"},
+    {20, "rate %P profile step %s %s"},
+    {30, "rate %P profile ramp %s %s %s"},
+    {40, "rate %P profile sine %s %s %s %s"},
+    {50, "rate %P profile load %s"},
+    {60, "rate %P profile loop %|on|off"},
+    {70, "rate %P profile %|on|off"},
+    {80, "rate %P profile show"},
+    {90, "rate %P arrival %|periodic|poisson"},
+    {91, "rate %P arrival onoff %s %s"},
+    {92, "rate %P arrival show"},
+    {100, "rate %P burst fixed"},
+    {101, "rate %P burst uniform %d %d"},
+    {102, "rate %P burst geometric %s"},
+    {103, "rate %P burst pareto %d %s"},
+    {-1, NULL}
+};
+
+static const char *rate_help[] = {
+    "",
+    "rate <portlist> profile clear                     - Remove all segments of the TX rate profile",
+    "rate <portlist> profile step <usec> <rate>        - Append a segment sending at rate percent",
+    "rate <portlist> profile ramp <usec> <from> <to>   - Append a segment ramping linearly between two rates",
+    "rate <portlist> profile sine <usec> <mean> <amp> <period_usec>",
+    "                                                  - Append a segment with a rate of mean + amp * sin(2*pi*t/period)",
+    "rate <portlist> profile load <file>               - Replace the profile with a CSV trace of time_us,rate points",
+    "rate <portlist> profile loop on|off               - Restart the profile at its end or keep the last rate (default: off)",
+    "rate <portlist> profile on|off                    - Make the TX rate follow the profile or the set rate",
+    "rate <portlist> profile show                      - Show the profile segments",
+    "                                                    Rates are in percent of the link, the profile starts with start",
+    "                                                    e.g. rate 0 profile ramp 10000000 1 100",
+    "rate <portlist> arrival periodic|poisson          - Send evenly spaced bursts or start bursts at exponential intervals",
+    "rate <portlist> arrival onoff <on_usec> <off_usec> - Poisson bursts during on periods, exponential on/off times with these means",
+    "rate <portlist> arrival show                      - Show the arrival model and burst length distribution",
+    "rate <portlist> burst fixed                       - Stochastic bursts are the paced burst size (default)",
+    "rate <portlist> burst uniform <min> <max>         - Stochastic burst lengths are uniform between min and max packets",
+    "rate <portlist> burst geometric <mean>            - Stochastic burst lengths are geometric with the given mean",
+    "rate <portlist> burst pareto <min> <shape>        - Stochastic burst lengths are Pareto, heavy tailed for shapes near 1",
+    "                                                    The gaps between bursts are scaled to keep the set mean rate",
+    CLI_HELP_PAUSE,
+    NULL
+};
+// clang-format on
+
+static int
+rate_cmd(int argc, char **argv)
+{
+    struct cli_map *m;
+    portlist_t portlist;
+    uint32_t mode;
+    int ret = 0;
+
+    m = cli_mapping(rate_map, argc, argv);
+    if (!m)
+        return cli_cmd_error("Rate invalid command", "Rate", argc, argv);
+
+    portlist_parse(argv[1], pktgen.nb_ports, &portlist);
+
+    switch (m->index) {
+    case 10:
+        foreach_port(portlist, ret |= rate_profile_clear(pinfo));
+        break;
+    case 20:
+        foreach_port(portlist, ret |= rate_profile_add(pinfo, RATE_SEG_STEP, atof(argv[4]),
+                                                       atof(argv[5]), 0.0, 0.0));
+        break;
+    case 30:
+        foreach_port(portlist, ret |= rate_profile_add(pinfo, RATE_SEG_RAMP, atof(argv[4]),
+                                                       atof(argv[5]), atof(argv[6]), 0.0));
+        break;
+    case 40:
+        foreach_port(portlist, ret |= rate_profile_add(pinfo, RATE_SEG_SINE, atof(argv[4]),
+                                                       atof(argv[5]), atof(argv[6]),
+                                                       atof(argv[7])));
+        break;
+    case 50:
+        foreach_port(portlist, ret |= rate_profile_load(pinfo, argv[4]));
+        break;
+    case 60:
+        foreach_port(portlist, rate_profile_loop(pinfo, estate(argv[4])));
+        break;
+    case 70:
+        foreach_port(portlist, ret |= rate_profile_enable(pinfo, estate(argv[3])));
+        break;
+    case 80:
+        foreach_port(portlist, rate_profile_show(pinfo));
+        return 0;
+    case 90:
+        mode = strcmp(argv[3], "poisson") ? TX_ARRIVAL_PERIODIC : TX_ARRIVAL_POISSON;
+        foreach_port(portlist, ret |= tx_arrival_set(pinfo, mode, 0.0, 0.0));
+        break;
+    case 91:
+        foreach_port(portlist, ret |= tx_arrival_set(pinfo, TX_ARRIVAL_ONOFF, atof(argv[4]),
+                                                     atof(argv[5])));
+        break;
+    case 92:
+        foreach_port(portlist, tx_arrival_show(pinfo));
+        return 0;
+    case 100:
+        foreach_port(portlist, ret |= tx_burst_dist_set(pinfo, TX_BURST_FIXED, 0.0, 0.0));
+        break;
+    case 101:
+        foreach_port(portlist, ret |= tx_burst_dist_set(pinfo, TX_BURST_UNIFORM, atof(argv[4]),
+                                                        atof(argv[5])));
+        break;
+    case 102:
+        foreach_port(portlist,
+                     ret |= tx_burst_dist_set(pinfo, TX_BURST_GEOMETRIC, atof(argv[4]), 0.0));
+        break;
+    case 103:
+        foreach_port(portlist, ret |= tx_burst_dist_set(pinfo, TX_BURST_PARETO, atof(argv[4]),
+                                                        atof(argv[5])));
+        break;
+    default:
+        return cli_cmd_error("Rate invalid command", "Rate", argc, argv);
+    }
+    if (ret)
+        return cli_cmd_error("Rate command failed", "Rate", argc, argv);
+
+    pktgen_update_display();
+    return 0;
+}
+
+// clang-format off
+static struct cli_map stream_map[] = {
+    {10, "stream %P %d %|on|off"},
+    {20, "stream %P %d rate %s"},
+    {30, "stream %P %d count %s"},
+    {40, "stream %P %d model %|periodic|poisson"},
+    {50, "stream %P %d copy"},
+    {60, "stream %P clear"},
+    {70, "stream %P show"},
+    {-1, NULL}
+};
+
+static const char *stream_help[] = {
+    "",
+    "stream <portlist> <id> on|off          - Send stream 0-15 in stream mode",
+    "stream <portlist> <id> rate <percent>  - Set the stream rate in percent of the link",
+    "stream <portlist> <id> count <packets> - Packets to send per start, 0 to send until stopped",
+    "stream <portlist> <id> model periodic|poisson",
+    "                                       - Evenly spaced packets or exponential gaps",
+    "stream <portlist> <id> copy            - Copy the single packet into the stream packet",
+    "stream <portlist> clear                - Turn off all streams and reset them",
+    "stream <portlist> show                 - Show the streams and the packets they sent",
+    "                                         A stream sends the sequence packet of its id,",
+    "                                         'enable <portlist> streams' sends the streams",
+    "                                         that are on until they are done or stopped",
+    CLI_HELP_PAUSE,
+    NULL
+};
+// clang-format on
+
+static int
+stream_cmd(int argc, char **argv)
+{
+    struct cli_map *m;
+    portlist_t portlist;
+    uint16_t sid;
+    uint32_t model;
+    int ret = 0;
+
+    m = cli_mapping(stream_map, argc, argv);
+    if (!m)
+        return cli_cmd_error("Stream invalid command", "Stream", argc, argv);
+
+    portlist_parse(argv[1], pktgen.nb_ports, &portlist);
+    sid = (m->index < 60) ? atoi(argv[2]) : 0;
+
+    switch (m->index) {
+    case 10:
+        foreach_port(portlist, ret |= pktgen_stream_enable(pinfo, sid, estate(argv[3])));
+        break;
+    case 20:
+        foreach_port(portlist, ret |= pktgen_stream_rate(pinfo, sid, atof(argv[4])));
+        break;
+    case 30:
+        foreach_port(portlist,
+                     ret |= pktgen_stream_count(pinfo, sid, strtoull(argv[4], NULL, 0)));
+        break;
+    case 40:
+        model = strcmp(argv[4], "poisson") ? TX_ARRIVAL_PERIODIC : TX_ARRIVAL_POISSON;
+        foreach_port(portlist, ret |= pktgen_stream_model(pinfo, sid, model));
+        break;
+    case 50:
+        foreach_port(portlist, ret |= pktgen_stream_copy(pinfo, sid));
+        break;
+    case 60:
+        foreach_port(portlist, ret |= pktgen_stream_clear(pinfo));
+        break;
+    case 70:
+        foreach_port(portlist, pktgen_stream_show(pinfo));
+        return 0;
+    default:
+        return cli_cmd_error("Stream invalid command", "Stream", argc, argv);
+    }
+    if (ret)
+        return cli_cmd_error("Stream command failed", "Stream", argc, argv);
+
+    pktgen_update_display();
+    return 0;
+}
+
+// clang-format off
+static struct cli_map capture_map[] = {
+    {10, "capture %P mode %|memory|disk|ring"},
+    {20, "capture %P direct %|on|off"},
+    {30, "capture %P show"},
+    {40, "capture %P ring %d %d %d"},
+    {45, "capture %P disk %d"},
+    {50, "capture %P trigger latency %d"},
+    {51, "capture %P trigger %|gap|errors %|on|off"},
+    {60, "capture %P freeze"},
+    {70, "capture %P snaplen %d"},
+    {80, "capture %P sample %d"},
+    {81, "capture %P sample %|packet|flow %d"},
+    {-1, NULL}
+};
+
+static const char *capture_help[] = {
+    "",
+    "capture <portlist> mode memory|disk|ring",
+    "                                       - Capture into memory until full and write the file",
+    "                                         when disabled, write to the file while enabled, or",
+    "                                         record continuously and write the trigger window",
+    "capture <portlist> direct on|off       - Write disk captures with O_DIRECT",
+    "capture <portlist> show                - Show the capture settings and capture counters",
+    "                                         'enable <portlist> capture' starts a capture",
+    "capture <portlist> disk <MB>           - Block memory of each RX queue for disk captures,",
+    "                                         0 is 128 MB, at least 4 MB",
+    "capture <portlist> ring <MB> <pre-ms> <post-ms>",
+    "                                       - Ring memory, 0 is 1024 MB, and the window kept",
+    "                                         before and after the trigger",
+    "capture <portlist> trigger latency <us> - Freeze the ring on a latency above <us>, 0 is off",
+    "capture <portlist> trigger gap|errors on|off",
+    "                                       - Freeze the ring on a latency sequence gap or when",
+    "                                         the RX error or missed counters grow",
+    "capture <portlist> freeze              - Freeze the ring now",
+    "capture <portlist> snaplen <bytes>     - Capture the first <bytes> of each packet, 0 is off",
+    "capture <portlist> sample [packet|flow] <N>",
+    "                                       - Capture 1 in <N> packets of each RX queue or the",
+    "                                         packets of 1 in <N> flows, 0 or 1 captures all",
+    CLI_HELP_PAUSE,
+    NULL
+};
+// clang-format on
+
+static int
+capture_cmd(int argc, char **argv)
+{
+    struct cli_map *m;
+    portlist_t portlist;
+    int ret = 0;
+
+    m = cli_mapping(capture_map, argc, argv);
+    if (!m)
+        return cli_cmd_error("Capture invalid command", "Capture", argc, argv);
+
+    portlist_parse(argv[1], pktgen.nb_ports, &portlist);
+
+    switch (m->index) {
+    case 10:
+        foreach_port(portlist, ret |= pktgen_capture_mode(pinfo, argv[3]));
+        break;
+    case 20:
+        foreach_port(portlist, pktgen_capture_direct(pinfo, estate(argv[3])));
+        break;
+    case 30:
+        foreach_port(portlist, pktgen_capture_show(pinfo));
+        return 0;
+    case 40:
+        foreach_port(portlist, pktgen_capture_ring_set(pinfo, atoi(argv[3]), atoi(argv[4]),
+                                                       atoi(argv[5])));
+        break;
+    case 45:
+        foreach_port(portlist, ret |= pktgen_capture_disk_set(pinfo, atoi(argv[3])));
+        break;
+    case 50:
+        foreach_port(portlist,
+                     ret |= pktgen_capture_ring_trigger(pinfo, argv[3], atoi(argv[4])));
+        break;
+    case 51:
+        foreach_port(portlist,
+                     ret |= pktgen_capture_ring_trigger(pinfo, argv[3], estate(argv[4])));
+        break;
+    case 60:
+        foreach_port(portlist, pktgen_capture_trigger(pinfo, CAP_TRIG_CLI));
+        break;
+    case 70:
+        foreach_port(portlist, pktgen_capture_snaplen(pinfo, atoi(argv[3])));
+        break;
+    case 80:
+        foreach_port(portlist, ret |= pktgen_capture_sample(pinfo, "packet", atoi(argv[3])));
+        break;
+    case 81:
+        foreach_port(portlist, ret |= pktgen_capture_sample(pinfo, argv[3], atoi(argv[4])));
+        break;
+    default:
+        return cli_cmd_error("Capture invalid command", "Capture", argc, argv);
+    }
+    if (ret)
+        return cli_cmd_error("Capture command failed", "Capture", argc, argv);
+
+    pktgen_update_display();
+    return 0;
+}
+
+// clang-format off
+static struct cli_map signature_map[] = {
+    {10, "signature %P show"},
+    {-1, NULL}
+};
+
+static const char *signature_help[] = {
+    "",
+    "signature <portlist> show              - Show the signed packets sent by each TX queue and",
+    "                                         the lost, reordered, duplicate and late packets of",
+    "                                         each stream received, 'enable <portlist> signature'",
+    "                                         signs the packets sent and analyzes those received",
+    CLI_HELP_PAUSE,
+    NULL
+};
+// clang-format on
+
+static int
+signature_cmd(int argc, char **argv)
+{
+    struct cli_map *m;
+    portlist_t portlist;
+
+    m = cli_mapping(signature_map, argc, argv);
+    if (!m)
+        return cli_cmd_error("Signature invalid command", "Signature", argc, argv);
+
+    portlist_parse(argv[1], pktgen.nb_ports, &portlist);
+
+    switch (m->index) {
+    case 10:
+        foreach_port(portlist, pktgen_sig_show(pinfo));
+        break;
+    default:
+        return cli_cmd_error("Signature invalid command", "Signature", argc, argv);
+    }
+
+    return 0;
+}
+
 // clang-format off
 static struct cli_map hmap_map[] = {
     {10, "hmap list"},
@@ -2114,6 +2551,10 @@ static struct cli_tree default_tree[] = {
     c_cmd("bonding", bonding_cmd, "Bonding commands"),
 #endif
     c_cmd("latency", latency_cmd, "Latency setup commands"),
+    c_cmd("rate", rate_cmd, "TX rate profile and arrival model commands"),
+    c_cmd("stream", stream_cmd, "TX stream commands"),
+    c_cmd("capture", capture_cmd, "RX capture commands"),
+    c_cmd("signature", signature_cmd, "Payload signature commands"),
     c_cmd("hmap", hmap_cmd, "hashmap commands"),
 
     c_alias("on", "enable screen", "Enable screen updates"),
@@ -2146,6 +2587,10 @@ init_tree(void)
     cli_help_add("Theme", theme_map, theme_help);
     cli_help_add("Plugin", plugin_map, plugin_help);
     cli_help_add("Latency", latency_map, latency_help);
+    cli_help_add("Rate", rate_map, rate_help);
+    cli_help_add("Stream", stream_map, stream_help);
+    cli_help_add("Capture", capture_map, capture_help);
+    cli_help_add("Signature", signature_map, signature_help);
     cli_help_add("Hashmap", hmap_map, hmap_help);
 #if defined(RTE_LIBRTE_PMD_BOND) || defined(RTE_NET_BOND)
     cli_help_add("Bonding", bonding_map, bonding_help);
@@ -117,35 +117,46 @@ parse_cores(uint16_t pid, const char *cores, int mode)
 
     do {
         l2p_lport_t *lport;
+        l2p_work_t *work;
         int32_t sid = pg_eth_dev_socket_id(port->pid);
 
+        if (l < 0 || l >= RTE_MAX_LCORE)
+            rte_exit(EXIT_FAILURE, "Invalid lcore %d in mapping '%s'\n", l, cores);
+
         lport = l2p->lports[l];
         if (lport == NULL) {
             snprintf(name, sizeof(name) - 1, "lport-%u:%u", l, port->pid);
             lport = rte_zmalloc_socket(name, sizeof(l2p_lport_t), RTE_CACHE_LINE_SIZE, sid);
             if (!lport)
                 rte_exit(EXIT_FAILURE, "Failed to allocate memory for lport info\n");
-            lport->lid = l;
+            lport->lid  = l;
+            lport->port = port;
 
             l2p->lports[l] = lport;
-        } else
-            printf("Err: lcore %u already in use\n", l);
+        }
+
+        /* An lcore mapped more then once polls each port/queue pair in turn */
+        if (lport->num_work >= MAX_LCORE_WORK)
+            rte_exit(EXIT_FAILURE, "Too many port/queue mappings for lcore %u (max %u)\n", l,
+                     (unsigned)MAX_LCORE_WORK);
+        work = &lport->work[lport->num_work++];
 
         num_cores++;
-        lport->port = port;
-        lport->mode = mode;
+        work->port = port;
+        work->mode = mode;
+        lport->mode |= mode;
         switch (mode) {
         case LCORE_MODE_RX:
             if (port->num_rx_qids >= MAX_QUEUES_PER_PORT)
                 rte_exit(EXIT_FAILURE, "Too many RX queues for port %u (max %u)\n", port->pid,
                          (unsigned)MAX_QUEUES_PER_PORT);
-            lport->rx_qid = port->num_rx_qids++;
+            work->rx_qid = port->num_rx_qids++;
             break;
         case LCORE_MODE_TX:
             if (port->num_tx_qids >= MAX_QUEUES_PER_PORT)
                 rte_exit(EXIT_FAILURE, "Too many TX queues for port %u (max %u)\n", port->pid,
                          (unsigned)MAX_QUEUES_PER_PORT);
-            lport->tx_qid = port->num_tx_qids++;
+            work->tx_qid = port->num_tx_qids++;
             break;
         case LCORE_MODE_BOTH:
             if (port->num_rx_qids >= MAX_QUEUES_PER_PORT)
@@ -154,8 +165,8 @@ parse_cores(uint16_t pid, const char *cores, int mode)
             if (port->num_tx_qids >= MAX_QUEUES_PER_PORT)
                 rte_exit(EXIT_FAILURE, "Too many TX queues for port %u (max %u)\n", port->pid,
                          (unsigned)MAX_QUEUES_PER_PORT);
-            lport->rx_qid = port->num_rx_qids++;
-            lport->tx_qid = port->num_tx_qids++;
+            work->rx_qid = port->num_rx_qids++;
+            work->tx_qid = port->num_tx_qids++;
             break;
         default:
             rte_exit(EXIT_FAILURE, "invalid port mode\n");
@@ -163,7 +174,7 @@ parse_cores(uint16_t pid, const char *cores, int mode)
         }
 
         if (mode == LCORE_MODE_RX || mode == LCORE_MODE_BOTH) {
-            const uint16_t qid = lport->rx_qid;
+            const uint16_t qid = work->rx_qid;
             if (port->rx_mp[qid] == NULL) {
                 /* Create the Rx mbuf pool one per port/queue */
                 port->rx_mp[qid] =
@@ -175,7 +186,7 @@ parse_cores(uint16_t pid, const char *cores, int mode)
         }
 
         if (mode == LCORE_MODE_TX || mode == LCORE_MODE_BOTH) {
-            const uint16_t qid = lport->tx_qid;
+            const uint16_t qid = work->tx_qid;
             if (port->tx_mp[qid] == NULL) {
                 port->tx_mp[qid] =
                     l2p_pktmbuf_create("TX", port, qid, mbuf_count, MEMPOOL_CACHE_SIZE);
@@ -196,6 +207,37 @@ parse_cores(uint16_t pid, const char *cores, int mode)
     return num_cores;
 }
 
+static int
+parse_ports(const char *ports, uint8_t *pids)
+{
+    char *port_map = NULL, *lists[RTE_MAX_ETHPORTS] = {0}, *range[3] = {0};
+    int num_lists, num_ports = 0;
+
+    port_map = alloca(MAX_ALLOCA_SIZE);
+    if (!port_map)
+        return -1;
+    snprintf(port_map, MAX_ALLOCA_SIZE - 1, "%s", ports);
+
+    /* <port-list> := <num> | <num> "-" <num> { "/" <port-list> } */
+    num_lists = rte_strsplit(port_map, strlen(port_map), lists, RTE_DIM(lists), '/');
+    for (int i = 0; i < num_lists; i++) {
+        int num_range, l, h;
+
+        num_range = rte_strsplit(lists[i], strlen(lists[i]), range, RTE_DIM(range), '-');
+        if (num_range <= 0 || num_range > 2)
+            return -1;
+        l = strtol(range[0], NULL, 10);
+        h = (num_range == 1) ? l : strtol(range[1], NULL, 10);
+        if (l < 0 || h < l || h >= RTE_MAX_ETHPORTS)
+            return -1;
+
+        for (; l <= h; l++, num_ports++)
+            pids[l] = 1;
+    }
+
+    return num_ports;
+}
+
 static int
 parse_mapping(const char *map)
 {
@@ -203,7 +245,7 @@ parse_mapping(const char *map)
     char *fields[3] = {0}, *f0, *f1, *lcores[3] = {0}, *c0, *c1;
     char *mapping = NULL;
     int num_fields, num_cores, num_lcores;
-    uint16_t pid;
+    uint8_t pids[RTE_MAX_ETHPORTS] = {0};
 
     if (!map || strlen(map) == 0) {
         printf("no mapping specified or string empty\n");
@@ -230,15 +272,12 @@ parse_mapping(const char *map)
     f1 = pg_strtrimset(f1, "[]");
     f1 = pg_strtrimset(f1, "{}");
 
-    pid = strtol(f1, NULL, 10);
-    if (pid >= RTE_MAX_ETHPORTS) {
+    /* The port is a single port or a list of ports sharing the same lcores */
+    if (parse_ports(f1, pids) <= 0) {
         printf("Invalid port number '%s'\n", f1);
         goto leave;
     }
 
-    l2p->ports[pid].pid = pid;
-    l2p->num_ports++;
-
     num_lcores = rte_strsplit(f0, strlen(f0), lcores, RTE_DIM(lcores), ':');
     if (num_lcores <= 0 || num_lcores > 2) {
         printf("Invalid mapping format '%s'\n", fields[0]);
@@ -251,23 +290,33 @@ parse_mapping(const char *map)
     c1 = pg_strtrimset(c1, "[]");
     c1 = pg_strtrimset(c1, "{}");
 
-    if (num_lcores == 1) {
-        num_cores = parse_cores(pid, c0, LCORE_MODE_BOTH);
-        if (num_cores <= 0) {
-            printf("Invalid mapping format '%s'\n", c0);
-            goto leave;
-        }
-    } else {
-        num_cores = parse_cores(pid, c0, LCORE_MODE_RX);
-        if (num_cores <= 0) {
-            printf("Invalid mapping format '%s'\n", c0);
-            goto leave;
+    for (uint16_t pid = 0; pid < RTE_MAX_ETHPORTS; pid++) {
+        if (!pids[pid])
+            continue;
+
+        if (l2p->ports[pid].pid != pid) {
+            l2p->ports[pid].pid = pid;
+            l2p->num_ports++;
         }
 
-        num_cores = parse_cores(pid, c1, LCORE_MODE_TX);
-        if (num_cores <= 0) {
-            printf("Invalid mapping format '%s'\n", c1);
-            goto leave;
+        if (num_lcores == 1) {
+            num_cores = parse_cores(pid, c0, LCORE_MODE_BOTH);
+            if (num_cores <= 0) {
+                printf("Invalid mapping format '%s'\n", c0);
+                goto leave;
+            }
+        } else {
+            num_cores = parse_cores(pid, c0, LCORE_MODE_RX);
+            if (num_cores <= 0) {
+                printf("Invalid mapping format '%s'\n", c0);
+                goto leave;
+            }
+
+            num_cores = parse_cores(pid, c1, LCORE_MODE_TX);
+            if (num_cores <= 0) {
+                printf("Invalid mapping format '%s'\n", c1);
+                goto leave;
+            }
         }
     }
     return 0;
@@ -286,7 +335,8 @@ leave:
  *      <matrix-string> := """ <lcore-port> { "," <lcore-port>} """
  *		<lcore-port>	:= <lcore-list> "." <port>
  *		<lcore-list>	:= "[" <rx-list> ":" <tx-list> "]"
- *		<port>      	:= <num>
+ *		<port>      	:= <num> | "[" <port-list> "]"
+ *		<port-list>		:= (<num> | <num> "-" <num>) { "/" <port-list> }
  *		<rx-list>		:= <num> { "/" (<num> | <list>) }
  *		<tx-list>		:= <num> { "/" (<num> | <list>) }
  *		<list>			:= <num>           { "/" (<range> | <list>) }
@@ -294,8 +344,9 @@ leave:
  *		<num>			:= <digit>+
  *		<digit>			:= 0 | 1 | 2 | 3 | 4 | 5 | 6 | 7 | 8 | 9
  *
- * BTW: A single lcore can only handle a single port/queue, which means
- *      you can not have a single core processing more then one network device or port.
+ * BTW: A lcore handles one port/queue pair per mapping. A lcore given in more then
+ *      one mapping, or mapped to a range of ports, polls each of its port/queue pairs
+ *      in turn and paces the TX of each pair on its own.
  *
  *	1.0, 2.1, 3.2                   - core 1 handles port 0 rx/tx,
  *					  core 2 handles port 1 rx/tx
@@ -309,6 +360,9 @@ leave:
  *					  core 4,5 handles port 1 rx & core 6 handles port 1 tx
  *	[1-2:3-5].0, [4-5:6/8].1, ...	- core 1,2 handles port 0 rx, core 3,4,5 handles port 0 tx
  *					  core 4,5 handles port 1 rx & core 6,8 handles port 1 tx
+ *	2.[0-3], 3.[4-7]		- core 2 handles ports 0-3 rx/tx,
+ *					  core 3 handles ports 4-7 rx/tx
+ *	[2:3].[0-3/6]			- core 2 handles ports 0-3,6 rx, core 3 handles them tx
  *	BTW: you can use "{}" instead of "[]" as it does not matter to the syntax.
  *
  * RETURNS: N/A
@@ -44,6 +44,7 @@ extern "C" {
 enum { LCORE_MODE_UNKNOWN = 0, LCORE_MODE_RX = 1, LCORE_MODE_TX = 2, LCORE_MODE_BOTH = 3 };
 
 #define MAX_MAPPINGS       32   /**< Maximum number of port/queue mappings */
+#define MAX_LCORE_WORK     16   /**< Maximum number of port/queue work items per lcore */
 #define MAX_ALLOCA_SIZE    1024 /**< Maximum size of a stack allocation */
 #define MEMPOOL_CACHE_SIZE (RTE_MEMPOOL_CACHE_MAX_SIZE / 2) /**< Per-lcore mempool cache size */
 
@@ -64,14 +65,28 @@ typedef struct l2p_port_s {
 } l2p_port_t;
 
 /**
- * Per-lcore L2P state: mode, queue IDs, and a pointer to the owning port.
+ * One port/queue pair served by an lcore.
+ *
+ * Every RX and TX queue is owned by exactly one work item, so an lcore polling
+ * several items never shares a queue with another lcore and needs no locking.
  */
-typedef struct l2p_lport_s {
+typedef struct l2p_work_s {
     uint16_t mode;    /**< LCORE_MODE_RX, LCORE_MODE_TX, or LCORE_MODE_BOTH */
-    uint16_t lid;     /**< Lcore ID */
-    uint16_t rx_qid;  /**< RX queue ID assigned to this lcore */
-    uint16_t tx_qid;  /**< TX queue ID assigned to this lcore */
-    l2p_port_t *port; /**< Pointer to the owning port structure */
+    uint16_t rx_qid;  /**< RX queue ID served by this item */
+    uint16_t tx_qid;  /**< TX queue ID served by this item */
+    l2p_port_t *port; /**< Pointer to the port structure */
+} l2p_work_t;
+
+/**
+ * Per-lcore L2P state: mode and the list of port/queue work items.
+ */
+typedef struct l2p_lport_s {
+    uint16_t mode;                    /**< Union of the LCORE_MODE_* of all work items */
+    uint16_t lid;                     /**< Lcore ID */
+    uint16_t num_work;                /**< Number of work items in work[] */
+    uint16_t cur;                     /**< Index of the work item being served */
+    l2p_port_t *port;                 /**< Port of the first work item */
+    l2p_work_t work[MAX_LCORE_WORK]; /**< Port/queue pairs served by this lcore */
 } l2p_lport_t;
 
 /**
@@ -144,7 +159,7 @@ l2p_get_port_cnt(void)
 /**
  * Return the lcore ID associated with a port.
  *
- * Scans the lport table and returns the first lcore mapped to @p pid.
+ * Scans the work items of every lcore and returns the first lcore serving @p pid.
  *
  * @param pid
  *   Port ID to search for.
@@ -154,20 +169,54 @@ l2p_get_port_cnt(void)
 static __inline__ uint16_t
 l2p_get_lcore_by_pid(uint16_t pid)
 {
-    l2p_t *l2p   = l2p_get();
-    uint16_t lid = RTE_MAX_LCORE;
+    l2p_t *l2p = l2p_get();
 
     for (uint16_t i = 0; i < RTE_MAX_LCORE; i++) {
-        if (l2p->lports[i] && l2p->lports[i]->port->pid == pid) {
-            lid = l2p->lports[i]->lid;
-            break;
-        }
+        l2p_lport_t *lport = l2p->lports[i];
+
+        if (lport == NULL)
+            continue;
+        for (uint16_t w = 0; w < lport->num_work; w++)
+            if (lport->work[w].port->pid == pid)
+                return lport->lid;
     }
-    return lid;
+    return RTE_MAX_LCORE;
 }
 
 /**
- * Return the port ID assigned to a given lcore.
+ * Return the per-lcore L2P state.
+ *
+ * @param lid
+ *   Lcore ID to look up.
+ * @return
+ *   Pointer to the l2p_lport_t, or NULL if @p lid has no work assigned.
+ */
+static __inline__ l2p_lport_t *
+l2p_get_lport(uint16_t lid)
+{
+    l2p_t *l2p = l2p_get();
+
+    return (lid < RTE_MAX_LCORE) ? l2p->lports[lid] : NULL;
+}
+
+/**
+ * Return the number of port/queue work items assigned to an lcore.
+ *
+ * @param lid
+ *   Lcore ID to query.
+ * @return
+ *   Number of work items, 0 if @p lid has no work assigned.
+ */
+static __inline__ uint16_t
+l2p_get_work_cnt(uint16_t lid)
+{
+    l2p_lport_t *lport = l2p_get_lport(lid);
+
+    return (lport == NULL) ? 0 : lport->num_work;
+}
+
+/**
+ * Return the port ID of the first work item assigned to a given lcore.
  *
  * @param lid
  *   Lcore ID to look up.
@@ -273,7 +322,7 @@ l2p_get_type(uint16_t lid)
 {
     l2p_t *l2p = l2p_get();
 
-    if (lid >= RTE_MAX_LCORE)
+    if (lid >= RTE_MAX_LCORE || l2p->lports[lid] == NULL)
         L2P_ERR_RET("Invalid lcore ID %u", lid);
 
     return l2p->lports[lid]->mode;
@@ -318,7 +367,7 @@ l2p_set_port_pinfo(uint16_t pid, struct port_info_s *pinfo)
 }
 
 /**
- * Return the port_info_t for the port assigned to a given lcore.
+ * Return the port_info_t for the work item a given lcore is serving.
  *
  * @param lid
  *   Lcore ID to look up.
@@ -328,11 +377,11 @@ l2p_set_port_pinfo(uint16_t pid, struct port_info_s *pinfo)
 static __inline__ struct port_info_s *
 l2p_get_pinfo_by_lcore(uint16_t lid)
 {
-    l2p_t *l2p = l2p_get();
+    l2p_lport_t *lport = l2p_get_lport(lid);
     l2p_port_t *port;
 
-    if (lid >= RTE_MAX_LCORE || l2p->lports[lid]->lid >= RTE_MAX_LCORE ||
-        (port = l2p->lports[lid]->port) == NULL)
+    if (lport == NULL || lport->lid >= RTE_MAX_LCORE ||
+        (port = lport->work[lport->cur].port) == NULL)
         L2P_NULL_RET("Invalid lcore ID %u", lid);
 
     return port->pinfo;
@@ -351,11 +400,11 @@ l2p_get_pinfo_by_lcore(uint16_t lid)
 static __inline__ int
 l2p_set_pinfo_by_lcore(uint16_t lid, struct port_info_s *pinfo)
 {
-    l2p_t *l2p = l2p_get();
+    l2p_lport_t *lport = l2p_get_lport(lid);
     l2p_port_t *port;
 
-    if (lid >= RTE_MAX_LCORE || l2p->lports[lid]->lid >= RTE_MAX_LCORE ||
-        (port = l2p->lports[lid]->port) == NULL)
+    if (lport == NULL || lport->lid >= RTE_MAX_LCORE ||
+        (port = lport->work[lport->cur].port) == NULL)
         L2P_ERR_RET("Invalid lcore ID %u", lid);
 
     port->pinfo = pinfo;
@@ -427,7 +476,7 @@ l2p_get_txcnt(uint16_t pid)
 }
 
 /**
- * Return the RX queue ID assigned to a given lcore.
+ * Return the RX queue ID of the work item a given lcore is serving.
  *
  * @param lid
  *   Lcore ID to query.
@@ -440,12 +489,12 @@ l2p_get_rxqid(uint16_t lid)
     l2p_t *l2p = l2p_get();
 
     if (lid < RTE_MAX_LCORE && l2p->lports[lid] != NULL && l2p->lports[lid]->port != NULL)
-        return l2p->lports[lid]->rx_qid;
+        return l2p->lports[lid]->work[l2p->lports[lid]->cur].rx_qid;
     return 0;
 }
 
 /**
- * Return the TX queue ID assigned to a given lcore.
+ * Return the TX queue ID of the work item a given lcore is serving.
  *
  * @param lid
  *   Lcore ID to query.
@@ -458,7 +507,7 @@ l2p_get_txqid(uint16_t lid)
     l2p_t *l2p = l2p_get();
 
     if (lid < RTE_MAX_LCORE && l2p->lports[lid] != NULL && l2p->lports[lid]->port != NULL)
-        return l2p->lports[lid]->tx_qid;
+        return l2p->lports[lid]->work[l2p->lports[lid]->cur].tx_qid;
     return 0;
 }
 
@@ -155,7 +155,139 @@ setf_qstats(lua_State *L, const qstats_t *qs)
 {
     setf_integer(L, "ipackets", qs->q_ipackets);
     setf_integer(L, "opackets", qs->q_opackets);
+    setf_integer(L, "ibytes", qs->q_ibytes);
+    setf_integer(L, "obytes", qs->q_obytes);
+    setf_integer(L, "tx_drops", qs->q_tx_drops);
+    setf_integer(L, "no_txmbufs", qs->q_no_txmbufs);
     setf_integer(L, "errors", qs->q_errors);
+    setf_integer(L, "tx_pps", qs->q_tx_pps);
+    setf_integer(L, "tx_req_pps", qs->q_tx_req_pps);
+    setf_integer(L, "filter_packets", qs->q_fpackets);
+    setf_integer(L, "filter_bytes", qs->q_fbytes);
+}
+
+static __inline__ void
+setf_latency(lua_State *L, port_info_t *pinfo)
+{
+    const latency_t *lat = &pinfo->latency;
+    double us_per_cycle  = 1000000.0 / (double)pktgen_get_timer_hz();
+    uint16_t nq;
+
+    setf_integer(L, "rate_us", lat->latency_rate_us);
+    setf_integer(L, "entropy", lat->latency_entropy);
+    setf_integer(L, "probes_per_burst", lat->probes_per_burst);
+    setf_string(L, "timestamp",
+                (lat->hw_tstamp && pinfo->hw_tstamp.rx_enabled) ? "hw" : "sw");
+    setf_integer(L, "num_pkts", lat->num_latency_pkts);
+    setf_integer(L, "num_tx_pkts", lat->num_latency_tx_pkts);
+    setf_integer(L, "num_skipped", lat->num_skipped);
+    setf_integer(L, "min_cycles", lat->min_cycles);
+    setf_integer(L, "avg_cycles", lat->avg_cycles);
+    setf_integer(L, "max_cycles", lat->max_cycles);
+    setf_number(L, "min_us", (double)lat->min_cycles * us_per_cycle);
+    setf_number(L, "avg_us", (double)lat->avg_cycles * us_per_cycle);
+    setf_number(L, "max_us", (double)lat->max_cycles * us_per_cycle);
+    setf_integer(L, "jitter_threshold_us", lat->jitter_threshold_us);
+    setf_integer(L, "jitter_count", lat->jitter_count);
+
+    /* Percentiles in micro-seconds keyed by name, e.g. t.percentiles.run["p99.9"] */
+    lua_newtable(L);
+    for (int h = 0; h < 2; h++) {
+        const lat_hist_t *hist = (h == 0) ? &lat->run_hist : &lat->int_hist;
+
+        lua_newtable(L);
+        for (int i = 0; i < pktgen.nb_lat_percentiles; i++) {
+            char name[32];
+
+            snprintf(name, sizeof(name), "p%g", pktgen.lat_percentiles[i]);
+            setf_number(L, name,
+                        (double)lat_hist_percentile(hist, pktgen.lat_percentiles[i]) *
+                            us_per_cycle);
+        }
+        lua_setfield(L, -2, (h == 0) ? "run" : "interval");
+    }
+    lua_setfield(L, -2, "percentiles");
+    setf_number(L, "interval_us", (double)lat->int_cycles * us_per_cycle);
+
+    /* Per queue values, to compare the RSS paths and the TX queues */
+    lua_newtable(L);
+    nq = RTE_MIN(l2p_get_rxcnt(pinfo->pid), MAX_QUEUES_PER_PORT);
+    for (uint16_t q = 0; q < nq; q++) {
+        static const rx_latency_t cleared;
+        const rx_latency_t *rxl = &pinfo->rx_latency[q];
+        uint64_t n;
+
+        /* A queue not reset by its lcore since the last clear counts nothing */
+        if (rxl->gen != pinfo->lat_clear_gen)
+            rxl = &cleared;
+        n = rxl->num_latency_pkts;
+
+        lua_pushinteger(L, q);
+        lua_newtable(L);
+        setf_integer(L, "num_pkts", n);
+        setf_integer(L, "num_skipped", rxl->num_skipped);
+        setf_number(L, "min_us", (double)rxl->min_cycles * us_per_cycle);
+        setf_number(L, "avg_us", (n) ? ((double)rxl->running_cycles / n) * us_per_cycle : 0.0);
+        setf_number(L, "max_us", (double)rxl->max_cycles * us_per_cycle);
+        lua_rawset(L, -3);
+    }
+    lua_setfield(L, -2, "rxq");
+
+    lua_newtable(L);
+    nq = RTE_MIN(l2p_get_txcnt(pinfo->pid), MAX_QUEUES_PER_PORT);
+    for (uint16_t q = 0; q < nq; q++) {
+        const tx_latency_t *txl = &pinfo->tx_latency[q];
+        bool cur                = (txl->gen == pinfo->lat_clear_gen);
+
+        lua_pushinteger(L, q);
+        lua_newtable(L);
+        setf_integer(L, "num_tx_pkts", cur ? txl->num_tx_pkts : 0);
+        setf_integer(L, "no_mbufs", cur ? txl->no_mbufs : 0);
+        lua_rawset(L, -3);
+    }
+    lua_setfield(L, -2, "txq");
+}
+
+static __inline__ void
+setf_sig_stats(lua_State *L, const sig_stats_t *st)
+{
+    setf_integer(L, "packets", st->pkts);
+    setf_integer(L, "lost", st->lost);
+    setf_integer(L, "reordered", st->reordered);
+    setf_integer(L, "max_reorder", st->max_reorder);
+    setf_integer(L, "duplicates", st->duplicates);
+    setf_integer(L, "late", st->late);
+    setf_integer(L, "rx_queues", st->rx_queues);
+}
+
+static __inline__ void
+setf_signature(lua_State *L, port_info_t *pinfo)
+{
+    sig_stats_t total, streams[SIG_STREAMS];
+    uint16_t nb   = pktgen_sig_stats(pinfo, &total, streams);
+    uint64_t sent = 0, unsigned_pkts = 0;
+
+    for (uint16_t q = 0; q < RTE_MIN(l2p_get_txcnt(pinfo->pid), MAX_QUEUES_PER_PORT); q++) {
+        uint64_t n, too_short;
+
+        pktgen_sig_tx_stats(pinfo, q, &n, &too_short);
+        sent += n;
+        unsigned_pkts += too_short;
+    }
+    setf_string(L, "state", pktgen_tst_port_flags(pinfo, SIGNATURE_PKTS) ? "enabled" : "disabled");
+    setf_integer(L, "tx_signed", sent);
+    setf_integer(L, "tx_unsigned", unsigned_pkts);
+    setf_sig_stats(L, &total);
+
+    /* Streams keyed by their number, sending port * 32 + TX queue */
+    lua_newtable(L);
+    for (uint16_t i = 0; i < nb; i++) {
+        lua_pushinteger(L, streams[i].stream);
+        lua_newtable(L);
+        setf_sig_stats(L, &streams[i]);
+        lua_rawset(L, -3);
+    }
+    lua_setfield(L, -2, "streams");
 }
 
 static void
@@ -186,7 +318,7 @@ push_port_stats_t(lua_State *L, const port_stats_t *ps, uint16_t rxq_cnt)
     for (uint16_t qid = 0; qid < rxq_cnt; qid++) {
         lua_pushinteger(L, qid);
         lua_newtable(L);
-        setf_qstats(L, &ps->qstats[qid]);
+        setf_qstats(L, &ps->snap_qstats[qid]);
         lua_rawset(L, -3);
     }
     lua_setfield(L, -2, "qstats");
@@ -932,6 +1064,120 @@ pktgen_pcap(lua_State *L)
     return 0;
 }
 
+/**
+ *
+ * pktgen_pcap_replay_timing - Replay the PCAP file of ports at its capture times.
+ *
+ * DESCRIPTION
+ * pcap_timing(portlist, "on"|"off"[, speed]), speed is a multiplier of the
+ * capture times or "top" to send the file as fast as the port can.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+
+static int
+pktgen_pcap_replay_timing(lua_State *L)
+{
+    portlist_t portlist;
+    const char *what;
+    double speed = 0.0;
+    int n        = lua_gettop(L);
+    int ret      = 0;
+
+    if (n < 2 || n > 3)
+        return luaL_error(L, "pcap_timing, wrong number of arguments");
+
+    portlist = pktgen_get_portlist(L, 1);
+    if (portlist == INVALID_PORTLIST)
+        return luaL_error(L, "invalid portlist");
+    what = luaL_checkstring(L, 2);
+
+    if (n == 3) {
+        if (lua_type(L, 3) == LUA_TSTRING && !strcmp(lua_tostring(L, 3), "top"))
+            speed = 0.0;
+        else
+            speed = luaL_checknumber(L, 3);
+        foreach_port(portlist, ret |= pktgen_pcap_speed(pinfo, speed));
+    }
+    foreach_port(portlist, ret |= pktgen_pcap_timing(pinfo, estate(what)));
+
+    if (ret)
+        return luaL_error(L, "pcap_timing, %s failed", what);
+
+    pktgen_update_display();
+    return 0;
+}
+
+/**
+ *
+ * pktgen_pcap_fmt - Set the format of the capture and TX pcap files of ports.
+ *
+ * DESCRIPTION
+ * pcap_format(portlist, "pcap"|"nsec"|"pcapng").
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+
+static int
+pktgen_pcap_fmt(lua_State *L)
+{
+    portlist_t portlist;
+    const char *fmt;
+    int ret = 0;
+
+    if (lua_gettop(L) != 2)
+        return luaL_error(L, "pcap_format, wrong number of arguments");
+
+    portlist = pktgen_get_portlist(L, 1);
+    if (portlist == INVALID_PORTLIST)
+        return luaL_error(L, "invalid portlist");
+    fmt = luaL_checkstring(L, 2);
+
+    foreach_port(portlist, ret |= pktgen_pcap_format(pinfo, fmt));
+    if (ret)
+        return luaL_error(L, "pcap_format, unknown format %s", fmt);
+
+    return 0;
+}
+
+/**
+ *
+ * pktgen_pcap_rx_filter - Set the RX filter of ports from a PCAP filter string.
+ *
+ * DESCRIPTION
+ * pcap_filter(portlist, "filter string"|"off").
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+
+static int
+pktgen_pcap_rx_filter(lua_State *L)
+{
+    portlist_t portlist;
+    char *expr;
+    int ret = 0;
+
+    if (lua_gettop(L) != 2)
+        return luaL_error(L, "pcap_filter, wrong number of arguments");
+
+    portlist = pktgen_get_portlist(L, 1);
+    if (portlist == INVALID_PORTLIST)
+        return luaL_error(L, "invalid portlist");
+    expr = (char *)luaL_checkstring(L, 2);
+
+    foreach_port(portlist, ret |= pcap_filter(pinfo, expr));
+    if (ret)
+        return luaL_error(L, "pcap_filter, %s failed", expr);
+
+    return 0;
+}
+
 /**
  *
  * pktgen_start - Start ports sending packets.
@@ -2571,6 +2817,36 @@ range(lua_State *L)
     return 0;
 }
 
+/**
+ *
+ * latency_percentile - Return a latency percentile for a given port.
+ *
+ * DESCRIPTION
+ * Push a table with the percentile over the whole run and the last interval,
+ * in cycles and micro-seconds, indexed by the port id.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+static void
+latency_percentile(lua_State *L, port_info_t *pinfo, double pct)
+{
+    latency_t *lat      = &pinfo->latency;
+    double us_per_cycle = 1000000.0 / (double)pktgen_get_timer_hz();
+    uint64_t run        = lat_hist_percentile(&lat->run_hist, pct);
+    uint64_t interval   = lat_hist_percentile(&lat->int_hist, pct);
+
+    lua_pushinteger(L, pinfo->pid);
+    lua_newtable(L);
+    setf_number(L, "percentile", pct);
+    setf_integer(L, "run_cycles", run);
+    setf_integer(L, "interval_cycles", interval);
+    setf_number(L, "run_us", (double)run * us_per_cycle);
+    setf_number(L, "interval_us", (double)interval * us_per_cycle);
+    lua_rawset(L, -3);
+}
+
 /**
  *
  * pktgen_latency - Enable or disable the latency testing.
@@ -2605,12 +2881,27 @@ pktgen_latency(lua_State *L)
         return luaL_error(L, "latency, missing argument or not a string");
 
     if (lua_gettop(L) == 3) {
-        if (strncasecmp(lua_tostring(L, 2), "rate", 4) == 0)
+        if (strcasecmp(what, "percentiles") == 0) {
+            if (latency_set_percentiles(luaL_checkstring(L, 3)) < 0)
+                return luaL_error(L, "latency, invalid percentile list");
+        } else if (strcasecmp(what, "percentile") == 0) {
+            double pct = luaL_checknumber(L, 3);
+
+            lua_newtable(L);
+            foreach_port(portlist, latency_percentile(L, pinfo, pct));
+            return 1;
+        } else if (strncasecmp(lua_tostring(L, 2), "rate", 4) == 0)
             foreach_port(portlist, latency_set_rate(pinfo, (uint32_t)luaL_checkinteger(L, 3)));
         else if (strncasecmp(lua_tostring(L, 2), "entropy", 7) == 0)
             foreach_port(portlist, latency_set_entropy(pinfo, (uint16_t)luaL_checkinteger(L, 3)));
+        else if (strcasecmp(what, "probes") == 0)
+            foreach_port(portlist, latency_set_probes(pinfo, (uint32_t)luaL_checkinteger(L, 3)));
+        else if (strcasecmp(what, "timestamp") == 0)
+            foreach_port(portlist,
+                         latency_set_tstamp(pinfo, !strcasecmp(luaL_checkstring(L, 3), "hw")));
         else
-            return luaL_error(L, "latency, invalid arguments must be rate or entropy");
+            return luaL_error(L, "latency, invalid arguments must be rate, entropy, probes, "
+                                 "timestamp, percentile or percentiles");
     } else if (lua_gettop(L) == 2)
         foreach_port(portlist, enable_latency(pinfo, estate((const char *)luaL_checkstring(L, 2))));
 
@@ -2618,6 +2909,43 @@ pktgen_latency(lua_State *L)
     return 0;
 }
 
+/**
+ *
+ * pktgen_signature - Enable, disable or show the payload signatures.
+ *
+ * DESCRIPTION
+ * signature(portlist, "enable"|"disable") signs the data packets sent and
+ * analyzes the signed packets received, signature(portlist, "show") prints
+ * the counters. portStats() returns them in the signature table.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+
+static int
+pktgen_signature(lua_State *L)
+{
+    portlist_t portlist;
+    const char *what;
+
+    if (lua_gettop(L) != 2)
+        return luaL_error(L, "signature, wrong number of arguments");
+
+    portlist = pktgen_get_portlist(L, 1);
+    if (portlist == INVALID_PORTLIST)
+        return luaL_error(L, "invalid portlist");
+
+    what = luaL_checkstring(L, 2);
+    if (strcasecmp(what, "show") == 0)
+        foreach_port(portlist, pktgen_sig_show(pinfo));
+    else
+        foreach_port(portlist, enable_signature(pinfo, estate(what)));
+
+    pktgen_update_display();
+    return 0;
+}
+
 /**
  *
  * pktgen_jitter - Set Jitter threshold
@@ -2833,6 +3161,250 @@ pktgen_capture(lua_State *L)
     return 0;
 }
 
+/**
+ *
+ * pktgen_capture_set_mode - Set the capture mode of ports.
+ *
+ * DESCRIPTION
+ * capture_mode(portlist, "memory"|"disk"|"ring" [, "on"|"off"]), the third argument
+ * turns O_DIRECT for disk captures on or off.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+
+static int
+pktgen_capture_set_mode(lua_State *L)
+{
+    portlist_t portlist;
+    const char *mode;
+    int n   = lua_gettop(L);
+    int ret = 0;
+
+    if (n < 2 || n > 3)
+        return luaL_error(L, "capture_mode, wrong number of arguments");
+
+    portlist = pktgen_get_portlist(L, 1);
+    if (portlist == INVALID_PORTLIST)
+        return luaL_error(L, "invalid portlist");
+    mode = luaL_checkstring(L, 2);
+
+    foreach_port(portlist, ret |= pktgen_capture_mode(pinfo, mode));
+    if (ret)
+        return luaL_error(L, "capture_mode, %s failed", mode);
+    if (n == 3)
+        foreach_port(portlist, pktgen_capture_direct(pinfo, estate(luaL_checkstring(L, 3))));
+
+    return 0;
+}
+
+/**
+ *
+ * pktgen_capture_set_disk - Set the disk capture block memory of ports.
+ *
+ * DESCRIPTION
+ * capture_disk(portlist, size_mb), the memory of each RX queue, 0 uses the default.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+
+static int
+pktgen_capture_set_disk(lua_State *L)
+{
+    portlist_t portlist;
+    uint32_t size_mb;
+    int ret = 0;
+
+    if (lua_gettop(L) != 2)
+        return luaL_error(L, "capture_disk, wrong number of arguments");
+
+    portlist = pktgen_get_portlist(L, 1);
+    if (portlist == INVALID_PORTLIST)
+        return luaL_error(L, "invalid portlist");
+    size_mb = luaL_checkinteger(L, 2);
+
+    foreach_port(portlist, ret |= pktgen_capture_disk_set(pinfo, size_mb));
+    if (ret)
+        return luaL_error(L, "capture_disk, %u MB failed", size_mb);
+
+    return 0;
+}
+
+/**
+ *
+ * pktgen_capture_set_ring - Set the flight recorder memory and window of ports.
+ *
+ * DESCRIPTION
+ * capture_ring(portlist, size_mb, pre_ms, post_ms), a size of 0 uses the default.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+
+static int
+pktgen_capture_set_ring(lua_State *L)
+{
+    portlist_t portlist;
+    uint32_t size_mb, pre_ms, post_ms;
+
+    if (lua_gettop(L) != 4)
+        return luaL_error(L, "capture_ring, wrong number of arguments");
+
+    portlist = pktgen_get_portlist(L, 1);
+    if (portlist == INVALID_PORTLIST)
+        return luaL_error(L, "invalid portlist");
+    size_mb = luaL_checkinteger(L, 2);
+    pre_ms  = luaL_checkinteger(L, 3);
+    post_ms = luaL_checkinteger(L, 4);
+
+    foreach_port(portlist, pktgen_capture_ring_set(pinfo, size_mb, pre_ms, post_ms));
+
+    return 0;
+}
+
+/**
+ *
+ * pktgen_capture_set_trigger - Set a flight recorder trigger of ports.
+ *
+ * DESCRIPTION
+ * capture_trigger(portlist, "latency", usecs) with 0 turning it off, or
+ * capture_trigger(portlist, "gap"|"errors", "on"|"off").
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+
+static int
+pktgen_capture_set_trigger(lua_State *L)
+{
+    portlist_t portlist;
+    const char *what;
+    uint32_t value;
+    int ret = 0;
+
+    if (lua_gettop(L) != 3)
+        return luaL_error(L, "capture_trigger, wrong number of arguments");
+
+    portlist = pktgen_get_portlist(L, 1);
+    if (portlist == INVALID_PORTLIST)
+        return luaL_error(L, "invalid portlist");
+    what = luaL_checkstring(L, 2);
+    if (lua_isnumber(L, 3))
+        value = luaL_checkinteger(L, 3);
+    else
+        value = estate(luaL_checkstring(L, 3));
+
+    foreach_port(portlist, ret |= pktgen_capture_ring_trigger(pinfo, what, value));
+    if (ret)
+        return luaL_error(L, "capture_trigger, %s failed", what);
+
+    return 0;
+}
+
+/**
+ *
+ * pktgen_capture_freeze - Fire the trigger of the flight recorder of ports.
+ *
+ * DESCRIPTION
+ * capture_freeze(portlist), ports without a running recorder are ignored.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+
+static int
+pktgen_capture_freeze(lua_State *L)
+{
+    portlist_t portlist;
+
+    if (lua_gettop(L) != 1)
+        return luaL_error(L, "capture_freeze, wrong number of arguments");
+
+    portlist = pktgen_get_portlist(L, 1);
+    if (portlist == INVALID_PORTLIST)
+        return luaL_error(L, "invalid portlist");
+
+    foreach_port(portlist, pktgen_capture_trigger(pinfo, CAP_TRIG_CLI));
+
+    return 0;
+}
+
+/**
+ *
+ * pktgen_capture_set_snaplen - Set the snap length of the captures of ports.
+ *
+ * DESCRIPTION
+ * capture_snaplen(portlist, bytes), 0 captures the whole first segment.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+
+static int
+pktgen_capture_set_snaplen(lua_State *L)
+{
+    portlist_t portlist;
+    uint32_t snaplen;
+
+    if (lua_gettop(L) != 2)
+        return luaL_error(L, "capture_snaplen, wrong number of arguments");
+
+    portlist = pktgen_get_portlist(L, 1);
+    if (portlist == INVALID_PORTLIST)
+        return luaL_error(L, "invalid portlist");
+    snaplen = luaL_checkinteger(L, 2);
+
+    foreach_port(portlist, pktgen_capture_snaplen(pinfo, snaplen));
+
+    return 0;
+}
+
+/**
+ *
+ * pktgen_capture_set_sample - Set the capture sampling of ports.
+ *
+ * DESCRIPTION
+ * capture_sample(portlist, N [, "packet"|"flow"]) captures 1 in N packets of
+ * each RX queue, the default, or the packets of 1 in N flows.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+
+static int
+pktgen_capture_set_sample(lua_State *L)
+{
+    portlist_t portlist;
+    const char *mode = "packet";
+    uint32_t rate;
+    int n   = lua_gettop(L);
+    int ret = 0;
+
+    if (n < 2 || n > 3)
+        return luaL_error(L, "capture_sample, wrong number of arguments");
+
+    portlist = pktgen_get_portlist(L, 1);
+    if (portlist == INVALID_PORTLIST)
+        return luaL_error(L, "invalid portlist");
+    rate = luaL_checkinteger(L, 2);
+    if (n == 3)
+        mode = luaL_checkstring(L, 3);
+
+    foreach_port(portlist, ret |= pktgen_capture_sample(pinfo, mode, rate));
+    if (ret)
+        return luaL_error(L, "capture_sample, %s failed", mode);
+
+    return 0;
+}
+
 #if defined(RTE_LIBRTE_PMD_BOND) || defined(RTE_NET_BOND)
 /**
  *
@@ -2938,6 +3510,256 @@ pktgen_latsampler(lua_State *L)
     return 0;
 }
 
+/**
+ *
+ * pktgen_rate_profile - Build and enable the TX rate profile of ports.
+ *
+ * DESCRIPTION
+ * rate_profile(portlist, action, ...) where action is one of:
+ *   "clear", "step" usec rate, "ramp" usec from to, "sine" usec mean amp period,
+ *   "load" file, "loop" on|off, "on", "off" or "show".
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+
+static int
+pktgen_rate_profile(lua_State *L)
+{
+    portlist_t portlist;
+    const char *what;
+    int n   = lua_gettop(L);
+    int ret = 0;
+
+    if (n < 2 || n > 6)
+        return luaL_error(L, "rate_profile, wrong number of arguments");
+
+    portlist = pktgen_get_portlist(L, 1);
+    if (portlist == INVALID_PORTLIST)
+        return luaL_error(L, "invalid portlist");
+
+    what = luaL_checkstring(L, 2);
+
+    if (!strcasecmp(what, "clear") && n == 2)
+        foreach_port(portlist, ret |= rate_profile_clear(pinfo));
+    else if (!strcasecmp(what, "step") && n == 4)
+        foreach_port(portlist, ret |= rate_profile_add(pinfo, RATE_SEG_STEP, luaL_checknumber(L, 3),
+                                                       luaL_checknumber(L, 4), 0.0, 0.0));
+    else if (!strcasecmp(what, "ramp") && n == 5)
+        foreach_port(portlist, ret |= rate_profile_add(pinfo, RATE_SEG_RAMP, luaL_checknumber(L, 3),
+                                                       luaL_checknumber(L, 4),
+                                                       luaL_checknumber(L, 5), 0.0));
+    else if (!strcasecmp(what, "sine") && n == 6)
+        foreach_port(portlist, ret |= rate_profile_add(pinfo, RATE_SEG_SINE, luaL_checknumber(L, 3),
+                                                       luaL_checknumber(L, 4),
+                                                       luaL_checknumber(L, 5),
+                                                       luaL_checknumber(L, 6)));
+    else if (!strcasecmp(what, "load") && n == 3)
+        foreach_port(portlist, ret |= rate_profile_load(pinfo, luaL_checkstring(L, 3)));
+    else if (!strcasecmp(what, "loop") && n == 3)
+        foreach_port(portlist, rate_profile_loop(pinfo, estate(luaL_checkstring(L, 3))));
+    else if (!strcasecmp(what, "show") && n == 2)
+        foreach_port(portlist, rate_profile_show(pinfo));
+    else if (n == 2)
+        foreach_port(portlist, ret |= rate_profile_enable(pinfo, estate(what)));
+    else
+        return luaL_error(L, "rate_profile, invalid action or number of arguments");
+
+    if (ret)
+        return luaL_error(L, "rate_profile, %s failed", what);
+
+    pktgen_update_display();
+    return 0;
+}
+
+/**
+ *
+ * pktgen_tx_arrival - Set the TX arrival model and burst lengths of ports.
+ *
+ * DESCRIPTION
+ * tx_arrival(portlist, "periodic"|"poisson"), tx_arrival(portlist, "onoff", on_us, off_us)
+ * or tx_arrival(portlist, "burst", "fixed"|"uniform"|"geometric"|"pareto", a, b).
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+
+static int
+pktgen_tx_arrival(lua_State *L)
+{
+    portlist_t portlist;
+    const char *what;
+    int n   = lua_gettop(L);
+    int ret = 0;
+
+    if (n < 2 || n > 5)
+        return luaL_error(L, "tx_arrival, wrong number of arguments");
+
+    portlist = pktgen_get_portlist(L, 1);
+    if (portlist == INVALID_PORTLIST)
+        return luaL_error(L, "invalid portlist");
+
+    what = luaL_checkstring(L, 2);
+
+    if (!strcasecmp(what, "periodic") && n == 2)
+        foreach_port(portlist, ret |= tx_arrival_set(pinfo, TX_ARRIVAL_PERIODIC, 0.0, 0.0));
+    else if (!strcasecmp(what, "poisson") && n == 2)
+        foreach_port(portlist, ret |= tx_arrival_set(pinfo, TX_ARRIVAL_POISSON, 0.0, 0.0));
+    else if (!strcasecmp(what, "onoff") && n == 4)
+        foreach_port(portlist, ret |= tx_arrival_set(pinfo, TX_ARRIVAL_ONOFF,
+                                                     luaL_checknumber(L, 3),
+                                                     luaL_checknumber(L, 4)));
+    else if (!strcasecmp(what, "burst") && n >= 3) {
+        const char *dist = luaL_checkstring(L, 3);
+        double a         = luaL_optnumber(L, 4, 0.0);
+        double b         = luaL_optnumber(L, 5, 0.0);
+        uint32_t type;
+
+        if (!strcasecmp(dist, "fixed"))
+            type = TX_BURST_FIXED;
+        else if (!strcasecmp(dist, "uniform"))
+            type = TX_BURST_UNIFORM;
+        else if (!strcasecmp(dist, "geometric"))
+            type = TX_BURST_GEOMETRIC;
+        else if (!strcasecmp(dist, "pareto"))
+            type = TX_BURST_PARETO;
+        else
+            return luaL_error(L, "tx_arrival, unknown burst distribution %s", dist);
+
+        foreach_port(portlist, ret |= tx_burst_dist_set(pinfo, type, a, b));
+    } else
+        return luaL_error(L, "tx_arrival, invalid model or number of arguments");
+
+    if (ret)
+        return luaL_error(L, "tx_arrival, %s failed", what);
+
+    pktgen_update_display();
+    return 0;
+}
+
+/**
+ *
+ * pktgen_imix - Set, enable or show the IMIX of ports.
+ *
+ * DESCRIPTION
+ * imix(portlist, "simple"|"tolly"), imix(portlist, "table"|"genome", spec),
+ * imix(portlist, "enable"|"disable") or imix(portlist, "show").
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+
+static int
+pktgen_imix(lua_State *L)
+{
+    portlist_t portlist;
+    const char *what;
+    int n   = lua_gettop(L);
+    int ret = 0;
+
+    if (n < 2 || n > 3)
+        return luaL_error(L, "imix, wrong number of arguments");
+
+    portlist = pktgen_get_portlist(L, 1);
+    if (portlist == INVALID_PORTLIST)
+        return luaL_error(L, "invalid portlist");
+
+    what = luaL_checkstring(L, 2);
+
+    if (!strcmp(what, "show") && n == 2)
+        foreach_port(portlist, pktgen_imix_show(pinfo));
+    else if ((!strcmp(what, "simple") || !strcmp(what, "tolly")) && n == 2)
+        foreach_port(portlist, ret |= pktgen_imix_set(pinfo, what, NULL));
+    else if ((!strcmp(what, "table") || !strcmp(what, "genome")) && n == 3)
+        foreach_port(portlist, ret |= pktgen_imix_set(pinfo, what, luaL_checkstring(L, 3)));
+    else if (n == 2)
+        foreach_port(portlist, enable_imix(pinfo, estate(what)));
+    else
+        return luaL_error(L, "imix, invalid type or number of arguments");
+
+    if (ret)
+        return luaL_error(L, "imix, %s failed", what);
+
+    pktgen_update_display();
+    return 0;
+}
+
+/**
+ *
+ * pktgen_stream - Set up, enable or show the TX streams of ports.
+ *
+ * DESCRIPTION
+ * stream(portlist, "show"|"clear"|"enable"|"disable"), stream(portlist, id,
+ * "on"|"off"|"copy") or stream(portlist, id, "rate"|"count"|"model", value).
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+
+static int
+pktgen_stream(lua_State *L)
+{
+    portlist_t portlist;
+    const char *what;
+    uint16_t sid;
+    int n   = lua_gettop(L);
+    int ret = 0;
+
+    if (n < 2 || n > 4)
+        return luaL_error(L, "stream, wrong number of arguments");
+
+    portlist = pktgen_get_portlist(L, 1);
+    if (portlist == INVALID_PORTLIST)
+        return luaL_error(L, "invalid portlist");
+
+    if (n == 2) {
+        what = luaL_checkstring(L, 2);
+        if (!strcmp(what, "show"))
+            foreach_port(portlist, pktgen_stream_show(pinfo));
+        else if (!strcmp(what, "clear"))
+            foreach_port(portlist, ret |= pktgen_stream_clear(pinfo));
+        else
+            foreach_port(portlist, enable_streams(pinfo, estate(what)));
+    } else {
+        sid  = luaL_checkinteger(L, 2);
+        what = luaL_checkstring(L, 3);
+
+        if (!strcmp(what, "copy") && n == 3)
+            foreach_port(portlist, ret |= pktgen_stream_copy(pinfo, sid));
+        else if (!strcmp(what, "rate") && n == 4)
+            foreach_port(portlist, ret |= pktgen_stream_rate(pinfo, sid, luaL_checknumber(L, 4)));
+        else if (!strcmp(what, "count") && n == 4)
+            foreach_port(portlist,
+                         ret |= pktgen_stream_count(pinfo, sid, luaL_checkinteger(L, 4)));
+        else if (!strcmp(what, "model") && n == 4) {
+            const char *model = luaL_checkstring(L, 4);
+            uint32_t type;
+
+            if (!strcmp(model, "periodic"))
+                type = TX_ARRIVAL_PERIODIC;
+            else if (!strcmp(model, "poisson"))
+                type = TX_ARRIVAL_POISSON;
+            else
+                return luaL_error(L, "stream, unknown model %s", model);
+
+            foreach_port(portlist, ret |= pktgen_stream_model(pinfo, sid, type));
+        } else if (n == 3)
+            foreach_port(portlist, ret |= pktgen_stream_enable(pinfo, sid, estate(what)));
+        else
+            return luaL_error(L, "stream, invalid action or number of arguments");
+    }
+
+    if (ret)
+        return luaL_error(L, "stream, %s failed", what);
+
+    pktgen_update_display();
+    return 0;
+}
+
 /**
  *
  * pktgen_blink - Enable or disable port Led blinking.
@@ -3124,6 +3946,14 @@ port_stats(lua_State *L, port_info_t *pinfo)
     rxq_cnt = l2p_get_rxcnt(pinfo->pid);
     push_port_stats_t(L, &ps, rxq_cnt);
 
+    lua_newtable(L); /* latency, merged from the RX queues by the stats timer */
+    setf_latency(L, pinfo);
+    lua_setfield(L, -2, "latency");
+
+    lua_newtable(L); /* signature analysis, merged from the RX queues */
+    setf_signature(L, pinfo);
+    lua_setfield(L, -2, "signature");
+
     /* Now set the table as an array with pid as the index. */
     lua_rawset(L, -3);
 }
@@ -3678,15 +4508,29 @@ static const char *lua_help_info[] = {
     "txtap          - Enable or disable TX Tap packet processing on a port\n",
     "latsampler_params - set latency sampler params\n",
     "latsampler     - enable or disable latency sampler\n",
+    "rate_profile   - Build, load and enable the TX rate profile of a port\n",
+    "tx_arrival     - Set the TX arrival model and burst length distribution\n",
+    "imix           - Set, enable or show the IMIX packet sizes of a port\n",
+    "stream         - Set up, enable or show the TX streams of a port\n",
+    "pcap_timing    - Replay the PCAP file at its capture times and speed\n",
+    "pcap_format    - Set the capture file format, pcap, nsec or pcapng\n",
+    "pcap_filter    - Set the PCAP filter of the packets captured and dumped\n",
     "pattern        - Set pattern type\n",
     "userPattern    - Set the user pattern string\n",
     "jitter         - Set the jitter threshold\n",
+    "signature      - Enable, disable or show the payload signatures of a port\n",
     "gtpu_teid      - Set GTP-U TEID\n",
     "\n",
     "page           - Select a page to display, seq, range, pcap and a number from 0-N\n",
     "port           - select a different port number used for sequence and range pages.\n",
     "process        - Enable or disable input packet processing on a port\n",
     "capture        - Enable or disable capture packet processing on a port\n",
+    "capture_mode   - Capture into memory, stream the capture to disk or record in a ring\n",
+    "capture_ring   - Set the flight recorder memory and trigger window\n",
+    "capture_trigger - Set a flight recorder trigger, latency, gap or errors\n",
+    "capture_freeze - Freeze the flight recorder now\n",
+    "capture_snaplen - Set the bytes captured of each packet\n",
+    "capture_sample - Capture 1 in N packets or flows\n",
     "bonding        - Enable or disable bonding support for sending zero packets\n",
     "blink          - Blink an led on a port\n",
     "help           - Return the help text\n",
@@ -3864,6 +4708,13 @@ static const luaL_Reg pktgenlib[] = {
     {"port", pktgen_port}, /* select a different port number used for sequence and range pages. */
     {"process", pktgen_process}, /* Enable or disable input packet processing on a port */
     {"capture", pktgen_capture}, /* Enable or disable capture on a port */
+    {"capture_mode", pktgen_capture_set_mode},       /* Capture to memory, disk or ring */
+    {"capture_disk", pktgen_capture_set_disk},       /* Disk capture block memory */
+    {"capture_ring", pktgen_capture_set_ring},       /* Flight recorder memory and window */
+    {"capture_trigger", pktgen_capture_set_trigger}, /* Flight recorder triggers */
+    {"capture_freeze", pktgen_capture_freeze},       /* Freeze the flight recorder */
+    {"capture_snaplen", pktgen_capture_set_snaplen}, /* Bytes captured of each packet */
+    {"capture_sample", pktgen_capture_set_sample},   /* Capture 1 in N packets or flows */
 #if defined(RTE_LIBRTE_PMD_BOND) || defined(RTE_NET_BOND)
     {"bonding", pktgen_bonding}, /* Enable or disable bonding on a port */
 #endif
@@ -3885,6 +4736,7 @@ static const luaL_Reg pktgenlib[] = {
     {"userPattern", pktgen_user_pattern}, /* Set the user pattern string */
     {"latency", pktgen_latency},          /* Enable or disable latency testing */
     {"jitter", pktgen_jitter},            /* Set the jitter threshold */
+    {"signature", pktgen_signature},      /* Sign packets and analyze the sequences */
     {"gtpu_teid", range_gtpu_teid},       /* set GTP-U TEID. */
 
     {"rnd", pktgen_rnd},           /* Set up the rnd function on a portlist */
@@ -3892,6 +4744,13 @@ static const luaL_Reg pktgenlib[] = {
 
     {"latsampler_params", pktgen_latsampler_params}, /* set latency sampler params */
     {"latsampler", pktgen_latsampler},               /* enable or disable latency sampler */
+    {"rate_profile", pktgen_rate_profile},           /* Build and enable TX rate profiles */
+    {"tx_arrival", pktgen_tx_arrival},               /* Set the TX arrival model */
+    {"imix", pktgen_imix},                           /* Set and enable IMIX packet sizes */
+    {"stream", pktgen_stream},                       /* Set up and enable TX streams */
+    {"pcap_timing", pktgen_pcap_replay_timing},      /* Timed PCAP replay */
+    {"pcap_format", pktgen_pcap_fmt},                /* Capture file format */
+    {"pcap_filter", pktgen_pcap_rx_filter},          /* RX capture filter */
 
     {"clock_gettime", pktgen_clock_gettime}, /* Enable/disable clock_gettime support */
 
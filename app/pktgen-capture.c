@@ -7,11 +7,14 @@
 
 #include "pktgen-capture.h"
 #include <time.h>
+#include <unistd.h>
 #include <sys/stat.h>
 
 #include <rte_memcpy.h>
 #include <rte_memzone.h>
 #include <rte_string_fns.h>
+#include <rte_ip.h>
+#include <rte_hash_crc.h>
 
 #ifdef LUA_ENABLED
 #include <lua_config.h>
@@ -23,6 +26,79 @@
 
 #define CAPTURE_BUFF_SIZE (4 * (1024 * 1024))
 
+/* Bytes of a record in a block of a disk capture, records start 8 byte aligned */
+#define CAP_REC_SIZE(dlen) RTE_ALIGN_CEIL(offsetof(cap_hdr_t, pkt) + (dlen), 8)
+
+/* Bytes of records a block of a disk capture holds */
+#define CAP_BLOCK_DATA (CAP_BLOCK_SIZE - sizeof(cap_block_t))
+
+/* Bytes of a record in a flight recorder buffer */
+#define CAP_RING_REC_SIZE(dlen) RTE_ALIGN_CEIL(offsetof(cap_hdr_t, pkt) + (dlen), CAP_RING_ALIGN)
+
+/* Bytes of a first segment of dlen bytes a capture with the snap length keeps */
+static inline uint32_t
+capture_snap(uint16_t snaplen, uint32_t dlen)
+{
+    return (snaplen && snaplen < dlen) ? snaplen : dlen;
+}
+
+/**
+ *
+ * capture_file_create - Create the pcap file of a capture of a port.
+ *
+ * DESCRIPTION
+ * The file is named after the time and the port, in the pcap format of the
+ * port, with the run metadata, the timer of the capture and the description of
+ * the capture as comments.
+ * The disk capture and the flight recorder write large files and get a
+ * buffered file.
+ *
+ * RETURNS: Open file or NULL on error.
+ *
+ * SEE ALSO:
+ */
+static pcap_writer_t *
+capture_file_create(port_info_t *pinfo, const cap_clock_t *clk, const char *what, char *filename,
+                    size_t len)
+{
+    char str_time[64];
+    char meta[4][160];
+    const char *comments[] = {meta[0], meta[1], meta[2], meta[3], NULL};
+    const cap_sample_cfg_t *smp = &pinfo->cap_sample;
+    bool buffered = (pinfo->capture_mode != CAPTURE_MODE_MEMORY);
+    pcap_writer_t *w;
+    time_t t;
+
+    snprintf(meta[0], sizeof(meta[0]), "Captured on port %d by %s", pinfo->pid, PKTGEN_VERSION);
+    snprintf(meta[1], sizeof(meta[1]), "Link %u Mbps, %s", pinfo->link.link_speed, what);
+    snprintf(meta[2], sizeof(meta[2]),
+             "Times from a %" PRIu64 " Hz timer anchored to the wall clock at %" PRIu64 " ns",
+             clk->hz, clk->ns0);
+    if (smp->rate > 1)
+        snprintf(meta[3], sizeof(meta[3]), "Snap length %u, 1 in %u %s",
+                 smp->snaplen ? smp->snaplen : UINT16_MAX, smp->rate,
+                 (smp->mode == CAP_SAMPLE_FLOW) ? "flows" : "packets");
+    else if (smp->snaplen)
+        snprintf(meta[3], sizeof(meta[3]), "Snap length %u", smp->snaplen);
+    else
+        comments[3] = NULL;
+
+    t = time(NULL);
+    strftime(str_time, sizeof(str_time), "%Y%m%d-%H%M%S", localtime(&t));
+    snprintf(filename, len, "pktgen-%s-%d.%s", str_time, pinfo->pid,
+             (pinfo->pcap_fmt == PCAP_FMT_PCAPNG) ? "pcapng" : "pcap");
+
+    if (buffered)
+        w = pktgen_create_pcap_stream_file(filename, pinfo->pcap_fmt, comments,
+                                           pinfo->capture_direct);
+    else
+        w = pktgen_create_pcap_file(filename, pinfo->pcap_fmt, comments);
+    if (w == NULL)
+        pktgen_log_error("Unable to create capture file %s", filename);
+
+    return w;
+}
+
 /**
  *
  * pktgen_packet_capture_init - Initialize memory and data structures for packet
@@ -63,6 +139,1141 @@ pktgen_packet_capture_init(uint16_t sid)
     }
 }
 
+/**
+ *
+ * capture_clock_read - Read the capture timer and the wall clock together.
+ *
+ * DESCRIPTION
+ * The wall clock read is bracketed by two timer reads, the pair with the
+ * closest bracket is kept and the timer is taken at its middle, so a
+ * preemption or a slow clock_gettime() does not skew the anchor.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+static void
+capture_clock_read(uint64_t *tsc, uint64_t *ns)
+{
+    uint64_t best = UINT64_MAX;
+
+    for (int i = 0; i < CAP_CLOCK_READS; i++) {
+        struct timespec ts;
+        uint64_t t1, t2;
+
+        t1 = pktgen_get_time();
+        clock_gettime(CLOCK_REALTIME, &ts);
+        t2 = pktgen_get_time();
+
+        if (t2 - t1 < best) {
+            best = t2 - t1;
+            *tsc = t1 + (t2 - t1) / 2;
+            *ns  = rte_timespec_to_ns(&ts);
+        }
+    }
+}
+
+/**
+ *
+ * capture_clock_start - Anchor the capture timer to the wall clock.
+ *
+ * DESCRIPTION
+ * Called once when a capture starts, every record of the capture is converted
+ * relative to this anchor.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+static void
+capture_clock_start(cap_clock_t *clk)
+{
+    capture_clock_read(&clk->tsc0, &clk->ns0);
+    clk->hz = pktgen_get_timer_hz();
+}
+
+/**
+ *
+ * capture_clock_calibrate - Measure the timer frequency over a capture.
+ *
+ * DESCRIPTION
+ * The nominal timer frequency can be off by enough to drift by tens of
+ * microseconds a second. Once the capture has run long enough, the frequency
+ * is measured against the wall clock since the anchor. A result far from the
+ * nominal frequency means the wall clock was stepped and is not used.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+static void
+capture_clock_calibrate(cap_clock_t *clk)
+{
+    uint64_t tsc, ns, dns;
+    double hz, err;
+
+    /* The clock_gettime() time source is the wall clock already */
+    if (pktgen.flags & CLOCK_GETTIME_FLAG)
+        return;
+
+    capture_clock_read(&tsc, &ns);
+    if (ns <= clk->ns0 || tsc <= clk->tsc0)
+        return;
+    dns = ns - clk->ns0;
+    if (dns < (uint64_t)CAP_CLOCK_MIN_MS * Million)
+        return;
+
+    hz  = ((double)(tsc - clk->tsc0) * Billion) / (double)dns;
+    err = (hz > (double)clk->hz) ? hz - (double)clk->hz : (double)clk->hz - hz;
+    if (err > ((double)clk->hz * CAP_CLOCK_MAX_PPM) / Million) {
+        pktgen_log_warning("Capture timer measured at %.0f Hz, the wall clock moved during "
+                           "the capture, using %" PRIu64 " Hz",
+                           hz, clk->hz);
+        return;
+    }
+    clk->hz = (uint64_t)(hz + 0.5);
+}
+
+/**
+ *
+ * capture_clock_ns - Convert a capture timer value to wall clock time.
+ *
+ * DESCRIPTION
+ * Times are taken relative to the anchor of the capture, split in seconds and
+ * cycles so long captures neither overflow nor lose nanoseconds.
+ *
+ * RETURNS: Time in ns since the epoch.
+ *
+ * SEE ALSO:
+ */
+static inline uint64_t
+capture_clock_ns(const cap_clock_t *clk, uint64_t tsc)
+{
+    uint64_t d;
+
+    if (tsc < clk->tsc0)
+        return clk->ns0 - ((clk->tsc0 - tsc) * Billion) / clk->hz;
+
+    d = tsc - clk->tsc0;
+    return clk->ns0 + (d / clk->hz) * Billion + ((d % clk->hz) * Billion) / clk->hz;
+}
+
+/**
+ *
+ * capture_disk_write_block - Write the records of a block to the capture file.
+ *
+ * DESCRIPTION
+ * Convert each record of the block to a pcap record of the output file.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+static void
+capture_disk_write_block(cap_disk_t *cd, cap_block_t *blk)
+{
+    uint32_t off = 0;
+
+    for (uint32_t i = 0; i < blk->nb_pkts; i++) {
+        cap_hdr_t *hdr = (cap_hdr_t *)(blk->data + off);
+        uint64_t ns    = capture_clock_ns(&cd->clock, hdr->tstamp);
+
+        if (pktgen_write_pcap_record(cd->w, ns, hdr->pkt, hdr->data_len, hdr->pkt_len))
+            cd->errors++;
+        else {
+            cd->pkts++;
+            cd->bytes += hdr->data_len;
+        }
+        off += CAP_REC_SIZE(hdr->data_len);
+    }
+}
+
+/**
+ *
+ * capture_disk_writer - Thread writing the blocks of a disk capture to its file.
+ *
+ * DESCRIPTION
+ * Take the filled blocks of every RX queue, write them and give them back to
+ * the queue. When the capture stops the rings are drained before the thread
+ * exits.
+ *
+ * RETURNS: NULL
+ *
+ * SEE ALSO:
+ */
+static void *
+capture_disk_writer(void *arg)
+{
+    cap_disk_t *cd = arg;
+    cap_block_t *blks[CAP_WRITER_BURST];
+
+    for (;;) {
+        /* Read before draining, so blocks queued before the stop are written */
+        int running = cd->running;
+        uint32_t done = 0;
+
+        rte_smp_rmb();
+        for (uint16_t q = 0; q < cd->nb_queues; q++) {
+            cap_queue_t *cq = &cd->q[q];
+            uint32_t n;
+
+            n = rte_ring_sc_dequeue_burst(cq->full, (void **)blks, CAP_WRITER_BURST, NULL);
+            for (uint32_t i = 0; i < n; i++)
+                capture_disk_write_block(cd, blks[i]);
+            if (n)
+                rte_ring_sp_enqueue_bulk(cq->free, (void **)blks, n, NULL);
+            done += n;
+        }
+
+        if (done == 0) {
+            if (!running)
+                break;
+            usleep(CAP_WRITER_IDLE);
+        }
+    }
+    return NULL;
+}
+
+/**
+ *
+ * capture_disk_free - Release the rings and the blocks of a disk capture.
+ *
+ * DESCRIPTION
+ * The writer thread must not be running and the file must be closed.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+static void
+capture_disk_free(cap_disk_t *cd)
+{
+    for (uint16_t q = 0; q < cd->nb_queues; q++) {
+        rte_ring_free(cd->q[q].full);
+        rte_ring_free(cd->q[q].free);
+        rte_free(cd->q[q].mem);
+    }
+    rte_free(cd);
+}
+
+/**
+ *
+ * capture_disk_start - Start a disk capture of a port.
+ *
+ * DESCRIPTION
+ * Allocate the blocks and rings of every RX queue on the socket of the port,
+ * create the output file and start the writer thread off the lcores.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+static void
+capture_disk_start(port_info_t *pinfo)
+{
+    char name[RTE_RING_NAMESIZE];
+    rte_cpuset_t cpuset;
+    uint16_t pid = pinfo->pid;
+    int sid      = rte_eth_dev_socket_id(pid);
+    cap_disk_t *cd;
+
+    if (sid < 0)
+        sid = SOCKET_ID_ANY;
+
+    cd = rte_zmalloc_socket("CaptureDisk", sizeof(cap_disk_t), RTE_CACHE_LINE_SIZE, sid);
+    if (cd == NULL) {
+        pktgen_log_error("Port %d unable to allocate the disk capture", pid);
+        return;
+    }
+    cd->pid       = pid;
+    cd->nb_queues = l2p_get_rxcnt(pid);
+    cd->snaplen   = pinfo->cap_sample.snaplen;
+    cd->nb_blocks = ((uint64_t)(pinfo->cap_disk_mb ? pinfo->cap_disk_mb : CAP_DISK_DEFAULT_MB)
+                     << 20) / CAP_BLOCK_SIZE;
+
+    for (uint16_t q = 0; q < cd->nb_queues; q++) {
+        cap_queue_t *cq = &cd->q[q];
+
+        cq->mem = rte_malloc_socket("CaptureBlocks", cd->nb_blocks * CAP_BLOCK_SIZE,
+                                    RTE_CACHE_LINE_SIZE, sid);
+        snprintf(name, sizeof(name), "CapFull-%d-%d", pid, q);
+        cq->full = rte_ring_create(name, cd->nb_blocks, sid,
+                                   RING_F_SP_ENQ | RING_F_SC_DEQ | RING_F_EXACT_SZ);
+        snprintf(name, sizeof(name), "CapFree-%d-%d", pid, q);
+        cq->free = rte_ring_create(name, cd->nb_blocks, sid,
+                                   RING_F_SP_ENQ | RING_F_SC_DEQ | RING_F_EXACT_SZ);
+        if (cq->mem == NULL || cq->full == NULL || cq->free == NULL) {
+            pktgen_log_error("Port %d unable to allocate %lu MB of capture blocks for queue %d",
+                             pid, (cd->nb_blocks * CAP_BLOCK_SIZE) >> 20, q);
+            capture_disk_free(cd);
+            return;
+        }
+
+        for (uint32_t i = 0; i < cd->nb_blocks; i++) {
+            cap_block_t *blk = RTE_PTR_ADD(cq->mem, i * CAP_BLOCK_SIZE);
+
+            rte_ring_sp_enqueue(cq->free, blk);
+        }
+    }
+
+    /* Records are written while the capture runs, the nominal timer frequency is used */
+    capture_clock_start(&cd->clock);
+
+    cd->w = capture_file_create(pinfo, &cd->clock, "continuous capture to disk", cd->filename,
+                                sizeof(cd->filename));
+    if (cd->w == NULL) {
+        capture_disk_free(cd);
+        return;
+    }
+
+    cd->running = 1;
+    if (pthread_create(&cd->tid, NULL, capture_disk_writer, cd)) {
+        pktgen_log_error("Port %d unable to create the capture writer thread", pid);
+        pktgen_close_pcap_file(cd->w);
+        capture_disk_free(cd);
+        return;
+    }
+    pktgen_pcap_thread_cpuset(&cpuset);
+    pthread_setaffinity_np(cd->tid, sizeof(cpuset), &cpuset);
+
+    /* The RX lcores only look at the capture once the flag is set */
+    pinfo->cap_disk = cd;
+    rte_smp_wmb();
+    pktgen_set_port_flags(pinfo, CAPTURE_PKTS);
+
+    pktgen_log_info("Capturing port %d to %s, %d RX queues with %lu MB of blocks each", pid,
+                    cd->filename, cd->nb_queues, (cd->nb_blocks * CAP_BLOCK_SIZE) >> 20);
+}
+
+/**
+ *
+ * capture_disk_stop - Stop the disk capture of a port.
+ *
+ * DESCRIPTION
+ * Stop the RX lcores adding to the blocks and wait until each RX queue is done
+ * with its burst, then hand over the partly filled blocks, let the writer drain
+ * the rings and close the file.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+static void
+capture_disk_stop(port_info_t *pinfo)
+{
+    cap_disk_t *cd = pinfo->cap_disk;
+    uint64_t drops = 0;
+
+    pktgen_clr_port_flags(pinfo, CAPTURE_PKTS);
+
+    /* A burst started before the flag was cleared may still be adding records */
+    pktgen_rx_quiesce(pinfo);
+    pinfo->cap_disk = NULL;
+
+    /* The RX lcores no longer touch the blocks or enqueue on the full rings */
+    for (uint16_t q = 0; q < cd->nb_queues; q++) {
+        cap_queue_t *cq = &cd->q[q];
+
+        if (cq->cur)
+            rte_ring_sp_enqueue(cq->cur->used ? cq->full : cq->free, cq->cur);
+        cq->cur = NULL;
+        drops += cq->drops;
+    }
+
+    rte_smp_wmb();
+    cd->running = 0;
+    pthread_join(cd->tid, NULL);
+
+    pktgen_close_pcap_file(cd->w);
+    chmod(cd->filename, 0666);
+
+    pktgen_log_info("Port %d captured %'" PRIu64 " packets to %s, %'" PRIu64 " dropped", cd->pid,
+                    cd->pkts, cd->filename, drops);
+    if (cd->errors)
+        pktgen_log_error("Port %d failed to write %'" PRIu64 " packets to %s", cd->pid,
+                         cd->errors, cd->filename);
+
+    capture_disk_free(cd);
+}
+
+void
+pktgen_packet_capture_disk(cap_disk_t *cd, uint16_t qid, struct rte_mbuf **pkts, uint32_t nb_pkts)
+{
+    const hw_tstamp_t *hw      = &l2p_get_port_pinfo(cd->pid)->hw_tstamp;
+    const hw_tstamp_cal_t *cal = pktgen_rx_cal(hw);
+    cap_queue_t *cq            = &cd->q[qid];
+    cap_block_t *blk           = cq->cur;
+    uint64_t now               = pktgen_get_time();
+    uint32_t i;
+
+    for (i = 0; i < nb_pkts; i++) {
+        struct rte_mbuf *pkt = pkts[i];
+        uint32_t dlen        = capture_snap(cd->snaplen, pkt->data_len); /* First segment only */
+        uint32_t size        = CAP_REC_SIZE(dlen);
+        cap_hdr_t *hdr;
+
+        if (blk == NULL || blk->used + size > CAP_BLOCK_DATA) {
+            /* The full ring has room for every block of the queue */
+            if (blk)
+                rte_ring_sp_enqueue(cq->full, blk);
+            if (rte_ring_sc_dequeue(cq->free, (void **)&blk)) {
+                blk = NULL;
+                cq->drops += nb_pkts - i;
+                break;
+            }
+            blk->start   = now;
+            blk->used    = 0;
+            blk->nb_pkts = 0;
+        }
+
+        hdr           = (cap_hdr_t *)(blk->data + blk->used);
+        hdr->tstamp   = cal ? pktgen_rx_time(hw, cal, pkt) : now;
+        hdr->pkt_len  = pkt->pkt_len;
+        hdr->data_len = dlen;
+        rte_memcpy(hdr->pkt, rte_pktmbuf_mtod(pkt, uint8_t *), dlen);
+
+        blk->used += size;
+        blk->nb_pkts++;
+    }
+    cq->pkts += i;
+
+    /* Hand over an old block, so a slow capture still reaches the file */
+    if (blk && (now - blk->start) > (cd->clock.hz * CAP_FLUSH_MS) / 1000) {
+        rte_ring_sp_enqueue(cq->full, blk);
+        blk = NULL;
+    }
+    cq->cur = blk;
+}
+
+void
+pktgen_packet_capture_disk_flush(cap_disk_t *cd, uint16_t qid)
+{
+    cap_queue_t *cq  = &cd->q[qid];
+    cap_block_t *blk = cq->cur;
+
+    if (blk && (pktgen_get_time() - blk->start) > (cd->clock.hz * CAP_FLUSH_MS) / 1000) {
+        rte_ring_sp_enqueue(cq->full, blk);
+        cq->cur = NULL;
+    }
+}
+
+int
+pktgen_capture_disk_set(port_info_t *pinfo, uint32_t size_mb)
+{
+    if (size_mb && size_mb < CAP_DISK_MIN_MB) {
+        pktgen_log_error("Disk capture memory %u MB is below %u MB per RX queue", size_mb,
+                         CAP_DISK_MIN_MB);
+        return -1;
+    }
+    pinfo->cap_disk_mb = size_mb;
+
+    return 0;
+}
+
+/**
+ *
+ * capture_trig_name - Return the name of a flight recorder trigger.
+ *
+ * DESCRIPTION
+ * Name the trigger for the log and the comments of the file.
+ *
+ * RETURNS: Name of the trigger.
+ *
+ * SEE ALSO:
+ */
+static const char *
+capture_trig_name(uint32_t why)
+{
+    switch (why) {
+    case CAP_TRIG_LATENCY:
+        return "latency";
+    case CAP_TRIG_SEQ_GAP:
+        return "sequence gap";
+    case CAP_TRIG_RX_ERRORS:
+        return "RX errors";
+    default:
+        return "freeze command";
+    }
+}
+
+/* Bytes of the record or wrap marker at the head, a marker has a pkt_len of 0 and its size in
+ * tstamp */
+static inline uint64_t
+cap_ring_rec_size(const cap_hdr_t *hdr)
+{
+    return hdr->pkt_len ? CAP_RING_REC_SIZE(hdr->data_len) : hdr->tstamp;
+}
+
+/* Drop the oldest record or wrap marker of a queue buffer */
+static inline void
+cap_ring_evict(cap_ring_q_t *rq)
+{
+    const cap_hdr_t *hdr = (const cap_hdr_t *)(rq->buf + rq->head);
+    uint64_t size        = cap_ring_rec_size(hdr);
+
+    if (hdr->pkt_len) {
+        rq->nb_recs--;
+        rq->overwritten++;
+    }
+    rq->head += size;
+    if (rq->head == rq->size)
+        rq->head = 0;
+    rq->used -= size;
+}
+
+/**
+ *
+ * cap_ring_reserve - Make room for a record at the tail of a queue buffer.
+ *
+ * DESCRIPTION
+ * Records are contiguous. When the record does not fit before the end of the
+ * buffer the rest of the buffer is filled with a wrap marker and the record
+ * goes to the start. The oldest records are dropped until there is room.
+ *
+ * RETURNS: Header of the record to fill.
+ *
+ * SEE ALSO:
+ */
+static inline cap_hdr_t *
+cap_ring_reserve(cap_ring_q_t *rq, uint64_t size)
+{
+    uint64_t gap = rq->size - rq->tail;
+
+    if (gap < size) {
+        cap_hdr_t *mark;
+
+        while (rq->size - rq->used < gap)
+            cap_ring_evict(rq);
+
+        mark           = (cap_hdr_t *)(rq->buf + rq->tail);
+        mark->tstamp   = gap;
+        mark->pkt_len  = 0;
+        mark->data_len = 0;
+        rq->used += gap;
+        rq->tail = 0;
+    }
+
+    while (rq->size - rq->used < size)
+        cap_ring_evict(rq);
+
+    return (cap_hdr_t *)(rq->buf + rq->tail);
+}
+
+void
+pktgen_packet_capture_ring(cap_ring_t *cr, uint16_t qid, struct rte_mbuf **pkts, uint32_t nb_pkts)
+{
+    const hw_tstamp_t *hw      = &l2p_get_port_pinfo(cr->pid)->hw_tstamp;
+    const hw_tstamp_cal_t *cal = pktgen_rx_cal(hw);
+    cap_ring_q_t *rq           = &cr->q[qid];
+    uint64_t now               = pktgen_get_time();
+    uint32_t state             = cr->state;
+
+    /* After a trigger, record until the end of the post-trigger window */
+    if (state >= CAP_RING_TRIGGERED) {
+        rte_smp_rmb();
+        if (state > CAP_RING_TRIGGERED || now > cr->stop_tsc)
+            return;
+    }
+
+    for (uint32_t i = 0; i < nb_pkts; i++) {
+        struct rte_mbuf *pkt = pkts[i];
+        uint32_t dlen        = capture_snap(cr->snaplen, pkt->data_len); /* First segment only */
+        uint32_t plen        = RTE_MIN(pkt->pkt_len, (uint32_t)UINT16_MAX);
+        uint64_t size        = CAP_RING_REC_SIZE(dlen);
+        cap_hdr_t *hdr;
+
+        /* A record with a zero length would read as a wrap marker */
+        if (plen == 0)
+            continue;
+
+        hdr           = cap_ring_reserve(rq, size);
+        hdr->tstamp   = cal ? pktgen_rx_time(hw, cal, pkt) : now;
+        hdr->pkt_len  = plen;
+        hdr->data_len = dlen;
+        rte_memcpy(hdr->pkt, rte_pktmbuf_mtod(pkt, uint8_t *), dlen);
+
+        rq->tail += size;
+        if (rq->tail == rq->size)
+            rq->tail = 0;
+        rq->used += size;
+        rq->nb_recs++;
+    }
+    rq->pkts += nb_pkts;
+}
+
+/**
+ *
+ * capture_ring_fire - Fire a trigger of a flight recorder.
+ *
+ * DESCRIPTION
+ * The first trigger sets the window, the RX lcores keep recording while it is
+ * set up and until the end of the post-trigger window.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+static void
+capture_ring_fire(cap_ring_t *cr, uint32_t why)
+{
+    uint64_t now;
+
+    if (!rte_atomic32_cmpset(&cr->state, CAP_RING_ARMED, CAP_RING_TRIGGERING))
+        return;
+
+    now          = pktgen_get_time();
+    cr->why      = why;
+    cr->trig_tsc = now;
+    cr->stop_tsc = now + cr->post_cycles;
+    rte_smp_wmb();
+    cr->state = CAP_RING_TRIGGERED;
+}
+
+void
+pktgen_capture_trigger(port_info_t *pinfo, uint32_t why)
+{
+    cap_ring_t *cr = pinfo->cap_ring;
+
+    if (cr)
+        capture_ring_fire(cr, why);
+}
+
+/* Step past the record or wrap marker at a read position of a queue buffer */
+static inline void
+cap_ring_next(const cap_ring_q_t *rq, uint64_t *pos, uint64_t *left)
+{
+    uint64_t size = cap_ring_rec_size((const cap_hdr_t *)(rq->buf + *pos));
+
+    *pos += size;
+    if (*pos == rq->size)
+        *pos = 0;
+    *left -= size;
+}
+
+/**
+ *
+ * capture_ring_write - Write the window around the trigger of a frozen recorder.
+ *
+ * DESCRIPTION
+ * The records of every RX queue are in time order, they are merged into one
+ * file in time order, from the start of the pre-trigger window to the end of
+ * the post-trigger window.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+static void
+capture_ring_write(port_info_t *pinfo, cap_ring_t *cr)
+{
+    uint64_t pos[MAX_QUEUES_PER_PORT], left[MAX_QUEUES_PER_PORT];
+    uint64_t start = 0;
+    char what[128];
+    pcap_writer_t *w;
+
+    if (cr->pre_cycles && cr->trig_tsc > cr->pre_cycles)
+        start = cr->trig_tsc - cr->pre_cycles;
+
+    snprintf(what, sizeof(what), "flight recorder frozen by %s, %u ms before and %u ms after",
+             capture_trig_name(cr->why), pinfo->cap_ring_cfg.pre_ms,
+             pinfo->cap_ring_cfg.post_ms);
+    capture_clock_calibrate(&cr->clock);
+    w = capture_file_create(pinfo, &cr->clock, what, cr->filename, sizeof(cr->filename));
+    if (w == NULL)
+        return;
+
+    for (uint16_t q = 0; q < cr->nb_queues; q++) {
+        pos[q]  = cr->q[q].head;
+        left[q] = cr->q[q].used;
+    }
+
+    for (;;) {
+        const cap_hdr_t *best = NULL;
+        uint16_t bq           = 0;
+
+        for (uint16_t q = 0; q < cr->nb_queues; q++) {
+            const cap_ring_q_t *rq = &cr->q[q];
+            const cap_hdr_t *hdr   = NULL;
+
+            /* Skip the wrap markers and the records before the window */
+            while (left[q]) {
+                hdr = (const cap_hdr_t *)(rq->buf + pos[q]);
+                if (hdr->pkt_len && hdr->tstamp >= start)
+                    break;
+                cap_ring_next(rq, &pos[q], &left[q]);
+                hdr = NULL;
+            }
+
+            if (hdr && (best == NULL || hdr->tstamp < best->tstamp)) {
+                best = hdr;
+                bq   = q;
+            }
+        }
+        if (best == NULL || best->tstamp > cr->stop_tsc)
+            break;
+
+        if (pktgen_write_pcap_record(w, capture_clock_ns(&cr->clock, best->tstamp), best->pkt,
+                                     best->data_len, best->pkt_len) == 0)
+            cr->written++;
+        cap_ring_next(&cr->q[bq], &pos[bq], &left[bq]);
+    }
+
+    pktgen_close_pcap_file(w);
+    chmod(cr->filename, 0666);
+
+    pktgen_log_info("Port %d flight recorder frozen by %s, %'" PRIu64 " packets written to %s",
+                    cr->pid, capture_trig_name(cr->why), cr->written, cr->filename);
+}
+
+/**
+ *
+ * capture_ring_thread - Watch the triggers of a flight recorder and write its window.
+ *
+ * DESCRIPTION
+ * Fire the RX error trigger when the error or missed counters of the port grow
+ * and freeze the recorder at the end of the post-trigger window, then write the
+ * window and exit.
+ *
+ * RETURNS: NULL
+ *
+ * SEE ALSO:
+ */
+static void *
+capture_ring_thread(void *arg)
+{
+    cap_ring_t *cr     = arg;
+    port_info_t *pinfo = l2p_get_port_pinfo(cr->pid);
+    struct rte_eth_stats st;
+
+    while (cr->running) {
+        if ((cr->triggers & CAP_TRIG_RX_ERRORS) && rte_eth_stats_get(cr->pid, &st) == 0) {
+            if (st.ierrors + st.imissed > cr->errors)
+                capture_ring_fire(cr, CAP_TRIG_RX_ERRORS);
+            cr->errors = st.ierrors + st.imissed;
+        }
+
+        if (cr->state == CAP_RING_TRIGGERED && pktgen_get_time() > cr->stop_tsc) {
+            cr->state = CAP_RING_FROZEN;
+
+            /* Wait for the RX lcores to finish a burst they may have started */
+            pktgen_rx_quiesce(pinfo);
+            capture_ring_write(pinfo, cr);
+            cr->state = CAP_RING_DONE;
+            break;
+        }
+
+        rte_delay_us_sleep(CAP_RING_POLL_US);
+    }
+    return NULL;
+}
+
+/**
+ *
+ * capture_ring_free - Release the buffers of a flight recorder.
+ *
+ * DESCRIPTION
+ * The thread of the recorder must not be running.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+static void
+capture_ring_free(cap_ring_t *cr)
+{
+    for (uint16_t q = 0; q < cr->nb_queues; q++)
+        rte_free(cr->q[q].buf);
+    rte_free(cr);
+}
+
+/**
+ *
+ * capture_ring_start - Start the flight recorder of a port.
+ *
+ * DESCRIPTION
+ * Split the recorder memory over the RX queues in hugepage memory on the socket
+ * of the port, arm the triggers and start the thread watching them.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+static void
+capture_ring_start(port_info_t *pinfo)
+{
+    cap_ring_cfg_t *cfg = &pinfo->cap_ring_cfg;
+    uint16_t pid        = pinfo->pid;
+    int sid             = rte_eth_dev_socket_id(pid);
+    uint64_t bytes, qbytes;
+    struct rte_eth_stats st;
+    rte_cpuset_t cpuset;
+    cap_ring_t *cr;
+
+    if (sid < 0)
+        sid = SOCKET_ID_ANY;
+
+    cr = rte_zmalloc_socket("CaptureRing", sizeof(cap_ring_t), RTE_CACHE_LINE_SIZE, sid);
+    if (cr == NULL) {
+        pktgen_log_error("Port %d unable to allocate the flight recorder", pid);
+        return;
+    }
+    cr->pid       = pid;
+    cr->nb_queues = l2p_get_rxcnt(pid);
+    cr->snaplen   = pinfo->cap_sample.snaplen;
+
+    bytes  = (uint64_t)(cfg->size_mb ? cfg->size_mb : CAP_RING_DEFAULT_MB) << 20;
+    qbytes = RTE_ALIGN_FLOOR(bytes / RTE_MAX(cr->nb_queues, 1), CAP_RING_ALIGN);
+    if (qbytes < CAP_RING_MIN_BYTES) {
+        pktgen_log_error("Port %d flight recorder needs at least %lu MB per RX queue", pid,
+                         CAP_RING_MIN_BYTES >> 20);
+        rte_free(cr);
+        return;
+    }
+
+    for (uint16_t q = 0; q < cr->nb_queues; q++) {
+        cap_ring_q_t *rq = &cr->q[q];
+
+        rq->buf  = rte_malloc_socket("CaptureRingBuf", qbytes, RTE_CACHE_LINE_SIZE, sid);
+        rq->size = qbytes;
+        if (rq->buf == NULL) {
+            pktgen_log_error("Port %d unable to allocate %" PRIu64 " MB of recorder memory for "
+                             "queue %d, are enough hugepages allocated?",
+                             pid, qbytes >> 20, q);
+            capture_ring_free(cr);
+            return;
+        }
+    }
+
+    capture_clock_start(&cr->clock);
+
+    cr->triggers    = cfg->triggers;
+    cr->lat_cycles  = ((uint64_t)cfg->lat_us * cr->clock.hz) / 1000000;
+    cr->pre_cycles  = ((uint64_t)cfg->pre_ms * cr->clock.hz) / 1000;
+    cr->post_cycles = ((uint64_t)cfg->post_ms * cr->clock.hz) / 1000;
+    if (rte_eth_stats_get(pid, &st) == 0)
+        cr->errors = st.ierrors + st.imissed;
+
+    cr->running = 1;
+    if (pthread_create(&cr->tid, NULL, capture_ring_thread, cr)) {
+        pktgen_log_error("Port %d unable to create the flight recorder thread", pid);
+        capture_ring_free(cr);
+        return;
+    }
+    pktgen_pcap_thread_cpuset(&cpuset);
+    pthread_setaffinity_np(cr->tid, sizeof(cpuset), &cpuset);
+
+    /* The RX lcores only look at the capture once the flag is set */
+    pinfo->cap_ring = cr;
+    rte_smp_wmb();
+    pktgen_set_port_flags(pinfo, CAPTURE_PKTS);
+
+    pktgen_log_info("Port %d flight recorder armed, %d RX queues with %" PRIu64 " MB each", pid,
+                    cr->nb_queues, qbytes >> 20);
+}
+
+/**
+ *
+ * capture_ring_stop - Stop the flight recorder of a port.
+ *
+ * DESCRIPTION
+ * Stop the RX lcores recording, wait for a window being written and release
+ * the recorder. A recorder that did not freeze writes nothing.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+static void
+capture_ring_stop(port_info_t *pinfo)
+{
+    cap_ring_t *cr = pinfo->cap_ring;
+
+    pktgen_clr_port_flags(pinfo, CAPTURE_PKTS);
+    pinfo->cap_ring = NULL;
+
+    /* Wait for the RX lcores to finish a burst or a trigger they may have started */
+    pktgen_rx_quiesce(pinfo);
+
+    cr->running = 0;
+    pthread_join(cr->tid, NULL);
+
+    if (cr->state < CAP_RING_FROZEN)
+        pktgen_log_info("Port %d flight recorder stopped before a trigger, nothing written",
+                        cr->pid);
+
+    capture_ring_free(cr);
+}
+
+void
+pktgen_capture_ring_set(port_info_t *pinfo, uint32_t size_mb, uint32_t pre_ms, uint32_t post_ms)
+{
+    pinfo->cap_ring_cfg.size_mb = size_mb;
+    pinfo->cap_ring_cfg.pre_ms  = pre_ms;
+    pinfo->cap_ring_cfg.post_ms = post_ms;
+}
+
+int
+pktgen_capture_ring_trigger(port_info_t *pinfo, const char *what, uint32_t value)
+{
+    cap_ring_cfg_t *cfg = &pinfo->cap_ring_cfg;
+    uint32_t bit;
+
+    if (!strcmp(what, "latency")) {
+        cfg->lat_us = value;
+        bit         = CAP_TRIG_LATENCY;
+    } else if (!strcmp(what, "gap"))
+        bit = CAP_TRIG_SEQ_GAP;
+    else if (!strcmp(what, "errors"))
+        bit = CAP_TRIG_RX_ERRORS;
+    else {
+        pktgen_log_error("Unknown capture trigger %s, use latency, gap or errors", what);
+        return -1;
+    }
+
+    if (value)
+        cfg->triggers |= bit;
+    else
+        cfg->triggers &= ~bit;
+
+    return 0;
+}
+
+int
+pktgen_capture_mode(port_info_t *pinfo, const char *mode)
+{
+    uint8_t m;
+
+    if (!strcmp(mode, "memory"))
+        m = CAPTURE_MODE_MEMORY;
+    else if (!strcmp(mode, "disk"))
+        m = CAPTURE_MODE_DISK;
+    else if (!strcmp(mode, "ring"))
+        m = CAPTURE_MODE_RING;
+    else {
+        pktgen_log_error("Unknown capture mode %s, use memory, disk or ring", mode);
+        return -1;
+    }
+
+    if (m != pinfo->capture_mode && pktgen_tst_port_flags(pinfo, CAPTURE_PKTS)) {
+        pktgen_log_error("Port %d is capturing, disable the capture first", pinfo->pid);
+        return -1;
+    }
+    pinfo->capture_mode = m;
+
+    return 0;
+}
+
+const char *
+pktgen_capture_mode_name(port_info_t *pinfo)
+{
+    switch (pinfo->capture_mode) {
+    case CAPTURE_MODE_DISK:
+        return "disk";
+    case CAPTURE_MODE_RING:
+        return "ring";
+    default:
+        return "memory";
+    }
+}
+
+void
+pktgen_capture_direct(port_info_t *pinfo, uint32_t onOff)
+{
+    pinfo->capture_direct = (onOff == ENABLE_STATE);
+}
+
+/**
+ *
+ * capture_flow_hash - Hash the flow of a received packet.
+ *
+ * DESCRIPTION
+ * Use the RSS hash the NIC computed when there is one, otherwise hash the IP
+ * addresses and the TCP or UDP ports, or the MAC addresses of non IP packets.
+ * The RSS hash is mixed again as its low bits select the RX queue.
+ *
+ * RETURNS: 32 bit hash of the flow.
+ *
+ * SEE ALSO:
+ */
+static inline uint32_t
+capture_flow_hash(struct rte_mbuf *m)
+{
+    const uint8_t *p                = rte_pktmbuf_mtod(m, const uint8_t *);
+    const struct rte_ether_hdr *eth = (const struct rte_ether_hdr *)p;
+    uint32_t off                    = sizeof(struct rte_ether_hdr);
+    uint16_t type                   = eth->ether_type;
+    uint8_t proto;
+    uint32_t h;
+
+    if (m->ol_flags & RTE_MBUF_F_RX_RSS_HASH)
+        return rte_hash_crc_4byte(m->hash.rss, CAP_SAMPLE_SEED);
+
+    if (type == htons(RTE_ETHER_TYPE_VLAN) && m->data_len >= off + sizeof(struct rte_vlan_hdr)) {
+        type = ((const struct rte_vlan_hdr *)(p + off))->eth_proto;
+        off += sizeof(struct rte_vlan_hdr);
+    }
+
+    if (type == htons(RTE_ETHER_TYPE_IPV4) && m->data_len >= off + sizeof(struct rte_ipv4_hdr)) {
+        const struct rte_ipv4_hdr *ip = (const struct rte_ipv4_hdr *)(p + off);
+
+        h     = rte_hash_crc(&ip->src_addr, 2 * sizeof(ip->src_addr), CAP_SAMPLE_SEED);
+        proto = ip->next_proto_id;
+        off += (ip->version_ihl & RTE_IPV4_HDR_IHL_MASK) * RTE_IPV4_IHL_MULTIPLIER;
+    } else if (type == htons(RTE_ETHER_TYPE_IPV6) &&
+               m->data_len >= off + sizeof(struct rte_ipv6_hdr)) {
+        const struct rte_ipv6_hdr *ip6 = (const struct rte_ipv6_hdr *)(p + off);
+
+        h     = rte_hash_crc(&ip6->src_addr, 2 * sizeof(ip6->src_addr), CAP_SAMPLE_SEED);
+        proto = ip6->proto;
+        off += sizeof(struct rte_ipv6_hdr);
+    } else
+        return rte_hash_crc(eth, 2 * RTE_ETHER_ADDR_LEN, CAP_SAMPLE_SEED);
+
+    /* The source and destination ports lead both the TCP and the UDP header */
+    if ((proto == IPPROTO_TCP || proto == IPPROTO_UDP) && m->data_len >= off + sizeof(uint32_t))
+        h = rte_hash_crc_4byte(*(const unaligned_uint32_t *)(p + off), h);
+
+    return h;
+}
+
+uint16_t
+pktgen_capture_sample_bulk(port_info_t *pinfo, uint16_t qid, uint32_t rate,
+                           struct rte_mbuf **pkts, uint16_t nb_pkts, struct rte_mbuf **keep)
+{
+    const cap_sample_cfg_t *smp = &pinfo->cap_sample;
+    uint16_t nb                 = 0;
+
+    if (unlikely(rate <= 1)) {
+        for (uint16_t i = 0; i < nb_pkts; i++)
+            keep[nb++] = pkts[i];
+    } else if (smp->mode == CAP_SAMPLE_FLOW) {
+        for (uint16_t i = 0; i < nb_pkts; i++)
+            if ((capture_flow_hash(pkts[i]) % rate) == 0)
+                keep[nb++] = pkts[i];
+    } else {
+        uint32_t cnt = pinfo->per_queue[qid].cap_sample_cnt;
+
+        /* Keep the first packet and then every rate'th one, counting across bursts */
+        for (uint16_t i = 0; i < nb_pkts; i++) {
+            if (cnt == 0)
+                keep[nb++] = pkts[i];
+            if (++cnt >= rate)
+                cnt = 0;
+        }
+        pinfo->per_queue[qid].cap_sample_cnt = cnt;
+    }
+
+    return nb;
+}
+
+void
+pktgen_capture_snaplen(port_info_t *pinfo, uint32_t snaplen)
+{
+    pinfo->cap_sample.snaplen = RTE_MIN(snaplen, (uint32_t)UINT16_MAX);
+}
+
+int
+pktgen_capture_sample(port_info_t *pinfo, const char *mode, uint32_t rate)
+{
+    uint8_t m;
+
+    if (!strcmp(mode, "packet"))
+        m = CAP_SAMPLE_PACKET;
+    else if (!strcmp(mode, "flow"))
+        m = CAP_SAMPLE_FLOW;
+    else {
+        pktgen_log_error("Unknown capture sampling %s, use packet or flow", mode);
+        return -1;
+    }
+
+    /* Set the mode first, the RX lcores start sampling once the rate is above 1 */
+    pinfo->cap_sample.mode = m;
+    rte_smp_wmb();
+    pinfo->cap_sample.rate = rate;
+
+    return 0;
+}
+
+/**
+ *
+ * capture_ring_show - Print the flight recorder settings and state of a port.
+ *
+ * DESCRIPTION
+ * Print the settings used by the next recorder and, while one runs, its state
+ * and the records held by each RX queue.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+static void
+capture_ring_show(port_info_t *pinfo)
+{
+    static const char *states[] = {"armed", "triggering", "triggered", "writing", "written"};
+    const cap_ring_cfg_t *cfg   = &pinfo->cap_ring_cfg;
+    cap_ring_t *cr              = pinfo->cap_ring;
+
+    printf("  Ring %u MB, window %u ms before and %u ms after the trigger\n",
+           cfg->size_mb ? cfg->size_mb : CAP_RING_DEFAULT_MB, cfg->pre_ms, cfg->post_ms);
+    printf("  Triggers: latency %s", (cfg->triggers & CAP_TRIG_LATENCY) ? "" : "off");
+    if (cfg->triggers & CAP_TRIG_LATENCY)
+        printf("> %u us", cfg->lat_us);
+    printf(", gap %s, errors %s\n", (cfg->triggers & CAP_TRIG_SEQ_GAP) ? "on" : "off",
+           (cfg->triggers & CAP_TRIG_RX_ERRORS) ? "on" : "off");
+    if (cr == NULL)
+        return;
+
+    printf("  Recorder %s", states[cr->state]);
+    if (cr->state >= CAP_RING_TRIGGERED)
+        printf(" by %s", capture_trig_name(cr->why));
+    if (cr->state == CAP_RING_DONE)
+        printf(", %'" PRIu64 " packets written to %s", cr->written, cr->filename);
+    printf("\n");
+    for (uint16_t q = 0; q < cr->nb_queues; q++) {
+        cap_ring_q_t *rq = &cr->q[q];
+
+        printf("  Q %2d: %'" PRIu64 " packets held, %'" PRIu64 " recorded, %'" PRIu64
+               " overwritten\n",
+               q, rq->nb_recs, rq->pkts, rq->overwritten);
+    }
+}
+
+void
+pktgen_capture_show(port_info_t *pinfo)
+{
+    cap_disk_t *cd = pinfo->cap_disk;
+
+    printf("Port %d capture mode %s, direct I/O %s, format %s, %s\n", pinfo->pid,
+           pktgen_capture_mode_name(pinfo), pinfo->capture_direct ? "on" : "off",
+           pktgen_pcap_format_name(pinfo->pcap_fmt),
+           pktgen_tst_port_flags(pinfo, CAPTURE_PKTS) ? "capturing" : "not capturing");
+    if (pinfo->cap_sample.snaplen)
+        printf("  Snap length %u, sampling ", pinfo->cap_sample.snaplen);
+    else
+        printf("  Snap length off, sampling ");
+    if (pinfo->cap_sample.rate > 1)
+        printf("1 in %u %s\n", pinfo->cap_sample.rate,
+               (pinfo->cap_sample.mode == CAP_SAMPLE_FLOW) ? "flows" : "packets");
+    else
+        printf("off\n");
+    if (pinfo->capture_mode == CAPTURE_MODE_RING)
+        capture_ring_show(pinfo);
+    else if (pinfo->capture_mode == CAPTURE_MODE_DISK)
+        printf("  Blocks %u MB per RX queue\n",
+               pinfo->cap_disk_mb ? pinfo->cap_disk_mb : CAP_DISK_DEFAULT_MB);
+    if (cd == NULL)
+        return;
+
+    printf("  File %s: %'" PRIu64 " packets, %'" PRIu64 " bytes written, %" PRIu64 " errors\n",
+           cd->filename, cd->pkts, cd->bytes, cd->errors);
+    for (uint16_t q = 0; q < cd->nb_queues; q++) {
+        cap_queue_t *cq = &cd->q[q];
+
+        printf("  Q %2d: %'" PRIu64 " packets, %'" PRIu64 " dropped, %u blocks to write\n", q,
+               cq->pkts, cq->drops, rte_ring_count(cq->full));
+    }
+}
+
 /**
  *
  * pktgen_set_capture - Enable or disable packet capturing
@@ -97,6 +1308,15 @@ pktgen_set_capture(port_info_t *pinfo, uint32_t onOff)
             return;
         }
 
+        if (pinfo->capture_mode == CAPTURE_MODE_DISK) {
+            capture_disk_start(pinfo);
+            return;
+        }
+        if (pinfo->capture_mode == CAPTURE_MODE_RING) {
+            capture_ring_start(pinfo);
+            return;
+        }
+
         /* Get socket of the selected lcore and check if capturing is possible */
         uint16_t sid = coreinfo_get(lid)->socket_id;
 
@@ -115,7 +1335,9 @@ pktgen_set_capture(port_info_t *pinfo, uint32_t onOff)
         cap->port    = pinfo->pid;
         cap->nb_pkts = 0;
 
-        cap->tail = cap->mz->addr;
+        cap->tail    = cap->mz->addr;
+        cap->snaplen = pinfo->cap_sample.snaplen;
+        capture_clock_start(&cap->clock);
 
         /* Write end-of-data sentinel to start of capture memory. This */
         /* effectively clears previously captured data. */
@@ -137,6 +1359,15 @@ pktgen_set_capture(port_info_t *pinfo, uint32_t onOff)
         if (!(rte_atomic64_read(&pinfo->port_flags) & CAPTURE_PKTS))
             return;
 
+        if (pinfo->cap_disk) {
+            capture_disk_stop(pinfo);
+            return;
+        }
+        if (pinfo->cap_ring) {
+            capture_ring_stop(pinfo);
+            return;
+        }
+
         int sid;
         for (sid = 0; sid < RTE_MAX_NUMA_NODES; ++sid) {
             cap = &pktgen.capture[sid];
@@ -152,13 +1383,10 @@ pktgen_set_capture(port_info_t *pinfo, uint32_t onOff)
 
         /* If there is previously captured data in the buffer, write it to disk. */
         if (cap->nb_pkts > 0) {
-            pcap_t *pcap;
-            pcap_dumper_t *pcap_dumper;
-            struct pcap_pkthdr pcap_hdr;
+            pcap_writer_t *w;
             cap_hdr_t *hdr;
-            time_t t;
             char filename[64];
-            char str_time[64];
+            char what[64];
             size_t mem_dumped = 0;
             unsigned int pct  = 0;
 
@@ -168,12 +1396,13 @@ pktgen_set_capture(port_info_t *pinfo, uint32_t onOff)
                     (double)cap->used / (1024 * 1024));
             scrn_printf(0, 0, "\n%s", status);
 
-            pcap = pcap_open_dead(DLT_EN10MB, 65535);
+            /* Convert the capture times with the anchor taken when the capture started */
+            capture_clock_calibrate(&cap->clock);
 
-            t = time(NULL);
-            strftime(str_time, sizeof(str_time), "%Y%m%d-%H%M%S", localtime(&t));
-            snprintf(filename, sizeof(filename), "pktgen-%s-%d.pcap", str_time, cap->port);
-            pcap_dumper = pcap_dump_open(pcap, filename);
+            snprintf(what, sizeof(what), "%u packets", cap->nb_pkts);
+            w = capture_file_create(pinfo, &cap->clock, what, filename, sizeof(filename));
+            if (w == NULL)
+                cap->nb_pkts = 0;
 
             hdr = cap->mz->addr;
 
@@ -182,14 +1411,8 @@ pktgen_set_capture(port_info_t *pinfo, uint32_t onOff)
                     printf("\n>>> Hit packet length zero at %'u of %'u\n", i, cap->nb_pkts);
                     break;
                 }
-                struct timespec ts;
-                clock_gettime(CLOCK_REALTIME, &ts);
-                pcap_hdr.len        = hdr->pkt_len;
-                pcap_hdr.caplen     = hdr->data_len;
-                pcap_hdr.ts.tv_sec  = ts.tv_sec;
-                pcap_hdr.ts.tv_usec = ts.tv_nsec / 1000;
-
-                pcap_dump((u_char *)pcap_dumper, &pcap_hdr, (const u_char *)hdr->pkt);
+                pktgen_write_pcap_record(w, capture_clock_ns(&cap->clock, hdr->tstamp), hdr->pkt,
+                                         hdr->data_len, hdr->pkt_len);
 
                 hdr = (cap_hdr_t *)(hdr->pkt + hdr->data_len);
 
@@ -211,10 +1434,10 @@ pktgen_set_capture(port_info_t *pinfo, uint32_t onOff)
             scrn_printf(0, 0, "\r");
             scrn_printf(0, 0, "\n"); /* Clean of the screen a bit */
 
-            pcap_dump_close(pcap_dumper);
-            pcap_close(pcap);
-
-            chmod(filename, 0666);
+            if (w) {
+                pktgen_close_pcap_file(w);
+                chmod(filename, 0666);
+            }
         }
 
         cap->used = 0;
@@ -231,6 +1454,8 @@ pktgen_set_capture(port_info_t *pinfo, uint32_t onOff)
  *
  * DESCRIPTION
  * Capture packet contents to memory, so they can be written to disk later.
+ * Each packet is stamped with its NIC RX timestamp when the port has them,
+ * otherwise with the time it is captured.
  *
  * A captured packet is stored as follows:
  * - uint16_t: non-truncated packet length
@@ -246,6 +1471,8 @@ pktgen_set_capture(port_info_t *pinfo, uint32_t onOff)
 void
 pktgen_packet_capture_bulk(struct rte_mbuf **pkts, uint32_t nb_dump, capture_t *cap)
 {
+    const hw_tstamp_t *hw      = &l2p_get_port_pinfo(cap->port)->hw_tstamp;
+    const hw_tstamp_cal_t *cal = pktgen_rx_cal(hw);
     uint32_t dlen, plen, i;
     struct rte_mbuf *pkt;
 
@@ -266,6 +1493,7 @@ pktgen_packet_capture_bulk(struct rte_mbuf **pkts, uint32_t nb_dump, capture_t *
             plen = 128;
         if (dlen == 0)
             dlen = 128;
+        dlen = capture_snap(cap->snaplen, dlen);
 
         /* If packet to capture is larger than available buffer size, stop capturing.
          * The packet data is prepended by the untruncated packet length and
@@ -278,7 +1506,7 @@ pktgen_packet_capture_bulk(struct rte_mbuf **pkts, uint32_t nb_dump, capture_t *
         /* Write untruncated data length and size of the actually captured data. */
         cap->tail->pkt_len  = plen;
         cap->tail->data_len = dlen;
-        cap->tail->tstamp   = pktgen_get_time();
+        cap->tail->tstamp   = pktgen_rx_time(hw, cal, pkt);
 
         rte_memcpy(cap->tail->pkt, rte_pktmbuf_mtod(pkt, uint8_t *), dlen);
 
@@ -11,17 +11,46 @@
 /**
  * @file
  *
- * In-memory packet capture for Pktgen.
+ * Packet capture for Pktgen.
  *
- * Provides structures and functions for capturing received packets into a
- * DPDK memzone with per-packet timestamps and length metadata.
+ * Provides structures and functions for capturing received packets with
+ * per-packet timestamps and length metadata, in one of three modes:
+ *
+ * - memory: packets are copied into a DPDK memzone per socket until it is full
+ *   and written to a pcap file when the capture is disabled.
+ * - disk: every RX queue of the port fills blocks of its own and hands them to
+ *   a writer thread through a single producer, single consumer ring. The writer
+ *   streams the records to a pcap file in large aligned writes, optionally with
+ *   O_DIRECT, for as long as the capture is enabled. A queue without a free
+ *   block drops the packets from the capture and counts them.
+ * - ring: a flight recorder. Every RX queue records into a circular buffer of
+ *   its own in hugepage memory, overwriting the oldest records, until a trigger
+ *   fires: a latency above a threshold, a gap in the latency probe sequence, an
+ *   increase of the RX error counters or a CLI/Lua command. The capture runs on
+ *   for the post-trigger window, then freezes, and the records of the window
+ *   around the trigger are merged in time order into a pcap file.
+ *
+ * Records carry the timer value read when their burst was received. A capture
+ * anchors the timer to the wall clock once when it starts and converts the
+ * records with that anchor, so the file keeps the arrival times and the gaps
+ * between packets with nanosecond resolution. The memory and ring modes write
+ * after the capture and measure the timer frequency against the wall clock
+ * over the capture first.
+ *
+ * To keep a capture running at line rate a port can capture only the first
+ * bytes of each packet, its snap length, and only 1 in N packets, either every
+ * Nth packet of each RX queue or all the packets of 1 in N flows, chosen by a
+ * hash of the addresses and ports. The pcap records keep the original length.
  */
 
 #include <stddef.h>
+#include <stdbool.h>
 #include <inttypes.h>
+#include <pthread.h>
 
 #include <rte_memzone.h>
 #include <rte_mbuf.h>
+#include <rte_ring.h>
 
 #include "pktgen-port-cfg.h"
 
@@ -37,6 +66,17 @@ typedef struct cap_hdr_s {
     uint8_t pkt[0];    /**< Inline packet data (flexible array) */
 } cap_hdr_t;
 
+#define CAP_CLOCK_READS   8    /**< Paired timer and wall clock reads, the closest pair is kept */
+#define CAP_CLOCK_MIN_MS  1000 /**< Least capture time the timer frequency is measured over */
+#define CAP_CLOCK_MAX_PPM 500  /**< Largest timer frequency correction accepted */
+
+/** Conversion of capture timer values to wall clock time. */
+typedef struct cap_clock_s {
+    uint64_t tsc0; /**< Timer value at the anchor */
+    uint64_t ns0;  /**< Wall clock time in ns since the epoch at tsc0 */
+    uint64_t hz;   /**< Timer frequency */
+} cap_clock_t;
+
 /** Capture buffer state for one NUMA socket. */
 typedef struct capture_s {
     const struct rte_memzone *mz; /**< Memory region to store packets */
@@ -45,8 +85,123 @@ typedef struct capture_s {
     size_t used;                  /**< Memory used by captured packets */
     uint32_t nb_pkts;             /**< Number of packets in capture pool */
     uint16_t port;                /**< port for this memzone */
+    uint16_t snaplen;             /**< Bytes kept of each packet, taken when the capture started */
+    cap_clock_t clock;            /**< Anchor taken when the capture started */
 } capture_t;
 
+/** Capture modes of a port. */
+enum {
+    CAPTURE_MODE_MEMORY = 0, /**< Capture into the socket memzone, write on disable */
+    CAPTURE_MODE_DISK,       /**< Stream the capture to a file while it is enabled */
+    CAPTURE_MODE_RING,       /**< Flight recorder, write the window around a trigger */
+};
+
+/** Capture sampling modes, cap_sample_cfg_t.mode. */
+enum {
+    CAP_SAMPLE_PACKET = 0, /**< Every Nth packet of each RX queue */
+    CAP_SAMPLE_FLOW,       /**< Every packet of the flows whose hash selects them */
+};
+
+#define CAP_SAMPLE_SEED 0x9e3779b9 /**< Seed of the flow hash of the capture sampler */
+
+/** Flight recorder triggers, cap_ring_cfg_t.triggers holds the automatic ones. */
+enum {
+    CAP_TRIG_CLI       = (1 << 0), /**< CLI or Lua freeze command */
+    CAP_TRIG_LATENCY   = (1 << 1), /**< Latency probe above cap_ring_cfg_t.lat_us */
+    CAP_TRIG_SEQ_GAP   = (1 << 2), /**< Latency probe sequence gap */
+    CAP_TRIG_RX_ERRORS = (1 << 3), /**< RX error or missed counter increase */
+};
+
+/** Flight recorder states, the recorder only moves forward through them. */
+enum {
+    CAP_RING_ARMED = 0,   /**< Recording and waiting for a trigger */
+    CAP_RING_TRIGGERING,  /**< A trigger is setting the window, still recording */
+    CAP_RING_TRIGGERED,   /**< Recording until the end of the post-trigger window */
+    CAP_RING_FROZEN,      /**< Recording stopped, the window is being written */
+    CAP_RING_DONE,        /**< Window written */
+};
+
+#define CAP_RING_DEFAULT_MB 1024        /**< Default flight recorder memory of a port */
+#define CAP_RING_MIN_BYTES  (1UL << 20) /**< Least recorder memory of an RX queue */
+#define CAP_RING_ALIGN      16          /**< Alignment of flight recorder records */
+#define CAP_RING_POLL_US    10000       /**< Period of the flight recorder thread */
+
+#define CAP_BLOCK_SIZE      (2UL << 20) /**< Bytes of a block of records of a disk capture */
+#define CAP_DISK_DEFAULT_MB 128         /**< Default disk capture block memory of an RX queue */
+#define CAP_DISK_MIN_MB     4           /**< Least disk capture block memory of an RX queue */
+#define CAP_FLUSH_MS        100         /**< Age at which a partly filled block is handed over */
+#define CAP_WRITER_BURST    16          /**< Blocks the writer takes from a queue at a time */
+#define CAP_WRITER_IDLE     100         /**< Writer sleep in us when no block is ready */
+
+/** Block of capture records handed from an RX queue to the disk writer. */
+typedef struct cap_block_s {
+    uint64_t start;                     /**< Time the first record was added */
+    uint32_t used;                      /**< Bytes of records in data */
+    uint32_t nb_pkts;                   /**< Number of records in data */
+    uint8_t data[] __rte_cache_aligned; /**< cap_hdr_t records, each 8 byte aligned */
+} cap_block_t;
+
+/** Disk capture state of one RX queue, filled only by the lcore serving the queue. */
+typedef struct cap_queue_s {
+    struct rte_ring *full; /**< Filled blocks for the writer */
+    struct rte_ring *free; /**< Empty blocks for the RX queue */
+    cap_block_t *cur;      /**< Block being filled, NULL when none is free */
+    void *mem;             /**< Memory of all the blocks of the queue */
+    uint64_t pkts;         /**< Packets added to blocks */
+    uint64_t drops;        /**< Packets not captured for lack of a free block */
+} cap_queue_t __rte_cache_aligned;
+
+/** Disk capture of a port. */
+typedef struct cap_disk_s {
+    pthread_t tid;                       /**< Writer thread */
+    volatile int running;                /**< Cleared to make the writer drain the rings and exit */
+    uint16_t pid;                        /**< Port captured */
+    uint16_t nb_queues;                  /**< RX queues of the port */
+    uint16_t snaplen;                    /**< Bytes kept of each packet */
+    uint32_t nb_blocks;                  /**< Blocks of each RX queue */
+    pcap_writer_t *w;                    /**< Output file */
+    char filename[64];                   /**< Name of the output file */
+    cap_clock_t clock;                   /**< Anchor taken when the capture started */
+    uint64_t pkts;                       /**< Records written by the writer */
+    uint64_t bytes;                      /**< Packet bytes written by the writer */
+    uint64_t errors;                     /**< Records the writer failed to write */
+    cap_queue_t q[MAX_QUEUES_PER_PORT];  /**< Per RX queue state */
+} cap_disk_t;
+
+/** Flight recorder buffer of one RX queue, written only by the lcore serving the queue. */
+typedef struct cap_ring_q_s {
+    uint8_t *buf;         /**< Circular buffer of cap_hdr_t records and wrap markers */
+    uint64_t size;        /**< Bytes of buf, a multiple of CAP_RING_ALIGN */
+    uint64_t head;        /**< Offset of the oldest record */
+    uint64_t tail;        /**< Offset the next record is written at */
+    uint64_t used;        /**< Bytes from head to tail */
+    uint64_t nb_recs;     /**< Records held */
+    uint64_t pkts;        /**< Records added since the recorder started */
+    uint64_t overwritten; /**< Records dropped to make room for new ones */
+} cap_ring_q_t __rte_cache_aligned;
+
+/** Flight recorder of a port. */
+typedef struct cap_ring_s {
+    volatile uint32_t state;            /**< CAP_RING_* */
+    uint32_t why;                       /**< CAP_TRIG_* that fired */
+    uint32_t triggers;                  /**< CAP_TRIG_* automatic triggers armed */
+    uint16_t pid;                       /**< Port recorded */
+    uint16_t nb_queues;                 /**< RX queues of the port */
+    uint16_t snaplen;                   /**< Bytes kept of each packet */
+    uint64_t lat_cycles;                /**< Latency trigger in timer cycles, 0 for none */
+    uint64_t trig_tsc;                  /**< Time the trigger fired */
+    uint64_t stop_tsc;                  /**< End of the post-trigger window */
+    uint64_t pre_cycles;                /**< Pre-trigger window, 0 for all records held */
+    uint64_t post_cycles;               /**< Post-trigger window */
+    cap_clock_t clock;                  /**< Anchor taken when the recorder started */
+    uint64_t errors;                    /**< RX error and missed count last seen */
+    uint64_t written;                   /**< Records written to the file */
+    pthread_t tid;                      /**< Thread watching the triggers and writing */
+    volatile int running;               /**< Cleared to make the thread exit */
+    char filename[64];                  /**< Name of the output file */
+    cap_ring_q_t q[MAX_QUEUES_PER_PORT]; /**< Per RX queue buffers */
+} cap_ring_t;
+
 /**
  * Allocate and initialise the capture memzone for a NUMA socket.
  *
@@ -63,15 +218,173 @@ void pktgen_packet_capture_init(uint16_t socket_id);
  */
 void pktgen_set_capture(port_info_t *pinfo, uint32_t onOff);
 
+/**
+ * Select the packets of a received burst the capture sampling of a port keeps.
+ *
+ * The caller reads the sampling rate of the port once and passes it, so a rate
+ * changed by the CLI while a burst is sampled cannot reach the modulo as 0.
+ *
+ * @param pinfo    Per-port state.
+ * @param qid      RX queue the packets were received on.
+ * @param rate     Sampling rate read by the caller, 0 or 1 keeps every packet.
+ * @param pkts     Received packets, at most MAX_PKT_RX_BURST.
+ * @param nb_pkts  Number of packets in @p pkts.
+ * @param keep     Filled with the packets to capture, in receive order.
+ * @return
+ *   Number of packets placed in @p keep.
+ */
+uint16_t pktgen_capture_sample_bulk(port_info_t *pinfo, uint16_t qid, uint32_t rate,
+                                    struct rte_mbuf **pkts, uint16_t nb_pkts,
+                                    struct rte_mbuf **keep);
+
 /**
  * Capture a burst of received packets into the per-socket capture buffer.
  *
+ * Each packet is stamped with its NIC RX time when the port has RX timestamps,
+ * otherwise with the time it is captured.
+ *
  * @param pkts     Array of mbufs to capture.
  * @param nb_dump  Number of mbufs in @p pkts.
  * @param capture  Capture state for the NUMA socket.
  */
 void pktgen_packet_capture_bulk(struct rte_mbuf **pkts, uint32_t nb_dump, capture_t *capture);
 
+/**
+ * Add a burst of received packets to the disk capture of the RX queue.
+ *
+ * Packets are stamped with their NIC RX time when the port has RX timestamps,
+ * otherwise with the time of the burst.
+ *
+ * @param cd       Disk capture of the port.
+ * @param qid      RX queue the packets were received on.
+ * @param pkts     Array of mbufs to capture.
+ * @param nb_pkts  Number of mbufs in @p pkts.
+ */
+void pktgen_packet_capture_disk(cap_disk_t *cd, uint16_t qid, struct rte_mbuf **pkts,
+                                uint32_t nb_pkts);
+
+/**
+ * Hand over the partly filled disk capture block of an RX queue once it is old.
+ *
+ * Called by the lcore of the RX queue when a burst gives it nothing to capture,
+ * so the last packets of a capture that went quiet still reach the file.
+ *
+ * @param cd   Disk capture of the port.
+ * @param qid  RX queue of the lcore.
+ */
+void pktgen_packet_capture_disk_flush(cap_disk_t *cd, uint16_t qid);
+
+/**
+ * Set the disk capture block memory of a port.
+ *
+ * @param pinfo    Per-port state, used by the next disk capture started.
+ * @param size_mb  Block memory of each RX queue, 0 for CAP_DISK_DEFAULT_MB.
+ * @return
+ *   0 on success or -1 when the size is below CAP_DISK_MIN_MB.
+ */
+int pktgen_capture_disk_set(port_info_t *pinfo, uint32_t size_mb);
+
+/**
+ * Add a burst of received packets to the flight recorder of the RX queue.
+ *
+ * Packets are stamped like pktgen_packet_capture_disk() does.
+ *
+ * @param cr       Flight recorder of the port.
+ * @param qid      RX queue the packets were received on.
+ * @param pkts     Array of mbufs to capture.
+ * @param nb_pkts  Number of mbufs in @p pkts.
+ */
+void pktgen_packet_capture_ring(cap_ring_t *cr, uint16_t qid, struct rte_mbuf **pkts,
+                                uint32_t nb_pkts);
+
+/**
+ * Fire a trigger of the flight recorder of a port.
+ *
+ * Only the first trigger after the recorder starts counts, later ones are
+ * ignored. Safe to call from the RX lcores.
+ *
+ * @param pinfo  Per-port state.
+ * @param why    CAP_TRIG_* that fired.
+ */
+void pktgen_capture_trigger(port_info_t *pinfo, uint32_t why);
+
+/**
+ * Set the flight recorder memory and window of a port.
+ *
+ * @param pinfo    Per-port state, used by the next flight recorder started.
+ * @param size_mb  Memory split over the RX queues, 0 for CAP_RING_DEFAULT_MB.
+ * @param pre_ms   Time before the trigger written, 0 for all that is held.
+ * @param post_ms  Time the capture runs on after the trigger.
+ */
+void pktgen_capture_ring_set(port_info_t *pinfo, uint32_t size_mb, uint32_t pre_ms,
+                             uint32_t post_ms);
+
+/**
+ * Arm or disarm an automatic trigger of the flight recorder of a port.
+ *
+ * @param pinfo  Per-port state, used by the next flight recorder started.
+ * @param what   "latency", "gap" or "errors".
+ * @param value  For latency the threshold in us, 0 to disarm. For the others
+ *               non-zero arms the trigger.
+ * @return
+ *   0 on success or -1 on error.
+ */
+int pktgen_capture_ring_trigger(port_info_t *pinfo, const char *what, uint32_t value);
+
+/**
+ * Set the capture mode of a port.
+ *
+ * @param pinfo  Per-port state, the capture must be disabled.
+ * @param mode   "memory", "disk" or "ring".
+ * @return
+ *   0 on success or -1 on error.
+ */
+int pktgen_capture_mode(port_info_t *pinfo, const char *mode);
+
+/**
+ * Return the name of the capture mode of a port.
+ *
+ * @param pinfo  Per-port state.
+ * @return
+ *   "memory", "disk" or "ring".
+ */
+const char *pktgen_capture_mode_name(port_info_t *pinfo);
+
+/**
+ * Enable or disable O_DIRECT for the files of disk captures of a port.
+ *
+ * @param pinfo  Per-port state, used by the next disk capture started.
+ * @param onOff  ENABLE_STATE or DISABLE_STATE.
+ */
+void pktgen_capture_direct(port_info_t *pinfo, uint32_t onOff);
+
+/**
+ * Set the snap length of the captures of a port.
+ *
+ * @param pinfo    Per-port state, used by the next capture started.
+ * @param snaplen  Bytes kept of each packet, 0 keeps the whole first segment.
+ */
+void pktgen_capture_snaplen(port_info_t *pinfo, uint32_t snaplen);
+
+/**
+ * Set the capture sampling of a port, it applies at once.
+ *
+ * @param pinfo  Per-port state.
+ * @param mode   "packet" for 1 in @p rate packets of each RX queue, "flow" for
+ *               the packets of 1 in @p rate flows.
+ * @param rate   Sampling rate, 0 or 1 captures every packet.
+ * @return
+ *   0 on success or -1 on error.
+ */
+int pktgen_capture_sample(port_info_t *pinfo, const char *mode, uint32_t rate);
+
+/**
+ * Print the capture settings and the disk capture counters of a port.
+ *
+ * @param pinfo  Per-port state.
+ */
+void pktgen_capture_show(port_info_t *pinfo);
+
 #ifdef __cplusplus
 }
 #endif
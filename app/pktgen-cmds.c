@@ -209,10 +209,55 @@ pktgen_script_save(char *path)
 
         fprintf(fd, "#\n# Port flag values:\n");
         fprintf(fd, "%sable %d icmp\n", (flags & ICMP_ECHO_ENABLE_FLAG) ? "en" : "dis", i);
+        if (l2p_get_pcap(pinfo->pid)) {
+            pcap_info_t *pcap = l2p_get_pcap(pinfo->pid);
+
+            if (pcap->speed > 0.0)
+                fprintf(fd, "pcap %d speed %g\n", i, pcap->speed);
+            else
+                fprintf(fd, "pcap %d speed top\n", i);
+            fprintf(fd, "pcap %d timing %s\n", i, (flags & SEND_PCAP_TIMED) ? "on" : "off");
+        }
+        fprintf(fd, "pcap %d format %s\n", i, pktgen_pcap_format_name(pinfo->pcap_fmt));
+        if (pinfo->rx_filter)
+            fprintf(fd, "pcap filter %d \"%s\"\n", i, pktgen_rx_filter_expr(pinfo));
         fprintf(fd, "%sable %d pcap\n", (flags & SEND_PCAP_PKTS) ? "en" : "dis", i);
         fprintf(fd, "%sable %d range\n", (flags & SEND_RANGE_PKTS) ? "en" : "dis", i);
+        if (pinfo->imix) {
+            fprintf(fd, "set %d imix %s\n", i, pinfo->imix->spec);
+            fprintf(fd, "%sable %d imix\n", (flags & SEND_IMIX_PKTS) ? "en" : "dis", i);
+        }
+        if (pinfo->streams) {
+            for (uint16_t s = 0; s < STREAM_MAX; s++) {
+                stream_t *st = &pinfo->streams->streams[s];
+
+                fprintf(fd, "stream %d %d rate %.4f\n", i, s, st->rate);
+                fprintf(fd, "stream %d %d count %" PRIu64 "\n", i, s, st->count);
+                fprintf(fd, "stream %d %d model %s\n", i, s,
+                        (st->model == TX_ARRIVAL_POISSON) ? "poisson" : "periodic");
+                fprintf(fd, "stream %d %d %s\n", i, s, st->enabled ? "on" : "off");
+            }
+            fprintf(fd, "%sable %d streams\n", (flags & SEND_STREAM_PKTS) ? "en" : "dis", i);
+        }
         fprintf(fd, "%sable %d latency\n", (flags & SEND_LATENCY_PKTS) ? "en" : "dis", i);
+        fprintf(fd, "%sable %d signature\n", (flags & SIGNATURE_PKTS) ? "en" : "dis", i);
         fprintf(fd, "%sable %d process\n", (flags & PROCESS_INPUT_PKTS) ? "en" : "dis", i);
+        fprintf(fd, "capture %d mode %s\n", i, pktgen_capture_mode_name(pinfo));
+        fprintf(fd, "capture %d direct %s\n", i, pinfo->capture_direct ? "on" : "off");
+        fprintf(fd, "capture %d disk %u\n", i, pinfo->cap_disk_mb);
+        fprintf(fd, "capture %d ring %u %u %u\n", i, pinfo->cap_ring_cfg.size_mb,
+                pinfo->cap_ring_cfg.pre_ms, pinfo->cap_ring_cfg.post_ms);
+        fprintf(fd, "capture %d trigger latency %u\n", i,
+                (pinfo->cap_ring_cfg.triggers & CAP_TRIG_LATENCY) ? pinfo->cap_ring_cfg.lat_us
+                                                                  : 0);
+        fprintf(fd, "capture %d trigger gap %s\n", i,
+                (pinfo->cap_ring_cfg.triggers & CAP_TRIG_SEQ_GAP) ? "on" : "off");
+        fprintf(fd, "capture %d trigger errors %s\n", i,
+                (pinfo->cap_ring_cfg.triggers & CAP_TRIG_RX_ERRORS) ? "on" : "off");
+        fprintf(fd, "capture %d snaplen %u\n", i, pinfo->cap_sample.snaplen);
+        fprintf(fd, "capture %d sample %s %u\n", i,
+                (pinfo->cap_sample.mode == CAP_SAMPLE_FLOW) ? "flow" : "packet",
+                pinfo->cap_sample.rate);
         fprintf(fd, "%sable %d capture\n", (flags & CAPTURE_PKTS) ? "en" : "dis", i);
         fprintf(fd, "%sable %d vlan\n", (flags & SEND_VLAN_ID) ? "en" : "dis", i);
 
@@ -541,13 +586,70 @@ pktgen_lua_save(char *path)
         fprintf(fd, "--\n-- Port flag values:\n");
         fprintf(fd, "pktgen.icmp_echo('%d', '%sable');\n", i,
                 (flags & ICMP_ECHO_ENABLE_FLAG) ? "en" : "dis");
+        if (l2p_get_pcap(pinfo->pid)) {
+            pcap_info_t *pcap = l2p_get_pcap(pinfo->pid);
+
+            if (pcap->speed > 0.0)
+                fprintf(fd, "pktgen.pcap_timing('%d', '%s', %g);\n", i,
+                        (flags & SEND_PCAP_TIMED) ? "on" : "off", pcap->speed);
+            else
+                fprintf(fd, "pktgen.pcap_timing('%d', '%s', 'top');\n", i,
+                        (flags & SEND_PCAP_TIMED) ? "on" : "off");
+        }
+        fprintf(fd, "pktgen.pcap_format('%d', '%s');\n", i,
+                pktgen_pcap_format_name(pinfo->pcap_fmt));
+        if (pinfo->rx_filter)
+            fprintf(fd, "pktgen.pcap_filter('%d', \"%s\");\n", i, pktgen_rx_filter_expr(pinfo));
         fprintf(fd, "pktgen.pcap('%d', '%sable');\n", i, (flags & SEND_PCAP_PKTS) ? "en" : "dis");
         fprintf(fd, "pktgen.set_range('%d', '%sable');\n", i,
                 (flags & SEND_RANGE_PKTS) ? "en" : "dis");
+        if (pinfo->imix) {
+            const char *arg = strchr(pinfo->imix->spec, ' ');
+
+            if (arg)
+                fprintf(fd, "pktgen.imix('%d', '%.*s', '%s');\n", i,
+                        (int)(arg - pinfo->imix->spec), pinfo->imix->spec, arg + 1);
+            else
+                fprintf(fd, "pktgen.imix('%d', '%s');\n", i, pinfo->imix->spec);
+            fprintf(fd, "pktgen.imix('%d', '%sable');\n", i,
+                    (flags & SEND_IMIX_PKTS) ? "en" : "dis");
+        }
+        if (pinfo->streams) {
+            for (uint16_t s = 0; s < STREAM_MAX; s++) {
+                stream_t *st = &pinfo->streams->streams[s];
+
+                fprintf(fd, "pktgen.stream('%d', %d, 'rate', %.4f);\n", i, s, st->rate);
+                fprintf(fd, "pktgen.stream('%d', %d, 'count', %" PRIu64 ");\n", i, s,
+                        st->count);
+                fprintf(fd, "pktgen.stream('%d', %d, 'model', '%s');\n", i, s,
+                        (st->model == TX_ARRIVAL_POISSON) ? "poisson" : "periodic");
+                fprintf(fd, "pktgen.stream('%d', %d, '%s');\n", i, s,
+                        st->enabled ? "on" : "off");
+            }
+            fprintf(fd, "pktgen.stream('%d', '%sable');\n", i,
+                    (flags & SEND_STREAM_PKTS) ? "en" : "dis");
+        }
         fprintf(fd, "pktgen.latency('%d', '%sable');\n", i,
                 (flags & SEND_LATENCY_PKTS) ? "en" : "dis");
+        fprintf(fd, "pktgen.signature('%d', '%sable');\n", i,
+                (flags & SIGNATURE_PKTS) ? "en" : "dis");
         fprintf(fd, "pktgen.process('%d', '%sable');\n", i,
                 (flags & PROCESS_INPUT_PKTS) ? "en" : "dis");
+        fprintf(fd, "pktgen.capture_mode('%d', '%s', '%s');\n", i, pktgen_capture_mode_name(pinfo),
+                pinfo->capture_direct ? "on" : "off");
+        fprintf(fd, "pktgen.capture_disk('%d', %u);\n", i, pinfo->cap_disk_mb);
+        fprintf(fd, "pktgen.capture_ring('%d', %u, %u, %u);\n", i, pinfo->cap_ring_cfg.size_mb,
+                pinfo->cap_ring_cfg.pre_ms, pinfo->cap_ring_cfg.post_ms);
+        fprintf(fd, "pktgen.capture_trigger('%d', 'latency', %u);\n", i,
+                (pinfo->cap_ring_cfg.triggers & CAP_TRIG_LATENCY) ? pinfo->cap_ring_cfg.lat_us
+                                                                  : 0);
+        fprintf(fd, "pktgen.capture_trigger('%d', 'gap', '%s');\n", i,
+                (pinfo->cap_ring_cfg.triggers & CAP_TRIG_SEQ_GAP) ? "on" : "off");
+        fprintf(fd, "pktgen.capture_trigger('%d', 'errors', '%s');\n", i,
+                (pinfo->cap_ring_cfg.triggers & CAP_TRIG_RX_ERRORS) ? "on" : "off");
+        fprintf(fd, "pktgen.capture_snaplen('%d', %u);\n", i, pinfo->cap_sample.snaplen);
+        fprintf(fd, "pktgen.capture_sample('%d', %u, '%s');\n", i, pinfo->cap_sample.rate,
+                (pinfo->cap_sample.mode == CAP_SAMPLE_FLOW) ? "flow" : "packet");
         fprintf(fd, "pktgen.capture('%d', '%sable');\n", i, (flags & CAPTURE_PKTS) ? "en" : "dis");
         fprintf(fd, "pktgen.vlan('%d', '%sable');\n\n", i, (flags & SEND_VLAN_ID) ? "en" : "dis");
         fflush(fd);
@@ -905,6 +1007,8 @@ pktgen_flags_string(port_info_t *pinfo)
              (flags & SEND_PCAP_PKTS)             ? "PCAP"
              : (flags & SEND_SEQ_PKTS)            ? "Seq"
              : (flags & SEND_RANGE_PKTS)          ? "Range"
+             : (flags & SEND_STREAM_PKTS)         ? "Stream"
+             : (flags & SEND_IMIX_PKTS)           ? "IMIX"
              : (flags & SEND_SINGLE_PKTS)         ? "Single"
                                                   : "Unkn");
     // clang-format on
@@ -1167,6 +1271,76 @@ enable_random(port_info_t *pinfo, uint32_t onOff)
         pktgen_clr_port_flags(pinfo, SEND_RANDOM_PKTS);
 }
 
+/**
+ *
+ * enable_imix - Enable or disable sending single packets with the IMIX sizes.
+ *
+ * DESCRIPTION
+ * Enable or disable the IMIX packet sizes, set with the 'set <portlist> imix'
+ * command, for the single packet mode.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+
+void
+enable_imix(port_info_t *pinfo, uint32_t onOff)
+{
+    if (pktgen_tst_port_flags(pinfo, SENDING_PACKETS)) {
+        pktgen_log_warning("Cannot change the IMIX mode while sending packets!");
+        return;
+    }
+
+    if (onOff == ENABLE_STATE) {
+        if (pinfo->imix == NULL) {
+            pktgen_log_warning("Port %d has no IMIX, use 'set %d imix ...' first", pinfo->pid,
+                               pinfo->pid);
+            return;
+        }
+        pktgen_clr_port_flags(pinfo, EXCLUSIVE_MODES);
+        pktgen_set_port_flags(pinfo, SEND_IMIX_PKTS | SEND_SINGLE_PKTS);
+    } else
+        pktgen_clr_port_flags(pinfo, SEND_IMIX_PKTS);
+
+    pktgen_packet_rate(pinfo);
+}
+
+/**
+ *
+ * enable_streams - Enable or disable sending the streams of a port.
+ *
+ * DESCRIPTION
+ * Stream mode sends the enabled streams, set with the 'stream' command, in place
+ * of the other packet sending modes.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+
+void
+enable_streams(port_info_t *pinfo, uint32_t onOff)
+{
+    if (pktgen_tst_port_flags(pinfo, SENDING_PACKETS)) {
+        pktgen_log_warning("Cannot change the stream mode while sending packets!");
+        return;
+    }
+
+    if (onOff == ENABLE_STATE) {
+        if (!pktgen_stream_ready(pinfo)) {
+            pktgen_log_warning("Port %d has no enabled stream, use 'stream %d <id> on' first",
+                               pinfo->pid, pinfo->pid);
+            return;
+        }
+        pktgen_clr_port_flags(pinfo, EXCLUSIVE_MODES);
+        pktgen_set_port_flags(pinfo, SEND_STREAM_PKTS);
+    } else if (pktgen_tst_port_flags(pinfo, SEND_STREAM_PKTS)) {
+        pktgen_clr_port_flags(pinfo, EXCLUSIVE_MODES);
+        pktgen_set_port_flags(pinfo, SEND_SINGLE_PKTS);
+    }
+}
+
 void
 enable_clock_gettime(uint32_t onOff)
 {
@@ -1269,6 +1443,7 @@ pktgen_start_transmitting(port_info_t *pinfo)
 
         pktgen_set_port_flags(pinfo, SETUP_TRANSMIT_PKTS);
         pktgen_setup_packets(pinfo->pid);        // will clear the SETUP_TRANSMIT_PKTS flag
+        rate_profile_restart(pinfo);
         pktgen_set_port_flags(pinfo, SENDING_PACKETS);
     }
 }
@@ -1336,6 +1511,7 @@ void
 pktgen_start_latency_sampler(port_info_t *pinfo)
 {
     uint16_t q, rxq;
+    uint32_t per_q;
 
     /* Start sampler */
     if (pktgen_tst_port_flags(pinfo, SAMPLING_LATENCIES)) {
@@ -1344,7 +1520,7 @@ pktgen_start_latency_sampler(port_info_t *pinfo)
     }
 
     if (pinfo->latsamp_rate == 0 || pinfo->latsamp_type == LATSAMPLER_UNSPEC ||
-        pinfo->latsamp_num_samples == 0) {
+        pinfo->latsamp_outfile[0] == '\0') {
         pktgen_log_error("Set proper sampling type, number, rate and outfile!");
         return;
     }
@@ -1356,20 +1532,30 @@ pktgen_start_latency_sampler(port_info_t *pinfo)
         return;
     }
 
+    /* Spread the sample count over the queues, zero means sample until stopped */
+    per_q = pinfo->latsamp_num_samples / rxq;
     for (q = 0; q < rxq; q++) {
-        pinfo->latsamp_stats[q].next        = 0;
-        pinfo->latsamp_stats[q].idx         = 0;
-        pinfo->latsamp_stats[q].num_samples = pinfo->latsamp_num_samples / rxq;
-        pktgen_log_info("Assigning %d sample latencies to queue %d",
-                        pinfo->latsamp_num_samples / rxq, q);
+        latsamp_stats_t *stats = &pinfo->latsamp_stats[q];
+
+        stats->next        = 0;
+        stats->count       = 0;
+        stats->dropped     = 0;
+        if (pinfo->latsamp_num_samples == 0)
+            stats->num_samples = UINT64_MAX;
+        else
+            stats->num_samples = per_q + ((q < pinfo->latsamp_num_samples % rxq) ? 1 : 0);
     }
 
+    if (pktgen_latsamp_open(pinfo) < 0)
+        return;
+    pktgen_log_info("Streaming sample latencies to %s", pinfo->latsamp_outfile);
+
     if (pinfo->seq_pkt[LATENCY_PKT].pkt_size <
         (RTE_ETHER_MIN_LEN - RTE_ETHER_CRC_LEN) + sizeof(tstamp_t))
         pinfo->seq_pkt[LATENCY_PKT].pkt_size += sizeof(tstamp_t);
 
     pinfo->seq_pkt[LATENCY_PKT].ipProto = PG_IPPROTO_UDP;
-    pktgen_packet_ctor(pinfo, LATENCY_PKT, -1);
+    pktgen_latency_template(pinfo);
 
     /* Start sampling */
     pktgen_set_port_flags(pinfo, SAMPLING_LATENCIES);
@@ -1389,8 +1575,6 @@ pktgen_start_latency_sampler(port_info_t *pinfo)
 void
 pktgen_stop_latency_sampler(port_info_t *pinfo)
 {
-    FILE *outfile;
-    uint32_t i, count;
     uint16_t q, rxq = l2p_get_rxcnt(pinfo->pid);
 
     if (!pktgen_tst_port_flags(pinfo, SAMPLING_LATENCIES)) {
@@ -1401,33 +1585,17 @@ pktgen_stop_latency_sampler(port_info_t *pinfo)
     /* Stop sampling */
     pktgen_clr_port_flags(pinfo, SAMPLING_LATENCIES);
 
-    /* Dump stats to file */
-    outfile = fopen(pinfo->latsamp_outfile, "w");
-    if (outfile == NULL)
-        pktgen_log_error("Cannot open the latency outfile!");
-    else {
-        pktgen_log_info("Writing to file %s", pinfo->latsamp_outfile);
-        fprintf(outfile, "Latency\n");
-        for (q = 0, count = 0; q < rxq; q++) {
-            pktgen_log_info("Writing sample latencies of queue %d", q);
-            for (i = 0; i < pinfo->latsamp_stats[q].idx; i++) {
-                fprintf(outfile, "%" PRIu64 "\n", pinfo->latsamp_stats[q].data[i]);
-                count++;
-            }
-        }
-        fclose(outfile);
-        pktgen_log_warning("Wrote %d sample latencies to file %s", count, pinfo->latsamp_outfile);
-    }
+    /* Write out the samples still queued and close the file */
+    pktgen_latsamp_close(pinfo);
 
     /* Reset stats data */
     for (q = 0; q < rxq; q++) {
         pinfo->latsamp_stats[q].next        = 0;
-        pinfo->latsamp_stats[q].idx         = 0;
         pinfo->latsamp_stats[q].num_samples = 0;
     }
 
     pinfo->seq_pkt[LATENCY_PKT].ipProto = PG_IPPROTO_UDP;
-    pktgen_packet_ctor(pinfo, LATENCY_PKT, -1);
+    pktgen_latency_template(pinfo);
 }
 
 /**
@@ -1530,30 +1698,30 @@ enable_pcap(port_info_t *pinfo, uint32_t state)
             pktgen_set_port_flags(pinfo, SEND_SINGLE_PKTS);
         }
         pinfo->tx_cycles = 0;
+
+        /* The wire size and, for a streamed file, the TX queues sending change */
+        pktgen_packet_rate(pinfo);
     }
 }
 
 /**
  *
- * pcap_filter - Compile a PCAP filter for a portlist
+ * pcap_filter - Set the RX filter of a port from a PCAP filter string
  *
  * DESCRIPTION
- * Compile a pcap filter for a portlist
+ * Compile the pcap filter string and load it as the RX filter of the port,
+ * "off" removes the filter. Only the packets the filter accepts are captured,
+ * dumped and counted as filtered.
  *
- * RETURNS: N/A
+ * RETURNS: 0 on success or -1 on error
  *
  * SEE ALSO:
  */
 
-void
+int
 pcap_filter(port_info_t *pinfo, char *str)
 {
-    pcap_t *pc        = pcap_open_dead(DLT_EN10MB, 65535);
-    pcap_info_t *pcap = l2p_get_pcap(pinfo->pid);
-
-    pcap->pcap_result = pcap_compile(pc, &pcap->pcap_program, str, 1, PCAP_NETMASK_UNKNOWN);
-
-    pcap_close(pc);
+    return pktgen_rx_filter_set(pinfo, str);
 }
 
 /**
@@ -2043,10 +2211,6 @@ single_set_latsampler_params(port_info_t *pinfo, char *type, uint32_t num_sample
     }
     fclose(fp);
 
-    if (num_samples > MAX_LATENCY_ENTRIES) {
-        pktgen_log_error("Too many samples requested. Max %d!", MAX_LATENCY_ENTRIES);
-        return;
-    }
 
     pinfo->latsamp_type        = sampler_type;
     pinfo->latsamp_rate        = sampling_rate;
@@ -2260,6 +2424,10 @@ pktgen_clear_stats(port_info_t *pinfo)
     latency_t *lat = &pinfo->latency;
 
     memset(lat->stats, 0, (lat->end_stats - lat->stats) * sizeof(uint64_t));
+    /* The lcores reset their own queues at their next burst */
+    pinfo->lat_clear_gen++;
+
+    pktgen_sig_clear(pinfo);
 
     memset(&pktgen.cumm_rate_totals, 0, sizeof(struct rte_eth_stats));
 }
@@ -2658,7 +2826,14 @@ single_set_rx_burst(port_info_t *pinfo, uint32_t burst)
 void
 debug_set_tx_cycles(port_info_t *pinfo, uint32_t cycles)
 {
+    double pps = 0.0;
+
+    /* Pace one tx_burst every cycles, zero cycles sends without pacing */
+    if (cycles)
+        pps = ((double)pinfo->tx_burst * pktgen_get_timer_hz()) / cycles;
+
     pinfo->tx_cycles = cycles;
+    pktgen_tx_pace_set(pinfo, pps, pinfo->tx_burst, pinfo->tx_pace_cfg.pps_per_pcnt);
 }
 
 /**
@@ -3129,6 +3304,31 @@ enable_latency(port_info_t *pinfo, uint32_t state)
         pktgen_clr_port_flags(pinfo, SEND_LATENCY_PKTS);
 }
 
+/**
+ *
+ * enable_signature - Enable or disable payload signatures.
+ *
+ * DESCRIPTION
+ * Sign the data packets the port sends and analyze the signed packets it
+ * receives. The analyzers of the RX queues are allocated the first time.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+
+void
+enable_signature(port_info_t *pinfo, uint32_t state)
+{
+    if (state == ENABLE_STATE) {
+        if (pktgen_sig_setup(pinfo))
+            return;
+
+        pktgen_set_port_flags(pinfo, SIGNATURE_PKTS);
+    } else
+        pktgen_clr_port_flags(pinfo, SIGNATURE_PKTS);
+}
+
 /**
  *
  * single_set_jitter - Set the jitter threshold.
@@ -3149,6 +3349,8 @@ single_set_jitter(port_info_t *pinfo, uint64_t threshold)
 
     lat->jitter_threshold_us     = threshold;
     lat->jitter_count            = 0;
+    for (int q = 0; q < MAX_QUEUES_PER_PORT; q++)
+        pinfo->rx_latency[q].jitter_count = 0;
     us_per_tick                  = pktgen_get_timer_hz() / 1000000;
     lat->jitter_threshold_cycles = lat->jitter_threshold_us * us_per_tick;
 }
@@ -3176,6 +3378,7 @@ pattern_set_type(port_info_t *pinfo, char *str)
         pinfo->fill_pattern_type = USER_FILL_PATTERN;
     else if (strncmp(str, "zero", 4) == 0)
         pinfo->fill_pattern_type = ZERO_FILL_PATTERN;
+    pktgen_fill_pattern_update(pinfo);
 }
 
 /**
@@ -3205,6 +3408,7 @@ pattern_set_user_pattern(port_info_t *pinfo, char *str)
     memset(pinfo->user_pattern, 0, USER_PATTERN_SIZE);
     snprintf(pinfo->user_pattern, USER_PATTERN_SIZE, "%s", cp);
     pinfo->fill_pattern_type = USER_FILL_PATTERN;
+    pktgen_fill_pattern_update(pinfo);
 }
 
 /**
@@ -3831,7 +4035,7 @@ _pcap_file_open(port_info_t *port, char *filename)
 {
     _pcap_file_close(port);
 
-    port->pcap_file = pktgen_create_pcap_file(filename);
+    port->pcap_file = pktgen_create_pcap_file(filename, port->pcap_fmt, NULL);
 }
 
 void
@@ -3840,7 +4044,8 @@ pktgen_pcap_handler(port_info_t *pinfo, uint32_t state)
     if (state == ENABLE_STATE) {
         char filename[64];
 
-        snprintf(filename, sizeof(filename), "tx-%d.pcap", pinfo->pid);
+        snprintf(filename, sizeof(filename), "tx-%d.%s", pinfo->pid,
+                 (pinfo->pcap_fmt == PCAP_FMT_PCAPNG) ? "pcapng" : "pcap");
         _pcap_file_open(pinfo, filename);
     } else if (state == DISABLE_STATE) {
         _pcap_file_close(pinfo);
@@ -329,9 +329,18 @@ void enable_rnd_s_pt(port_info_t *pinfo, uint32_t state);
 /** Enable or disable random bitfield packet mode. */
 void enable_random(port_info_t *pinfo, uint32_t state);
 
+/** Enable or disable the IMIX packet sizes of the single packet mode. */
+void enable_imix(port_info_t *pinfo, uint32_t state);
+
+/** Enable or disable sending the streams of a port. */
+void enable_streams(port_info_t *pinfo, uint32_t state);
+
 /** Enable or disable latency measurement packet injection. */
 void enable_latency(port_info_t *pinfo, uint32_t state);
 
+/** Enable or disable signing sent data packets and analyzing received ones. */
+void enable_signature(port_info_t *pinfo, uint32_t state);
+
 /** Enable or disable global MAC-from-ARP learning. */
 void enable_mac_from_arp(uint32_t state);
 
@@ -358,7 +367,7 @@ void enable_bonding(port_info_t *pinfo, uint32_t state);
 /* PCAP */
 
 /** Set a BPF filter string for PCAP packet capture. */
-void pcap_filter(port_info_t *pinfo, char *str);
+int pcap_filter(port_info_t *pinfo, char *str);
 
 /* Range commands */
 
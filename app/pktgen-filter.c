@@ -0,0 +1,174 @@
+/*-
+ * Copyright(c) <2010-2026>, Intel Corporation. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <pcap/pcap.h>
+
+#include <rte_malloc.h>
+#include <rte_bpf.h>
+
+#include "pktgen.h"
+#include "pktgen-log.h"
+#include "pktgen-filter.h"
+
+/**
+ *
+ * rx_filter_free - Unload a filter and release its memory.
+ *
+ * DESCRIPTION
+ * Destroy the rte_bpf program and free the filter, NULL is ignored.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+static void
+rx_filter_free(rx_filter_t *flt)
+{
+    if (flt == NULL)
+        return;
+
+    rte_bpf_destroy(flt->bpf);
+    rte_free(flt);
+}
+
+/**
+ *
+ * rx_filter_load - Compile a libpcap filter expression into a loaded eBPF filter.
+ *
+ * DESCRIPTION
+ * Compile the expression to classic BPF for Ethernet frames, convert it to eBPF
+ * taking an mbuf as argument and load it on the socket of the port. The JIT
+ * code is looked up once so the RX path does not have to.
+ *
+ * RETURNS: New filter or NULL on error.
+ *
+ * SEE ALSO:
+ */
+static rx_filter_t *
+rx_filter_load(uint16_t pid, const char *expr)
+{
+#ifdef RTE_PORT_PCAP
+    struct bpf_program prog;
+    struct rte_bpf_prm *prm;
+    rx_filter_t *flt;
+    pcap_t *pc;
+    int ret;
+
+    pc = pcap_open_dead(DLT_EN10MB, 65535);
+    if (pc == NULL) {
+        pktgen_log_error("Port %d unable to open a pcap handle for the filter", pid);
+        return NULL;
+    }
+
+    ret = pcap_compile(pc, &prog, expr, 1, PCAP_NETMASK_UNKNOWN);
+    if (ret) {
+        pktgen_log_error("Port %d filter '%s': %s", pid, expr, pcap_geterr(pc));
+        pcap_close(pc);
+        return NULL;
+    }
+    pcap_close(pc);
+
+    prm = rte_bpf_convert(&prog);
+    pcap_freecode(&prog);
+    if (prm == NULL) {
+        pktgen_log_error("Port %d filter '%s' does not convert to eBPF: %s", pid, expr,
+                         rte_strerror(rte_errno));
+        return NULL;
+    }
+
+    flt = rte_zmalloc_socket("rx_filter", sizeof(*flt), RTE_CACHE_LINE_SIZE,
+                             rte_eth_dev_socket_id(pid));
+    if (flt == NULL) {
+        pktgen_log_error("Port %d unable to allocate the filter", pid);
+        rte_free(prm);
+        return NULL;
+    }
+
+    flt->bpf = rte_bpf_load(prm);
+    rte_free(prm);
+    if (flt->bpf == NULL) {
+        pktgen_log_error("Port %d filter '%s' does not load: %s", pid, expr,
+                         rte_strerror(rte_errno));
+        rte_free(flt);
+        return NULL;
+    }
+
+    /* The interpreter is used when there is no JIT for this CPU */
+    if (rte_bpf_get_jit(flt->bpf, &flt->jit) != 0)
+        flt->jit.func = NULL;
+
+    snprintf(flt->expr, sizeof(flt->expr), "%s", expr);
+
+    pktgen_log_info("Port %d filter '%s' loaded%s", pid, expr,
+                    flt->jit.func ? " (JIT)" : " (interpreted)");
+    return flt;
+#else
+    RTE_SET_USED(expr);
+    pktgen_log_error("Port %d filters need DPDK built with libpcap", pid);
+    return NULL;
+#endif
+}
+
+int
+pktgen_rx_filter_set(port_info_t *pinfo, const char *expr)
+{
+    rx_filter_t *flt = NULL, *old;
+
+    if (expr && expr[0] != '\0' && strcmp(expr, "off")) {
+        flt = rx_filter_load(pinfo->pid, expr);
+        if (flt == NULL)
+            return -1;
+    }
+
+    old = pinfo->rx_filter;
+    rte_smp_wmb();
+    pinfo->rx_filter = flt;
+
+    /* The old filter and its JIT code go once no RX queue can still be running them */
+    if (old) {
+        pktgen_rx_quiesce(pinfo);
+        rx_filter_free(old);
+    }
+
+    return 0;
+}
+
+const char *
+pktgen_rx_filter_expr(port_info_t *pinfo)
+{
+    return pinfo->rx_filter ? pinfo->rx_filter->expr : "off";
+}
+
+uint16_t
+pktgen_rx_filter_bulk(rx_filter_t *flt, struct rte_mbuf **pkts, uint16_t nb_pkts,
+                      struct rte_mbuf **match, rx_qstats_t *qs)
+{
+    uint64_t rc[MAX_PKT_RX_BURST];
+    uint64_t bytes = 0;
+    uint16_t i, nb = 0;
+
+    if (likely(flt->jit.func != NULL)) {
+        for (i = 0; i < nb_pkts; i++)
+            rc[i] = flt->jit.func(pkts[i]);
+    } else
+        rte_bpf_exec_burst(flt->bpf, (void **)pkts, rc, nb_pkts);
+
+    /* A classic BPF filter accepts a packet by returning a non-zero snap length */
+    for (i = 0; i < nb_pkts; i++) {
+        if (rc[i]) {
+            match[nb++] = pkts[i];
+            bytes += rte_pktmbuf_pkt_len(pkts[i]);
+        }
+    }
+
+    qs->q_fpackets += nb;
+    qs->q_fbytes += bytes;
+
+    return nb;
+}
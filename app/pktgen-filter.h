@@ -0,0 +1,90 @@
+/*-
+ * Copyright(c) <2010-2026>, Intel Corporation. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PKTGEN_FILTER_H_
+#define _PKTGEN_FILTER_H_
+
+/**
+ * @file
+ *
+ * RX packet filters of a port.
+ *
+ * A filter is a libpcap expression compiled to classic BPF, converted to eBPF
+ * and loaded with rte_bpf. Where rte_bpf has a JIT for the CPU the RX lcores
+ * call the generated code directly, otherwise the burst is run through the
+ * rte_bpf interpreter. Only packets the filter accepts are captured or dumped
+ * and counted in the per-queue filter counters, the port statistics still see
+ * every packet.
+ */
+
+#include <stdint.h>
+
+#include <rte_mbuf.h>
+#include <rte_bpf.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RX_FILTER_EXPR_SIZE 256 /**< Longest filter expression kept for display and save */
+
+/** Loaded RX filter of a port. */
+typedef struct rx_filter_s {
+    struct rte_bpf *bpf;            /**< Loaded eBPF program */
+    struct rte_bpf_jit jit;         /**< JIT code, jit.func is NULL when not available */
+    char expr[RX_FILTER_EXPR_SIZE]; /**< Filter as given to pktgen_rx_filter_set() */
+} rx_filter_t;
+
+struct port_info_s;
+struct rx_qstats_s;
+
+/**
+ * Set or clear the RX filter of a port.
+ *
+ * @param pinfo
+ *   Port to update, it may be receiving.
+ * @param expr
+ *   libpcap filter expression, NULL, "" or "off" clears the filter.
+ * @return
+ *   0 on success or -1 when the expression does not compile or load, the
+ *   current filter is kept in that case.
+ */
+int pktgen_rx_filter_set(struct port_info_s *pinfo, const char *expr);
+
+/**
+ * Return the filter expression of a port.
+ *
+ * @param pinfo
+ *   Port to query.
+ * @return
+ *   The expression or "off" when the port has no filter.
+ */
+const char *pktgen_rx_filter_expr(struct port_info_s *pinfo);
+
+/**
+ * Run a burst of received packets through a filter.
+ *
+ * @param flt
+ *   Filter to run.
+ * @param pkts
+ *   Received packets, at most MAX_PKT_RX_BURST.
+ * @param nb_pkts
+ *   Number of packets in pkts.
+ * @param match
+ *   Filled with the packets the filter accepts, in receive order.
+ * @param qs
+ *   RX queue counters the matching packets are added to.
+ * @return
+ *   Number of packets placed in match.
+ */
+uint16_t pktgen_rx_filter_bulk(rx_filter_t *flt, struct rte_mbuf **pkts, uint16_t nb_pkts,
+                               struct rte_mbuf **match, struct rx_qstats_s *qs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PKTGEN_FILTER_H_ */
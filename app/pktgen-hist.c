@@ -0,0 +1,74 @@
+/*-
+ * Copyright(c) <2010-2026>, Intel Corporation. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <string.h>
+
+#include "pktgen-hist.h"
+
+void
+lat_hist_reset(lat_hist_t *h)
+{
+    memset(h, 0, sizeof(lat_hist_t));
+}
+
+void
+lat_hist_add(lat_hist_t *dst, const lat_hist_t *src)
+{
+    uint64_t count = 0;
+
+    /* Count from the buckets, src may still be updated while it is read */
+    for (uint32_t i = 0; i < LAT_HIST_BUCKETS; i++) {
+        uint64_t c = src->buckets[i];
+
+        dst->buckets[i] += c;
+        count += c;
+    }
+    dst->count += count;
+}
+
+void
+lat_hist_delta(lat_hist_t *dst, const lat_hist_t *curr, const lat_hist_t *prev)
+{
+    uint64_t count = 0;
+
+    /* Counts only grow between two snapshots, unless the stats were cleared */
+    for (uint32_t i = 0; i < LAT_HIST_BUCKETS; i++) {
+        uint64_t c = curr->buckets[i], p = prev->buckets[i];
+
+        dst->buckets[i] = (c > p) ? c - p : 0;
+        count += dst->buckets[i];
+    }
+    dst->count = count;
+}
+
+uint64_t
+lat_hist_percentile(const lat_hist_t *h, double percentile)
+{
+    uint64_t target, seen = 0;
+
+    if (h->count == 0)
+        return 0;
+
+    if (percentile < 0.0)
+        percentile = 0.0;
+    else if (percentile > 100.0)
+        percentile = 100.0;
+
+    /* Smallest number of values covering the percentile, rounded up */
+    target = (uint64_t)((percentile * (double)h->count) / 100.0);
+    if ((double)target * 100.0 < percentile * (double)h->count)
+        target++;
+    if (target == 0)
+        target = 1;
+
+    for (uint32_t i = 0; i < LAT_HIST_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= target)
+            return lat_hist_value(i);
+    }
+
+    return lat_hist_value(LAT_HIST_BUCKETS - 1);
+}
@@ -0,0 +1,154 @@
+/*-
+ * Copyright(c) <2010-2026>, Intel Corporation. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PKTGEN_HIST_H_
+#define _PKTGEN_HIST_H_
+
+/**
+ * @file
+ *
+ * Fixed-size log-linear (HDR style) histogram for latency values.
+ *
+ * Values below LAT_HIST_SUB_COUNT get one bucket each. Above that every power of
+ * two is split into LAT_HIST_SUB_COUNT linear sub-buckets, which bounds the relative
+ * error of a reported value to 1/LAT_HIST_SUB_COUNT. Recording a value is O(1)
+ * and the memory used does not depend on the number of samples.
+ */
+
+#include <stdint.h>
+
+#include <rte_common.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LAT_HIST_SUB_BITS  7                         /**< log2 of the sub-buckets per power of two */
+#define LAT_HIST_SUB_COUNT (1U << LAT_HIST_SUB_BITS) /**< Number of sub-buckets per power of two */
+#define LAT_HIST_MAX_BITS  40 /**< Values are clamped to (2^LAT_HIST_MAX_BITS - 1) cycles */
+#define LAT_HIST_MAX_VALUE ((1ULL << LAT_HIST_MAX_BITS) - 1) /**< Largest value recorded */
+#define LAT_HIST_BUCKETS                                                                           \
+    ((LAT_HIST_MAX_BITS - LAT_HIST_SUB_BITS + 1) * LAT_HIST_SUB_COUNT) /**< Number of buckets */
+
+/** Log-linear histogram of latency values in cycles. */
+typedef struct lat_hist_s {
+    uint64_t count;                    /**< Number of values recorded */
+    uint64_t buckets[LAT_HIST_BUCKETS]; /**< Per bucket value counts */
+} lat_hist_t;
+
+/**
+ * Return the bucket index for a value.
+ *
+ * @param value
+ *   Value to locate, values above LAT_HIST_MAX_VALUE use the last bucket.
+ * @return
+ *   Bucket index in [0, LAT_HIST_BUCKETS).
+ */
+static inline uint32_t
+lat_hist_index(uint64_t value)
+{
+    uint32_t shift;
+
+    if (value < LAT_HIST_SUB_COUNT)
+        return (uint32_t)value;
+    if (value > LAT_HIST_MAX_VALUE)
+        value = LAT_HIST_MAX_VALUE;
+
+    /* Keep the top (LAT_HIST_SUB_BITS + 1) bits of the value */
+    shift = (rte_fls_u64(value) - 1) - LAT_HIST_SUB_BITS;
+
+    return ((shift + 1) << LAT_HIST_SUB_BITS) + (uint32_t)(value >> shift) - LAT_HIST_SUB_COUNT;
+}
+
+/**
+ * Return the highest value that maps to a bucket.
+ *
+ * @param idx
+ *   Bucket index in [0, LAT_HIST_BUCKETS).
+ * @return
+ *   Largest value counted in the bucket.
+ */
+static inline uint64_t
+lat_hist_value(uint32_t idx)
+{
+    uint32_t shift;
+    uint64_t sub;
+
+    if (idx < LAT_HIST_SUB_COUNT)
+        return idx;
+
+    shift = (idx >> LAT_HIST_SUB_BITS) - 1;
+    sub   = (idx & (LAT_HIST_SUB_COUNT - 1)) + LAT_HIST_SUB_COUNT;
+
+    return ((sub + 1) << shift) - 1;
+}
+
+/**
+ * Record a value in the histogram.
+ *
+ * Only one thread may record into a given histogram.
+ *
+ * @param h
+ *   Histogram to update.
+ * @param value
+ *   Value in cycles.
+ */
+static inline void
+lat_hist_record(lat_hist_t *h, uint64_t value)
+{
+    h->buckets[lat_hist_index(value)]++;
+    h->count++;
+}
+
+/**
+ * Clear all counts in a histogram.
+ *
+ * @param h
+ *   Histogram to clear.
+ */
+void lat_hist_reset(lat_hist_t *h);
+
+/**
+ * Add the counts of @p src to @p dst.
+ *
+ * @param dst
+ *   Histogram to add to.
+ * @param src
+ *   Histogram to add.
+ */
+void lat_hist_add(lat_hist_t *dst, const lat_hist_t *src);
+
+/**
+ * Set @p dst to the counts of @p curr minus the counts of @p prev.
+ *
+ * Used to derive the histogram of an interval from two cumulative snapshots.
+ *
+ * @param dst
+ *   Histogram to write.
+ * @param curr
+ *   Newer cumulative histogram.
+ * @param prev
+ *   Older cumulative histogram.
+ */
+void lat_hist_delta(lat_hist_t *dst, const lat_hist_t *curr, const lat_hist_t *prev);
+
+/**
+ * Return the value at a percentile.
+ *
+ * @param h
+ *   Histogram to query.
+ * @param percentile
+ *   Percentile in [0.0, 100.0], e.g. 99.99.
+ * @return
+ *   Highest value of the bucket holding the percentile, or 0 if the histogram is empty.
+ */
+uint64_t lat_hist_percentile(const lat_hist_t *h, double percentile);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PKTGEN_HIST_H_ */
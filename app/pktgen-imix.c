@@ -0,0 +1,385 @@
+/*-
+ * Copyright(c) <2010-2026>, Intel Corporation. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rte_malloc.h>
+#include <rte_random.h>
+
+#include "pktgen.h"
+#include "pktgen-log.h"
+#include "pktgen-imix.h"
+
+typedef struct imix_def_s {
+    const char *name;
+    const char *table;
+} imix_def_t;
+
+/* Built-in mixes, sizes include the FCS */
+static const imix_def_t imix_defs[] = {
+    {"simple", "64:7,594:4,1518:1"},
+    {"tolly", "64:55,78:5,576:17,1518:23"},
+};
+
+/**
+ *
+ * imix_genome_size - Return the frame size of an RFC 6985 genome letter.
+ *
+ * DESCRIPTION
+ * Letters a to i are the fixed sizes of RFC 6985 table 1, z is the largest frame
+ * the port MTU allows.
+ *
+ * RETURNS: Frame size including the FCS or 0 for an unknown letter.
+ *
+ * SEE ALSO:
+ */
+static uint32_t
+imix_genome_size(port_info_t *pinfo, char c)
+{
+    static const uint16_t sizes[] = {64, 128, 256, 512, 1024, 1280, 1518, 2112, 9000};
+
+    if (c >= 'a' && c <= 'i')
+        return sizes[c - 'a'];
+    if (c == 'z')
+        return pinfo->max_mtu + RTE_ETHER_HDR_LEN + RTE_ETHER_CRC_LEN;
+
+    return 0;
+}
+
+/**
+ *
+ * imix_add - Add frames of one size to an IMIX being built.
+ *
+ * DESCRIPTION
+ * Validate the frame size against the port limits and add the weight to the
+ * entry of the size, creating it when the size is new.
+ *
+ * RETURNS: Index of the size or -1 on error.
+ *
+ * SEE ALSO:
+ */
+static int
+imix_add(imix_t *imix, unsigned long size, unsigned long weight)
+{
+    uint32_t max = (pktgen.flags & JUMBO_PKTS_FLAG) ? RTE_ETHER_MAX_JUMBO_FRAME_LEN
+                                                    : RTE_ETHER_MAX_LEN;
+    uint16_t i;
+
+    /* Checked before narrowing, a huge value must not wrap into the valid range */
+    if (size < RTE_ETHER_MIN_LEN || size > max) {
+        pktgen_log_error("IMIX frame size %lu must be %u to %u bytes", size, RTE_ETHER_MIN_LEN,
+                         max);
+        return -1;
+    }
+    if (weight == 0 || weight > IMIX_SCHED_SIZE) {
+        pktgen_log_error("IMIX weight %lu must be 1 to %u", weight, IMIX_SCHED_SIZE);
+        return -1;
+    }
+
+    size -= RTE_ETHER_CRC_LEN;
+    for (i = 0; i < imix->nb_sizes; i++)
+        if (imix->sizes[i] == (uint16_t)size)
+            break;
+    if (i == imix->nb_sizes) {
+        if (imix->nb_sizes == IMIX_MAX_SIZES) {
+            pktgen_log_error("IMIX is limited to %u frame sizes", IMIX_MAX_SIZES);
+            return -1;
+        }
+        imix->sizes[imix->nb_sizes++] = size;
+    }
+    imix->weights[i] += (uint32_t)weight;
+
+    return i;
+}
+
+/**
+ *
+ * imix_parse_table - Parse a list of size:weight pairs.
+ *
+ * DESCRIPTION
+ * Parse a comma separated list like "64:7,594:4,1518:1" into the IMIX.
+ *
+ * RETURNS: 0 on success or -1 on error.
+ *
+ * SEE ALSO:
+ */
+static int
+imix_parse_table(imix_t *imix, const char *table)
+{
+    char buf[IMIX_SPEC_SIZE], *entry, *save = NULL;
+
+    if (snprintf(buf, sizeof(buf), "%s", table) >= (int)sizeof(buf)) {
+        pktgen_log_error("IMIX table is longer than %d characters", IMIX_SPEC_SIZE - 1);
+        return -1;
+    }
+
+    for (entry = strtok_r(buf, ",", &save); entry; entry = strtok_r(NULL, ",", &save)) {
+        char *end;
+        unsigned long size, weight = 1;
+
+        /* strtoul() takes a sign, only accept digits */
+        if (!isdigit((unsigned char)*entry)) {
+            pktgen_log_error("IMIX entry '%s' must be size[:weight]", entry);
+            return -1;
+        }
+        size = strtoul(entry, &end, 10);
+        if (*end == ':') {
+            if (!isdigit((unsigned char)end[1])) {
+                pktgen_log_error("IMIX entry '%s' must be size[:weight]", entry);
+                return -1;
+            }
+            weight = strtoul(end + 1, &end, 10);
+        }
+        if (*end != '\0' || end == entry) {
+            pktgen_log_error("IMIX entry '%s' must be size[:weight]", entry);
+            return -1;
+        }
+        if (imix_add(imix, size, weight) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+/**
+ *
+ * imix_schedule - Expand the IMIX weights into a TX schedule.
+ *
+ * DESCRIPTION
+ * Repeat the weights as many times as fit in IMIX_SCHED_SIZE entries, so every
+ * pass over the schedule sends each size exactly in proportion to its weight.
+ * Table schedules are shuffled with Fisher-Yates, a genome schedule is the
+ * genome repeated.
+ *
+ * RETURNS: 0 on success or -1 on error.
+ *
+ * SEE ALSO:
+ */
+static int
+imix_schedule(imix_t *imix, const uint8_t *genome, uint32_t genome_len)
+{
+    uint32_t total = 0, reps, n = 0;
+    double bytes   = 0.0;
+
+    for (uint16_t i = 0; i < imix->nb_sizes; i++) {
+        imix->tx_sizes[i] = imix->sizes[i];
+        total += imix->weights[i];
+        bytes += (double)imix->sizes[i] * imix->weights[i];
+    }
+    if (total == 0 || total > IMIX_SCHED_SIZE) {
+        pktgen_log_error("IMIX weights must add up to 1 to %u", IMIX_SCHED_SIZE);
+        return -1;
+    }
+    imix->avg_size = bytes / total;
+
+    reps = IMIX_SCHED_SIZE / total;
+    for (uint32_t r = 0; r < reps; r++) {
+        if (genome) {
+            memcpy(&imix->sched[n], genome, genome_len);
+            n += genome_len;
+        } else {
+            for (uint16_t i = 0; i < imix->nb_sizes; i++)
+                for (uint32_t w = 0; w < imix->weights[i]; w++)
+                    imix->sched[n++] = i;
+        }
+    }
+    imix->sched_len = n;
+
+    if (!imix->ordered) {
+        for (uint32_t i = n - 1; i > 0; i--) {
+            uint32_t j  = (uint32_t)rte_rand_max(i + 1);
+            uint8_t tmp = imix->sched[i];
+
+            imix->sched[i] = imix->sched[j];
+            imix->sched[j] = tmp;
+        }
+    }
+
+    return 0;
+}
+
+int
+pktgen_imix_set(port_info_t *pinfo, const char *type, const char *arg)
+{
+    uint8_t genome[IMIX_SCHED_SIZE];
+    imix_t *imix;
+    int ret = -1;
+
+    if (pktgen_tst_port_flags(pinfo, SENDING_PACKETS)) {
+        pktgen_log_warning("Cannot change the IMIX while sending packets!");
+        return -1;
+    }
+
+    imix = rte_zmalloc_socket("IMIX", sizeof(imix_t), RTE_CACHE_LINE_SIZE,
+                              pg_eth_dev_socket_id(pinfo->pid));
+    if (imix == NULL) {
+        pktgen_log_error("Unable to allocate port %d IMIX", pinfo->pid);
+        return -1;
+    }
+
+    if (!strcmp(type, "table") && arg) {
+        ret = imix_parse_table(imix, arg);
+        if (ret == 0)
+            ret = imix_schedule(imix, NULL, 0);
+
+        /* The saved configuration must set the same IMIX again */
+        if (ret == 0 &&
+            snprintf(imix->spec, sizeof(imix->spec), "table %s", arg) >= (int)sizeof(imix->spec)) {
+            pktgen_log_error("IMIX table is longer than %d characters", IMIX_SPEC_SIZE - 7);
+            ret = -1;
+        }
+    } else if (!strcmp(type, "genome") && arg) {
+        uint32_t len = strlen(arg);
+
+        imix->ordered = true;
+        if (len == 0 || len > IMIX_SCHED_SIZE) {
+            pktgen_log_error("IMIX genome must be 1 to %u letters", IMIX_SCHED_SIZE);
+            len = 0;
+        }
+        ret = (len == 0) ? -1 : 0;
+        for (uint32_t i = 0; i < len && ret == 0; i++) {
+            uint32_t size = imix_genome_size(pinfo, arg[i]);
+            int idx;
+
+            if (size == 0) {
+                pktgen_log_error("IMIX genome letter '%c' is not one of a-i or z", arg[i]);
+                ret = -1;
+                break;
+            }
+            idx = imix_add(imix, size, 1);
+            if (idx < 0)
+                ret = -1;
+            else
+                genome[i] = idx;
+        }
+        if (ret == 0)
+            ret = imix_schedule(imix, genome, len);
+        snprintf(imix->spec, sizeof(imix->spec), "genome %s", arg);
+    } else {
+        for (uint32_t i = 0; i < RTE_DIM(imix_defs); i++) {
+            if (strcmp(type, imix_defs[i].name))
+                continue;
+            ret = imix_parse_table(imix, imix_defs[i].table);
+            if (ret == 0)
+                ret = imix_schedule(imix, NULL, 0);
+            snprintf(imix->spec, sizeof(imix->spec), "%s", type);
+            break;
+        }
+        if (ret < 0 && imix->nb_sizes == 0)
+            pktgen_log_error("Unknown IMIX '%s'", type);
+    }
+
+    if (ret < 0) {
+        rte_free(imix);
+        return -1;
+    }
+
+    rte_free(pinfo->imix);
+    pinfo->imix = imix;
+
+    pktgen_packet_rate(pinfo);
+
+    return 0;
+}
+
+bool
+pktgen_imix_active(port_info_t *pinfo)
+{
+    return pinfo->imix && pktgen_tst_port_flags(pinfo, SEND_IMIX_PKTS) &&
+           !pktgen_tst_port_flags(pinfo, IMIX_EXCLUDED_MODES);
+}
+
+uint16_t
+pktgen_imix_setup(port_info_t *pinfo)
+{
+    pkt_seq_t *pkt    = &pinfo->seq_pkt[SINGLE_PKT];
+    imix_t *imix      = pinfo->imix;
+    uint16_t saved    = pkt->pkt_size;
+    uint16_t min_size = UINT16_MAX, max_size = 0;
+    uint16_t txcnt    = l2p_get_txcnt(pinfo->pid);
+    double bytes      = 0.0, avg_size;
+    uint32_t total    = 0;
+
+    for (uint16_t i = 0; i < imix->nb_sizes; i++) {
+        uint16_t size = imix->sizes[i];
+
+        /*
+         * Smaller sizes can not hold an IPv6 header, send them at the IPv6 minimum.
+         * Only the sizes sent change, the IMIX as set is kept for IPv4 and for save.
+         */
+        if (pkt->ethType == RTE_ETHER_TYPE_IPV6 && size < (MIN_v6_PKT_SIZE - RTE_ETHER_CRC_LEN)) {
+            pktgen_log_warning("IMIX size %u is sent as %u for IPv6", size + RTE_ETHER_CRC_LEN,
+                               MIN_v6_PKT_SIZE);
+            size = MIN_v6_PKT_SIZE - RTE_ETHER_CRC_LEN;
+        }
+        imix->tx_sizes[i] = size;
+        total += imix->weights[i];
+        bytes += (double)size * imix->weights[i];
+
+        pkt->pkt_size = size;
+        pktgen_packet_ctor(pinfo, SINGLE_PKT, -1);
+        memcpy(imix->hdrs[i], pkt->hdr, RTE_MIN(size, IMIX_HDR_SIZE));
+
+        min_size = RTE_MIN(min_size, size);
+        max_size = RTE_MAX(max_size, size);
+    }
+
+    /* The payload past the headers is the same fill for every size */
+    imix->hdr_len = RTE_MIN(min_size, IMIX_HDR_SIZE);
+
+    /* The TX rate follows the mean size sent, it changes with the IP version */
+    avg_size = bytes / total;
+    if (avg_size != imix->avg_size) {
+        imix->avg_size = avg_size;
+        pktgen_packet_rate(pinfo);
+    }
+
+    /* Queues start spread over the schedule so they do not send the same sizes together */
+    for (uint16_t q = 0; q < txcnt; q++)
+        pinfo->per_queue[q].imix_idx = (uint32_t)(((uint64_t)q * imix->sched_len) / txcnt);
+
+    pkt->pkt_size = max_size;
+    pktgen_packet_ctor(pinfo, SINGLE_PKT, -1);
+
+    return saved;
+}
+
+void
+pktgen_imix_restore(port_info_t *pinfo, uint16_t pkt_size)
+{
+    pinfo->seq_pkt[SINGLE_PKT].pkt_size = pkt_size;
+    pktgen_packet_ctor(pinfo, SINGLE_PKT, -1);
+}
+
+void
+pktgen_imix_show(port_info_t *pinfo)
+{
+    imix_t *imix   = pinfo->imix;
+    uint32_t total = 0;
+
+    if (imix == NULL) {
+        printf("Port %d has no IMIX\n", pinfo->pid);
+        return;
+    }
+
+    for (uint16_t i = 0; i < imix->nb_sizes; i++)
+        total += imix->weights[i];
+
+    printf("Port %d IMIX %s, %s, mean frame %.2f bytes, schedule of %u %s packets\n", pinfo->pid,
+           imix->spec, pktgen_imix_active(pinfo) ? "active" : "inactive",
+           imix->avg_size + RTE_ETHER_CRC_LEN, imix->sched_len,
+           imix->ordered ? "ordered" : "shuffled");
+    for (uint16_t i = 0; i < imix->nb_sizes; i++) {
+        printf("  %5u bytes: weight %5u, %6.2f%% of packets", imix->sizes[i] + RTE_ETHER_CRC_LEN,
+               imix->weights[i], (100.0 * imix->weights[i]) / total);
+        if (imix->tx_sizes[i] != imix->sizes[i])
+            printf(", sent as %u bytes", imix->tx_sizes[i] + RTE_ETHER_CRC_LEN);
+        printf("\n");
+    }
+}
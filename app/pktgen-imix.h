@@ -0,0 +1,119 @@
+/*-
+ * Copyright(c) <2010-2026>, Intel Corporation. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PKTGEN_IMIX_H_
+#define _PKTGEN_IMIX_H_
+
+/**
+ * @file
+ *
+ * IMIX packet size distributions for the single packet mode.
+ *
+ * An IMIX is a set of frame sizes with integer weights, either one of the
+ * built-in mixes, a user table of "size:weight" pairs or an RFC 6985 IMIX
+ * genome string. The weights are expanded into a schedule of up to
+ * IMIX_SCHED_SIZE entries holding every size exactly weight times per pass.
+ * Table schedules are shuffled once, genome schedules keep the genome order.
+ *
+ * The TX mbufs are built at the largest size. When the port starts the headers
+ * of every size are built once, and each TX queue then walks the schedule and
+ * copies the header of the scheduled size into the mbuf, so no decision is made
+ * per packet. The TX rate uses the weighted mean wire size of the mix.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <rte_common.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IMIX_MAX_SIZES  16                     /**< Distinct frame sizes in an IMIX */
+#define IMIX_SCHED_SIZE 4096                   /**< Largest number of entries in an IMIX schedule */
+#define IMIX_HDR_SIZE   128                    /**< Bytes of each size template copied per packet */
+#define IMIX_SPEC_SIZE  (IMIX_SCHED_SIZE + 16) /**< Longest IMIX specification, a full genome */
+
+/** IMIX sizes, weights and schedule of a port. */
+typedef struct imix_s {
+    uint16_t nb_sizes;                 /**< Number of distinct frame sizes */
+    uint16_t hdr_len;                  /**< Bytes copied from a template into each packet */
+    uint32_t sched_len;                /**< Entries in the schedule, a multiple of the weights */
+    uint16_t sizes[IMIX_MAX_SIZES];    /**< Frame sizes in bytes not counting the FCS */
+    uint16_t tx_sizes[IMIX_MAX_SIZES]; /**< Sizes sent, raised to the IPv6 minimum for IPv6 */
+    uint32_t weights[IMIX_MAX_SIZES];  /**< Relative number of frames of each size */
+    double avg_size;                   /**< Weighted mean of tx_sizes not counting the FCS */
+    bool ordered;                      /**< Schedule keeps the genome order instead of shuffled */
+    char spec[IMIX_SPEC_SIZE];         /**< IMIX as given to pktgen_imix_set() */
+    uint8_t hdrs[IMIX_MAX_SIZES][IMIX_HDR_SIZE] __rte_cache_aligned; /**< Size templates */
+    uint8_t sched[IMIX_SCHED_SIZE];                                  /**< Size index per entry */
+} imix_t;
+
+struct port_info_s;
+
+/**
+ * Set the IMIX of a port.
+ *
+ * @param pinfo
+ *   Port to update, it must not be sending.
+ * @param type
+ *   "simple" (64:7, 594:4, 1518:1), "tolly" (64:55, 78:5, 576:17, 1518:23),
+ *   "table" or "genome".
+ * @param arg
+ *   For "table" a list of size:weight pairs e.g. "64:7,594:4,1518:1", for
+ *   "genome" an RFC 6985 genome e.g. "aaaaaaadddg". Unused otherwise.
+ * @return
+ *   0 on success or -1 on error.
+ */
+int pktgen_imix_set(struct port_info_s *pinfo, const char *type, const char *arg);
+
+/**
+ * Build the size templates of the IMIX of a port from its single packet.
+ *
+ * Leaves the single packet template at the largest IMIX size so the TX mbufs
+ * are built with room for every size, pktgen_imix_restore() puts it back.
+ *
+ * @param pinfo
+ *   Port to set up.
+ * @return
+ *   Single packet size to pass to pktgen_imix_restore().
+ */
+uint16_t pktgen_imix_setup(struct port_info_s *pinfo);
+
+/**
+ * Restore the single packet template after the TX mbufs were built.
+ *
+ * @param pinfo
+ *   Port to restore.
+ * @param pkt_size
+ *   Value returned by pktgen_imix_setup().
+ */
+void pktgen_imix_restore(struct port_info_s *pinfo, uint16_t pkt_size);
+
+/**
+ * Test if the IMIX sizes apply to the packets a port sends.
+ *
+ * @param pinfo
+ *   Port to test.
+ * @return
+ *   true when IMIX is enabled, set and the port is in single packet mode.
+ */
+bool pktgen_imix_active(struct port_info_s *pinfo);
+
+/**
+ * Print the IMIX of a port.
+ *
+ * @param pinfo
+ *   Port to show.
+ */
+void pktgen_imix_show(struct port_info_s *pinfo);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PKTGEN_IMIX_H_ */
@@ -36,10 +36,200 @@ void
 latency_set_entropy(port_info_t *pinfo, uint16_t value)
 {
     latency_t *lat = &pinfo->latency;
+    pkt_seq_t *pkt = &pinfo->seq_pkt[LATENCY_PKT];
+
+    if (value > 1) {
+        if (pkt->ethType != RTE_ETHER_TYPE_IPV4 || pkt->ipProto != PG_IPPROTO_UDP)
+            pktgen_log_warning("Port %u latency entropy needs an IPv4 UDP latency packet",
+                               pinfo->pid);
+        pktgen_log_info("Port %u latency probes may reach several RX queues, a skipped "
+                        "probe is counted %d probes later",
+                        pinfo->pid, PROBE_WIN_LAG);
+    }
 
     lat->latency_entropy = value;
 }
 
+void
+latency_set_probes(port_info_t *pinfo, uint32_t value)
+{
+    latency_t *lat = &pinfo->latency;
+
+    if (value == 0)
+        value = DEFAULT_LATENCY_PROBES;
+    if (value > MAX_LATENCY_PROBES)
+        value = MAX_LATENCY_PROBES;
+
+    lat->probes_per_burst = value;
+}
+
+void
+latency_set_tstamp(port_info_t *pinfo, bool hw)
+{
+    latency_t *lat = &pinfo->latency;
+
+    if (hw && !pinfo->hw_tstamp.rx_enabled)
+        pktgen_log_warning("Port %u has no RX hardware timestamps, latency uses the TSC",
+                           pinfo->pid);
+
+    lat->hw_tstamp = hw;
+}
+
+/**
+ *
+ * pktgen_latency_calibrate - Calibrate the NIC clock against pktgen time.
+ *
+ * DESCRIPTION
+ * Read the NIC clock between two pktgen_get_time() calls. The rate is measured
+ * against the first reading, so it gets more precise the longer the port runs.
+ * The new conversion is written to the unused cal[] entry and then published by
+ * flipping cal_idx, so the RX lcores never see a half written entry.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+
+void
+pktgen_latency_calibrate(port_info_t *pinfo)
+{
+    hw_tstamp_t *hw = &pinfo->hw_tstamp;
+    hw_tstamp_cal_t *next;
+    uint64_t t0, t1, clock, now;
+
+    if (!hw->rx_enabled)
+        return;
+
+    t0 = pktgen_get_time();
+    if (rte_eth_read_clock(pinfo->pid, &clock) < 0) {
+        pktgen_log_warning("Port %u cannot read the NIC clock, latency uses the TSC", pinfo->pid);
+        hw->rx_enabled = false;
+        return;
+    }
+    t1  = pktgen_get_time();
+    now = t0 + ((t1 - t0) / 2);
+
+    if (hw->first_time == 0 || clock <= hw->first_clock) {
+        hw->first_clock = clock;
+        hw->first_time  = now;
+        return;
+    }
+
+    next                = &hw->cal[hw->cal_idx ^ 1];
+    next->clock         = clock;
+    next->time          = now;
+    next->time_per_tick = (double)(now - hw->first_time) / (double)(clock - hw->first_clock);
+
+    rte_smp_wmb();
+    hw->cal_idx ^= 1;
+}
+
+int
+latency_set_percentiles(const char *list)
+{
+    double vals[MAX_LATENCY_PERCENTILES];
+    char buff[128], *p, *save = NULL;
+    int n = 0;
+
+    if (list == NULL)
+        return -1;
+    snprintf(buff, sizeof(buff), "%s", list);
+
+    for (p = strtok_r(buff, ", ", &save); p; p = strtok_r(NULL, ", ", &save)) {
+        char *end;
+        double v;
+
+        if (n >= MAX_LATENCY_PERCENTILES)
+            return -1;
+        v = strtod(p, &end);
+        if (end == p || *end != '\0' || v <= 0.0 || v > 100.0)
+            return -1;
+        vals[n++] = v;
+    }
+    if (n == 0)
+        return -1;
+
+    memcpy(pktgen.lat_percentiles, vals, n * sizeof(double));
+    pktgen.nb_lat_percentiles = n;
+
+    /* Percentile labels are static text on the latency page */
+    pktgen.flags |= PRINT_LABELS_FLAG;
+
+    return 0;
+}
+
+/**
+ *
+ * pktgen_latency_merge - Merge the per-RX-queue latency state for a port.
+ *
+ * DESCRIPTION
+ * Sum the counters and histograms of each RX queue and combine the min/max values
+ * into the port latency_t. The interval histogram is the difference between the
+ * run histogram of this merge and of the previous one, the stats timer runs the
+ * merge once a second so the interval is one timer second long.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+
+void
+pktgen_latency_merge(port_info_t *pinfo)
+{
+    latency_t *lat    = &pinfo->latency;
+    uint64_t num_pkts = 0, num_skipped = 0, running = 0, jitter = 0;
+    uint64_t min_cycles = 0, max_cycles = 0, num_tx_pkts = 0;
+    uint64_t now = pktgen_get_time();
+    int nq;
+
+    /* The queues not reset by their lcore since the last clear count nothing */
+    nq = RTE_MIN(l2p_get_txcnt(pinfo->pid), MAX_QUEUES_PER_PORT);
+    for (int q = 0; q < nq; q++)
+        if (pinfo->tx_latency[q].gen == pinfo->lat_clear_gen)
+            num_tx_pkts += pinfo->tx_latency[q].num_tx_pkts;
+    lat->num_latency_tx_pkts = num_tx_pkts;
+
+    nq = RTE_MIN(l2p_get_rxcnt(pinfo->pid), MAX_QUEUES_PER_PORT);
+    if (nq <= 0)
+        return;
+
+    /* Ensure all RX worker stores to latency fields are visible before reading */
+    rte_smp_rmb();
+
+    rte_memcpy(&lat->prev_hist, &lat->run_hist, sizeof(lat_hist_t));
+    lat_hist_reset(&lat->run_hist);
+
+    for (int q = 0; q < nq; q++) {
+        rx_latency_t *rxl = &pinfo->rx_latency[q];
+
+        if (rxl->gen != pinfo->lat_clear_gen)
+            continue;
+
+        num_pkts += rxl->num_latency_pkts;
+        num_skipped += rxl->num_skipped;
+        running += rxl->running_cycles;
+        jitter += rxl->jitter_count;
+
+        if (rxl->min_cycles && (min_cycles == 0 || rxl->min_cycles < min_cycles))
+            min_cycles = rxl->min_cycles;
+        if (rxl->max_cycles > max_cycles)
+            max_cycles = rxl->max_cycles;
+
+        lat_hist_add(&lat->run_hist, &rxl->hist);
+    }
+    lat_hist_delta(&lat->int_hist, &lat->run_hist, &lat->prev_hist);
+    lat->int_cycles = (lat->int_time) ? now - lat->int_time : 0;
+    lat->int_time   = now;
+
+    lat->num_latency_pkts = num_pkts;
+    lat->num_skipped      = num_skipped;
+    lat->running_cycles   = running;
+    lat->jitter_count     = jitter;
+    lat->min_cycles       = min_cycles;
+    lat->max_cycles       = max_cycles;
+    lat->avg_cycles       = (num_pkts) ? running / num_pkts : 0;
+}
+
 /**
  *
  * pktgen_print_static_data - Display the static data on the screen.
@@ -89,10 +279,14 @@ pktgen_print_static_data(void)
     scrn_printf(row++, 1, "%-*s", COLUMN_WIDTH_0, "  Cycles/Minimum(us)");
     scrn_printf(row++, 1, "%-*s", COLUMN_WIDTH_0, "  Cycles/Average(us)");
     scrn_printf(row++, 1, "%-*s", COLUMN_WIDTH_0, "  Cycles/Maximum(us)");
-    scrn_printf(row++, 1, "%-*s", COLUMN_WIDTH_0, "Percentiles:");
-    scrn_printf(row++, 1, "%-*s", COLUMN_WIDTH_0, "  90th Cycles / us");
-    scrn_printf(row++, 1, "%-*s", COLUMN_WIDTH_0, "  95th Cycles / us");
-    scrn_printf(row++, 1, "%-*s", COLUMN_WIDTH_0, "  99th Cycles / us");
+    scrn_printf(row++, 1, "%-*s", COLUMN_WIDTH_0, "Percentiles Run/Int(us)");
+    for (int i = 0; i < MAX_LATENCY_PERCENTILES; i++) {
+        if (i < pktgen.nb_lat_percentiles) {
+            snprintf(buff, sizeof(buff), "  p%g", pktgen.lat_percentiles[i]);
+            scrn_printf(row++, 1, "%-*s", COLUMN_WIDTH_0, buff);
+        } else
+            scrn_printf(row++, 1, "%-*s", COLUMN_WIDTH_0, "");
+    }
     scrn_printf(row++, 1, "%-*s", COLUMN_WIDTH_0, "Jitter:");
     scrn_printf(row++, 1, "%-*s", COLUMN_WIDTH_0, "  Threshold (us)");
     scrn_printf(row++, 1, "%-*s", COLUMN_WIDTH_0, "  Count/Percent");
@@ -198,43 +392,6 @@ pktgen_print_static_data(void)
 
     pktgen.flags &= ~PRINT_LABELS_FLAG;
 }
-/* comparator function for qsort ring */
-static int
-cmp_uint64_asc(const void *a, const void *b)
-{
-    uint64_t va = *(const uint64_t *)a;
-    uint64_t vb = *(const uint64_t *)b;
-    if (va < vb)
-        return -1;
-    if (va > vb)
-        return 1;
-    return 0;
-}
-/* returns quantile (0.9, 0.95, 0.99) */
-static uint64_t
-latency_ring_percentile(const latency_ring_t *ring, double q)
-{
-    if (ring->count == 0)
-        return 0;
-
-    uint64_t tmp[RING_SIZE];
-    for (int i = 0; i < ring->count; i++) {
-        tmp[i] = ring->data[i];
-    }
-
-    qsort(tmp, ring->count, sizeof(uint64_t), cmp_uint64_asc);
-
-    // percentile position (es. 0.9 == 90%)
-    double pos  = q * (ring->count - 1);
-    int idx     = (int)pos;
-    double frac = pos - idx;
-
-    if (idx + 1 < ring->count)
-        return tmp[idx] + (uint64_t)((tmp[idx + 1] - tmp[idx]) * frac);
-    else
-        return tmp[idx];
-}
-
 static inline double
 cycles_to_us(uint64_t cycles, double per_cycle)
 {
@@ -314,12 +471,9 @@ pktgen_page_latency(void)
         pktgen.cumm_rate_totals.rx_nombuf += pinfo->stats.rate.rx_nombuf;
 
         row++; /* Skip Latency header row */
-        lat = &pinfo->latency;
-        /* Ensure all RX worker stores to latency fields are visible before reading */
-        rte_smp_rmb();
+        lat     = &pinfo->latency; /* merged by the timer thread, see pktgen_latency_merge() */
         nb_pkts = (lat->num_latency_pkts == 0) ? 1 : lat->num_latency_pkts;
-        uint64_t avg_cycles =
-            lat->running_cycles / nb_pkts; /* compute locally; do not write back */
+        uint64_t avg_cycles = lat->avg_cycles;
 
         snprintf(buff, sizeof(buff), "%'" PRIu64, lat->latency_rate_us);
         scrn_printf(row++, col, "%*s", COLUMN_WIDTH_1, buff);
@@ -349,21 +503,17 @@ pktgen_page_latency(void)
         scrn_printf(row++, col, "%*s", COLUMN_WIDTH_1, buff);
 
         row++; /* Skip Percentiles header */
-        double q90, q95, q99;
-        q90 = cycles_to_us(latency_ring_percentile(&lat->tail_latencies, 0.90), per_cycle);
-        snprintf(buff, sizeof(buff), "%'" PRIu64 "/%'8.2f",
-                 latency_ring_percentile(&lat->tail_latencies, 0.90), q90);
-        scrn_printf(row++, col, "%*s", COLUMN_WIDTH_1, buff);
-
-        q95 = cycles_to_us(latency_ring_percentile(&lat->tail_latencies, 0.95), per_cycle);
-        snprintf(buff, sizeof(buff), "%'" PRIu64 "/%'8.2f",
-                 latency_ring_percentile(&lat->tail_latencies, 0.95), q95);
-        scrn_printf(row++, col, "%*s", COLUMN_WIDTH_1, buff);
-
-        q99 = cycles_to_us(latency_ring_percentile(&lat->tail_latencies, 0.99), per_cycle);
-        snprintf(buff, sizeof(buff), "%'" PRIu64 "/%'8.2f",
-                 latency_ring_percentile(&lat->tail_latencies, 0.99), q99);
-        scrn_printf(row++, col, "%*s", COLUMN_WIDTH_1, buff);
+        for (int p = 0; p < MAX_LATENCY_PERCENTILES; p++) {
+            if (p < pktgen.nb_lat_percentiles) {
+                double pct = pktgen.lat_percentiles[p];
+
+                snprintf(buff, sizeof(buff), "%'.2f/%'.2f",
+                         cycles_to_us(lat_hist_percentile(&lat->run_hist, pct), per_cycle),
+                         cycles_to_us(lat_hist_percentile(&lat->int_hist, pct), per_cycle));
+            } else
+                buff[0] = '\0';
+            scrn_printf(row++, col, "%*s", COLUMN_WIDTH_1, buff);
+        }
 
         row++; /* Skip Jitter header */
         snprintf(buff, sizeof(buff), "%'" PRIu64, lat->jitter_threshold_us);
@@ -397,11 +547,40 @@ void
 pktgen_latency_setup(port_info_t *pinfo)
 {
     pkt_seq_t *pkt = &pinfo->seq_pkt[LATENCY_PKT];
+    pkt_hdr_t *hdr = pkt->hdr;
 
+    /* Keep the frame buffer of the probe, only the fields are copied */
     rte_memcpy(pkt, &pinfo->seq_pkt[SINGLE_PKT], sizeof(pkt_seq_t));
+    pkt->hdr = hdr;
 
     pkt->pkt_size = LATENCY_PKT_SIZE;
     pkt->ipProto  = PG_IPPROTO_UDP;
     pkt->ethType  = RTE_ETHER_TYPE_IPV4;
     pkt->dport    = LATENCY_DPORT;
+
+    pktgen_latency_template(pinfo);
+}
+
+void
+pktgen_latency_template(port_info_t *pinfo)
+{
+    pkt_seq_t *pkt = &pinfo->seq_pkt[LATENCY_PKT];
+    struct rte_ipv4_hdr *ip;
+    struct rte_udp_hdr *udp;
+
+    pktgen_packet_ctor(pinfo, LATENCY_PKT, -1);
+
+    if (pkt->ethType != RTE_ETHER_TYPE_IPV4 || pkt->ipProto != PG_IPPROTO_UDP)
+        return;
+
+    /*
+     * Probes are sent from the special mempool without TX offload flags, and the
+     * timestamp is written after the copy, so do not use a UDP checksum.
+     */
+    ip  = (struct rte_ipv4_hdr *)((struct rte_ether_hdr *)&pkt->hdr->eth + 1);
+    udp = (struct rte_udp_hdr *)(ip + 1);
+
+    udp->dgram_cksum = 0;
+    ip->hdr_checksum = 0;
+    ip->hdr_checksum = rte_ipv4_cksum(ip);
 }
@@ -30,6 +30,10 @@ extern "C" {
 #define DEFAULT_LATENCY_ENTROPY (0) /**< Default entropy seed for source port randomisation */
 #define LATENCY_PKT_SIZE        RTE_ETHER_MIN_LEN /**< Latency probe packet size (64 B + 4 B FCS) */
 #define LATENCY_DPORT           1028 /**< Destination UDP port used for latency probes */
+#define MAX_LATENCY_PERCENTILES 6    /**< Maximum number of percentiles displayed */
+#define DEFAULT_LATENCY_PROBES  1    /**< Default max latency probes per TX burst */
+#define MAX_LATENCY_PROBES      16   /**< Maximum latency probes per TX burst */
+#define DEFAULT_LATENCY_PERCENTILES "50,90,99,99.9,99.99" /**< Default percentile list */
 
 /**
  * Render the latency statistics display page to the console.
@@ -44,6 +48,17 @@ void pktgen_page_latency(void);
  */
 void pktgen_latency_setup(port_info_t *pinfo);
 
+/**
+ * Build the latency probe template used by the TX queues of port @p pinfo.
+ *
+ * The template carries no UDP checksum and a software IPv4 checksum, so a probe
+ * only needs its timestamp, sequence and source port written before sending.
+ *
+ * @param pinfo
+ *   Port information structure to update.
+ */
+void pktgen_latency_template(port_info_t *pinfo);
+
 /**
  * Set the latency probe injection rate for port @p pinfo.
  *
@@ -58,7 +73,10 @@ void latency_set_rate(port_info_t *pinfo, uint32_t value);
  * Set the source-port entropy value used for latency probe identification.
  *
  * The entropy value controls how many distinct source ports are cycled
- * (SPORT + (i % entropy)); a value of 0 disables cycling.
+ * (SPORT + (i % entropy)); a value of 0 or 1 disables cycling. Only IPv4 UDP
+ * latency packets are changed. Above 1 RSS may spread the probes of a TX queue
+ * over the RX queues, a skipped probe is then counted PROBE_WIN_LAG probes later
+ * by the RX queue receiving that probe.
  *
  * @param pinfo
  *   Port information structure to update.
@@ -67,6 +85,68 @@ void latency_set_rate(port_info_t *pinfo, uint32_t value);
  */
 void latency_set_entropy(port_info_t *pinfo, uint16_t value);
 
+/**
+ * Set the maximum number of latency probes placed in one TX burst.
+ *
+ * Each TX queue sends a probe every latency rate interval. When more than one
+ * interval passed since the last burst, up to @p value probes replace data packets
+ * at the end of the burst.
+ *
+ * @param pinfo
+ *   Port information structure to update.
+ * @param value
+ *   Probes per burst in [1, MAX_LATENCY_PROBES].
+ */
+void latency_set_probes(port_info_t *pinfo, uint32_t value);
+
+/**
+ * Select hardware or software RX timestamps for latency on port @p pinfo.
+ *
+ * Hardware timestamps need the --hw-tstamp option and a NIC with the RX timestamp
+ * offload, otherwise the TSC read at receive time is used.
+ *
+ * @param pinfo
+ *   Port information structure to update.
+ * @param hw
+ *   true to use hardware RX timestamps when available.
+ */
+void latency_set_tstamp(port_info_t *pinfo, bool hw);
+
+/**
+ * Update the NIC clock to pktgen time conversion used for RX hardware timestamps.
+ *
+ * Called once per second from pktgen_process_stats() on the timer thread, also
+ * while the screen is paused or shows another page than the main one.
+ *
+ * @param pinfo
+ *   Port information structure to update.
+ */
+void pktgen_latency_calibrate(port_info_t *pinfo);
+
+/**
+ * Set the latency percentiles reported on the latency page, CLI and Lua.
+ *
+ * @param list
+ *   Comma separated list of up to MAX_LATENCY_PERCENTILES values in (0, 100],
+ *   e.g. "50,99,99.9,99.999".
+ * @return
+ *   0 on success or -1 if the list is invalid, the current list is kept on error.
+ */
+int latency_set_percentiles(const char *list);
+
+/**
+ * Merge the per-RX-queue latency accumulators into the port latency statistics.
+ *
+ * Called once per second from pktgen_process_stats() on the timer thread, whatever
+ * page is shown and also while the screen is paused. The RX lcores keep updating
+ * their own queue entries while the merge runs, so no locking is needed on the RX
+ * path.
+ *
+ * @param pinfo
+ *   Port information structure to update.
+ */
+void pktgen_latency_merge(port_info_t *pinfo);
+
 #ifdef __cplusplus
 }
 #endif
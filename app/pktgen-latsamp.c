@@ -0,0 +1,256 @@
+/*-
+ * Copyright(c) <2010-2026>, Intel Corporation. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <rte_ring.h>
+#include <rte_spinlock.h>
+#include <rte_cycles.h>
+
+#include "pktgen.h"
+#include "pktgen-log.h"
+#include "pktgen-latsamp.h"
+
+static pthread_t latsamp_tid;
+static volatile int latsamp_running;
+
+/**
+ *
+ * latsamp_drain - Write out the samples queued on the rings of a port.
+ *
+ * DESCRIPTION
+ * Dequeue the samples of every RX queue ring and write them to the port sampler
+ * file. Must be called with the port latsamp_lock held.
+ *
+ * RETURNS: Number of samples written.
+ *
+ * SEE ALSO:
+ */
+static uint32_t
+latsamp_drain(port_info_t *pinfo)
+{
+    uint64_t samples[LATSAMP_BURST];
+    latsamp_rec_t recs[LATSAMP_BURST];
+    uint16_t rxq = l2p_get_rxcnt(pinfo->pid);
+    uint32_t total = 0;
+
+    for (uint16_t q = 0; q < rxq; q++) {
+        struct rte_ring *r = pinfo->latsamp_stats[q].ring;
+        uint32_t n;
+
+        if (r == NULL)
+            continue;
+
+        while ((n = rte_ring_sc_dequeue_burst_elem(r, samples, sizeof(uint64_t), LATSAMP_BURST,
+                                                   NULL)) > 0) {
+            if (pinfo->latsamp_binary) {
+                memset(recs, 0, sizeof(latsamp_rec_t) * n);
+                for (uint32_t i = 0; i < n; i++) {
+                    recs[i].latency_ns = samples[i];
+                    recs[i].qid        = q;
+                }
+                fwrite(recs, sizeof(latsamp_rec_t), n, pinfo->latsamp_fp);
+            } else {
+                for (uint32_t i = 0; i < n; i++)
+                    fprintf(pinfo->latsamp_fp, "%u,%" PRIu64 "\n", q, samples[i]);
+            }
+            total += n;
+        }
+    }
+    pinfo->latsamp_written += total;
+
+    return total;
+}
+
+/**
+ *
+ * _latsamp_thread - Latency sample writer thread.
+ *
+ * DESCRIPTION
+ * Drain the sample rings of all sampling ports to their output files, sleeping
+ * when there is nothing to write.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+static void *
+_latsamp_thread(void *arg __rte_unused)
+{
+    while (latsamp_running) {
+        uint32_t written = 0;
+        uint16_t pid;
+
+        RTE_ETH_FOREACH_DEV(pid)
+        {
+            port_info_t *pinfo = l2p_get_port_pinfo(pid);
+
+            if (pinfo == NULL || pinfo->latsamp_fp == NULL)
+                continue;
+
+            /* Skip the port while it is being stopped */
+            if (!rte_spinlock_trylock(&pinfo->latsamp_lock))
+                continue;
+            if (pinfo->latsamp_fp)
+                written += latsamp_drain(pinfo);
+            rte_spinlock_unlock(&pinfo->latsamp_lock);
+        }
+
+        if (written == 0)
+            usleep(LATSAMP_IDLE_US);
+    }
+    return NULL;
+}
+
+/**
+ *
+ * latsamp_thread_start - Start the latency sample writer thread once.
+ *
+ * DESCRIPTION
+ * Create the writer thread and pin it to the main lcore, next to the timer thread.
+ *
+ * RETURNS: 0 on success or -1 on error.
+ *
+ * SEE ALSO:
+ */
+static int
+latsamp_thread_start(void)
+{
+    rte_cpuset_t cpuset;
+
+    if (latsamp_running)
+        return 0;
+
+    latsamp_running = 1;
+    if (pthread_create(&latsamp_tid, NULL, _latsamp_thread, NULL)) {
+        latsamp_running = 0;
+        pktgen_log_error("Unable to create latency sampler writer thread");
+        return -1;
+    }
+
+    CPU_ZERO(&cpuset);
+    CPU_SET(rte_get_main_lcore(), &cpuset);
+    pthread_setaffinity_np(latsamp_tid, sizeof(cpuset), &cpuset);
+
+    return 0;
+}
+
+/**
+ *
+ * latsamp_thread_stop - Stop the latency sample writer thread.
+ *
+ * DESCRIPTION
+ * Clear the running flag and join the writer thread, once it returns no port
+ * file or ring is touched by it any more.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+static void
+latsamp_thread_stop(void)
+{
+    if (!latsamp_running)
+        return;
+
+    latsamp_running = 0;
+    pthread_join(latsamp_tid, NULL);
+}
+
+int
+pktgen_latsamp_open(port_info_t *pinfo)
+{
+    uint16_t rxq = l2p_get_rxcnt(pinfo->pid);
+    size_t len   = strlen(pinfo->latsamp_outfile);
+    size_t slen  = strlen(LATSAMP_BINARY_SUFFIX);
+    char name[RTE_RING_NAMESIZE];
+    FILE *fp;
+
+    for (uint16_t q = 0; q < rxq; q++) {
+        latsamp_stats_t *stats = &pinfo->latsamp_stats[q];
+
+        /* Rings are kept for the life of the port and only reset between runs */
+        if (stats->ring) {
+            rte_ring_reset(stats->ring);
+            continue;
+        }
+
+        snprintf(name, sizeof(name), "LatSamp-%u-%u", pinfo->pid, q);
+        stats->ring = rte_ring_create_elem(name, sizeof(uint64_t), LATSAMP_RING_SIZE,
+                                           pg_eth_dev_socket_id(pinfo->pid),
+                                           RING_F_SP_ENQ | RING_F_SC_DEQ);
+        if (stats->ring == NULL) {
+            pktgen_log_error("Unable to create latency sample ring %s: %s", name,
+                             rte_strerror(rte_errno));
+            return -1;
+        }
+    }
+
+    pinfo->latsamp_binary =
+        (len > slen) && !strcasecmp(&pinfo->latsamp_outfile[len - slen], LATSAMP_BINARY_SUFFIX);
+
+    fp = fopen(pinfo->latsamp_outfile, pinfo->latsamp_binary ? "wb" : "w");
+    if (fp == NULL) {
+        pktgen_log_error("Cannot open the latency outfile %s!", pinfo->latsamp_outfile);
+        return -1;
+    }
+    if (!pinfo->latsamp_binary)
+        fprintf(fp, "queue,latency_ns\n");
+
+    rte_spinlock_init(&pinfo->latsamp_lock);
+    pinfo->latsamp_written = 0;
+    pinfo->latsamp_fp      = fp;
+
+    if (latsamp_thread_start() < 0) {
+        pinfo->latsamp_fp = NULL;
+        fclose(fp);
+        return -1;
+    }
+
+    return 0;
+}
+
+void
+pktgen_latsamp_close(port_info_t *pinfo)
+{
+    uint16_t rxq     = l2p_get_rxcnt(pinfo->pid);
+    uint64_t dropped = 0;
+    bool sampling    = false;
+    uint16_t pid;
+
+    if (pinfo->latsamp_fp == NULL)
+        return;
+
+    /* The rings live as long as the port, a sample enqueued after the drain is only lost */
+    rte_delay_us_sleep(100);
+
+    /* Nothing else writes the file once the writer thread has returned */
+    latsamp_thread_stop();
+
+    latsamp_drain(pinfo);
+    fclose(pinfo->latsamp_fp);
+    pinfo->latsamp_fp = NULL;
+
+    /* Keep writing the files of the ports still sampling */
+    RTE_ETH_FOREACH_DEV(pid)
+    {
+        port_info_t *p = l2p_get_port_pinfo(pid);
+
+        if (p && p->latsamp_fp)
+            sampling = true;
+    }
+    if (sampling && latsamp_thread_start() < 0)
+        pktgen_log_error("Latency sampler writer thread not restarted");
+
+    for (uint16_t q = 0; q < rxq; q++)
+        dropped += pinfo->latsamp_stats[q].dropped;
+
+    pktgen_log_info("Wrote %" PRIu64 " sample latencies to file %s, %" PRIu64 " dropped",
+                    pinfo->latsamp_written, pinfo->latsamp_outfile, dropped);
+}
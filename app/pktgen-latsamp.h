@@ -0,0 +1,71 @@
+/*-
+ * Copyright(c) <2010-2026>, Intel Corporation. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PKTGEN_LATSAMP_H_
+#define _PKTGEN_LATSAMP_H_
+
+/**
+ * @file
+ *
+ * Streaming export of sampled latencies.
+ *
+ * Each RX queue pushes its sampled latencies into a single producer/single consumer
+ * ring. A writer thread, pinned to the main lcore, drains the rings of every sampling
+ * port to the sampler output file while the sampler runs, so the number of samples
+ * is not bounded by memory.
+ *
+ * The output file is CSV ("queue,latency_ns") unless its name ends in
+ * LATSAMP_BINARY_SUFFIX, in which case it is a sequence of latsamp_rec_t records
+ * in host byte order.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LATSAMP_RING_SIZE     16384  /**< Latency samples buffered per RX queue */
+#define LATSAMP_BURST         64     /**< Samples dequeued per ring read by the writer */
+#define LATSAMP_IDLE_US       1000   /**< Writer sleep time when all rings are empty */
+#define LATSAMP_BINARY_SUFFIX ".bin" /**< Output file suffix selecting the binary format */
+
+/** Binary output file record. */
+typedef struct latsamp_rec_s {
+    uint64_t latency_ns; /**< Sampled latency in nanoseconds */
+    uint16_t qid;        /**< RX queue the sample was taken on */
+    uint16_t reserved[3]; /**< Reserved, always zero */
+} latsamp_rec_t;
+
+struct port_info_s;
+
+/**
+ * Create the sample rings of a port, open its output file and start the writer.
+ *
+ * @param pinfo
+ *   Port to start exporting samples for, latsamp_outfile must be set.
+ * @return
+ *   0 on success or -1 on error.
+ */
+int pktgen_latsamp_open(struct port_info_s *pinfo);
+
+/**
+ * Write out the samples still queued for a port and close its output file.
+ *
+ * The caller must have cleared SAMPLING_LATENCIES on the port first. The writer
+ * thread is stopped and joined before the file is closed, and started again when
+ * other ports are still sampling.
+ *
+ * @param pinfo
+ *   Port to stop exporting samples for.
+ */
+void pktgen_latsamp_close(struct port_info_s *pinfo);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PKTGEN_LATSAMP_H_ */
@@ -72,6 +72,7 @@ pktgen_usage(const char *prgname)
 #endif
            "  -l filename   Write log to filename\n"
            "  -s P:filepath PCAP packet stream file, 'P' is the port number\n"
+           "                Files larger than 1GB of mbufs are streamed from the disk\n"
            "  -P            Enable PROMISCUOUS mode on all ports\n"
            "  -g address    Optional IP address and port number default is (localhost:0x5606)\n"
            "                If -g is used that enable socket support as a server application\n"
@@ -83,12 +84,14 @@ pktgen_usage(const char *prgname)
            "  -c            Enable clock_gettime\n"
            "  --txd=N       set the number of descriptors in Tx rings to N \n"
            "  --rxd=N       set the number of descriptors in Rx rings to N \n"
+           "  --hw-tstamp   Enable Rx hardware timestamps for latency, when the NIC supports them\n"
            "  -m <string>   matrix for mapping ports to logical cores\n"
            "      BNF: (or kind of BNF)\n"
            "      <matrix-string>   := \"\"\" <lcore-port> { \",\" <lcore-port>} \"\"\"\n"
            "      <lcore-port>      := <lcore-list> \".\" <port>\n"
            "      <lcore-list>      := \"[\" <rx-list> \":\" <tx-list> \"]\"\n"
-           "      <port>            := \"<num>\"\n"
+           "      <port>            := <num> | \"[\" <port-list> \"]\"\n"
+           "      <port-list>       := (<num> | <num> \"-\" <num>) { \"/\" <port-list> }\n"
            "      <rx-list>         := <num> { \"/\" (<num> | <list>) }\n"
            "      <tx-list>         := <num> { \"/\" (<num> | <list>) }\n"
            "      <list>            := <num> { \"/\" (<range> | <list>) }\n"
@@ -116,6 +119,10 @@ pktgen_usage(const char *prgname)
            "port 0 tx\n"
            "                                      core 4,5 handles port 1 rx & core 6,8 handles "
            "port 1 tx\n"
+           "      [1:2].[0-3/6], ...            - core 1 handles ports 0-3,6 rx, core 2 handles "
+           "them tx\n"
+           "      A core given more then one port polls each port/queue pair in turn and paces\n"
+           "      the TX of each pair on its own.\n"
            "      BTW: you can use \"{}\" instead of \"[]\" as it does not matter to the syntax.\n"
            "  -h           Display the help information\n",
            prgname);
@@ -145,6 +152,7 @@ pktgen_parse_args(int argc, char **argv)
     static struct option lgopts[] = {
         {"txd", required_argument, 0, 't'},
         {"rxd", required_argument, 0, 'r'},
+        {"hw-tstamp", no_argument, 0, 'H'},
         {NULL, 0, 0, 0}
     };
     // clang-format on
@@ -254,6 +262,9 @@ pktgen_parse_args(int argc, char **argv)
         case 'c':
             enable_clock_gettime(ENABLE_STATE);
             break;
+        case 'H':
+            pktgen.flags |= HW_TSTAMP_FLAG;
+            break;
         case 'v':
             pktgen.verbose = 1;
             break;
@@ -398,6 +409,8 @@ main(int argc, char **argv)
     pktgen.nb_txd            = DEFAULT_TX_DESC;
     pktgen.nb_ports_per_page = DEFAULT_PORTS_PER_PAGE;
 
+    latency_set_percentiles(DEFAULT_LATENCY_PERCENTILES);
+
     l2p_create();
 
     pktgen.portdesc_cnt = get_portdesc(pktgen.portdesc, RTE_MAX_ETHPORTS, 0);
@@ -5,6 +5,10 @@
  */
 /* Created 2010 by Keith Wiles @ intel.com */
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
 #include <lua_config.h>
 
 #include "pktgen-display.h"
@@ -16,6 +20,17 @@
 #define MBUF_INVALID_PORT UINT16_MAX
 #endif
 
+#define PCAP_INDEX_SIZE 1024 /**< Initial record index entries, doubled as needed */
+#define PCAP_LOAD_CHUNK 1024 /**< mbufs an lcore fills before taking the next chunk */
+
+/* Shared by the lcores filling the mbuf pool of a file */
+typedef struct pcap_load_s {
+    pcap_info_t *pcap;      /**< File being loaded */
+    struct rte_mbuf **objs; /**< mbufs of the pool in pool order */
+    uint32_t nb_objs;       /**< Number of mbufs in the pool */
+    rte_atomic32_t next;    /**< First mbuf of the next chunk */
+} pcap_load_t;
+
 static pcap_info_t *pcap_info_list[RTE_MAX_ETHPORTS];
 
 void
@@ -28,113 +43,505 @@ pktgen_pcap_info(pcap_info_t *pcap, uint16_t port, int flag)
     printf(" snaplen: %d,", pcap->info.snaplen);
     printf(" sigfigs: %d,", pcap->info.sigfigs);
     printf(" network: %d", pcap->info.network);
-    printf(" Convert Endian: %s\n", pcap->convert ? "Yes" : "No");
-    if (flag)
+    printf(" Convert Endian: %s,", pcap->convert ? "Yes" : "No");
+    printf(" Format: %s\n", pktgen_pcap_format_name(pcap->format));
+    if (flag && pcap->stream) {
+        pcap_stream_t *st = pcap->stream;
+
+        printf("  Packet count: %d, max size %d, streamed from the file\n", pcap->pkt_count,
+               pcap->max_pkt_size);
+        printf("  Read: %" PRIu64 " packets, %" PRIu64 " bytes, %" PRIu64 " passes\n",
+               st->records, st->bytes, st->loops);
+        printf("  Ring full: %" PRIu64 ", no mbufs: %" PRIu64 ", ring empty: %" PRIu64 "\n",
+               st->ring_full, st->no_mbufs, st->ring_empty);
+    } else if (flag) {
         printf("  Packet count: %d, max size %d\n", pcap->pkt_count, pcap->max_pkt_size);
+        printf("  Duration: %.6f seconds, timed replay %s, speed ",
+               pcap->pkt_count ? (double)pcap->ts_ns[pcap->pkt_count - 1] / 1e9 : 0.0,
+               pktgen_tst_port_flags(l2p_get_port_pinfo(port), SEND_PCAP_TIMED) ? "on" : "off");
+        if (pcap->speed > 0.0)
+            printf("%gx\n", pcap->speed);
+        else
+            printf("top\n");
+        if (pcap->replay.gen)
+            printf("  Replay passes: %" PRIu64 ", max late: %.3f usec\n", pcap->replay.loops,
+                   ((double)pcap->replay.max_late * 1e6) / (double)pktgen_get_timer_hz());
+    }
     fflush(stdout);
 }
 
-static __inline__ void
-pcap_convert(pcap_info_t *pcap, pcap_record_hdr_t *pHdr)
+/* Record returned by pcap_next_record() */
+typedef struct pcap_rec_s {
+    const uint8_t *data; /* Packet bytes in the mapped file */
+    uint32_t caplen;     /* Bytes of the packet in the file */
+    uint32_t len;        /* Length of the packet on the wire */
+    uint16_t ifid;       /* pcapng interface of the packet, 0 for classic files */
+    uint64_t ts_ns;      /* Capture time in ns */
+} pcap_rec_t;
+
+static __inline__ uint64_t
+pcap_pow10(uint32_t e)
+{
+    uint64_t v = 1;
+
+    while (e--)
+        v *= 10;
+    return v;
+}
+
+static __inline__ uint16_t
+pcap_u16(bool swap, const uint8_t *p)
+{
+    uint16_t v;
+
+    memcpy(&v, p, sizeof(v));
+    return swap ? rte_bswap16(v) : v;
+}
+
+static __inline__ uint32_t
+pcap_u32(bool swap, const uint8_t *p)
+{
+    uint32_t v;
+
+    memcpy(&v, p, sizeof(v));
+    return swap ? rte_bswap32(v) : v;
+}
+
+/**
+ *
+ * pcapng_ns - Convert a pcapng timestamp to ns.
+ *
+ * DESCRIPTION
+ * The if_tsresol option gives the units of the interface timestamps, a power
+ * of 10 or with the top bit set a power of 2 of a second.
+ *
+ * RETURNS: Timestamp in ns.
+ *
+ * SEE ALSO:
+ */
+static __inline__ uint64_t
+pcapng_ns(uint8_t tsresol, uint64_t ticks)
 {
-    if (pcap->convert) {
-        pHdr->incl_len = ntohl(pHdr->incl_len);
-        pHdr->orig_len = ntohl(pHdr->orig_len);
-        pHdr->ts_sec   = ntohl(pHdr->ts_sec);
-        pHdr->ts_usec  = ntohl(pHdr->ts_usec);
+    uint32_t e = tsresol & 0x7f;
+
+    if (tsresol & 0x80) {
+        uint64_t sec, frac;
+
+        if (e == 0)
+            return ticks * Billion;
+        if (e >= 64)
+            return 0;
+        sec  = ticks >> e;
+        frac = ticks & ((1ULL << e) - 1);
+        if (e > 34) { /* Keep frac * Billion within 64 bits */
+            frac >>= (e - 34);
+            e = 34;
+        }
+        return (sec * Billion) + ((frac * Billion) >> e);
     }
+    if (e <= 9)
+        return ticks * pcap_pow10(9 - e);
+    if (e <= 28)
+        return ticks / pcap_pow10(e - 9);
+    return 0;
 }
 
+/**
+ *
+ * pcapng_block - Read a pcapng block that is not a packet.
+ *
+ * DESCRIPTION
+ * A section header sets the byte order and drops the interfaces of the previous
+ * section, an interface description adds an interface with its timestamp
+ * resolution. Other blocks are skipped.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
 static void
-pcap_rewind(pcap_info_t *pcap)
+pcapng_block(pcap_cursor_t *c, const uint8_t *b, uint32_t type, uint32_t blen)
+{
+    if (type == PCAPNG_SHB_TYPE) {
+        c->nb_ifs = 0;
+        return;
+    }
+    if (type != PCAPNG_IDB_TYPE || c->nb_ifs >= PCAPNG_MAX_IFS || blen < 20)
+        return;
+
+    uint16_t i = c->nb_ifs++;
+
+    c->linktype[i] = pcap_u16(c->swap, b + 8);
+    c->snaplen[i]  = pcap_u32(c->swap, b + 12);
+    c->tsresol[i]  = 6; /* Microseconds unless the option says otherwise */
+
+    /* Options run from after the snaplen to the trailing block length */
+    for (uint32_t o = 16; o + 4 <= blen - 4;) {
+        uint16_t code = pcap_u16(c->swap, b + o);
+        uint16_t olen = pcap_u16(c->swap, b + o + 2);
+
+        if (code == PCAPNG_OPT_END || o + 4 + olen > blen - 4)
+            break;
+        if (code == PCAPNG_IF_TSRESOL && olen >= 1)
+            c->tsresol[i] = b[o + 4];
+        o += 4 + RTE_ALIGN_CEIL(olen, 4);
+    }
+}
+
+/**
+ *
+ * pcap_next_record - Return the next packet of a mapped file.
+ *
+ * DESCRIPTION
+ * Walk the records of a classic pcap file or the blocks of a pcapng file from
+ * the cursor. A truncated or malformed record ends the walk like the end of the
+ * file does.
+ *
+ * RETURNS: true with the packet in rec, false at the end of the file.
+ *
+ * SEE ALSO:
+ */
+static bool
+pcap_next_record(pcap_info_t *pcap, pcap_cursor_t *c, pcap_rec_t *rec)
 {
-    /* Rewind to the beginning */
-    rewind(pcap->fp);
+    const uint8_t *map = pcap->map;
+    size_t len         = pcap->map_len;
 
-    /* Seek past the pcap header */
-    (void)fseek(pcap->fp, sizeof(pcap_hdr_t), SEEK_SET);
+    if (pcap->format != PCAP_FMT_PCAPNG) {
+        const uint8_t *h = map + c->off;
+        uint32_t sub;
+
+        if (c->off + sizeof(pcap_record_hdr_t) > len)
+            return false;
+
+        rec->caplen = pcap_u32(c->swap, h + 8);
+        rec->len    = pcap_u32(c->swap, h + 12);
+        if (c->off + sizeof(pcap_record_hdr_t) + rec->caplen > len)
+            return false;
+
+        /* The second field holds microseconds or, with the nanosecond magic, ns */
+        sub        = pcap_u32(c->swap, h + 4);
+        rec->ts_ns = ((uint64_t)pcap_u32(c->swap, h) * Billion) +
+                     ((pcap->format == PCAP_FMT_NSEC) ? sub : (uint64_t)sub * 1000);
+        rec->ifid  = 0;
+        rec->data  = h + sizeof(pcap_record_hdr_t);
+        c->off += sizeof(pcap_record_hdr_t) + rec->caplen;
+        c->last_ns = rec->ts_ns;
+        return true;
+    }
+
+    while (c->off + 12 <= len) {
+        const uint8_t *b = map + c->off;
+        uint32_t type, blen;
+
+        /* The byte order of a section is only known from its header */
+        if (pcap_u32(false, b) == PCAPNG_SHB_TYPE) {
+            if (c->off + 16 > len)
+                return false;
+            c->swap = (pcap_u32(false, b + 8) != PCAPNG_BYTE_ORDER);
+        }
+        type = pcap_u32(c->swap, b);
+        blen = pcap_u32(c->swap, b + 4);
+        if (blen < 12 || (blen & 3) || c->off + blen > len)
+            return false;
+        c->off += blen;
+
+        if (type == PCAPNG_EPB_TYPE && blen >= 32) {
+            uint32_t ifid = pcap_u32(c->swap, b + 8);
+            uint64_t ticks;
+
+            rec->caplen = pcap_u32(c->swap, b + 20);
+            rec->len    = pcap_u32(c->swap, b + 24);
+            if (ifid >= c->nb_ifs || rec->caplen > blen - 32)
+                continue;
+
+            ticks = ((uint64_t)pcap_u32(c->swap, b + 12) << 32) | pcap_u32(c->swap, b + 16);
+            rec->ts_ns = pcapng_ns(c->tsresol[ifid], ticks);
+            rec->ifid  = ifid;
+            rec->data  = b + 28;
+            c->last_ns = rec->ts_ns;
+            return true;
+        }
+        if (type == PCAPNG_SPB_TYPE && blen >= 16 && c->nb_ifs > 0) {
+            rec->len    = pcap_u32(c->swap, b + 8);
+            rec->caplen = RTE_MIN(rec->len, blen - 16);
+            if (c->snaplen[0])
+                rec->caplen = RTE_MIN(rec->caplen, c->snaplen[0]);
+            rec->ts_ns = c->last_ns; /* Simple packets carry no time */
+            rec->ifid  = 0;
+            rec->data  = b + 12;
+            return true;
+        }
+        pcapng_block(c, b, type, blen);
+    }
+    return false;
+}
+
+/**
+ *
+ * pcap_cursor_init - Start a walk at the first record of a file.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+static void
+pcap_cursor_init(pcap_info_t *pcap, pcap_cursor_t *c)
+{
+    memset(c, 0, sizeof(*c));
+    c->swap = pcap->convert;
+    c->off  = (pcap->format == PCAP_FMT_PCAPNG) ? 0 : sizeof(pcap_hdr_t);
 }
 
+/**
+ *
+ * pcap_get_info - Map a pcap file and index its records.
+ *
+ * DESCRIPTION
+ * Check the file header, then walk the records of the mapped file once to count
+ * them, find the largest one and note the offset and time of each when the
+ * file may be loaded. Classic files with microsecond or nanosecond timestamps
+ * and pcapng files in either byte order are accepted.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
 static void
 pcap_get_info(pcap_info_t *pcap)
 {
-    pcap_record_hdr_t hdr;
+    uint64_t total_size = 0;
+    uint32_t nb_index   = 0;
+    pcap_cursor_t c;
+    pcap_rec_t rec;
+    struct stat sb;
+    uint32_t magic;
 
-    if (fread(&pcap->info, 1, sizeof(pcap_hdr_t), pcap->fp) != sizeof(pcap_hdr_t))
+    if (fstat(fileno(pcap->fp), &sb) < 0 || (size_t)sb.st_size < sizeof(pcap_hdr_t))
         rte_exit(EXIT_FAILURE, "%s: failed to read pcap header\n", __func__);
 
+    pcap->map_len = sb.st_size;
+    pcap->map     = mmap(NULL, pcap->map_len, PROT_READ, MAP_SHARED, fileno(pcap->fp), 0);
+    if (pcap->map == MAP_FAILED)
+        rte_exit(EXIT_FAILURE, "%s: mmap(%s) failed: %s\n", __func__, pcap->filename,
+                 strerror(errno));
+    (void)madvise((void *)(uintptr_t)pcap->map, pcap->map_len, MADV_SEQUENTIAL);
+
+    memcpy(&pcap->info, pcap->map, sizeof(pcap_hdr_t));
+    magic = pcap->info.magic_number;
+
     /* Make sure we have a valid PCAP file for Big or Little Endian formats. */
-    if (pcap->info.magic_number == PCAP_MAGIC_NUMBER)
+    if (magic == PCAP_MAGIC_NUMBER || magic == PCAP_NSEC_MAGIC)
         pcap->convert = 0;
-    else if (pcap->info.magic_number == ntohl(PCAP_MAGIC_NUMBER))
+    else if (magic == rte_bswap32(PCAP_MAGIC_NUMBER) || magic == rte_bswap32(PCAP_NSEC_MAGIC))
         pcap->convert = 1;
+    else if (magic == PCAPNG_SHB_TYPE)
+        pcap->convert = (pcap_u32(false, pcap->map + 8) != PCAPNG_BYTE_ORDER);
     else
-        rte_exit(EXIT_FAILURE, "%s: invalid magic number 0x%08x\n", __func__,
-                 pcap->info.magic_number);
+        rte_exit(EXIT_FAILURE, "%s: invalid magic number 0x%08x\n", __func__, magic);
+
+    if (magic == PCAPNG_SHB_TYPE) {
+        pcap->format = PCAP_FMT_PCAPNG;
 
-    if (pcap->convert) {
-        pcap->info.magic_number  = ntohl(pcap->info.magic_number);
-        pcap->info.version_major = ntohs(pcap->info.version_major);
-        pcap->info.version_minor = ntohs(pcap->info.version_minor);
-        pcap->info.thiszone      = ntohl(pcap->info.thiszone);
-        pcap->info.sigfigs       = ntohl(pcap->info.sigfigs);
-        pcap->info.snaplen       = ntohl(pcap->info.snaplen);
-        pcap->info.network       = ntohl(pcap->info.network);
+        /* Show the version of the first section, the rest comes from its first interface */
+        memset(&pcap->info, 0, sizeof(pcap->info));
+        pcap->info.magic_number  = PCAPNG_SHB_TYPE;
+        pcap->info.version_major = pcap_u16(pcap->convert, pcap->map + 12);
+        pcap->info.version_minor = pcap_u16(pcap->convert, pcap->map + 14);
+    } else {
+        pcap->format = (pcap_u32(pcap->convert, pcap->map) == PCAP_NSEC_MAGIC) ? PCAP_FMT_NSEC
+                                                                              : PCAP_FMT_USEC;
+        if (pcap->convert) {
+            pcap->info.magic_number  = ntohl(pcap->info.magic_number);
+            pcap->info.version_major = ntohs(pcap->info.version_major);
+            pcap->info.version_minor = ntohs(pcap->info.version_minor);
+            pcap->info.thiszone      = ntohl(pcap->info.thiszone);
+            pcap->info.sigfigs       = ntohl(pcap->info.sigfigs);
+            pcap->info.snaplen       = ntohl(pcap->info.snaplen);
+            pcap->info.network       = ntohl(pcap->info.network);
+        }
     }
 
-    pcap->max_pkt_size  = 0;
-    pcap->avg_pkt_size  = 0;
-    uint64_t total_size = 0;
+    pcap->max_pkt_size = 0;
+    pcap->avg_pkt_size = 0;
+
     /* count the number of packets and get the largest size packet */
-    for (;;) {
-        if (fread(&hdr, 1, sizeof(pcap_record_hdr_t), pcap->fp) != sizeof(hdr))
-            break;
+    pcap_cursor_init(pcap, &c);
+    while (pcap_next_record(pcap, &c, &rec)) {
+        if (pcap->pkt_count == 0 && pcap->format == PCAP_FMT_PCAPNG) {
+            pcap->info.snaplen = c.snaplen[rec.ifid];
+            pcap->info.network = c.linktype[rec.ifid];
+        }
 
-        /* Convert the packet header to the correct format if needed */
-        pcap_convert(pcap, &hdr);
+        /* A file larger than PCAP_STREAM_MIN_BYTES is streamed and needs no index */
+        if (pcap->map_len <= PCAP_STREAM_MIN_BYTES && pcap->pkt_count == nb_index) {
+            pcap_index_t *index;
 
-        if (fseek(pcap->fp, hdr.incl_len, SEEK_CUR) < 0)
-            break;
+            nb_index = (nb_index == 0) ? PCAP_INDEX_SIZE : nb_index * 2;
+            index    = realloc(pcap->index, nb_index * sizeof(pcap_index_t));
+            if (index == NULL)
+                rte_exit(EXIT_FAILURE, "%s: unable to index %u packets\n", __func__, nb_index);
+            pcap->index = index;
+        }
+        if (pcap->index) {
+            pcap_index_t *ix = &pcap->index[pcap->pkt_count];
 
+            ix->off    = rec.data - pcap->map;
+            ix->ts_ns  = rec.ts_ns;
+            ix->caplen = rec.caplen;
+        }
         pcap->pkt_count++;
-        if (hdr.incl_len > pcap->max_pkt_size)
-            pcap->max_pkt_size = hdr.incl_len;
 
-        total_size += hdr.incl_len;
+        if (rec.caplen > pcap->max_pkt_size)
+            pcap->max_pkt_size = rec.caplen;
+
+        total_size += rec.caplen;
     }
     printf("PCAP: Max Packet Size: %d\n", pcap->max_pkt_size);
 
-    pcap->avg_pkt_size = total_size / pcap->pkt_count;
+    if (pcap->pkt_count)
+        pcap->avg_pkt_size = total_size / pcap->pkt_count;
 
     printf("PCAP: Avg Packet Size: %d\n", pcap->avg_pkt_size);
-
-    pcap_rewind(pcap);
 }
 
+/**
+ *
+ * pcap_load_mbuf - Copy a record of a mapped pcap file into an mbuf.
+ *
+ * DESCRIPTION
+ * The first pkt_count mbufs of the pool hold the file in order, the rest repeat
+ * it. Called by several lcores at once, each for its own mbufs.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
 static __inline__ void
-mbuf_iterate_cb(struct rte_mempool *mp, void *opaque, void *obj, unsigned obj_idx __rte_unused)
+pcap_load_mbuf(pcap_info_t *pcap, struct rte_mbuf *m, uint32_t idx)
 {
-    pcap_info_t *pcap     = (pcap_info_t *)opaque;
-    struct rte_mbuf *m    = (struct rte_mbuf *)obj;
-    pcap_record_hdr_t hdr = {0};
-
-    if (fread(&hdr, 1, sizeof(pcap_record_hdr_t), pcap->fp) != sizeof(hdr)) {
-        pcap_rewind(pcap);
-        if (fread(&hdr, 1, sizeof(pcap_record_hdr_t), pcap->fp) != sizeof(hdr))
-            rte_exit(EXIT_FAILURE, "%s: failed to read pcap header\n", __func__);
-    }
+    const pcap_index_t *ix = &pcap->index[idx % pcap->pkt_count];
 
-    pcap_convert(pcap, &hdr); /* Convert the packet header to the correct format. */
+    rte_memcpy(rte_pktmbuf_mtod(m, void *), pcap->map + ix->off, ix->caplen);
 
-    if (fread(rte_pktmbuf_mtod(m, char *), 1, hdr.incl_len, pcap->fp) == 0)
-        rte_exit(EXIT_FAILURE, "%s: failed to read packet data from PCAP file\n", __func__);
-
-    m->pool     = mp;
+    m->pool     = pcap->mp;
     m->next     = NULL;
-    m->data_len = hdr.incl_len;
-    m->pkt_len  = hdr.incl_len;
+    m->data_len = ix->caplen;
+    m->pkt_len  = ix->caplen;
     m->port     = 0;
     m->ol_flags = 0;
+
+    if (idx < pcap->pkt_count) {
+        pcap->pkts[idx]  = m;
+        pcap->ts_ns[idx] = ix->ts_ns;
+    }
+}
+
+static void
+pcap_obj_cb(struct rte_mempool *mp __rte_unused, void *opaque, void *obj, unsigned obj_idx)
+{
+    pcap_load_t *ld = (pcap_load_t *)opaque;
+
+    ld->objs[obj_idx] = (struct rte_mbuf *)obj;
+}
+
+/**
+ *
+ * pcap_load_worker - Fill chunks of mbufs until none are left.
+ *
+ * DESCRIPTION
+ * Run on every lcore while the file loads. Each lcore takes the next chunk of
+ * PCAP_LOAD_CHUNK mbufs, so a slow lcore does not hold up the others.
+ *
+ * RETURNS: 0
+ *
+ * SEE ALSO:
+ */
+static int
+pcap_load_worker(void *arg)
+{
+    pcap_load_t *ld = (pcap_load_t *)arg;
+
+    for (;;) {
+        uint32_t last  = (uint32_t)rte_atomic32_add_return(&ld->next, PCAP_LOAD_CHUNK);
+        uint32_t first = last - PCAP_LOAD_CHUNK;
+
+        if (first >= ld->nb_objs)
+            break;
+        last = RTE_MIN(last, ld->nb_objs);
+
+        for (uint32_t i = first; i < last; i++)
+            pcap_load_mbuf(ld->pcap, ld->objs[i], i);
+    }
+    return 0;
+}
+
+/**
+ *
+ * pcap_load_mbufs - Copy the records of a pcap file into its mbuf pool.
+ *
+ * DESCRIPTION
+ * The worker lcores are still idle while the command line is parsed, so they
+ * and the main lcore fill the pool together from the record index.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+static void
+pcap_load_mbufs(pcap_info_t *pcap, uint16_t sid)
+{
+    pcap_load_t ld = {0};
+    unsigned lcore;
+
+    ld.pcap    = pcap;
+    ld.nb_objs = pcap->mp->size;
+    ld.objs    = rte_malloc_socket(NULL, ld.nb_objs * sizeof(struct rte_mbuf *),
+                                   RTE_CACHE_LINE_SIZE, sid);
+    if (ld.objs == NULL)
+        rte_exit(EXIT_FAILURE, "%s: unable to allocate %u mbuf pointers\n", __func__, ld.nb_objs);
+
+    rte_mempool_obj_iter(pcap->mp, pcap_obj_cb, &ld);
+    rte_atomic32_init(&ld.next);
+
+    /* The lcores read the file out of order, have the kernel read all of it */
+    (void)madvise((void *)(uintptr_t)pcap->map, pcap->map_len, MADV_WILLNEED);
+
+    /* An lcore that cannot be launched leaves its share to the others */
+    RTE_LCORE_FOREACH_WORKER(lcore)
+    {
+        (void)rte_eal_remote_launch(pcap_load_worker, &ld, lcore);
+    }
+    pcap_load_worker(&ld);
+    rte_eal_mp_wait_lcore();
+
+    rte_free(ld.objs);
+}
+
+/**
+ *
+ * pcap_replay_times - Make the capture times relative to the first record.
+ *
+ * DESCRIPTION
+ * A record captured before the one ahead of it in the file is replayed right
+ * after it, so the replay times never go backwards.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+static void
+pcap_replay_times(pcap_info_t *pcap)
+{
+    uint64_t first = pcap->ts_ns[0], prev = 0;
+
+    for (uint32_t i = 0; i < pcap->pkt_count; i++) {
+        uint64_t t = pcap->ts_ns[i];
+
+        t              = (t > first) ? t - first : 0;
+        pcap->ts_ns[i] = RTE_MAX(t, prev);
+        prev           = pcap->ts_ns[i];
+    }
 }
 
 int
@@ -157,12 +564,256 @@ pktgen_pcap_add(char *filename, uint16_t pid)
 
     /* Default to little endian format. */
     pcap->filename = strdup(filename);
+    pcap->speed    = 1.0;
 
     pcap_info_list[pid] = pcap;
 
     return 0;
 }
 
+/**
+ *
+ * pcap_stream_read - Copy the next record of a streamed file into an mbuf.
+ *
+ * DESCRIPTION
+ * Reading starts over at the first record after the last one, a truncated last
+ * record ends the pass like the end of the file does.
+ *
+ * RETURNS: true if a record was read or false if a whole pass found none.
+ *
+ * SEE ALSO:
+ */
+static __inline__ bool
+pcap_stream_read(pcap_info_t *pcap, pcap_stream_t *st, struct rte_mbuf *m)
+{
+    bool restarted = false;
+    pcap_rec_t rec;
+
+    while (!pcap_next_record(pcap, &st->cur, &rec)) {
+        if (restarted)
+            return false;
+        pcap_cursor_init(pcap, &st->cur);
+        st->advised = 0;
+        st->loops++;
+        restarted = true;
+    }
+
+    rte_memcpy(rte_pktmbuf_mtod(m, void *), rec.data, rec.caplen);
+    m->data_len = rec.caplen;
+    m->pkt_len  = rec.caplen;
+
+    st->records++;
+    st->bytes += rec.caplen;
+
+    return true;
+}
+
+/**
+ *
+ * pcap_stream_advise - Ask the kernel to read ahead of a streamed file.
+ *
+ * DESCRIPTION
+ * Advise the next PCAP_STREAM_READAHEAD bytes once half of the previous window
+ * was read, so the reader thread rarely waits on a page fault.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+static void
+pcap_stream_advise(pcap_info_t *pcap, pcap_stream_t *st)
+{
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t start, len;
+
+    size_t off  = st->cur.off;
+
+    if (st->advised > off && (st->advised - off) > (PCAP_STREAM_READAHEAD / 2))
+        return;
+
+    start = RTE_ALIGN_FLOOR(off, page);
+    len   = RTE_MIN((size_t)PCAP_STREAM_READAHEAD, pcap->map_len - start);
+    (void)madvise((void *)(uintptr_t)(pcap->map + start), len, MADV_WILLNEED);
+    st->advised = start + len;
+}
+
+/*
+ * The reader starts while the arguments are parsed, before the ports are set up,
+ * so the port is looked up again each time and counts as not sending until then.
+ */
+static inline bool
+pcap_stream_sending(uint16_t pid)
+{
+    port_info_t *pinfo = l2p_get_port_pinfo(pid);
+
+    return pinfo != NULL && pktgen_tst_port_flags(pinfo, SENDING_PACKETS);
+}
+
+/**
+ *
+ * pcap_stream_thread - Reader thread of a streamed file.
+ *
+ * DESCRIPTION
+ * Fill the ring of the first TX queue with bursts of records. A full ring or an
+ * empty pool is counted while the port sends and waited out with a short sleep.
+ *
+ * RETURNS: NULL
+ *
+ * SEE ALSO:
+ */
+static void *
+pcap_stream_thread(void *arg)
+{
+    pcap_info_t *pcap = arg;
+    pcap_stream_t *st = pcap->stream;
+    struct rte_mbuf *pkts[PCAP_STREAM_BURST];
+
+    while (st->running) {
+        if (rte_ring_free_count(st->ring) < PCAP_STREAM_BURST) {
+            if (pcap_stream_sending(st->pid))
+                st->ring_full++;
+            usleep(PCAP_STREAM_IDLE_US);
+            continue;
+        }
+        if (rte_pktmbuf_alloc_bulk(pcap->mp, pkts, PCAP_STREAM_BURST) != 0) {
+            if (pcap_stream_sending(st->pid))
+                st->no_mbufs++;
+            usleep(PCAP_STREAM_IDLE_US);
+            continue;
+        }
+
+        for (int i = 0; i < PCAP_STREAM_BURST; i++) {
+            if (unlikely(!pcap_stream_read(pcap, st, pkts[i]))) {
+                pktgen_log_error("PCAP file %s has no complete record left, stop reading",
+                                 pcap->filename);
+                rte_pktmbuf_free_bulk(pkts, PCAP_STREAM_BURST);
+                return NULL;
+            }
+        }
+        pcap_stream_advise(pcap, st);
+
+        /* Only this thread enqueues, so the free space checked above is still there */
+        rte_ring_sp_enqueue_bulk(st->ring, (void **)pkts, PCAP_STREAM_BURST, NULL);
+    }
+    return NULL;
+}
+
+/**
+ *
+ * pktgen_pcap_thread_cpuset - Get the CPUs not used by the EAL lcores.
+ *
+ * DESCRIPTION
+ * The PCAP reader and writer threads copy every byte sent or captured, so they
+ * are kept off the lcores and the main lcore when there is a CPU left for them.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+void
+pktgen_pcap_thread_cpuset(rte_cpuset_t *cpuset)
+{
+    long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned lcore;
+
+    CPU_ZERO(cpuset);
+    for (long cpu = 0; cpu < ncpus && cpu < CPU_SETSIZE; cpu++)
+        CPU_SET(cpu, cpuset);
+
+    RTE_LCORE_FOREACH(lcore)
+    {
+        rte_cpuset_t used = rte_lcore_cpuset(lcore);
+
+        for (long cpu = 0; cpu < ncpus && cpu < CPU_SETSIZE; cpu++)
+            if (CPU_ISSET(cpu, &used))
+                CPU_CLR(cpu, cpuset);
+    }
+
+    if (CPU_COUNT(cpuset) == 0)
+        CPU_SET(rte_lcore_to_cpu_id(rte_get_main_lcore()), cpuset);
+}
+
+/**
+ *
+ * pcap_stream_open - Set up the streaming replay of a file too large to load.
+ *
+ * DESCRIPTION
+ * Create the small mbuf pool and the ring of the first TX queue and start the
+ * reader thread on the mapped file.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+static void
+pcap_stream_open(pcap_info_t *pcap, uint16_t pid, uint16_t sid, uint32_t dataroom)
+{
+    char name[RTE_RING_NAMESIZE];
+    rte_cpuset_t cpuset;
+    pcap_stream_t *st;
+
+    st = rte_zmalloc_socket(NULL, sizeof(pcap_stream_t), RTE_CACHE_LINE_SIZE, sid);
+    if (st == NULL)
+        rte_exit(EXIT_FAILURE, "%s: unable to allocate the PCAP stream\n", __func__);
+
+    /* The reader walks the file itself */
+    free(pcap->index);
+    pcap->index = NULL;
+
+    pcap_cursor_init(pcap, &st->cur);
+    st->pid = pid;
+
+    snprintf(name, sizeof(name), "pcap-%d", pid);
+    pcap->mp = rte_pktmbuf_pool_create(name, PCAP_STREAM_MBUFS, 0, DEFAULT_PRIV_SIZE, dataroom,
+                                       sid);
+    if (pcap->mp == NULL)
+        rte_exit(EXIT_FAILURE, "Cannot create mbuf pool (%s) port %d, nb_mbufs %d: %s\n", name,
+                 pid, PCAP_STREAM_MBUFS, rte_strerror(rte_errno));
+
+    snprintf(name, sizeof(name), "PCAP-Stream-%d", pid);
+    st->ring = rte_ring_create(name, PCAP_STREAM_RING_SIZE, sid, RING_F_SP_ENQ | RING_F_SC_DEQ);
+    if (st->ring == NULL)
+        rte_exit(EXIT_FAILURE, "Cannot create ring (%s): %s\n", name, rte_strerror(rte_errno));
+
+    pcap->stream = st;
+    st->running  = 1;
+    if (pthread_create(&st->tid, NULL, pcap_stream_thread, pcap))
+        rte_exit(EXIT_FAILURE, "%s: unable to create the PCAP reader thread\n", __func__);
+
+    pktgen_pcap_thread_cpuset(&cpuset);
+    pthread_setaffinity_np(st->tid, sizeof(cpuset), &cpuset);
+
+    printf("PCAP: Streaming %s, %u packets do not fit in memory\n", pcap->filename,
+           pcap->pkt_count);
+}
+
+/**
+ *
+ * pcap_stream_close - Stop the reader thread and release a streamed file.
+ *
+ * DESCRIPTION
+ * Stop the reader thread and free the records left in the ring.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+static void
+pcap_stream_close(pcap_info_t *pcap)
+{
+    pcap_stream_t *st = pcap->stream;
+    struct rte_mbuf *m;
+
+    st->running = 0;
+    pthread_join(st->tid, NULL);
+
+    while (rte_ring_sc_dequeue(st->ring, (void **)&m) == 0)
+        rte_pktmbuf_free(m);
+    rte_ring_free(st->ring);
+    rte_free(st);
+    pcap->stream = NULL;
+}
+
 int
 pktgen_pcap_open(void)
 {
@@ -187,10 +838,12 @@ pktgen_pcap_open(void)
 
         pcap_get_info(pcap);
 
+        /* A file without a complete record has nothing to load or stream */
         pkt_count = pcap->pkt_count;
         if (pkt_count == 0) {
             fclose(pcap->fp);
-            rte_exit(EXIT_FAILURE, "%s: PCAP file is empty: %s\n", __func__, pcap->filename);
+            rte_exit(EXIT_FAILURE, "%s: PCAP file has no complete record: %s\n", __func__,
+                     pcap->filename);
         }
         if (pkt_count < (DEFAULT_TX_DESC * 4))
             pkt_count = (DEFAULT_TX_DESC * 4);
@@ -198,6 +851,17 @@ pktgen_pcap_open(void)
         snprintf(name, sizeof(name), "pcap-%d", pid);
         uint32_t dataroom =
             RTE_ALIGN_CEIL(pcap->max_pkt_size + RTE_PKTMBUF_HEADROOM, RTE_CACHE_LINE_SIZE);
+
+        /* Records that do not fit in memory are read from the file while sending */
+        if (pcap->index == NULL ||
+            (uint64_t)pkt_count * (sizeof(struct rte_mbuf) + DEFAULT_PRIV_SIZE + dataroom) >
+                PCAP_STREAM_MIN_BYTES) {
+            pcap_stream_open(pcap, pid, sid, dataroom);
+            if (l2p_set_pcap_info(pid, pcap) < 0)
+                pktgen_log_error("Error opening PCAP file: %s", pcap->filename);
+            continue;
+        }
+
         mp = rte_pktmbuf_pool_create(name, pkt_count, 0, DEFAULT_PRIV_SIZE, dataroom, sid);
         if (mp == NULL)
             rte_exit(EXIT_FAILURE,
@@ -206,7 +870,24 @@ pktgen_pcap_open(void)
 
         pcap->mp = mp;
 
-        rte_mempool_obj_iter(mp, mbuf_iterate_cb, pcap);
+        pcap->pkts      = rte_zmalloc_socket(NULL, pcap->pkt_count * sizeof(struct rte_mbuf *),
+                                             RTE_CACHE_LINE_SIZE, sid);
+        pcap->ts_ns     = rte_zmalloc_socket(NULL, pcap->pkt_count * sizeof(uint64_t),
+                                             RTE_CACHE_LINE_SIZE, sid);
+        pcap->ts_cycles = rte_zmalloc_socket(NULL, pcap->pkt_count * sizeof(uint64_t),
+                                             RTE_CACHE_LINE_SIZE, sid);
+        if (pcap->pkts == NULL || pcap->ts_ns == NULL || pcap->ts_cycles == NULL)
+            rte_exit(EXIT_FAILURE, "%s: unable to allocate the replay table of %u packets\n",
+                     __func__, pcap->pkt_count);
+
+        pcap_load_mbufs(pcap, sid);
+        pcap_replay_times(pcap);
+
+        /* The records are in the mbufs now, the mapping and index are not needed */
+        free(pcap->index);
+        pcap->index = NULL;
+        munmap((void *)(uintptr_t)pcap->map, pcap->map_len);
+        pcap->map = NULL;
 
         if (l2p_set_pcap_info(pid, pcap) < 0)
             pktgen_log_error("Error opening PCAP file: %s", pcap->filename);
@@ -224,72 +905,476 @@ pktgen_pcap_close(void)
         if (pcap == NULL)
             return;
 
+        if (pcap->stream)
+            pcap_stream_close(pcap);
+        if (pcap->map)
+            munmap((void *)(uintptr_t)pcap->map, pcap->map_len);
+        free(pcap->index);
         if (pcap->filename)
             free(pcap->filename);
         if (pcap->fp)
             fclose(pcap->fp);
         if (pcap->mp)
             rte_mempool_free(pcap->mp);
+        rte_free(pcap->pkts);
+        rte_free(pcap->ts_ns);
+        rte_free(pcap->ts_cycles);
         rte_free(pcap);
     }
 }
 
-FILE *
-pktgen_create_pcap_file(char *filename)
+int
+pktgen_pcap_timing(port_info_t *pinfo, bool on)
+{
+    pcap_info_t *pcap = l2p_get_pcap(pinfo->pid);
+
+    if (pcap == NULL) {
+        pktgen_log_error("PCAP file is not loaded on port %d", pinfo->pid);
+        return -1;
+    }
+    if (on && pcap->stream) {
+        pktgen_log_error("PCAP file of port %d is streamed, timed replay needs it loaded",
+                         pinfo->pid);
+        return -1;
+    }
+    if (on && pcap->pkt_count < 2) {
+        /* A single record has no capture time gap to pace the passes with */
+        pktgen_log_error("PCAP file of port %d needs two records or more for timed replay",
+                         pinfo->pid);
+        return -1;
+    }
+    if (pktgen_tst_port_flags(pinfo, SENDING_PACKETS)) {
+        pktgen_log_error("Port %d is sending, stop it before changing the PCAP timing",
+                         pinfo->pid);
+        return -1;
+    }
+
+    if (on)
+        pktgen_set_port_flags(pinfo, SEND_PCAP_TIMED);
+    else
+        pktgen_clr_port_flags(pinfo, SEND_PCAP_TIMED);
+
+    return 0;
+}
+
+int
+pktgen_pcap_speed(port_info_t *pinfo, double speed)
+{
+    pcap_info_t *pcap = l2p_get_pcap(pinfo->pid);
+
+    if (pcap == NULL) {
+        pktgen_log_error("PCAP file is not loaded on port %d", pinfo->pid);
+        return -1;
+    }
+    if (speed < 0.0) {
+        pktgen_log_error("PCAP replay speed %g must be positive or 0 for top speed", speed);
+        return -1;
+    }
+    if (pktgen_tst_port_flags(pinfo, SENDING_PACKETS)) {
+        pktgen_log_error("Port %d is sending, stop it before changing the PCAP speed",
+                         pinfo->pid);
+        return -1;
+    }
+    pcap->speed = speed;
+
+    return 0;
+}
+
+void
+pktgen_pcap_replay_setup(pcap_info_t *pcap)
+{
+    double scale = 0.0;
+    uint32_t n   = pcap->pkt_count;
+
+    if (pcap->speed > 0.0)
+        scale = (double)pktgen_get_timer_hz() / (1e9 * pcap->speed);
+
+    for (uint32_t i = 0; i < n; i++)
+        pcap->ts_cycles[i] = (uint64_t)(((double)pcap->ts_ns[i] * scale) + 0.5);
+
+    /* The next pass starts one mean gap after the last record */
+    pcap->loop_cycles = 0;
+    if (n > 1)
+        pcap->loop_cycles = pcap->ts_cycles[n - 1] + (pcap->ts_cycles[n - 1] / (n - 1));
+
+    /* Publish the times before the TX queue sees the new generation */
+    rte_smp_wmb();
+    pcap->replay_gen++;
+}
+
+uint16_t
+pktgen_pcap_due(pcap_info_t *pcap, uint64_t now, struct rte_mbuf **pkts, uint16_t max)
+{
+    pcap_replay_t *r = &pcap->replay;
+    uint16_t n       = 0;
+
+    if (unlikely(r->gen != pcap->replay_gen)) {
+        r->gen = pcap->replay_gen;
+        rte_smp_rmb();
+        r->base     = now;
+        r->idx      = 0;
+        r->loops    = 1;
+        r->max_late = 0;
+    }
+
+    while (n < max) {
+        uint64_t due = r->base + pcap->ts_cycles[r->idx];
+
+        if ((int64_t)(now - due) < 0)
+            break;
+        if (now - due > r->max_late)
+            r->max_late = now - due;
+
+        pkts[n++] = pcap->pkts[r->idx];
+        if (unlikely(++r->idx == pcap->pkt_count)) {
+            r->idx = 0;
+            r->base += pcap->loop_cycles;
+            r->loops++;
+        }
+    }
+
+    return n;
+}
+
+int
+pktgen_pcap_format(port_info_t *pinfo, const char *fmt)
+{
+    if (!strcmp(fmt, "pcap"))
+        pinfo->pcap_fmt = PCAP_FMT_USEC;
+    else if (!strcmp(fmt, "nsec"))
+        pinfo->pcap_fmt = PCAP_FMT_NSEC;
+    else if (!strcmp(fmt, "pcapng"))
+        pinfo->pcap_fmt = PCAP_FMT_PCAPNG;
+    else {
+        pktgen_log_error("Unknown pcap file format %s, use pcap, nsec or pcapng", fmt);
+        return -1;
+    }
+    return 0;
+}
+
+const char *
+pktgen_pcap_format_name(uint32_t fmt)
+{
+    switch (fmt) {
+    case PCAP_FMT_NSEC:
+        return "nsec";
+    case PCAP_FMT_PCAPNG:
+        return "pcapng";
+    default:
+        return "pcap";
+    }
+}
+
+/**
+ *
+ * pcap_flush - Write the full part of the buffer of a buffered writer.
+ *
+ * DESCRIPTION
+ * With O_DIRECT only whole PCAP_WRITE_ALIGN blocks can be written, the tail is
+ * moved to the start of the buffer. When final is set the direct I/O is turned
+ * off so the tail can be written too.
+ *
+ * RETURNS: 0 on success or -1 on a write error.
+ *
+ * SEE ALSO:
+ */
+static int
+pcap_flush(pcap_writer_t *w, bool final)
+{
+    size_t n = w->len, off = 0;
+
+    if (final && w->direct) {
+        fcntl(w->fd, F_SETFL, fcntl(w->fd, F_GETFL) & ~O_DIRECT);
+        w->direct = false;
+    }
+    if (w->direct)
+        n = RTE_ALIGN_FLOOR(n, PCAP_WRITE_ALIGN);
+
+    while (off < n) {
+        ssize_t ret = write(w->fd, w->buf + off, n - off);
+
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        off += ret;
+    }
+
+    w->written += n;
+    w->len -= n;
+    if (w->len)
+        memmove(w->buf, w->buf + n, w->len);
+
+    return 0;
+}
+
+/* Append bytes to the file or to the buffer of a buffered writer */
+static int
+pcap_put(pcap_writer_t *w, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+
+    if (w->fp)
+        return (len == 0 || fwrite(data, len, 1, w->fp) == 1) ? 0 : -1;
+
+    while (len) {
+        size_t n = RTE_MIN(len, PCAP_WRITE_BUF_SIZE - w->len);
+
+        memcpy(w->buf + w->len, p, n);
+        w->len += n;
+        p += n;
+        len -= n;
+        if (w->len == PCAP_WRITE_BUF_SIZE && pcap_flush(w, false))
+            return -1;
+    }
+    return 0;
+}
+
+/* Bytes taken by a pcapng option with a value of len bytes */
+static __inline__ uint32_t
+pcapng_opt_len(uint32_t len)
+{
+    return 4 + RTE_ALIGN_CEIL(len, 4);
+}
+
+static int
+pcapng_write_opt(pcap_writer_t *w, uint16_t code, const void *val, uint16_t len)
+{
+    static const uint8_t pad[4];
+    uint16_t hdr[2] = {code, len};
+    uint32_t npad   = RTE_ALIGN_CEIL(len, 4) - len;
+
+    if (pcap_put(w, hdr, sizeof(hdr)) || pcap_put(w, val, len) || pcap_put(w, pad, npad))
+        return -1;
+    return 0;
+}
+
+/**
+ *
+ * pcapng_write_headers - Write the section header and the interface of a pcapng file.
+ *
+ * DESCRIPTION
+ * The section header names Pktgen as the writer and carries the run metadata as
+ * comments. The single Ethernet interface has nanosecond timestamps.
+ *
+ * RETURNS: 0 on success or -1 on a write error.
+ *
+ * SEE ALSO:
+ */
+static int
+pcapng_write_headers(pcap_writer_t *w, const char **comments)
+{
+    const char *appl    = PKTGEN_VERSION;
+    uint16_t ver[2]     = {1, 0};
+    int64_t section_len = -1; /* Not known while writing */
+    uint16_t lt[2]      = {1, 0}; /* LINKTYPE_ETHERNET */
+    uint32_t snaplen    = 65535;
+    uint8_t tsresol     = 9; /* 10^-9 seconds */
+    uint32_t hdr[3], blen;
+    int ret = 0;
+
+    blen = 28 + pcapng_opt_len(strlen(appl)) + 4;
+    for (int i = 0; comments && comments[i]; i++)
+        blen += pcapng_opt_len(RTE_MIN(strlen(comments[i]), (size_t)UINT16_MAX - 3));
+
+    hdr[0] = PCAPNG_SHB_TYPE;
+    hdr[1] = blen;
+    hdr[2] = PCAPNG_BYTE_ORDER;
+    if (pcap_put(w, hdr, sizeof(hdr)) || pcap_put(w, ver, sizeof(ver)) ||
+        pcap_put(w, &section_len, sizeof(section_len)))
+        return -1;
+    for (int i = 0; comments && comments[i]; i++)
+        ret |= pcapng_write_opt(w, PCAPNG_OPT_COMMENT, comments[i],
+                                RTE_MIN(strlen(comments[i]), (size_t)UINT16_MAX - 3));
+    ret |= pcapng_write_opt(w, PCAPNG_SHB_USERAPPL, appl, strlen(appl));
+    ret |= pcapng_write_opt(w, PCAPNG_OPT_END, NULL, 0);
+    if (ret || pcap_put(w, &blen, sizeof(blen)))
+        return -1;
+
+    blen   = 20 + pcapng_opt_len(sizeof(tsresol)) + 4;
+    hdr[0] = PCAPNG_IDB_TYPE;
+    hdr[1] = blen;
+    if (pcap_put(w, hdr, 2 * sizeof(uint32_t)) || pcap_put(w, lt, sizeof(lt)) ||
+        pcap_put(w, &snaplen, sizeof(snaplen)))
+        return -1;
+    ret |= pcapng_write_opt(w, PCAPNG_IF_TSRESOL, &tsresol, sizeof(tsresol));
+    ret |= pcapng_write_opt(w, PCAPNG_OPT_END, NULL, 0);
+    if (ret || pcap_put(w, &blen, sizeof(blen)))
+        return -1;
+
+    return 0;
+}
+
+/* Write the file header of the format of the writer */
+static int
+pcap_write_file_header(pcap_writer_t *w, const char **comments)
 {
     struct pcap_file_header file_header;
-    file_header.magic         = 0xa1b2c3d4;
-    file_header.version_major = 2;
-    file_header.version_minor = 4;
+
+    if (w->fmt == PCAP_FMT_PCAPNG)
+        return pcapng_write_headers(w, comments);
+
+    file_header.magic         = (w->fmt == PCAP_FMT_NSEC) ? PCAP_NSEC_MAGIC : PCAP_MAGIC_NUMBER;
+    file_header.version_major = PCAP_MAJOR_VERSION;
+    file_header.version_minor = PCAP_MINOR_VERSION;
     file_header.thiszone      = 0;
     file_header.sigfigs       = 0;
     file_header.snaplen       = 65535;
     file_header.linktype      = 1;        // LINKTYPE_ETHERNET
 
-    printf("Creating PCAP file: %s, %lu, %lu\n", filename, sizeof(struct pcap_file_header),
-           sizeof(struct pcap_pkthdr));
+    return pcap_put(w, &file_header, sizeof(file_header));
+}
+
+pcap_writer_t *
+pktgen_create_pcap_file(const char *filename, pcap_fmt_t fmt, const char **comments)
+{
+    pcap_writer_t *w;
+
+    w = calloc(1, sizeof(pcap_writer_t));
+    if (w == NULL)
+        return NULL;
+    w->fmt = fmt;
+    w->fd  = -1;
+
+    printf("Creating %s file: %s\n", pktgen_pcap_format_name(fmt), filename);
 
     // Open the output file
-    FILE *file = fopen(filename, "wb");
-    if (!file)
+    w->fp = fopen(filename, "wb");
+    if (w->fp == NULL) {
+        free(w);
         return NULL;
+    }
 
     // Write the file header
-    fwrite(&file_header, sizeof(uint8_t), sizeof(file_header), file);
-    fflush(file);
+    if (pcap_write_file_header(w, comments)) {
+        pktgen_log_error("Unable to write the header of %s", filename);
+        fclose(w->fp);
+        free(w);
+        return NULL;
+    }
+    fflush(w->fp);
 
-    return file;
+    return w;
+}
+
+pcap_writer_t *
+pktgen_create_pcap_stream_file(const char *filename, pcap_fmt_t fmt, const char **comments,
+                               bool direct)
+{
+    pcap_writer_t *w;
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+
+    w = calloc(1, sizeof(pcap_writer_t));
+    if (w == NULL)
+        return NULL;
+    w->fmt = fmt;
+
+    if (posix_memalign((void **)&w->buf, PCAP_WRITE_ALIGN, PCAP_WRITE_BUF_SIZE)) {
+        free(w);
+        return NULL;
+    }
+
+    w->fd = -1;
+    if (direct) {
+        w->fd = open(filename, flags | O_DIRECT, 0666);
+        if (w->fd < 0)
+            pktgen_log_warning("%s does not support O_DIRECT, using the page cache", filename);
+    }
+    w->direct = (w->fd >= 0);
+    if (w->fd < 0)
+        w->fd = open(filename, flags, 0666);
+    if (w->fd < 0) {
+        free(w->buf);
+        free(w);
+        return NULL;
+    }
+
+    printf("Creating %s file: %s%s\n", pktgen_pcap_format_name(fmt), filename,
+           w->direct ? " (O_DIRECT)" : "");
+
+    if (pcap_write_file_header(w, comments)) {
+        pktgen_log_error("Unable to write the header of %s", filename);
+        close(w->fd);
+        free(w->buf);
+        free(w);
+        return NULL;
+    }
+
+    return w;
 }
 
 void
-pktgen_close_pcap_file(FILE *fp)
+pktgen_close_pcap_file(pcap_writer_t *w)
 {
-    if (fp)
-        fclose(fp);
+    if (w == NULL)
+        return;
+
+    if (w->fp)
+        fclose(w->fp);
+    else {
+        if (pcap_flush(w, true))
+            pktgen_log_error("Unable to write the end of a pcap file: %s", strerror(errno));
+        close(w->fd);
+        free(w->buf);
+    }
+    free(w);
 }
 
 int
-pktgen_write_mbuf_to_pcap_file(FILE *fp, struct rte_mbuf *mbuf)
+pktgen_write_pcap_record(pcap_writer_t *w, uint64_t ts_ns, const void *data, uint32_t caplen,
+                         uint32_t len)
 {
-    // Packet header
-    pcap_record_hdr_t packet_header;
-    size_t size;
+    static const uint8_t pad[4];
 
-    if (fp == NULL)
+    if (w == NULL)
         return 0;
 
-    packet_header.ts_sec   = 0;
-    packet_header.ts_usec  = 0;
-    packet_header.incl_len = rte_pktmbuf_pkt_len(mbuf);
-    packet_header.orig_len = rte_pktmbuf_pkt_len(mbuf);
+    if (w->fmt == PCAP_FMT_PCAPNG) {
+        uint32_t npad = RTE_ALIGN_CEIL(caplen, 4) - caplen;
+        uint32_t blen = 32 + caplen + npad;
+        uint32_t epb[7];
 
-    // Write the packet header
-    if ((size = fwrite(&packet_header, sizeof(uint8_t), sizeof(packet_header), fp)) != 16)
-        printf("Error writing packet header %ld\n", size);
+        epb[0] = PCAPNG_EPB_TYPE;
+        epb[1] = blen;
+        epb[2] = 0; /* Interface */
+        epb[3] = (uint32_t)(ts_ns >> 32);
+        epb[4] = (uint32_t)ts_ns;
+        epb[5] = caplen;
+        epb[6] = len;
 
-    // Write the packet data
-    fwrite(rte_pktmbuf_mtod(mbuf, char *), sizeof(uint8_t), rte_pktmbuf_pkt_len(mbuf), fp);
-    fflush(fp);
+        if (pcap_put(w, epb, sizeof(epb)) || pcap_put(w, data, caplen) ||
+            pcap_put(w, pad, npad) || pcap_put(w, &blen, sizeof(blen)))
+            return -1;
+    } else {
+        pcap_record_hdr_t packet_header;
+
+        packet_header.ts_sec   = (uint32_t)(ts_ns / Billion);
+        packet_header.ts_usec  = (uint32_t)(ts_ns % Billion);
+        packet_header.incl_len = caplen;
+        packet_header.orig_len = len;
+        if (w->fmt == PCAP_FMT_USEC)
+            packet_header.ts_usec /= 1000;
+
+        if (pcap_put(w, &packet_header, sizeof(packet_header)) || pcap_put(w, data, caplen))
+            return -1;
+    }
+    return 0;
+}
+
+int
+pktgen_write_mbuf_to_pcap_file(pcap_writer_t *w, struct rte_mbuf *mbuf, uint64_t ts_ns)
+{
+    if (w == NULL)
+        return 0;
+
+    if (pktgen_write_pcap_record(w, ts_ns, rte_pktmbuf_mtod(mbuf, char *),
+                                 rte_pktmbuf_data_len(mbuf), rte_pktmbuf_pkt_len(mbuf)) < 0) {
+        printf("Error writing packet to the pcap file\n");
+        return -1;
+    }
+    if (w->fp)
+        fflush(w->fp);
 
     return 0;
 }
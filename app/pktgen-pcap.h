@@ -14,19 +14,51 @@
  * PCAP file read/write support for Pktgen.
  *
  * Provides structures mirroring the libpcap file format, plus functions for
- * opening, replaying, and writing PCAP files from mbufs.
+ * opening, replaying, and writing PCAP files from mbufs. Classic pcap files
+ * with microsecond or nanosecond timestamps and pcapng files are read, and
+ * written in the format selected for the port.
+ *
+ * A file whose records do not fit in PCAP_STREAM_MIN_BYTES of mbufs is not
+ * loaded but streamed: a reader thread copies the records of the mapped file
+ * into mbufs of a small pool and hands them to the first TX queue of the port
+ * through a single producer, single consumer ring.
  */
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
 #include <pcap/bpf.h>
 
+#include <rte_lcore.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 #define PCAP_MAGIC_NUMBER  0xa1b2c3d4 /**< PCAP global header magic (little-endian) */
+#define PCAP_NSEC_MAGIC    0xa1b23c4d /**< PCAP magic of files with nanosecond timestamps */
 #define PCAP_MAJOR_VERSION 2          /**< PCAP file format major version */
 #define PCAP_MINOR_VERSION 4          /**< PCAP file format minor version */
 
+#define PCAPNG_SHB_TYPE     0x0a0d0d0a /**< pcapng section header block */
+#define PCAPNG_IDB_TYPE     1          /**< pcapng interface description block */
+#define PCAPNG_SPB_TYPE     3          /**< pcapng simple packet block */
+#define PCAPNG_EPB_TYPE     6          /**< pcapng enhanced packet block */
+#define PCAPNG_BYTE_ORDER   0x1a2b3c4d /**< pcapng section byte order magic */
+#define PCAPNG_MAX_IFS      64         /**< Interfaces of a pcapng section that are read */
+#define PCAPNG_OPT_END      0          /**< pcapng end of options */
+#define PCAPNG_OPT_COMMENT  1          /**< pcapng comment option of any block */
+#define PCAPNG_SHB_USERAPPL 4          /**< pcapng application that wrote the section */
+#define PCAPNG_IF_NAME      2          /**< pcapng interface name option */
+#define PCAPNG_IF_TSRESOL   9          /**< pcapng interface timestamp resolution option */
+
+/** File formats read and written. */
+typedef enum {
+    PCAP_FMT_USEC = 0, /**< Classic pcap with microsecond timestamps */
+    PCAP_FMT_NSEC,     /**< Classic pcap with nanosecond timestamps */
+    PCAP_FMT_PCAPNG,   /**< pcapng with nanosecond timestamps when written */
+} pcap_fmt_t;
+
 /** PCAP global file header. */
 typedef struct pcap_hdr_s {
     uint32_t magic_number;  /**< magic number */
@@ -46,20 +78,98 @@ typedef struct pcap_record_hdr_s {
     uint32_t orig_len; /**< actual length of packet */
 } pcap_record_hdr_t;
 
+struct port_info_s;
+
+/** Position of a walk over the records of a mapped file. */
+typedef struct pcap_cursor_s {
+    size_t off;                        /**< Next record or pcapng block */
+    bool swap;                         /**< File or pcapng section is in the other byte order */
+    uint16_t nb_ifs;                   /**< Interfaces of the pcapng section */
+    uint8_t tsresol[PCAPNG_MAX_IFS];   /**< Timestamp resolution of each pcapng interface */
+    uint16_t linktype[PCAPNG_MAX_IFS]; /**< Link type of each pcapng interface */
+    uint32_t snaplen[PCAPNG_MAX_IFS];  /**< Snapshot length of each pcapng interface */
+    uint64_t last_ns;                  /**< Time of the last record, for records without one */
+} pcap_cursor_t;
+
+/** Record of the file index, kept only while a file is loaded. */
+typedef struct pcap_index_s {
+    uint64_t off;    /**< File offset of the packet data */
+    uint64_t ts_ns;  /**< Capture time in ns */
+    uint32_t caplen; /**< Bytes of the packet in the file */
+} pcap_index_t;
+
+#define PCAP_WRITE_BUF_SIZE (8UL << 20) /**< Output buffer of a buffered writer */
+#define PCAP_WRITE_ALIGN    4096        /**< Alignment of O_DIRECT buffers and writes */
+
+/** Output file opened by pktgen_create_pcap_file() or pktgen_create_pcap_stream_file(). */
+typedef struct pcap_writer_s {
+    FILE *fp;         /**< Output file of an unbuffered writer, NULL otherwise */
+    int fd;           /**< Output file of a buffered writer, -1 otherwise */
+    uint8_t fmt;      /**< pcap_fmt_t of the file */
+    bool direct;      /**< fd bypasses the page cache with O_DIRECT */
+    uint8_t *buf;     /**< PCAP_WRITE_ALIGN aligned output buffer of a buffered writer */
+    size_t len;       /**< Bytes waiting in buf */
+    uint64_t written; /**< Bytes written to the file */
+} pcap_writer_t;
+
+/** Timed replay position, written only by the lcore serving the first TX queue. */
+typedef struct pcap_replay_s {
+    uint64_t base;     /**< Time the current pass over the file started */
+    uint64_t max_late; /**< Most cycles a packet was sent after its replay time */
+    uint64_t loops;    /**< Passes over the file started since the port started */
+    uint32_t idx;      /**< Next record to send */
+    uint32_t gen;      /**< Replay setup the position belongs to */
+} pcap_replay_t;
+
+#define PCAP_STREAM_MIN_BYTES (1ULL << 30) /**< mbuf memory above which a file is streamed */
+#define PCAP_STREAM_RING_SIZE 16384        /**< Records read ahead of the TX queue */
+#define PCAP_STREAM_MBUFS     (PCAP_STREAM_RING_SIZE * 2) /**< mbufs of the stream pool */
+#define PCAP_STREAM_BURST     64                          /**< Records read per ring enqueue */
+#define PCAP_STREAM_READAHEAD (64UL << 20) /**< Bytes of the file the kernel reads ahead */
+#define PCAP_STREAM_IDLE_US   10           /**< Reader sleep when the ring or pool is full */
+
+struct rte_ring;
+
+/** Streaming replay of a file too large to load, see PCAP_STREAM_MIN_BYTES. */
+typedef struct pcap_stream_s {
+    struct rte_ring *ring;  /**< Records read ahead for the first TX queue */
+    pcap_cursor_t cur;      /**< Next record to read */
+    size_t advised;         /**< End of the range advised for readahead */
+    pthread_t tid;          /**< Reader thread */
+    uint16_t pid;           /**< Port the file is replayed on */
+    volatile int running;   /**< Cleared to stop the reader thread */
+    uint64_t records;       /**< Records read by the reader thread */
+    uint64_t bytes;         /**< Record bytes read by the reader thread */
+    uint64_t loops;         /**< Passes over the file started */
+    uint64_t ring_full;     /**< Reader waits on a full ring, TX queue is behind */
+    uint64_t no_mbufs;      /**< Reader waits on an empty pool, mbufs are still in the NIC */
+    uint64_t ring_empty;    /**< TX bursts that found no record, the reader is behind */
+} pcap_stream_t;
+
 /** Pktgen PCAP replay state for one port. */
 typedef struct pcap_info_s {
     char *filename;                  /**< allocated string for filename of pcap */
     FILE *fp;                        /**< file pointer for pcap file */
     struct rte_mempool *mp;          /**< Mempool for storing packets */
     uint32_t convert;                /**< Endian flag value if 1 convert to host endian format */
+    uint32_t format;                 /**< pcap_fmt_t of the file */
     uint32_t max_pkt_size;           /**< largest packet found in pcap file */
     uint32_t avg_pkt_size;           /**< average packet size in pcap file */
     uint32_t pkt_count;              /**< Number of packets in pcap file */
     uint32_t pkt_index;              /**< Index of current packet in pcap file */
     pcap_hdr_t info;                 /**< information on the PCAP file */
-    int32_t pcap_result;             /**< PCAP result of filter compile */
-    struct bpf_program pcap_program; /**< PCAP filter program structure */
 
+    struct rte_mbuf **pkts;       /**< mbuf holding each record, in file order */
+    uint64_t *ts_ns;              /**< Capture time of each record after the first one in ns */
+    uint64_t *ts_cycles;          /**< Replay time of each record at the set speed in cycles */
+    uint64_t loop_cycles;         /**< Replay time of a whole pass over the file */
+    double speed;                 /**< Timed replay speed multiplier, 0 for top speed */
+    volatile uint32_t replay_gen; /**< Bumped each time a timed replay starts */
+    pcap_replay_t replay;         /**< Timed replay position */
+    pcap_stream_t *stream;        /**< Streaming replay, NULL when the file is loaded */
+    const uint8_t *map;           /**< File mapped read only while it is loaded or streamed */
+    size_t map_len;               /**< Size of the file */
+    pcap_index_t *index;          /**< Records of the file while it is loaded */
 } pcap_info_t;
 
 /**
@@ -83,6 +193,52 @@ int pktgen_pcap_open(void);
 /** Close all open PCAP file handles. */
 void pktgen_pcap_close(void);
 
+/**
+ * Turn timed replay of the PCAP file of a port on or off.
+ *
+ * With timed replay the first TX queue sends the records in file order at their
+ * capture times, scaled by the speed multiplier, instead of at the port rate.
+ * The file must be loaded in memory and hold at least two records.
+ *
+ * @param pinfo  Port to change, it must not be sending.
+ * @param on     true to replay at the capture times.
+ * @return
+ *   0 on success or -1 on error.
+ */
+int pktgen_pcap_timing(struct port_info_s *pinfo, bool on);
+
+/**
+ * Set the timed replay speed multiplier of a port.
+ *
+ * @param pinfo  Port to change, it must not be sending.
+ * @param speed  2.0 replays twice as fast as captured, 0 sends back to back in file order.
+ * @return
+ *   0 on success or -1 on error.
+ */
+int pktgen_pcap_speed(struct port_info_s *pinfo, double speed);
+
+/**
+ * Compute the replay times of the records when a timed replay starts.
+ *
+ * @param pcap  PCAP of the port that starts.
+ */
+void pktgen_pcap_replay_setup(pcap_info_t *pcap);
+
+/**
+ * Take the records whose replay time has come.
+ *
+ * Only called by the lcore serving the first TX queue of the port. The file
+ * starts over after its last record, one file duration after the previous pass.
+ *
+ * @param pcap  PCAP of the port.
+ * @param now   Current time from pktgen_get_time().
+ * @param pkts  Array receiving the mbufs of the records, in file order.
+ * @param max   Most records to take.
+ * @return
+ *   Number of mbufs placed in @p pkts.
+ */
+uint16_t pktgen_pcap_due(pcap_info_t *pcap, uint64_t now, struct rte_mbuf **pkts, uint16_t max);
+
 /**
  * Print PCAP file information to the display.
  *
@@ -92,31 +248,94 @@ void pktgen_pcap_close(void);
  */
 void pktgen_pcap_info(pcap_info_t *pcap, uint16_t port, int flag);
 
+/**
+ * Set the format of the capture and TX pcap files of a port.
+ *
+ * @param pinfo  Port to change.
+ * @param fmt    Name of the format: "pcap", "nsec" or "pcapng".
+ * @return
+ *   0 on success or -1 on an unknown format.
+ */
+int pktgen_pcap_format(struct port_info_s *pinfo, const char *fmt);
+
+/**
+ * Return the name of a file format, as taken by pktgen_pcap_format().
+ *
+ * @param fmt  pcap_fmt_t value.
+ */
+const char *pktgen_pcap_format_name(uint32_t fmt);
+
 /**
  * Create a new PCAP output file for packet capture.
  *
  * @param filename  Path to the output PCAP file.
+ * @param fmt       pcap_fmt_t of the file.
+ * @param comments  NULL terminated run metadata written as pcapng section
+ *                  comments, ignored by the classic formats. May be NULL.
  * @return
- *   Open FILE pointer, or NULL on error.
+ *   Open file, or NULL on error.
  */
-FILE *pktgen_create_pcap_file(char *filename);
+pcap_writer_t *pktgen_create_pcap_file(const char *filename, pcap_fmt_t fmt,
+                                       const char **comments);
+
+/**
+ * Create a PCAP output file for a large stream of records.
+ *
+ * Records are gathered in a PCAP_WRITE_BUF_SIZE buffer written with one
+ * write() call when full, so the file is written in large aligned chunks.
+ *
+ * @param filename  Path to the output PCAP file.
+ * @param fmt       pcap_fmt_t of the file.
+ * @param comments  NULL terminated run metadata written as pcapng section
+ *                  comments, ignored by the classic formats. May be NULL.
+ * @param direct    Open the file with O_DIRECT, the page cache is used when the
+ *                  file system does not support it.
+ * @return
+ *   Open file, or NULL on error.
+ */
+pcap_writer_t *pktgen_create_pcap_stream_file(const char *filename, pcap_fmt_t fmt,
+                                              const char **comments, bool direct);
 
 /**
  * Close and finalise a PCAP output file.
  *
- * @param fp  File pointer returned by pktgen_create_pcap_file().
+ * @param w  File returned by pktgen_create_pcap_file().
+ */
+void pktgen_close_pcap_file(pcap_writer_t *w);
+
+/**
+ * Append a packet record to an open PCAP file.
+ *
+ * @param w       Open PCAP file.
+ * @param ts_ns   Capture time in ns since the epoch.
+ * @param data    Packet bytes.
+ * @param caplen  Bytes of the packet written.
+ * @param len     Length of the packet on the wire.
+ * @return
+ *   0 on success, -1 on write error.
+ */
+int pktgen_write_pcap_record(pcap_writer_t *w, uint64_t ts_ns, const void *data, uint32_t caplen,
+                             uint32_t len);
+
+/**
+ * Get the CPUs not used by the EAL lcores, for Pktgen helper threads.
+ *
+ * @param cpuset
+ *   Filled with the free CPUs, or the CPU of the main lcore when all CPUs are
+ *   used by lcores.
  */
-void pktgen_close_pcap_file(FILE *fp);
+void pktgen_pcap_thread_cpuset(rte_cpuset_t *cpuset);
 
 /**
  * Append one mbuf as a packet record to an open PCAP file.
  *
- * @param fp    Open PCAP file handle.
- * @param mbuf  mbuf containing the packet to write.
+ * @param w      Open PCAP file.
+ * @param mbuf   mbuf containing the packet to write.
+ * @param ts_ns  Capture time in ns since the epoch.
  * @return
  *   0 on success, negative on write error.
  */
-int pktgen_write_mbuf_to_pcap_file(FILE *fp, struct rte_mbuf *mbuf);
+int pktgen_write_mbuf_to_pcap_file(pcap_writer_t *w, struct rte_mbuf *mbuf, uint64_t ts_ns);
 
 #ifdef __cplusplus
 }
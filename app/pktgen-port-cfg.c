@@ -12,6 +12,7 @@
 #include "l2p.h"
 
 #include <rte_dev.h>
+#include <rte_mbuf_dyn.h>
 
 #include <link.h>
 
@@ -217,6 +218,11 @@ allocate_port_info(uint16_t pid)
         goto leave;
     }
 
+    pinfo->fill_buf = rte_zmalloc_socket(NULL, pktsz, RTE_CACHE_LINE_SIZE, sid);
+    if (pinfo->fill_buf == NULL)
+        pktgen_log_panic("Unable to allocate %ld fill pattern buffer space", pktsz);
+    pinfo->fill_buf_len = pktsz;
+
     for (int i = 0; i < NUM_TOTAL_PKTS; i++) {
         pinfo->seq_pkt[i].hdr = rte_zmalloc_socket(NULL, pktsz, RTE_CACHE_LINE_SIZE, sid);
         if (pinfo->seq_pkt[i].hdr == NULL)
@@ -258,6 +264,7 @@ _latency_defaults(port_info_t *pinfo)
     lat->jitter_threshold_us = DEFAULT_JITTER_THRESHOLD;
     lat->latency_rate_us     = DEFAULT_LATENCY_RATE;
     lat->latency_entropy     = DEFAULT_LATENCY_ENTROPY;
+    lat->probes_per_burst    = DEFAULT_LATENCY_PROBES;
     lat->latency_rate_cycles =
         pktgen_get_timer_hz() / ((uint64_t)MAX_LATENCY_RATE / lat->latency_rate_us);
     uint64_t ticks               = pktgen_get_timer_hz() / (uint64_t)1000000;
@@ -271,6 +278,7 @@ _fill_pattern_defaults(port_info_t *pinfo)
 
     pinfo->fill_pattern_type = ABC_FILL_PATTERN;
     snprintf(pinfo->user_pattern, sizeof(pinfo->user_pattern), "%s", "0123456789abcdef");
+    pktgen_fill_pattern_update(pinfo);
 }
 
 static void
@@ -337,10 +345,16 @@ _tx_offload_defaults(port_info_t *pinfo)
 {
     struct rte_eth_dev_info *dinfo = &pinfo->dev_info;
     struct rte_eth_conf *conf      = &pinfo->conf;
+    pcap_info_t *pcap              = l2p_get_pcap(pinfo->pid);
 
     pktgen_log_info("   Setup TX offload defaults");
 
-    if (dinfo->tx_offload_capa & RTE_ETH_TX_OFFLOAD_MBUF_FAST_FREE)
+    /* Timed replay sends the loaded pcap mbufs with an extra reference, which
+     * fast free ignores, so a port with a loaded pcap file frees them normally.
+     */
+    if (pcap && pcap->stream == NULL)
+        pktgen_log_info("   PCAP file loaded, Tx MBUF_FAST_FREE left off");
+    else if (dinfo->tx_offload_capa & RTE_ETH_TX_OFFLOAD_MBUF_FAST_FREE)
         conf->txmode.offloads |= RTE_ETH_TX_OFFLOAD_MBUF_FAST_FREE;
 
     if (dinfo->tx_offload_capa & RTE_ETH_TX_OFFLOAD_TCP_CKSUM) {
@@ -359,6 +373,48 @@ _tx_offload_defaults(port_info_t *pinfo)
     }
 }
 
+static void
+_tx_offload_profile(port_info_t *pinfo)
+{
+    tx_offload_t *ol = &pinfo->tx_ol;
+
+    ol->offloads   = pinfo->conf.txmode.offloads;
+    ol->ipv4_cksum = (ol->offloads & RTE_ETH_TX_OFFLOAD_IPV4_CKSUM) != 0;
+    ol->udp_cksum  = (ol->offloads & RTE_ETH_TX_OFFLOAD_UDP_CKSUM) != 0;
+    ol->tcp_cksum  = (ol->offloads & RTE_ETH_TX_OFFLOAD_TCP_CKSUM) != 0;
+
+    pktgen_log_info("   TX offload profile: IPv4 %s, UDP %s, TCP %s checksum",
+                    ol->ipv4_cksum ? "HW" : "SW", ol->udp_cksum ? "HW" : "SW",
+                    ol->tcp_cksum ? "HW" : "SW");
+}
+
+static void
+_rx_timestamp_setup(port_info_t *pinfo)
+{
+    hw_tstamp_t *hw = &pinfo->hw_tstamp;
+
+    if ((pktgen.flags & HW_TSTAMP_FLAG) == 0)
+        return;
+
+    if ((pinfo->dev_info.rx_offload_capa & RTE_ETH_RX_OFFLOAD_TIMESTAMP) == 0) {
+        pktgen_log_warning("   RX timestamps not supported on port %u, latency uses the TSC",
+                           pinfo->pid);
+        return;
+    }
+
+    /* The dynamic field must be registered before the RX queues are setup */
+    if (rte_mbuf_dyn_rx_timestamp_register(&hw->dynfield_offset, &hw->rx_flag) < 0) {
+        pktgen_log_warning("   Unable to register the mbuf timestamp field for port %u: %s",
+                           pinfo->pid, rte_strerror(rte_errno));
+        return;
+    }
+
+    pinfo->conf.rxmode.offloads |= RTE_ETH_RX_OFFLOAD_TIMESTAMP;
+    hw->rx_enabled = true;
+
+    pktgen_log_info("   Setup RX hardware timestamps");
+}
+
 static void
 _device_configuration(port_info_t *pinfo)
 {
@@ -506,6 +562,20 @@ _promiscuous_mode(port_info_t *pinfo)
     }
 }
 
+static void
+_rx_quiesce_setup(port_info_t *pinfo)
+{
+    uint32_t nb_rxq = RTE_MAX(l2p_get_rxcnt(pinfo->pid), 1);
+    size_t sz       = rte_rcu_qsbr_get_memsize(nb_rxq);
+
+    pktgen_log_info("   Setup RX quiescent state reporting");
+
+    pinfo->rx_qsv = rte_zmalloc_socket("rx_qsv", sz, RTE_CACHE_LINE_SIZE,
+                                       pg_eth_dev_socket_id(pinfo->pid));
+    if (pinfo->rx_qsv == NULL || rte_rcu_qsbr_init(pinfo->rx_qsv, nb_rxq))
+        pktgen_log_panic("Unable to set up the RX quiescent state of port %u", pinfo->pid);
+}
+
 static void
 _debug_output(port_info_t *pinfo)
 {
@@ -547,12 +617,15 @@ initialize_port_info(uint16_t pid)
         _mtu_defaults,
         _rx_offload_defaults,
         _tx_offload_defaults,
+        _tx_offload_profile,
+        _rx_timestamp_setup,
         _device_configuration,
         _rxtx_descriptors,
         _src_mac_address,
         _device_ptypes,
         _device_mtu,
         _rx_queues,
+        _rx_quiesce_setup,
         _tx_queues,
         _debug_output,
         _promiscuous_mode,
@@ -644,3 +717,9 @@ pktgen_config_ports(void)
     for (uint16_t sid = 0; sid < coreinfo_socket_cnt(); sid++)
         pktgen_packet_capture_init(sid);
 }
+
+void
+pktgen_rx_quiesce(port_info_t *pinfo)
+{
+    rte_rcu_qsbr_synchronize(pinfo->rx_qsv, RTE_QSBR_THRID_INVALID);
+}
@@ -22,6 +22,7 @@
 #include <string.h>
 #include <rte_version.h>
 #include <rte_atomic.h>
+#include <rte_spinlock.h>
 #include <rte_pci.h>
 #ifdef TX_DEBUG_PKT_DUMP
 #include "rte_hexdump.h"
@@ -36,14 +37,13 @@
 #include "pktgen-pcap.h"
 #include "pktgen-dump.h"
 #include "pktgen-ether.h"
+#include "pktgen-hist.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 #define USER_PATTERN_SIZE 16 /**< Maximum length of the user-defined fill pattern */
-#define MAX_LATENCY_ENTRIES \
-    50108 /**< Max latency records (limited by latsamp_stats_t.data[] max size) */
 
 // clang-format off
 enum { /* Per port flag bits */
@@ -58,6 +58,8 @@ enum { /* Per port flag bits */
        CAPTURE_PKTS             = (1ULL << 5), /**< Capture received packets */
        SAMPLING_LATENCIES       = (1ULL << 6), /**< Sampling latency measurements */
 
+       SIGNATURE_PKTS           = (1ULL << 7), /**< Sign data packets, analyze received ones */
+
        SEND_PING4_REQUEST       = (1ULL << 8), /**< Send a IPv4 Ping request */
        SEND_PING6_REQUEST       = (1ULL << 9), /**< Send a IPv6 Ping request */
 
@@ -79,6 +81,10 @@ enum { /* Per port flag bits */
        SEND_LATENCY_PKTS        = (1ULL << 23), /**< Send latency packets in any mode */
 
        /* Sending flags */
+       TX_RATE_PROFILE          = (1ULL << 24), /**< TX rate follows the port rate profile */
+       SEND_IMIX_PKTS           = (1ULL << 25), /**< Single packets use the port IMIX sizes */
+       SEND_STREAM_PKTS         = (1ULL << 26), /**< Send the enabled streams of the port */
+       SEND_PCAP_TIMED          = (1ULL << 27), /**< Replay the pcap file at its capture times */
        SETUP_TRANSMIT_PKTS      = (1ULL << 28), /**< Need to setup transmit packets */
        STOP_RECEIVING_PACKETS   = (1ULL << 29), /**< Stop receiving packet */
        SENDING_PACKETS          = (1ULL << 30), /**< sending packets on this port */
@@ -91,12 +97,16 @@ enum { /* Per port flag bits */
 #define RANDOMIZE_SRC_PT (1ULL << 33) /**< Set the source port as random */
 // clang-format on
 
-#define EXCLUSIVE_MODES (SEND_SINGLE_PKTS | SEND_PCAP_PKTS | SEND_RANGE_PKTS | SEND_SEQ_PKTS)
+#define EXCLUSIVE_MODES \
+    (SEND_SINGLE_PKTS | SEND_PCAP_PKTS | SEND_RANGE_PKTS | SEND_SEQ_PKTS | SEND_STREAM_PKTS)
 
 #define EXCLUSIVE_PKT_MODES                                                                       \
     (SEND_RANDOM_PKTS | SEND_VLAN_ID | SEND_MPLS_LABEL | SEND_Q_IN_Q_IDS | SEND_GRE_IPv4_HEADER | \
      SEND_GRE_ETHER_HEADER | SEND_VXLAN_PACKETS | SEND_LATENCY_PKTS)
 
+/** Modes IMIX sizes do not apply to, they only resize single packets */
+#define IMIX_EXCLUDED_MODES (SEND_PCAP_PKTS | SEND_RANGE_PKTS | SEND_SEQ_PKTS | SEND_STREAM_PKTS)
+
 #define RTE_PMD_PARAM_UNSET -1
 
 /** Payload fill pattern mode. */
@@ -110,54 +120,207 @@ typedef enum {
 /** Function pointer type for a port's TX handler. */
 typedef void (*tx_func_t)(struct port_info_s *info, uint16_t qid);
 
-#define RING_SIZE 1024 /**< Number of entries in the tail-latency ring buffer */
-
-/** Ring buffer for recording tail-latency samples. */
-typedef struct {
-    uint64_t data[RING_SIZE]; /**< Latency sample values (in TSC cycles) */
-    int head;                 /**< Index of next write position */
-    int count;                /**< Number of elements currently in the ring */
-} latency_ring_t;
+/** Per-RX-queue latency accumulators, written only by the lcore serving the RX queue. */
+typedef struct rx_latency_s {
+    uint64_t num_latency_pkts;     /**< Number of latency packets received on this queue */
+    uint64_t num_skipped;          /**< Number of out-of-sequence latency packets skipped */
+    uint64_t running_cycles;       /**< Sum of latency cycles for the received packets */
+    uint64_t prev_cycles;          /**< Latency of the previous packet, used for jitter */
+    uint64_t min_cycles;           /**< Minimum latency in cycles */
+    uint64_t max_cycles;           /**< Maximum latency in cycles */
+    uint64_t jitter_count;         /**< Number of packets over the jitter threshold */
+    uint32_t expect_index[MAX_QUEUES_PER_PORT]; /**< Expected sequence per sending TX queue */
+    uint32_t seen_txq; /**< Bit per sending TX queue with an expected sequence */
+    uint32_t gen;      /**< lat_clear_gen the counters of the queue follow */
+    lat_hist_t hist;   /**< Histogram of all latencies received on this queue */
+} rx_latency_t __rte_cache_aligned;
+
+#define PROBE_WIN_SIZE 1024 /**< Latency probes tracked per TX queue with entropy */
+#define PROBE_WIN_LAG  256  /**< Probes after which a missing probe counts as skipped */
 
-/** Per-queue latency sample collection buffer. */
+/**
+ * Latency probes of one TX queue received on any RX queue, used to count the
+ * skipped probes when entropy spreads them over the RX queues.
+ */
+typedef struct rx_probe_win_s {
+    uint64_t bits[PROBE_WIN_SIZE / 64]; /**< Bit per received sequence number modulo the size */
+    volatile uint32_t first;            /**< First sequence number received plus one, 0 before */
+} rx_probe_win_t __rte_cache_aligned;
+
+/** Per-TX-queue latency probe state, written only by the lcore serving the TX queue. */
+typedef struct tx_latency_s {
+    uint64_t next_cycles; /**< Time the next latency probe is due */
+    uint64_t num_tx_pkts; /**< Number of latency probes sent on this queue */
+    uint64_t no_mbufs;    /**< Number of probes not sent because no mbuf was available */
+    uint32_t next_index;  /**< Sequence number of the next probe on this queue */
+    uint16_t pending;     /**< Probes at the end of the burst waiting for their TX timestamp */
+    uint32_t gen;         /**< lat_clear_gen the counters of the queue follow */
+} tx_latency_t __rte_cache_aligned;
+
+/** Per-queue latency sampler state, written only by the lcore serving the RX queue. */
 typedef struct {
-    uint64_t data[MAX_LATENCY_ENTRIES]; /**< Recorded latency values in cycles */
-    uint32_t idx;                       /**< Index to the latencies array */
-    uint32_t num_samples;               /**< Number of latency samples */
-    uint64_t next;                      /**< Next latency sample time */
-    uint64_t reserved[2];               /**< Reserved for future use and align 64 bytes */
+    struct rte_ring *ring; /**< SPSC ring of sampled latencies in nanoseconds */
+    uint64_t next;         /**< Next latency sample time */
+    uint64_t num_samples;  /**< Number of samples to take on this queue */
+    uint64_t count;        /**< Number of samples queued for the writer */
+    uint64_t dropped;      /**< Number of samples lost because the ring was full */
 } latsamp_stats_t __rte_cache_aligned;
 
-/** Per-port latency measurement state and running statistics. */
+/** NIC clock to pktgen time conversion, published by the timer thread. */
+typedef struct hw_tstamp_cal_s {
+    uint64_t clock;       /**< NIC clock at the reference point */
+    uint64_t time;        /**< pktgen_get_time() at the reference point */
+    double time_per_tick; /**< pktgen time units per NIC clock tick, 0 when not calibrated */
+} hw_tstamp_cal_t;
+
+/** Hardware RX timestamp state for a port. */
+typedef struct hw_tstamp_s {
+    bool rx_enabled;           /**< RX timestamp offload is enabled on the port */
+    int dynfield_offset;       /**< Offset of the mbuf timestamp dynamic field */
+    uint64_t rx_flag;          /**< mbuf ol_flags bit set when the RX timestamp is valid */
+    uint64_t first_clock;      /**< NIC clock at the first calibration */
+    uint64_t first_time;       /**< pktgen time at the first calibration */
+    hw_tstamp_cal_t cal[2];    /**< Double buffered conversion, cal_idx selects the valid one */
+    volatile uint32_t cal_idx; /**< Index of the valid entry in cal[] */
+} hw_tstamp_t;
+
+/**
+ * Per-port latency measurement state and running statistics.
+ *
+ * The statistics are merged from the per-queue rx_latency_t and tx_latency_t entries
+ * by the timer thread, see pktgen_latency_merge().
+ */
 typedef struct {
     uint64_t latency_rate_us;         /**< Number micro-seconds between injecting packets */
     uint64_t jitter_threshold_us;     /**< Jitter threshold in micro-seconds */
     uint64_t jitter_threshold_cycles; /**< Jitter threshold cycles */
     uint64_t latency_rate_cycles;     /**< Number of cycles between injections */
-    uint64_t latency_timo_cycles;     /**< Number of cycles to next latency injection */
     uint16_t latency_entropy;         /**< Entropy value to be used to increment sport */
+    uint16_t probes_per_burst;        /**< Max latency probes placed in a single TX burst */
+    bool hw_tstamp;                   /**< Use RX hardware timestamps when the port has them */
+    uint64_t int_time;                /**< Time the last interval histogram was cut */
+    uint64_t int_cycles;              /**< Length of the last interval histogram */
     MARKER stats;                     /**< Start marker for stats region (used to clear stats) */
     uint64_t jitter_count;            /**< Number of jitter stats */
     uint64_t num_latency_pkts;        /**< Total number of latency packets */
-    uint64_t num_latency_tx_pkts;     /**< Total number of TX latency packets */
+    uint64_t num_latency_tx_pkts;     /**< Total number of TX latency packets, all TX queues */
     uint64_t num_skipped;             /**< Number of skipped latency packets */
     uint64_t running_cycles;          /**< Running, Number of cycles per latency packet */
-    uint64_t prev_cycles;             /**< previous cycles cyles time from last latency packet */
     uint64_t min_cycles;              /**< minimum cycles per latency packet */
     uint64_t avg_cycles;              /**< average cycles per latency packet */
     uint64_t max_cycles;              /**< maximum cycles per latency packet */
-    uint32_t next_index;              /**< Next index to use for sending latency packets */
-    uint32_t expect_index;            /**< Expected index for received latency packets */
-    latency_ring_t tail_latencies;    /**< ring buffer for tail latencies */
+    lat_hist_t run_hist;              /**< Latency histogram for the whole run */
+    lat_hist_t prev_hist;             /**< Run histogram at the previous merge */
+    lat_hist_t int_hist;              /**< Latency histogram for the last interval */
     MARKER end_stats;                 /**< End marker for stats region (used to clear stats) */
 } latency_t;
 
+#define TX_PACE_SHIFT      48 /**< Fraction bits of the fixed point TX packet credit */
+#define TX_PACE_ONE        (1ULL << TX_PACE_SHIFT) /**< One packet of TX credit */
+#define TX_PACE_GAP_NS     1000 /**< Shortest gap between paced bursts before the burst grows */
+#define TX_PACE_MAX_BURSTS 2    /**< Bursts of credit a TX queue may bank while it is late */
+
+/**
+ * Port TX pacing parameters, set by pktgen_tx_pace_set() and read by the TX lcores.
+ *
+ * The TX lcores pace with a copy taken under port_info_t.tx_pace_gen, so the
+ * parameters of one setting are never mixed with those of another.
+ */
+typedef struct tx_pace_cfg_s {
+    uint64_t credit_rate; /**< Packet credit earned per timer cycle, 0 when not paced */
+    uint64_t credit_max;  /**< Most credit a TX queue may bank */
+    uint64_t max_cycles;  /**< Longest time credited at once, keeps the credit math in 64 bits */
+    uint16_t burst;       /**< Packets sent per paced burst */
+    double pps;           /**< Requested packets per second per TX queue */
+    double pps_per_pcnt;  /**< Packets per second per TX queue for one percent of the link */
+} tx_pace_cfg_t;
+
+/** Flight recorder settings of a port, used when its capture mode is ring. */
+typedef struct cap_ring_cfg_s {
+    uint32_t size_mb;  /**< Recorder memory split over the RX queues, 0 for the default */
+    uint32_t pre_ms;   /**< Time before the trigger written, 0 for all that is held */
+    uint32_t post_ms;  /**< Time the capture runs on after the trigger */
+    uint32_t lat_us;   /**< Latency that triggers the recorder, 0 for none */
+    uint32_t triggers; /**< CAP_TRIG_* bits of the automatic triggers armed */
+} cap_ring_cfg_t;
+
+/** Capture sampling and truncation of a port, applied in every capture mode. */
+typedef struct cap_sample_cfg_s {
+    uint32_t rate;    /**< Keep 1 in rate packets or flows, 0 or 1 keeps every packet */
+    uint16_t snaplen; /**< Bytes kept of each packet, 0 keeps the whole first segment */
+    uint8_t mode;     /**< CAP_SAMPLE_* */
+} cap_sample_cfg_t;
+
+/** TX packet arrival models. */
+enum {
+    TX_ARRIVAL_PERIODIC = 0, /**< Evenly spaced bursts */
+    TX_ARRIVAL_POISSON,      /**< Bursts start at exponentially distributed intervals */
+    TX_ARRIVAL_ONOFF,        /**< Poisson bursts during on periods, exponential on/off times */
+};
+
+/** Length distributions of the bursts of the stochastic arrival models. */
+enum {
+    TX_BURST_FIXED = 0, /**< The paced burst size */
+    TX_BURST_UNIFORM,   /**< Uniform between burst_a and burst_b packets */
+    TX_BURST_GEOMETRIC, /**< Geometric with a mean of burst_a packets */
+    TX_BURST_PARETO,    /**< Pareto with a minimum of burst_a packets and shape burst_b */
+};
+
+#define TX_ARRIVAL_MAX_BURST 65535 /**< Longest burst drawn from a burst length distribution */
+
+/** Port TX arrival model, read by the TX lcores. */
+typedef struct tx_arrival_s {
+    uint32_t mode;         /**< TX_ARRIVAL_PERIODIC, TX_ARRIVAL_POISSON or TX_ARRIVAL_ONOFF */
+    uint32_t burst_dist;   /**< TX_BURST_* burst length distribution */
+    double burst_a;        /**< First burst length parameter */
+    double burst_b;        /**< Second burst length parameter */
+    double burst_mean;     /**< Mean burst length, unused for TX_BURST_FIXED */
+    double on_cycles;      /**< Mean on period of TX_ARRIVAL_ONOFF in timer cycles */
+    double off_cycles;     /**< Mean off period of TX_ARRIVAL_ONOFF in timer cycles */
+    volatile uint32_t gen; /**< Bumped when the model changes, resets the queue state */
+} tx_arrival_t;
+
+/** Per-TX-queue pacing state, written only by the lcore serving the TX queue. */
+typedef struct tx_pace_s {
+    uint64_t last;          /**< Time credit was last added */
+    uint64_t credit;        /**< Packet credit in TX_PACE_SHIFT fixed point */
+    uint64_t next_eval;     /**< Time the rate profile is evaluated next */
+    uint32_t seg;           /**< Rate profile segment the queue is in */
+    uint32_t gen;           /**< Rate profile run the segment belongs to */
+    tx_pace_cfg_t cfg;      /**< Pacing parameters from the rate profile */
+    uint64_t next;          /**< Time the next stochastic burst starts */
+    uint64_t state_end;     /**< Time the current on or off period of TX_ARRIVAL_ONOFF ends */
+    uint32_t pending;       /**< Packets of the current stochastic burst left to send */
+    uint32_t on;            /**< Non-zero while in an on period of TX_ARRIVAL_ONOFF */
+    uint32_t arrival_gen;   /**< Arrival model generation the state belongs to */
+    uint32_t port_gen;      /**< tx_pace_gen of the port the port_cfg copy was taken at */
+    tx_pace_cfg_t port_cfg; /**< Copy of the port pacing parameters */
+} tx_pace_t __rte_cache_aligned;
+
 /** Per-queue packet buffer arrays for RX and TX. */
 typedef struct per_queue_s {
     struct rte_mbuf **rx_pkts; /**< Array of pointers to packet buffers for RX */
     struct rte_mbuf **tx_pkts; /**< Array of pointers to packet buffers for TX */
+    pkt_seq_t range_pkt;       /**< Range cursor for rewriting TX packets in range mode */
+    range_min_t range_min;     /**< First step state of the range cursor */
+    range_info_t range;        /**< Range of the TX queue, stepping over the other queues */
+    struct imix_s *imix;       /**< IMIX the TX queue sends, NULL when IMIX is not active */
+    uint32_t imix_idx;         /**< Next IMIX schedule entry of the TX queue */
+    uint32_t cap_sample_cnt;   /**< Packets the capture sampler of the RX queue skipped in a row */
+    uint64_t sig_seq;          /**< Sequence number of the next signed packet of the TX queue */
+    uint64_t sig_base;         /**< sig_seq at the last clear of the signature counters */
+    uint64_t sig_unsigned;     /**< Packets of the TX queue too short to carry a signature */
+    uint32_t sig_gen;          /**< sig_clear_gen the signature counters of the TX queue follow */
 } per_queue_t;
 
+/** TX offload profile of a port, resolved once at port configuration time. */
+typedef struct tx_offload_s {
+    uint64_t offloads; /**< RTE_ETH_TX_OFFLOAD_* flags enabled on the TX queues */
+    bool ipv4_cksum;   /**< IPv4 header checksum is computed by the NIC */
+    bool udp_cksum;    /**< UDP checksum is computed by the NIC */
+    bool tcp_cksum;    /**< TCP checksum is computed by the NIC */
+} tx_offload_t;
+
 /** Central per-port state for Pktgen. */
 typedef struct port_info_s {
     struct rte_eth_dev_info dev_info; /**< Device information */
@@ -168,6 +331,9 @@ typedef struct port_info_s {
     rte_atomic64_t transmit_count;    /**< Packets to transmit loaded into current_tx_count */
     rte_atomic64_t current_tx_count;  /**< Current number of packets to send */
     volatile uint64_t tx_cycles;      /**< Number cycles between TX bursts */
+    tx_pace_cfg_t tx_pace_cfg;        /**< TX pacing parameters of the port */
+    volatile uint32_t tx_pace_gen;    /**< Odd while tx_pace_cfg is written, bumped twice */
+    tx_arrival_t tx_arrival;          /**< TX arrival model of the port */
     pkt_seq_t *seq_pkt;               /**< Packet sequence array */
     range_info_t range;               /**< Range Information */
     uint16_t pid;                     /**< Port ID value */
@@ -185,15 +351,36 @@ typedef struct port_info_s {
     uint32_t mpls_entry;              /**< Set the port MPLS entry */
     uint32_t gre_key;                 /**< GRE key if used */
     per_queue_t per_queue[MAX_QUEUES_PER_PORT]; /**< Per queue info */
-    FILE *pcap_file;                            /**< PCAP file handle */
+    tx_pace_t tx_pace[MAX_QUEUES_PER_PORT];     /**< Per TX queue pacing credit */
+    pcap_writer_t *pcap_file;                   /**< PCAP file handle */
+    uint8_t pcap_fmt;                           /**< pcap_fmt_t of capture and TX pcap files */
+    uint8_t capture_mode;                       /**< CAPTURE_MODE_* of the port */
+    bool capture_direct;                        /**< Disk captures are written with O_DIRECT */
+    uint32_t cap_disk_mb;                       /**< Disk capture memory per RX queue, 0 default */
+    struct cap_disk_s *cap_disk;                /**< Running disk capture, NULL otherwise */
+    struct cap_ring_s *cap_ring;                /**< Running flight recorder, NULL otherwise */
+    cap_ring_cfg_t cap_ring_cfg;                /**< Flight recorder settings */
+    cap_sample_cfg_t cap_sample;                /**< Capture sampling and snap length */
 
     /** Whether the pseudo-header is required when calculating the checksum.
      *  Depends on the original NIC driver (e.g., ixgbe NICs expect the pseudo-header)
      *  See Table 1.133: https://doc.dpdk.org/guides/nics/overview.html */
     bool cksum_requires_phdr;
+    tx_offload_t tx_ol;                   /**< TX offload profile used by the packet ctors */
     struct rnd_bits_s *rnd_bitfields;     /**< Random bitfield settings */
+    struct rate_profile_s *rate_profile;  /**< TX rate profile, NULL when none is set */
+    struct imix_s *imix;                  /**< IMIX packet sizes, NULL when none is set */
+    struct stream_table_s *streams;       /**< TX streams, NULL until a stream is set */
+    struct rx_filter_s *rx_filter;        /**< RX capture and dump filter, NULL when off */
+    struct rte_rcu_qsbr *rx_qsv;          /**< RX queues report a quiescent state per burst */
+    struct sig_rx_s *sig_rx;              /**< Signature analyzer of each RX queue, or NULL */
+    volatile uint32_t sig_clear_gen;      /**< Bumped by a clear of the signature counters */
+    uint64_t rate_start;                  /**< Time the rate profile started */
+    volatile uint32_t rate_gen;           /**< Bumped each time the rate profile restarts */
     char user_pattern[USER_PATTERN_SIZE]; /**< User set pattern values */
     fill_t fill_pattern_type;             /**< Type of pattern to fill with */
+    uint8_t *fill_buf;                    /**< Pre-built fill pattern copied into templates */
+    uint16_t fill_buf_len;                /**< Length of the fill_buf in bytes */
     union {
         uint64_t vxlan; /**< VxLAN 64 bit word */
         struct {
@@ -215,14 +402,21 @@ typedef struct port_info_s {
     uint8_t dump_count; /**< Number of packets the user requested */
 
     /* Latency sampling data */
-    /* Depending on MAX_LATENCY_ENTRIES, this could blow up static array memory usage
-     * over the limit allowed by x86_64 architecture */
     latency_t latency;                                  /**< Latency information */
+    rx_latency_t rx_latency[MAX_QUEUES_PER_PORT];       /**< Per RX queue latency accumulators */
+    tx_latency_t tx_latency[MAX_QUEUES_PER_PORT];       /**< Per TX queue latency probe state */
+    rx_probe_win_t probe_win[MAX_QUEUES_PER_PORT];      /**< Per TX queue probes with entropy */
+    volatile uint32_t lat_clear_gen;                    /**< Bumped by a clear of the latency */
+    hw_tstamp_t hw_tstamp;                              /**< RX hardware timestamp state */
     latsamp_stats_t latsamp_stats[MAX_QUEUES_PER_PORT]; /**< Per port stats */
     uint32_t latsamp_type;                              /**< Type of lat sampler  */
     uint32_t latsamp_rate;        /**< Sampling rate i.e., samples per second  */
-    uint32_t latsamp_num_samples; /**< Number of samples to collect  */
+    uint32_t latsamp_num_samples; /**< Number of samples to collect, 0 for no limit */
     char latsamp_outfile[256];    /**< Path to file for dumping latency samples */
+    FILE *latsamp_fp;             /**< Sampler output file, NULL when not sampling */
+    rte_spinlock_t latsamp_lock;  /**< Serializes latsamp_fp between writer and stop */
+    bool latsamp_binary;          /**< Write binary latsamp_rec_t records instead of CSV */
+    uint64_t latsamp_written;     /**< Number of samples written to latsamp_fp */
 } port_info_t;
 
 /** VxLAN tunnel header fields. */
@@ -240,6 +434,19 @@ struct vxlan {
  */
 void pktgen_config_ports(void);
 
+/**
+ * Wait until every RX queue of a port finished the burst it was handling.
+ *
+ * The RX lcores report a quiescent state before each burst, so state the RX
+ * path could still see before the call, e.g. a filter or a capture buffer that
+ * was unpublished, is no longer used when it returns. RX queues whose lcore is
+ * not running are not waited for.
+ *
+ * @param pinfo
+ *   Port of the RX queues.
+ */
+void pktgen_rx_quiesce(port_info_t *pinfo);
+
 /**
  * Transmit a burst of packets on a port queue.
  *
@@ -16,7 +16,8 @@
  * pktgen_range_ctor - Construct a range packet in buffer provided.
  *
  * DESCRIPTION
- * Build the special range packet in the buffer provided.
+ * Build the special range packet in the buffer provided. The fields starting
+ * at their MIN_ value skip their first step once, min records it per cursor.
  *
  * RETURNS: N/A
  *
@@ -24,7 +25,7 @@
  */
 
 void
-pktgen_range_ctor(range_info_t *range, pkt_seq_t *pkt)
+pktgen_range_ctor(range_info_t *range, pkt_seq_t *pkt, range_min_t *min)
 {
     if (pkt->ipProto == PG_IPPROTO_TCP) {
         if (unlikely(range->tcp_seq_inc != 0)) {
@@ -134,11 +135,10 @@ pktgen_range_ctor(range_info_t *range, pkt_seq_t *pkt)
                 /* Since VLAN is set to MIN_VLAN_ID, check this and skip first increment
                  * to maintain the range sequence in sync with other range fields */
                 uint32_t p;
-                static uint8_t min_vlan_set = 0;
 
-                if ((pkt->vlanid == MIN_VLAN_ID) && !min_vlan_set) {
-                    p            = 0;
-                    min_vlan_set = 1;
+                if ((pkt->vlanid == MIN_VLAN_ID) && !min->vlan) {
+                    p         = 0;
+                    min->vlan = 1;
                 } else
                     p = pkt->vlanid;
                 p += range->vlan_id_inc;
@@ -152,11 +152,10 @@ pktgen_range_ctor(range_info_t *range, pkt_seq_t *pkt)
 
             if (unlikely(range->cos_inc != 0)) {
                 uint32_t p;
-                static uint8_t min_cos_set = 0;
 
-                if ((pkt->cos == MIN_COS) && !min_cos_set) {
-                    p           = 0;
-                    min_cos_set = 1;
+                if ((pkt->cos == MIN_COS) && !min->cos) {
+                    p        = 0;
+                    min->cos = 1;
                 } else
                     p = pkt->cos;
                 p += range->cos_inc;
@@ -170,11 +169,10 @@ pktgen_range_ctor(range_info_t *range, pkt_seq_t *pkt)
 
             if (unlikely(range->tos_inc != 0)) {
                 uint32_t p;
-                static uint8_t min_tos_set = 0;
 
-                if ((pkt->tos == MIN_TOS) && !min_tos_set) {
-                    p           = 0;
-                    min_tos_set = 1;
+                if ((pkt->tos == MIN_TOS) && !min->tos) {
+                    p        = 0;
+                    min->tos = 1;
                 } else
                     p = pkt->tos;
                 p += range->tos_inc;
@@ -333,11 +331,10 @@ pktgen_range_ctor(range_info_t *range, pkt_seq_t *pkt)
                 /* Since VLAN is set to MIN_VLAN_ID, check this and skip first increment
                  * to maintain the range sequence in sync with other range fields */
                 uint32_t p;
-                static uint8_t min_vlan_set = 0;
 
-                if ((pkt->vlanid == MIN_VLAN_ID) && !min_vlan_set) {
-                    p            = 0;
-                    min_vlan_set = 1;
+                if ((pkt->vlanid == MIN_VLAN_ID) && !min->vlan) {
+                    p         = 0;
+                    min->vlan = 1;
                 } else
                     p = pkt->vlanid;
                 p += range->vlan_id_inc;
@@ -351,11 +348,10 @@ pktgen_range_ctor(range_info_t *range, pkt_seq_t *pkt)
 
             if (unlikely(range->cos_inc != 0)) {
                 uint32_t p;
-                static uint8_t min_cos_set = 0;
 
-                if ((pkt->cos == MIN_COS) && !min_cos_set) {
-                    p           = 0;
-                    min_cos_set = 1;
+                if ((pkt->cos == MIN_COS) && !min->cos) {
+                    p        = 0;
+                    min->cos = 1;
                 } else
                     p = pkt->cos;
                 p += range->cos_inc;
@@ -369,11 +365,10 @@ pktgen_range_ctor(range_info_t *range, pkt_seq_t *pkt)
 
             if (unlikely(range->traffic_class_inc != 0)) {
                 uint32_t p;
-                static uint8_t min_traffic_class_set = 0;
 
-                if ((pkt->traffic_class == MIN_TOS) && !min_traffic_class_set) {
-                    p                     = 0;
-                    min_traffic_class_set = 1;
+                if ((pkt->traffic_class == MIN_TOS) && !min->traffic_class) {
+                    p                  = 0;
+                    min->traffic_class = 1;
                 } else
                     p = pkt->traffic_class;
                 p += range->traffic_class_inc;
@@ -439,6 +434,341 @@ pktgen_range_ctor(range_info_t *range, pkt_seq_t *pkt)
     }
 }
 
+/* RFC 1624 incremental update of a one's complement checksum for one 16 bit word */
+static __rte_always_inline void
+range_cksum_adjust(uint16_t *cksum, uint16_t old, uint16_t val)
+{
+    uint32_t sum;
+
+    if (cksum == NULL)
+        return;
+
+    sum = (uint16_t)~*cksum + (uint16_t)~old + (uint32_t)val;
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+
+    *cksum = (uint16_t)~sum;
+}
+
+/* Write a 16 bit network order value and adjust up to two checksums */
+static __rte_always_inline void
+range_set16(void *field, uint16_t val, uint16_t *ck1, uint16_t *ck2)
+{
+    uint16_t old;
+
+    memcpy(&old, field, sizeof(old));
+    if (old == val)
+        return;
+    memcpy(field, &val, sizeof(val));
+
+    range_cksum_adjust(ck1, old, val);
+    range_cksum_adjust(ck2, old, val);
+}
+
+/* Write a 32 bit network order value and adjust up to two checksums */
+static __rte_always_inline void
+range_set32(void *field, uint32_t val, uint16_t *ck1, uint16_t *ck2)
+{
+    uint16_t w[2];
+
+    memcpy(w, &val, sizeof(w));
+    range_set16(field, w[0], ck1, ck2);
+    range_set16(RTE_PTR_ADD(field, sizeof(uint16_t)), w[1], ck1, ck2);
+}
+
+/* Write one byte of the 16 bit word at @word, idx 0 is the first byte in memory */
+static __rte_always_inline void
+range_set8(void *word, int idx, uint8_t val, uint16_t *cksum)
+{
+    uint8_t w[2];
+    uint16_t v;
+
+    memcpy(w, word, sizeof(w));
+    w[idx] = val;
+    memcpy(&v, w, sizeof(v));
+
+    range_set16(word, v, cksum, NULL);
+}
+
+/* Return a pointer to the UDP or TCP checksum field or NULL for other protocols */
+static __rte_always_inline uint16_t *
+range_l4_cksum(void *l4, uint16_t proto)
+{
+    if (proto == PG_IPPROTO_UDP)
+        return &((struct rte_udp_hdr *)l4)->dgram_cksum;
+    if (proto == PG_IPPROTO_TCP)
+        return &((struct rte_tcp_hdr *)l4)->cksum;
+    return NULL;
+}
+
+/**
+ *
+ * pktgen_range_rewrite - Rewrite the range fields of a template mbuf in place.
+ *
+ * DESCRIPTION
+ * Patch the MAC, VLAN, IP, TTL/ToS, L4 port, TCP seq/ack, GTP-U TEID and size
+ * fields of an already constructed packet with the values from the range
+ * cursor @pkt. Checksums are updated incrementally unless the packet size
+ * changed, in which case the L4 checksum is recomputed. Checksums handled by
+ * the NIC (from the mbuf ol_flags) are left alone or only get the pseudo-header
+ * refreshed when the driver requires it.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+static inline void
+pktgen_range_rewrite(port_info_t *pinfo, pkt_seq_t *pkt, struct rte_mbuf *m)
+{
+    struct rte_ether_hdr *eth = rte_pktmbuf_mtod(m, struct rte_ether_hdr *);
+    uint64_t l4_offload       = m->ol_flags & RTE_MBUF_F_TX_L4_MASK;
+    uint16_t ether_type       = eth->ether_type;
+    uint16_t *ip_ck = NULL, *l4_ck = NULL, *l4_field = NULL;
+    void *l3 = &eth[1], *l4 = NULL;
+    bool resized;
+
+    rte_ether_addr_copy(&pkt->eth_dst_addr, &eth->dst_addr);
+    rte_ether_addr_copy(&pkt->eth_src_addr, &eth->src_addr);
+
+    if (ether_type == htons(RTE_ETHER_TYPE_VLAN)) {
+        struct rte_vlan_hdr *vlan = l3;
+
+        vlan->vlan_tci = htons(pkt->vlanid | (pkt->cos << 13));
+        ether_type     = vlan->eth_proto;
+        l3             = &vlan[1];
+    }
+
+    resized = (m->data_len != pkt->pkt_size);
+
+    if (ether_type == htons(RTE_ETHER_TYPE_IPV4)) {
+        struct rte_ipv4_hdr *ip = l3;
+
+        if (ip->next_proto_id != pkt->ipProto)
+            return; /* Encapsulated packet, only the L2 fields are updated, the size is kept */
+
+        if (!(m->ol_flags & RTE_MBUF_F_TX_IP_CKSUM))
+            ip_ck = &ip->hdr_checksum;
+
+        l4       = &ip[1];
+        l4_field = range_l4_cksum(l4, pkt->ipProto);
+        if (!l4_offload)
+            l4_ck = l4_field;
+
+        /* Source and destination addresses are part of the L4 pseudo-header */
+        range_set32(&ip->src_addr, htonl(pkt->ip_src_addr.addr.ipv4.s_addr), ip_ck, l4_ck);
+        range_set32(&ip->dst_addr, htonl(pkt->ip_dst_addr.addr.ipv4.s_addr), ip_ck, l4_ck);
+        range_set8(&ip->time_to_live, 0, pkt->ttl, ip_ck);
+        range_set8(&ip->version_ihl, 1, pkt->tos, ip_ck);
+        if (resized)
+            range_set16(&ip->total_length, htons(pkt->pkt_size - pkt->ether_hdr_size), ip_ck,
+                        NULL);
+    } else if (ether_type == htons(RTE_ETHER_TYPE_IPV6)) {
+        struct rte_ipv6_hdr *ip = l3;
+        uint32_t vtc_flow;
+
+        if (ip->proto != pkt->ipProto)
+            return;
+
+        l4       = &ip[1];
+        l4_field = range_l4_cksum(l4, pkt->ipProto);
+        if (!l4_offload)
+            l4_ck = l4_field;
+
+        for (int i = 0; i < PG_IN6ADDRSZ; i += sizeof(uint16_t)) {
+            range_set16(RTE_PTR_ADD(&ip->src_addr, i),
+                        *(uint16_t *)RTE_PTR_ADD(&pkt->ip_src_addr.addr.ipv6, i), l4_ck, NULL);
+            range_set16(RTE_PTR_ADD(&ip->dst_addr, i),
+                        *(uint16_t *)RTE_PTR_ADD(&pkt->ip_dst_addr.addr.ipv6, i), l4_ck, NULL);
+        }
+        ip->hop_limits = pkt->hop_limits;
+
+        vtc_flow = ntohl(ip->vtc_flow) & ~RTE_IPV6_HDR_TC_MASK;
+        vtc_flow |= ((uint32_t)pkt->traffic_class << RTE_IPV6_HDR_TC_SHIFT);
+        ip->vtc_flow = htonl(vtc_flow);
+
+        if (resized)
+            ip->payload_len =
+                htons(pkt->pkt_size - (pkt->ether_hdr_size + sizeof(struct rte_ipv6_hdr)));
+    }
+
+    /* Only resize once the IP lengths above describe the new size */
+    if (resized) {
+        m->pkt_len  = pkt->pkt_size;
+        m->data_len = pkt->pkt_size;
+    }
+
+    if (ether_type != htons(RTE_ETHER_TYPE_IPV4) && ether_type != htons(RTE_ETHER_TYPE_IPV6))
+        return;
+
+    if (pkt->ipProto == PG_IPPROTO_UDP) {
+        struct rte_udp_hdr *udp = l4;
+
+        range_set16(&udp->src_port, htons(pkt->sport), l4_ck, NULL);
+        range_set16(&udp->dst_port, htons(pkt->dport), l4_ck, NULL);
+        if (resized)
+            udp->dgram_len = htons(m->data_len - ((char *)l4 - (char *)eth));
+
+        if (pkt->dport == PG_IPPROTO_L4_GTPU_PORT) {
+            gtpuHdr_t *gtpu = (gtpuHdr_t *)&udp[1];
+
+            range_set32(&gtpu->teid, htonl(pkt->gtpu_teid), l4_ck, NULL);
+            if (resized)
+                range_set16(&gtpu->tot_len,
+                            htons(pkt->pkt_size - (sizeof(struct rte_udp_hdr) +
+                                                   sizeof(gtpuHdr_t) + pkt->ether_hdr_size)),
+                            l4_ck, NULL);
+        }
+    } else if (pkt->ipProto == PG_IPPROTO_TCP) {
+        struct rte_tcp_hdr *tcp = l4;
+
+        range_set16(&tcp->src_port, htons(pkt->sport), l4_ck, NULL);
+        range_set16(&tcp->dst_port, htons(pkt->dport), l4_ck, NULL);
+        range_set32(&tcp->sent_seq, htonl(pkt->tcp_seq), l4_ck, NULL);
+        range_set32(&tcp->recv_ack, htonl(pkt->tcp_ack), l4_ck, NULL);
+
+        if (pkt->dport == PG_IPPROTO_L4_GTPU_PORT) {
+            gtpuHdr_t *gtpu = (gtpuHdr_t *)&tcp[1];
+
+            range_set32(&gtpu->teid, htonl(pkt->gtpu_teid), l4_ck, NULL);
+            if (resized)
+                range_set16(&gtpu->tot_len,
+                            htons(pkt->pkt_size - (sizeof(struct rte_tcp_hdr) +
+                                                   sizeof(gtpuHdr_t) + pkt->ether_hdr_size)),
+                            l4_ck, NULL);
+        }
+    } else
+        return;
+
+    if (l4_offload) {
+        /* The NIC computes the L4 checksum, only refresh the pseudo-header if needed */
+        if (pinfo->cksum_requires_phdr) {
+            if (ether_type == htons(RTE_ETHER_TYPE_IPV4))
+                *l4_field = rte_ipv4_phdr_cksum(l3, 0);
+            else
+                *l4_field = rte_ipv6_phdr_cksum(l3, 0);
+        }
+        return;
+    }
+
+    /* The payload covered by the L4 checksum changed size, recompute it */
+    if (resized) {
+        *l4_ck = 0;
+        if (ether_type == htons(RTE_ETHER_TYPE_IPV4))
+            *l4_ck = rte_ipv4_udptcp_cksum(l3, l4);
+        else
+            *l4_ck = rte_ipv6_udptcp_cksum(l3, l4);
+    }
+
+    /* A zero UDP checksum means no checksum, use the one's complement form */
+    if (pkt->ipProto == PG_IPPROTO_UDP && *l4_ck == 0)
+        *l4_ck = 0xFFFF;
+}
+
+/*
+ * Step a field of the range of a TX queue over the values of the other queues
+ * and wrap it to its own place in the sequence. A stride that does not fit the
+ * field keeps the single step.
+ */
+#define RANGE_QUEUE_STRIDE(qr, f, qid, nb)                                                   \
+    do {                                                                                     \
+        uint64_t _inc = (qr)->f##_inc;                                                       \
+                                                                                             \
+        if (_inc && (uint64_t)(__typeof__((qr)->f##_inc))(_inc * (nb)) == _inc * (nb)) {     \
+            (qr)->f##_inc = _inc * (nb);                                                     \
+            if ((uint64_t)(qr)->f##_min + _inc * (qid) <= (qr)->f##_max)                     \
+                (qr)->f##_min += _inc * (qid);                                               \
+        }                                                                                    \
+    } while (0)
+
+/* The same for an IPv6 address field */
+static void
+range_queue_stride_ipv6(uint8_t *inc, uint8_t *min, uint8_t *max, uint16_t qid, uint16_t nb)
+{
+    uint8_t step[PG_IN6ADDRSZ], off[PG_IN6ADDRSZ];
+
+    if (inet6AddrIsUnspecified(inc))
+        return;
+
+    memcpy(step, inc, sizeof(step));
+    memcpy(off, min, sizeof(off));
+    for (uint16_t i = 1; i < nb; i++)
+        inet6AddrAdd(step, inc, step);
+    for (uint16_t i = 0; i < qid; i++)
+        inet6AddrAdd(off, inc, off);
+
+    memcpy(inc, step, sizeof(step));
+    if (memcmp(off, max, sizeof(off)) <= 0)
+        memcpy(min, off, sizeof(off));
+}
+
+void
+pktgen_range_queue_setup(port_info_t *pinfo, uint16_t qid, const range_min_t *min)
+{
+    per_queue_t *pq  = &pinfo->per_queue[qid];
+    range_info_t *qr = &pq->range;
+    uint16_t nb      = l2p_get_txcnt(pinfo->pid);
+
+    pq->range_pkt = pinfo->seq_pkt[RANGE_PKT];
+    pq->range_min = *min;
+    for (uint16_t i = 0; i < qid; i++)
+        pktgen_range_ctor(&pinfo->range, &pq->range_pkt, &pq->range_min);
+
+    *qr = pinfo->range;
+    if (nb < 2)
+        return;
+
+    if (pq->range_pkt.ethType == RTE_ETHER_TYPE_IPV6) {
+        range_queue_stride_ipv6(qr->src_ipv6_inc, qr->src_ipv6_min, qr->src_ipv6_max, qid, nb);
+        range_queue_stride_ipv6(qr->dst_ipv6_inc, qr->dst_ipv6_min, qr->dst_ipv6_max, qid, nb);
+    } else {
+        RANGE_QUEUE_STRIDE(qr, src_ip, qid, nb);
+        RANGE_QUEUE_STRIDE(qr, dst_ip, qid, nb);
+    }
+    RANGE_QUEUE_STRIDE(qr, src_port, qid, nb);
+    RANGE_QUEUE_STRIDE(qr, dst_port, qid, nb);
+    RANGE_QUEUE_STRIDE(qr, vlan_id, qid, nb);
+    RANGE_QUEUE_STRIDE(qr, tcp_seq, qid, nb);
+    RANGE_QUEUE_STRIDE(qr, tcp_ack, qid, nb);
+    RANGE_QUEUE_STRIDE(qr, tos, qid, nb);
+    RANGE_QUEUE_STRIDE(qr, cos, qid, nb);
+    RANGE_QUEUE_STRIDE(qr, pkt_size, qid, nb);
+    RANGE_QUEUE_STRIDE(qr, src_mac, qid, nb);
+    RANGE_QUEUE_STRIDE(qr, dst_mac, qid, nb);
+    RANGE_QUEUE_STRIDE(qr, ttl, qid, nb);
+    RANGE_QUEUE_STRIDE(qr, gtpu_teid, qid, nb);
+    RANGE_QUEUE_STRIDE(qr, vxlan_gid, qid, nb);
+    RANGE_QUEUE_STRIDE(qr, vxlan_vid, qid, nb);
+}
+
+/**
+ *
+ * pktgen_range_rewrite_bulk - Apply the next range values to a burst of packets.
+ *
+ * DESCRIPTION
+ * Each TX queue keeps its own range cursor, every packet in the burst gets the
+ * current cursor values patched in and the cursor is then stepped with
+ * pktgen_range_ctor() and the range of the queue. The number of unique flows is
+ * no longer bound by the size of the TX mempool. Queue q starts q steps into the
+ * sequence and steps over the other queues, so N queues send N different flows
+ * at a time for one step per packet.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+void
+pktgen_range_rewrite_bulk(port_info_t *pinfo, uint16_t qid, struct rte_mbuf **pkts,
+                          uint16_t nb_pkts)
+{
+    per_queue_t *pq = &pinfo->per_queue[qid];
+    pkt_seq_t *pkt  = &pq->range_pkt;
+
+    for (uint16_t i = 0; i < nb_pkts; i++) {
+        pktgen_range_rewrite(pinfo, pkt, pkts[i]);
+        pktgen_range_ctor(&pq->range, pkt, &pq->range_min);
+    }
+}
+
 /**
  *
  * pktgen_print_range - Display the range data page.
@@ -180,7 +180,16 @@ typedef struct range_info_s {
     uint32_t vni_flags; /**< VxLAN VNI flags */
 } range_info_t;
 
+/** Fields of a range cursor that already skipped the first step from their MIN_ value. */
+typedef struct range_min_s {
+    uint8_t vlan;          /**< VLAN ID */
+    uint8_t cos;           /**< Class of service */
+    uint8_t tos;           /**< IPv4 type of service */
+    uint8_t traffic_class; /**< IPv6 traffic class */
+} range_min_t;
+
 struct port_info_s;
+struct rte_mbuf;
 
 /**
  * Populate a packet sequence template from a range_info_t configuration.
@@ -189,8 +198,46 @@ struct port_info_s;
  *   Pointer to the range configuration to apply.
  * @param pkt
  *   Packet sequence entry to update with current range field values.
+ * @param min
+ *   First step state of the cursor @p pkt belongs to.
+ */
+void pktgen_range_ctor(range_info_t *range, pkt_seq_t *pkt, range_min_t *min);
+
+/**
+ * Set up the range cursor and the range of a TX queue.
+ *
+ * The cursor of queue @p qid starts @p qid values into the range sequence. The
+ * range of the queue steps each field by its increment times the number of TX
+ * queues, and a field wraps to its minimum plus @p qid increments, so the
+ * queues send interleaved parts of one range sequence for one step per packet.
+ *
+ * @param info
+ *   Per-port state holding the range configuration and per-queue cursors.
+ * @param qid
+ *   TX queue ID to set up.
+ * @param min
+ *   First step state of the cursor after the first range values were loaded.
+ */
+void pktgen_range_queue_setup(struct port_info_s *info, uint16_t qid, const range_min_t *min);
+
+/**
+ * Patch the range fields of a burst of template packets in place.
+ *
+ * Writes the current values of the per-queue range cursor into each mbuf,
+ * updates the checksums incrementally and steps the cursor once per packet with
+ * the range of the TX queue, see pktgen_range_queue_setup().
+ *
+ * @param info
+ *   Per-port state holding the range configuration and per-queue cursors.
+ * @param qid
+ *   TX queue ID whose range cursor is used.
+ * @param pkts
+ *   Array of template mbufs to rewrite.
+ * @param nb_pkts
+ *   Number of mbufs in @p pkts.
  */
-void pktgen_range_ctor(range_info_t *range, pkt_seq_t *pkt);
+void pktgen_range_rewrite_bulk(struct port_info_s *info, uint16_t qid, struct rte_mbuf **pkts,
+                               uint16_t nb_pkts);
 
 /**
  * Initialise range-mode state for a port.
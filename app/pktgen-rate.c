@@ -0,0 +1,686 @@
+/*-
+ * Copyright(c) <2010-2026>, Intel Corporation. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <rte_malloc.h>
+#include <rte_cycles.h>
+#include <rte_per_lcore.h>
+#include <rte_random.h>
+
+#include "pktgen.h"
+#include "pktgen-log.h"
+#include "pktgen-rate.h"
+
+#define RATE_PROFILE_MIN_SEGS 16 /**< Segments allocated for a new profile */
+
+static const char *rate_seg_names[] = {"step", "ramp", "sine"};
+static const char *arrival_names[]  = {"periodic", "poisson", "onoff"};
+static const char *burst_names[]    = {"fixed", "uniform", "geometric", "pareto"};
+
+/* Arrival model generator of each lcore, seeded on first use */
+static RTE_DEFINE_PER_LCORE(uint64_t, arrival_rng);
+
+/**
+ *
+ * rate_profile_busy - Test if the rate profile of a port can not be edited.
+ *
+ * DESCRIPTION
+ * The TX lcores read the profile without a lock, so it is only changed while the
+ * port does not follow it.
+ *
+ * RETURNS: true if the profile is in use.
+ *
+ * SEE ALSO:
+ */
+static bool
+rate_profile_busy(port_info_t *pinfo)
+{
+    if (!pktgen_tst_port_flags(pinfo, TX_RATE_PROFILE))
+        return false;
+
+    pktgen_log_error("Port %d rate profile is on, turn it off before changing it", pinfo->pid);
+    return true;
+}
+
+/**
+ *
+ * rate_profile_grow - Make room for one more segment in a rate profile.
+ *
+ * DESCRIPTION
+ * Allocate the profile of the port or double its number of segments when it is
+ * full.
+ *
+ * RETURNS: 0 on success or -1 on error.
+ *
+ * SEE ALSO:
+ */
+static int
+rate_profile_grow(port_info_t *pinfo)
+{
+    rate_profile_t *prof = pinfo->rate_profile;
+    uint32_t max;
+
+    if (prof && prof->nb_segs < prof->max_segs)
+        return 0;
+
+    if (prof && prof->nb_segs >= RATE_PROFILE_MAX_SEGS) {
+        pktgen_log_error("Port %d rate profile is limited to %d segments", pinfo->pid,
+                         RATE_PROFILE_MAX_SEGS);
+        return -1;
+    }
+
+    max  = (prof == NULL) ? RATE_PROFILE_MIN_SEGS : prof->max_segs * 2;
+    prof = rte_realloc_socket(prof, sizeof(rate_profile_t) + (max * sizeof(rate_seg_t)),
+                              RTE_CACHE_LINE_SIZE, pg_eth_dev_socket_id(pinfo->pid));
+    if (prof == NULL) {
+        pktgen_log_error("Unable to allocate port %d rate profile", pinfo->pid);
+        return -1;
+    }
+    if (pinfo->rate_profile == NULL) {
+        prof->nb_segs = 0;
+        prof->total   = 0;
+        prof->loop    = false;
+    }
+    prof->max_segs      = max;
+    pinfo->rate_profile = prof;
+
+    return 0;
+}
+
+/**
+ *
+ * rate_profile_append - Append a segment to a rate profile.
+ *
+ * DESCRIPTION
+ * Add a segment after the last one of the port profile. Times are in timer cycles.
+ *
+ * RETURNS: 0 on success or -1 on error.
+ *
+ * SEE ALSO:
+ */
+static int
+rate_profile_append(port_info_t *pinfo, uint32_t type, uint64_t duration, double rate,
+                    double rate2, uint64_t period)
+{
+    rate_profile_t *prof;
+    rate_seg_t *seg;
+
+    if (rate_profile_grow(pinfo) < 0)
+        return -1;
+
+    prof          = pinfo->rate_profile;
+    seg           = &prof->segs[prof->nb_segs++];
+    seg->type     = type;
+    seg->start    = prof->total;
+    seg->duration = duration;
+    seg->rate     = rate;
+    seg->rate2    = rate2;
+    seg->period   = period;
+
+    prof->total += duration;
+
+    return 0;
+}
+
+static inline uint64_t
+usec_to_cycles(double usec)
+{
+    return (uint64_t)(((usec * (double)pktgen_get_timer_hz()) / 1e6) + 0.5);
+}
+
+static inline double
+cycles_to_usec(uint64_t cycles)
+{
+    return ((double)cycles * 1e6) / (double)pktgen_get_timer_hz();
+}
+
+int
+rate_profile_clear(port_info_t *pinfo)
+{
+    if (rate_profile_busy(pinfo))
+        return -1;
+
+    if (pinfo->rate_profile) {
+        pinfo->rate_profile->nb_segs = 0;
+        pinfo->rate_profile->total   = 0;
+    }
+
+    return 0;
+}
+
+int
+rate_profile_add(port_info_t *pinfo, uint32_t type, double usec, double rate, double rate2,
+                 double period_usec)
+{
+    if (rate_profile_busy(pinfo))
+        return -1;
+
+    if (usec < 1.0) {
+        pktgen_log_error("Rate profile segment must be at least 1 usec long");
+        return -1;
+    }
+    if (rate < 0.0 || rate > 100.0) {
+        pktgen_log_error("Rate profile rate %.3f must be between 0 and 100 percent", rate);
+        return -1;
+    }
+
+    switch (type) {
+    case RATE_SEG_STEP:
+        rate2       = rate;
+        period_usec = 0.0;
+        break;
+    case RATE_SEG_RAMP:
+        if (rate2 < 0.0 || rate2 > 100.0) {
+            pktgen_log_error("Rate profile rate %.3f must be between 0 and 100 percent", rate2);
+            return -1;
+        }
+        period_usec = 0.0;
+        break;
+    case RATE_SEG_SINE:
+        if (rate2 < 0.0) {
+            pktgen_log_error("Rate profile sine amplitude %.3f must not be negative", rate2);
+            return -1;
+        }
+        if (period_usec < 1.0) {
+            pktgen_log_error("Rate profile sine period must be at least 1 usec");
+            return -1;
+        }
+        break;
+    default:
+        pktgen_log_error("Unknown rate profile segment type %u", type);
+        return -1;
+    }
+
+    return rate_profile_append(pinfo, type, usec_to_cycles(usec), rate, rate2,
+                               usec_to_cycles(period_usec));
+}
+
+int
+rate_profile_load(port_info_t *pinfo, const char *filename)
+{
+    char line[256];
+    double t, r, prev_t = 0.0, prev_r = 0.0;
+    uint32_t lineno = 0, points = 0;
+    FILE *fp;
+    int ret = 0;
+
+    if (rate_profile_busy(pinfo))
+        return -1;
+
+    fp = fopen(filename, "r");
+    if (fp == NULL) {
+        pktgen_log_error("Unable to open rate profile file %s", filename);
+        return -1;
+    }
+
+    rate_profile_clear(pinfo);
+
+    while (fgets(line, sizeof(line), fp)) {
+        char *p = line;
+
+        lineno++;
+        while (*p == ' ' || *p == '\t')
+            p++;
+        if (*p == '#' || *p == '\n' || *p == '\r' || *p == '\0')
+            continue;
+
+        if (sscanf(p, "%lf , %lf", &t, &r) != 2) {
+            pktgen_log_error("%s:%u: expected time_us,rate", filename, lineno);
+            ret = -1;
+            break;
+        }
+        if (r < 0.0 || r > 100.0 || t < 0.0 || (points && t < prev_t)) {
+            pktgen_log_error("%s:%u: time must not go backwards and rate must be 0-100",
+                             filename, lineno);
+            ret = -1;
+            break;
+        }
+
+        /* Hold the first rate until the first point, then ramp between points */
+        if (points == 0 && t > 0.0)
+            ret = rate_profile_append(pinfo, RATE_SEG_STEP, usec_to_cycles(t), r, r, 0);
+        else if (points)
+            ret = rate_profile_append(pinfo, RATE_SEG_RAMP, usec_to_cycles(t) -
+                                      usec_to_cycles(prev_t), prev_r, r, 0);
+        if (ret < 0)
+            break;
+
+        prev_t = t;
+        prev_r = r;
+        points++;
+    }
+    fclose(fp);
+
+    if (ret == 0 && (pinfo->rate_profile == NULL || pinfo->rate_profile->total == 0)) {
+        pktgen_log_error("%s: rate profile needs at least two points in time", filename);
+        ret = -1;
+    }
+    if (ret < 0) {
+        rate_profile_clear(pinfo);
+        return -1;
+    }
+
+    pktgen_log_info("Port %d loaded %u rate points from %s", pinfo->pid, points, filename);
+
+    return 0;
+}
+
+void
+rate_profile_loop(port_info_t *pinfo, bool loop)
+{
+    if (rate_profile_busy(pinfo))
+        return;
+
+    if (rate_profile_grow(pinfo) == 0)
+        pinfo->rate_profile->loop = loop;
+}
+
+void
+rate_profile_restart(port_info_t *pinfo)
+{
+    pinfo->rate_start = pktgen_get_time();
+
+    /* The TX lcores reset their position when they see the new generation */
+    rte_smp_wmb();
+    pinfo->rate_gen++;
+}
+
+int
+rate_profile_enable(port_info_t *pinfo, bool on)
+{
+    if (!on) {
+        if (!pktgen_tst_port_flags(pinfo, TX_RATE_PROFILE))
+            return 0;
+
+        pktgen_clr_port_flags(pinfo, TX_RATE_PROFILE);
+
+        /* Let the TX lcores finish an evaluation they may have started */
+        rte_delay_us_sleep(100);
+        return 0;
+    }
+
+    if (pinfo->rate_profile == NULL || pinfo->rate_profile->total == 0) {
+        pktgen_log_error("Port %d has no rate profile", pinfo->pid);
+        return -1;
+    }
+
+    /* Start the profile now when the port is already sending */
+    rate_profile_restart(pinfo);
+    rte_smp_wmb();
+    pktgen_set_port_flags(pinfo, TX_RATE_PROFILE);
+
+    return 0;
+}
+
+void
+rate_profile_show(port_info_t *pinfo)
+{
+    rate_profile_t *prof = pinfo->rate_profile;
+
+    printf("Port %d rate profile %s, %s, ", pinfo->pid,
+           pktgen_tst_port_flags(pinfo, TX_RATE_PROFILE) ? "on" : "off",
+           (prof && prof->loop) ? "loop" : "hold last rate");
+    if (prof == NULL || prof->nb_segs == 0) {
+        printf("no segments\n");
+        return;
+    }
+    printf("%u segments, %.3f usec\n", prof->nb_segs, cycles_to_usec(prof->total));
+
+    for (uint32_t i = 0; i < prof->nb_segs; i++) {
+        rate_seg_t *seg = &prof->segs[i];
+
+        printf("  %6u: %-4s at %14.3f for %14.3f usec, ", i, rate_seg_names[seg->type],
+               cycles_to_usec(seg->start), cycles_to_usec(seg->duration));
+        switch (seg->type) {
+        case RATE_SEG_STEP:
+            printf("rate %.3f%%\n", seg->rate);
+            break;
+        case RATE_SEG_RAMP:
+            printf("rate %.3f%% to %.3f%%\n", seg->rate, seg->rate2);
+            break;
+        case RATE_SEG_SINE:
+            printf("mean %.3f%%, amplitude %.3f%%, period %.3f usec\n", seg->rate, seg->rate2,
+                   cycles_to_usec(seg->period));
+            break;
+        }
+    }
+}
+
+double
+rate_profile_rate(const rate_profile_t *prof, uint32_t *seg_idx, uint64_t t)
+{
+    const rate_seg_t *seg;
+    uint32_t i = *seg_idx;
+    uint64_t dt;
+    double rate;
+
+    /* Segments are searched forward from the last one, restart after a wrap */
+    if (i >= prof->nb_segs || prof->segs[i].start > t)
+        i = 0;
+    while ((i + 1) < prof->nb_segs && t >= (prof->segs[i].start + prof->segs[i].duration))
+        i++;
+    *seg_idx = i;
+
+    seg = &prof->segs[i];
+    dt  = t - seg->start;
+    if (dt > seg->duration)
+        dt = seg->duration;
+
+    switch (seg->type) {
+    case RATE_SEG_RAMP:
+        rate = seg->rate;
+        if (seg->duration)
+            rate += ((seg->rate2 - seg->rate) * (double)dt) / (double)seg->duration;
+        break;
+    case RATE_SEG_SINE:
+        rate = seg->rate;
+        if (seg->period)
+            rate += seg->rate2 * sin((2.0 * M_PI * (double)(dt % seg->period)) /
+                                     (double)seg->period);
+        break;
+    default:
+        rate = seg->rate;
+        break;
+    }
+
+    if (rate < 0.0)
+        rate = 0.0;
+    else if (rate > 100.0)
+        rate = 100.0;
+
+    return rate;
+}
+
+void
+rate_profile_eval(port_info_t *pinfo, uint16_t qid, uint64_t now)
+{
+    const rate_profile_t *prof = pinfo->rate_profile;
+    tx_pace_t *pace            = &pinfo->tx_pace[qid];
+    uint32_t gen               = pinfo->rate_gen;
+    uint64_t t;
+    double pps;
+
+    if (pace->gen != gen) {
+        /* New run of the profile, start from the first segment with no credit */
+        pace->gen    = gen;
+        pace->seg    = 0;
+        pace->credit = 0;
+        pace->last   = now;
+        memset(&pace->cfg, 0, sizeof(pace->cfg));
+    }
+    rte_smp_rmb();
+
+    pace->next_eval = now + (pktgen_get_timer_hz() * RATE_PROFILE_EVAL_NS) / Billion;
+
+    if (unlikely(prof == NULL || prof->total == 0))
+        return;
+
+    t = (now > pinfo->rate_start) ? now - pinfo->rate_start : 0;
+    if (t >= prof->total)
+        t = prof->loop ? t % prof->total : prof->total;
+
+    /* The scale is taken from the copy loaded under tx_pace_gen */
+    pps = rate_profile_rate(prof, &pace->seg, t) * pace->port_cfg.pps_per_pcnt;
+
+    /* The pacing math is only redone when the rate changes */
+    if (pps != pace->cfg.pps)
+        pktgen_tx_pace_cfg(&pace->cfg, pps, (pps > 0.0) ? pktgen_tx_pace_burst(pinfo, pps) : 0);
+}
+
+/**
+ *
+ * arrival_u01 - Return a uniform random number in [0, 1).
+ *
+ * DESCRIPTION
+ * Use the xorshift64* generator of the calling lcore, so TX lcores do not share
+ * state.
+ *
+ * RETURNS: Random number in [0, 1).
+ *
+ * SEE ALSO:
+ */
+static inline double
+arrival_u01(void)
+{
+    uint64_t *state = &RTE_PER_LCORE(arrival_rng);
+
+    if (unlikely(*state == 0))
+        *state = rte_rand() | 1;
+
+    /* Top 53 bits give every double in [0, 1) with an equal spacing */
+    return (double)(xorshift64star_r(state) >> 11) * 0x1.0p-53;
+}
+
+/* Exponentially distributed value with a mean of one */
+static inline double
+arrival_exp(void)
+{
+    return -log(1.0 - arrival_u01());
+}
+
+/**
+ *
+ * arrival_burst_len - Draw the length of a stochastic burst.
+ *
+ * DESCRIPTION
+ * Draw from the burst length distribution of the port, the fixed length is the
+ * paced burst size.
+ *
+ * RETURNS: Burst length between 1 and TX_ARRIVAL_MAX_BURST packets.
+ *
+ * SEE ALSO:
+ */
+static uint32_t
+arrival_burst_len(const tx_arrival_t *arr, const tx_pace_cfg_t *cfg)
+{
+    double len;
+
+    switch (arr->burst_dist) {
+    case TX_BURST_UNIFORM:
+        len = arr->burst_a + floor(arrival_u01() * (arr->burst_b - arr->burst_a + 1.0));
+        break;
+    case TX_BURST_GEOMETRIC:
+        /* Number of trials to the first success with p = 1 / mean */
+        len = 1.0;
+        if (arr->burst_a > 1.0)
+            len += floor(log(1.0 - arrival_u01()) / log(1.0 - (1.0 / arr->burst_a)));
+        break;
+    case TX_BURST_PARETO:
+        len = floor(arr->burst_a / pow(1.0 - arrival_u01(), 1.0 / arr->burst_b));
+        break;
+    default:
+        len = cfg->burst;
+        break;
+    }
+
+    if (len < 1.0)
+        len = 1.0;
+    else if (len > TX_ARRIVAL_MAX_BURST)
+        len = TX_ARRIVAL_MAX_BURST;
+
+    return (uint32_t)len;
+}
+
+void
+tx_arrival_next(port_info_t *pinfo, const tx_pace_cfg_t *cfg, tx_pace_t *pace, uint64_t now)
+{
+    const tx_arrival_t *arr = &pinfo->tx_arrival;
+    uint32_t gen            = arr->gen;
+    double mean, pps, hz = (double)pktgen_get_timer_hz();
+    uint64_t base;
+
+    if (pace->arrival_gen != gen) {
+        /* Model changed, start with an on period and a burst right away */
+        pace->arrival_gen = gen;
+        pace->pending     = 0;
+        pace->next        = now;
+        pace->on          = 1;
+        pace->state_end   = now + (uint64_t)(arrival_exp() * arr->on_cycles);
+    }
+    rte_smp_rmb();
+
+    pps = cfg->pps;
+    if (arr->mode == TX_ARRIVAL_ONOFF) {
+        double line_pps = pace->port_cfg.pps_per_pcnt * 100.0;
+        int64_t stall   = (int64_t)(16.0 * (arr->on_cycles + arr->off_cycles));
+
+        /* After a long stall restart the on/off process instead of replaying it */
+        if ((int64_t)(now - pace->state_end) > stall) {
+            pace->on        = 0;
+            pace->state_end = now;
+        }
+        while ((int64_t)(now - pace->state_end) >= 0) {
+            pace->on = !pace->on;
+            if (pace->on)
+                pace->next = pace->state_end; /* Bursts start with the on period */
+            pace->state_end +=
+                1 + (uint64_t)(arrival_exp() * (pace->on ? arr->on_cycles : arr->off_cycles));
+        }
+        if (!pace->on) {
+            pace->next = pace->state_end;
+            return;
+        }
+
+        /* Send at the peak rate while on, so the mean over on and off is the set rate */
+        pps *= (arr->on_cycles + arr->off_cycles) / arr->on_cycles;
+        if (line_pps > 0.0 && pps > line_pps)
+            pps = line_pps;
+    }
+
+    mean = (arr->burst_dist == TX_BURST_FIXED) ? (double)cfg->burst : arr->burst_mean;
+
+    pace->pending = arrival_burst_len(arr, cfg);
+
+    /* Bursts start at a rate of pps / mean, keep the schedule unless far behind */
+    base = pace->next;
+    if ((int64_t)(now - base) > (int64_t)cfg->max_cycles)
+        base = now;
+    pace->next = base + (uint64_t)((arrival_exp() * mean * hz) / pps);
+}
+
+double
+tx_arrival_exp(void)
+{
+    return arrival_exp();
+}
+
+int
+tx_arrival_set(port_info_t *pinfo, uint32_t mode, double on_usec, double off_usec)
+{
+    tx_arrival_t *arr = &pinfo->tx_arrival;
+
+    if (mode > TX_ARRIVAL_ONOFF) {
+        pktgen_log_error("Unknown TX arrival model %u", mode);
+        return -1;
+    }
+    if (mode == TX_ARRIVAL_ONOFF) {
+        if (on_usec < 1.0 || off_usec < 0.0) {
+            pktgen_log_error("TX arrival on time must be at least 1 usec, off time not negative");
+            return -1;
+        }
+        arr->on_cycles  = ((on_usec * (double)pktgen_get_timer_hz()) / 1e6);
+        arr->off_cycles = ((off_usec * (double)pktgen_get_timer_hz()) / 1e6);
+    }
+
+    /* The TX lcores reset their arrival state when they see the new generation */
+    arr->mode = TX_ARRIVAL_PERIODIC;
+    rte_smp_wmb();
+    arr->gen++;
+    rte_smp_wmb();
+    arr->mode = mode;
+
+    return 0;
+}
+
+int
+tx_burst_dist_set(port_info_t *pinfo, uint32_t dist, double a, double b)
+{
+    tx_arrival_t *arr = &pinfo->tx_arrival;
+    double mean;
+
+    switch (dist) {
+    case TX_BURST_FIXED:
+        mean = 0.0;
+        break;
+    case TX_BURST_UNIFORM:
+        if (a < 1.0 || b < a || b > TX_ARRIVAL_MAX_BURST) {
+            pktgen_log_error("Uniform burst length needs 1 <= min <= max <= %d",
+                             TX_ARRIVAL_MAX_BURST);
+            return -1;
+        }
+        a    = floor(a);
+        b    = floor(b);
+        mean = (a + b) / 2.0;
+        break;
+    case TX_BURST_GEOMETRIC:
+        if (a < 1.0 || a > TX_ARRIVAL_MAX_BURST) {
+            pktgen_log_error("Geometric burst length mean must be 1 to %d", TX_ARRIVAL_MAX_BURST);
+            return -1;
+        }
+        mean = a;
+        break;
+    case TX_BURST_PARETO:
+        if (a < 1.0 || a > TX_ARRIVAL_MAX_BURST || b <= 1.0) {
+            pktgen_log_error("Pareto burst length needs a minimum of 1 to %d and a shape above 1",
+                             TX_ARRIVAL_MAX_BURST);
+            return -1;
+        }
+        /*
+         * Mean of the floored and capped distribution, the mean rate depends on it.
+         * The mean is the sum of P(len >= k) for k = 1..max, which is 1 up to the
+         * floor of the minimum and (min / k)^shape above it.
+         */
+        mean = floor(a);
+        for (uint32_t k = (uint32_t)a + 1; k <= TX_ARRIVAL_MAX_BURST; k++)
+            mean += pow(a / (double)k, b);
+        break;
+    default:
+        pktgen_log_error("Unknown TX burst length distribution %u", dist);
+        return -1;
+    }
+
+    arr->burst_dist = TX_BURST_FIXED;
+    rte_smp_wmb();
+    arr->burst_a    = a;
+    arr->burst_b    = b;
+    arr->burst_mean = mean;
+    rte_smp_wmb();
+    arr->burst_dist = dist;
+
+    return 0;
+}
+
+void
+tx_arrival_show(port_info_t *pinfo)
+{
+    tx_arrival_t *arr = &pinfo->tx_arrival;
+
+    printf("Port %d TX arrival %s", pinfo->pid, arrival_names[arr->mode]);
+    if (arr->mode == TX_ARRIVAL_ONOFF)
+        printf(" on %.3f usec off %.3f usec", cycles_to_usec((uint64_t)arr->on_cycles),
+               cycles_to_usec((uint64_t)arr->off_cycles));
+
+    printf(", burst %s", burst_names[arr->burst_dist]);
+    switch (arr->burst_dist) {
+    case TX_BURST_UNIFORM:
+        printf(" %.0f to %.0f packets", arr->burst_a, arr->burst_b);
+        break;
+    case TX_BURST_GEOMETRIC:
+        printf(" mean %.3f packets", arr->burst_a);
+        break;
+    case TX_BURST_PARETO:
+        printf(" min %.0f shape %.3f, mean %.3f packets", arr->burst_a, arr->burst_b,
+               arr->burst_mean);
+        break;
+    default:
+        break;
+    }
+    printf("\n");
+}
@@ -0,0 +1,254 @@
+/*-
+ * Copyright(c) <2010-2026>, Intel Corporation. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PKTGEN_RATE_H_
+#define _PKTGEN_RATE_H_
+
+/**
+ * @file
+ *
+ * Time-varying TX rate profiles.
+ *
+ * A profile is a list of segments, each giving the TX rate in percent of the
+ * link over a period of time: a constant step, a linear ramp or a sine wave.
+ * Profiles can also be loaded from a CSV trace of "time_us,rate" points, which
+ * are joined with ramps. The profile starts when the port starts transmitting
+ * and every TX queue evaluates it in its pacing check once per microsecond.
+ * When the profile ends the port either loops back to the start or keeps the
+ * last rate.
+ *
+ * The arrival model decides how the packets of that rate are spread in time.
+ * The default sends evenly spaced bursts. The Poisson model starts bursts at
+ * exponentially distributed intervals and the on/off model does the same only
+ * during on periods, with exponentially distributed on and off times. Burst
+ * lengths of both models are drawn from a configurable distribution using a
+ * per-lcore generator, and the gaps are scaled so the mean rate is kept.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RATE_PROFILE_EVAL_NS  1000    /**< Time between two evaluations of the profile */
+#define RATE_PROFILE_MAX_SEGS 1000000 /**< Maximum number of segments in a profile */
+
+/** Rate profile segment types. */
+enum { RATE_SEG_STEP = 0, RATE_SEG_RAMP, RATE_SEG_SINE };
+
+/** One segment of a rate profile, times are in timer cycles. */
+typedef struct rate_seg_s {
+    uint64_t start;    /**< Time from the start of the profile the segment starts */
+    uint64_t duration; /**< Length of the segment */
+    uint64_t period;   /**< Period of a sine segment */
+    double rate;       /**< Rate in percent of a step, start of a ramp or mean of a sine */
+    double rate2;      /**< End rate of a ramp or amplitude of a sine, in percent */
+    uint32_t type;     /**< RATE_SEG_STEP, RATE_SEG_RAMP or RATE_SEG_SINE */
+} rate_seg_t;
+
+/** TX rate profile of a port. */
+typedef struct rate_profile_s {
+    uint64_t total;     /**< Length of all segments in timer cycles */
+    uint32_t nb_segs;   /**< Number of segments in use */
+    uint32_t max_segs;  /**< Number of segments allocated */
+    bool loop;          /**< Restart the profile at the end instead of keeping the last rate */
+    rate_seg_t segs[];  /**< Segments in time order */
+} rate_profile_t;
+
+struct port_info_s;
+
+/**
+ * Remove all segments from the rate profile of a port.
+ *
+ * @param pinfo
+ *   Port to update, the profile must not be running.
+ * @return
+ *   0 on success or -1 on error.
+ */
+int rate_profile_clear(struct port_info_s *pinfo);
+
+/**
+ * Append a segment to the rate profile of a port.
+ *
+ * @param pinfo
+ *   Port to update, the profile must not be running.
+ * @param type
+ *   RATE_SEG_STEP, RATE_SEG_RAMP or RATE_SEG_SINE.
+ * @param usec
+ *   Length of the segment in micro-seconds.
+ * @param rate
+ *   Rate of a step, start rate of a ramp or mean rate of a sine, in percent.
+ * @param rate2
+ *   End rate of a ramp or amplitude of a sine in percent, unused for a step.
+ * @param period_usec
+ *   Period of a sine in micro-seconds, unused otherwise.
+ * @return
+ *   0 on success or -1 on error.
+ */
+int rate_profile_add(struct port_info_s *pinfo, uint32_t type, double usec, double rate,
+                     double rate2, double period_usec);
+
+/**
+ * Replace the rate profile of a port with a CSV trace.
+ *
+ * Each line holds a "time_us,rate" point with the time from the start of the
+ * trace in micro-seconds and the rate in percent, in increasing time order.
+ * Blank lines and lines starting with '#' are skipped. Consecutive points are
+ * joined by ramps, two points with the same time give a step.
+ *
+ * @param pinfo
+ *   Port to update, the profile must not be running.
+ * @param filename
+ *   Path of the CSV file.
+ * @return
+ *   0 on success or -1 on error.
+ */
+int rate_profile_load(struct port_info_s *pinfo, const char *filename);
+
+/**
+ * Loop the rate profile of a port or keep the last rate when it ends.
+ *
+ * @param pinfo
+ *   Port to update.
+ * @param loop
+ *   True to restart the profile when it ends.
+ */
+void rate_profile_loop(struct port_info_s *pinfo, bool loop);
+
+/**
+ * Make the TX rate of a port follow its rate profile or the fixed tx_rate.
+ *
+ * @param pinfo
+ *   Port to update.
+ * @param on
+ *   True to follow the rate profile.
+ * @return
+ *   0 on success or -1 if the port has no profile.
+ */
+int rate_profile_enable(struct port_info_s *pinfo, bool on);
+
+/**
+ * Restart the rate profile of a port from its first segment.
+ *
+ * Called when the port starts transmitting.
+ *
+ * @param pinfo
+ *   Port to update.
+ */
+void rate_profile_restart(struct port_info_s *pinfo);
+
+/**
+ * Print the rate profile of a port.
+ *
+ * @param pinfo
+ *   Port to show.
+ */
+void rate_profile_show(struct port_info_s *pinfo);
+
+/**
+ * Return the rate of a port's profile at a time from its start.
+ *
+ * @param prof
+ *   Profile to evaluate.
+ * @param seg
+ *   Segment to start the search from, updated to the segment holding @p t.
+ * @param t
+ *   Time from the start of the profile in timer cycles.
+ * @return
+ *   Rate in percent of the link.
+ */
+double rate_profile_rate(const rate_profile_t *prof, uint32_t *seg, uint64_t t);
+
+/**
+ * Update the pacing parameters of a TX queue from the port rate profile.
+ *
+ * Only called by the lcore serving the TX queue.
+ *
+ * @param pinfo
+ *   Port of the TX queue.
+ * @param qid
+ *   TX queue ID.
+ * @param now
+ *   Current time from pktgen_get_time().
+ */
+void rate_profile_eval(struct port_info_s *pinfo, uint16_t qid, uint64_t now);
+
+/**
+ * Set the TX arrival model of a port.
+ *
+ * @param pinfo
+ *   Port to update.
+ * @param mode
+ *   TX_ARRIVAL_PERIODIC, TX_ARRIVAL_POISSON or TX_ARRIVAL_ONOFF.
+ * @param on_usec
+ *   Mean on period of TX_ARRIVAL_ONOFF in micro-seconds, unused otherwise.
+ * @param off_usec
+ *   Mean off period of TX_ARRIVAL_ONOFF in micro-seconds, unused otherwise.
+ * @return
+ *   0 on success or -1 on error.
+ */
+int tx_arrival_set(struct port_info_s *pinfo, uint32_t mode, double on_usec, double off_usec);
+
+/**
+ * Set the burst length distribution of the stochastic arrival models of a port.
+ *
+ * @param pinfo
+ *   Port to update.
+ * @param dist
+ *   TX_BURST_FIXED, TX_BURST_UNIFORM, TX_BURST_GEOMETRIC or TX_BURST_PARETO.
+ * @param a
+ *   Minimum of a uniform, mean of a geometric or minimum of a Pareto burst length.
+ * @param b
+ *   Maximum of a uniform or shape (above 1) of a Pareto burst length.
+ * @return
+ *   0 on success or -1 on error.
+ */
+int tx_burst_dist_set(struct port_info_s *pinfo, uint32_t dist, double a, double b);
+
+/**
+ * Print the TX arrival model of a port.
+ *
+ * @param pinfo
+ *   Port to show.
+ */
+void tx_arrival_show(struct port_info_s *pinfo);
+
+/**
+ * Draw the next burst of a TX queue using a stochastic arrival model.
+ *
+ * Sets the length of the burst in pace->pending and the time the burst after it
+ * starts in pace->next. Only called by the lcore serving the TX queue once
+ * pace->next is reached.
+ *
+ * @param pinfo
+ *   Port of the TX queue.
+ * @param cfg
+ *   Pacing parameters the TX queue uses.
+ * @param pace
+ *   Pacing state of the TX queue.
+ * @param now
+ *   Current time from pktgen_get_time().
+ */
+void tx_arrival_next(struct port_info_s *pinfo, const struct tx_pace_cfg_s *cfg,
+                     struct tx_pace_s *pace, uint64_t now);
+
+/**
+ * Draw an exponentially distributed value with a mean of one.
+ *
+ * Uses the arrival model generator of the calling lcore.
+ *
+ * @return
+ *   Random value of at least 0.
+ */
+double tx_arrival_exp(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PKTGEN_RATE_H_ */
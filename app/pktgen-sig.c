@@ -0,0 +1,439 @@
+/*-
+ * Copyright(c) <2010-2026>, Intel Corporation. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <rte_malloc.h>
+#include <rte_ip.h>
+#include <rte_tcp.h>
+#include <rte_udp.h>
+#include <rte_icmp.h>
+
+#include "pktgen.h"
+#include "pktgen-log.h"
+#include "pktgen-sig.h"
+
+/**
+ *
+ * sig_payload_off - Return the offset of the L4 payload of a packet.
+ *
+ * DESCRIPTION
+ * Step over the Ethernet header, VLAN tags, the IPv4 or IPv6 header and the
+ * TCP, UDP or ICMP header. The signature must not overwrite any of them.
+ *
+ * RETURNS: Offset of the first payload byte.
+ *
+ * SEE ALSO:
+ */
+static inline uint32_t
+sig_payload_off(const uint8_t *p, uint32_t len)
+{
+    uint32_t off  = sizeof(struct rte_ether_hdr);
+    uint16_t type = ((const struct rte_ether_hdr *)p)->ether_type;
+    uint8_t proto;
+
+    while ((type == htons(RTE_ETHER_TYPE_VLAN) || type == htons(RTE_ETHER_TYPE_QINQ)) &&
+           len >= off + sizeof(struct rte_vlan_hdr)) {
+        type = ((const struct rte_vlan_hdr *)(p + off))->eth_proto;
+        off += sizeof(struct rte_vlan_hdr);
+    }
+
+    if (type == htons(RTE_ETHER_TYPE_IPV4) && len >= off + sizeof(struct rte_ipv4_hdr)) {
+        const struct rte_ipv4_hdr *ip = (const struct rte_ipv4_hdr *)(p + off);
+
+        proto = ip->next_proto_id;
+        off += (ip->version_ihl & RTE_IPV4_HDR_IHL_MASK) * RTE_IPV4_IHL_MULTIPLIER;
+    } else if (type == htons(RTE_ETHER_TYPE_IPV6) && len >= off + sizeof(struct rte_ipv6_hdr)) {
+        proto = ((const struct rte_ipv6_hdr *)(p + off))->proto;
+        off += sizeof(struct rte_ipv6_hdr);
+    } else
+        return off;
+
+    switch (proto) {
+    case IPPROTO_TCP:
+        if (len >= off + sizeof(struct rte_tcp_hdr))
+            off += (((const struct rte_tcp_hdr *)(p + off))->data_off >> 4) * 4;
+        else
+            off += sizeof(struct rte_tcp_hdr);
+        break;
+    case IPPROTO_UDP:
+        off += sizeof(struct rte_udp_hdr);
+        break;
+    case IPPROTO_ICMP:
+    case IPPROTO_ICMPV6:
+        off += sizeof(struct rte_icmp_hdr);
+        break;
+    default:
+        break;
+    }
+    return off;
+}
+
+/* Ones' complement difference, adding it to after gives before */
+static inline uint16_t
+sig_csum_adjust(uint16_t before, uint16_t after)
+{
+    uint32_t sum = (uint32_t)before + (uint16_t)~after;
+
+    sum = (sum & 0xffff) + (sum >> 16);
+    return (uint16_t)((sum & 0xffff) + (sum >> 16));
+}
+
+int
+pktgen_sig_setup(port_info_t *pinfo)
+{
+    uint16_t nb_rxq = l2p_get_rxcnt(pinfo->pid);
+    int sid         = rte_eth_dev_socket_id(pinfo->pid);
+    sig_rx_t *rx;
+
+    if (pinfo->sig_rx)
+        return 0;
+
+    if (sid < 0)
+        sid = SOCKET_ID_ANY;
+
+    rx = rte_zmalloc_socket("sig_rx", RTE_MAX(nb_rxq, 1) * sizeof(sig_rx_t), RTE_CACHE_LINE_SIZE,
+                            sid);
+    if (rx == NULL) {
+        pktgen_log_error("Port %d unable to allocate the signature analyzers", pinfo->pid);
+        return -1;
+    }
+
+    /* The RX lcores only look at the analyzers once they are filled in */
+    rte_smp_wmb();
+    pinfo->sig_rx = rx;
+
+    return 0;
+}
+
+void
+pktgen_sig_tx_bulk(port_info_t *pinfo, uint16_t qid, struct rte_mbuf **pkts, uint16_t nb_pkts)
+{
+    per_queue_t *pq = &pinfo->per_queue[qid];
+    uint32_t gen    = pinfo->sig_clear_gen;
+    pkt_sig_t sig;
+
+    /* A clear restarts the counters, the sequence numbers go on for the receivers */
+    if (unlikely(pq->sig_gen != gen)) {
+        pq->sig_base     = pq->sig_seq;
+        pq->sig_unsigned = 0;
+        rte_smp_wmb();
+        pq->sig_gen = gen;
+    }
+
+    sig.magic  = PKT_SIG_MAGIC;
+    sig.stream = (uint16_t)(pinfo->pid * MAX_QUEUES_PER_PORT + qid);
+
+    for (uint16_t i = 0; i < nb_pkts; i++) {
+        uint8_t *p   = rte_pktmbuf_mtod(pkts[i], uint8_t *);
+        uint32_t len = pkts[i]->data_len;
+        uint8_t *tail;
+        uint16_t before;
+
+        /* Too short to carry a signature after its headers, send it as is */
+        if (len < sig_payload_off(p, len) + sizeof(pkt_sig_t)) {
+            pq->sig_unsigned++;
+            continue;
+        }
+
+        tail   = p + len - sizeof(pkt_sig_t);
+        before = rte_raw_cksum(tail, sizeof(pkt_sig_t));
+
+        sig.seq    = pq->sig_seq++;
+        sig.adjust = 0;
+        sig.adjust = sig_csum_adjust(before, rte_raw_cksum(&sig, sizeof(sig)));
+
+        memcpy(tail, &sig, sizeof(sig));
+    }
+}
+
+void
+pktgen_sig_tx_stats(port_info_t *pinfo, uint16_t qid, uint64_t *sent, uint64_t *too_short)
+{
+    const per_queue_t *pq = &pinfo->per_queue[qid];
+
+    *sent      = 0;
+    *too_short = 0;
+
+    /* The TX lcore resets the counters at its next burst after a clear */
+    if (pq->sig_gen != pinfo->sig_clear_gen)
+        return;
+    rte_smp_rmb();
+    *sent      = pq->sig_seq - pq->sig_base;
+    *too_short = pq->sig_unsigned;
+}
+
+/* Set or test the bit of a sequence number in the window of a stream */
+#define SIG_BIT(seq)  (1ULL << ((seq) % 64))
+#define SIG_WORD(seq) (((seq) % SIG_WINDOW) / 64)
+
+/**
+ *
+ * sig_stream_update - Add a received sequence number to a stream.
+ *
+ * DESCRIPTION
+ * A number above the newest moves the window up and counts the numbers it
+ * skips as lost. A number below the newest and inside the window fills a hole,
+ * a reordered packet, unless its bit is set already, a duplicate. Below the
+ * window, or below the first number of the stream, the packet is late.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+static inline void
+sig_stream_update(sig_stream_t *s, uint64_t seq)
+{
+    sig_stats_t *st = &s->st;
+
+    st->pkts++;
+
+    if (likely(seq >= s->next)) {
+        uint64_t gap = seq - s->next;
+
+        /* The numbers entering the window replace those leaving it */
+        if (unlikely(gap >= SIG_WINDOW))
+            memset(s->bits, 0, sizeof(s->bits));
+        else
+            for (uint64_t q = s->next; q < seq; q++)
+                s->bits[SIG_WORD(q)] &= ~SIG_BIT(q);
+
+        st->lost += gap;
+        s->bits[SIG_WORD(seq)] |= SIG_BIT(seq);
+        s->next = seq + 1;
+        return;
+    }
+
+    if (s->next - seq > SIG_WINDOW || seq < s->first) {
+        st->late++;
+        return;
+    }
+
+    if (s->bits[SIG_WORD(seq)] & SIG_BIT(seq)) {
+        st->duplicates++;
+        return;
+    }
+
+    s->bits[SIG_WORD(seq)] |= SIG_BIT(seq);
+    st->lost--;
+    st->reordered++;
+    if (s->next - 1 - seq > st->max_reorder)
+        st->max_reorder = s->next - 1 - seq;
+}
+
+void
+pktgen_sig_rx_bulk(port_info_t *pinfo, uint16_t qid, struct rte_mbuf **pkts, uint16_t nb_pkts)
+{
+    sig_rx_t *rx = &pinfo->sig_rx[qid];
+    uint32_t gen = pinfo->sig_clear_gen;
+
+    /* Restart the analysis of the queue after a clear */
+    if (unlikely(rx->gen != gen)) {
+        rx->foreign = 0;
+        memset(rx->s, 0, sizeof(rx->s));
+        rte_smp_wmb();
+        rx->gen = gen;
+    }
+
+    for (uint16_t i = 0; i < nb_pkts; i++) {
+        struct rte_mbuf *m = pkts[i];
+        const void *tail;
+        pkt_sig_t sig;
+        sig_stream_t *s;
+
+        if (m->pkt_len < sizeof(pkt_sig_t))
+            continue;
+
+        /* The signature is the end of the frame, in the last segment of a chain */
+        tail = rte_pktmbuf_read(m, m->pkt_len - sizeof(pkt_sig_t), sizeof(pkt_sig_t), &sig);
+        if (tail == NULL)
+            continue;
+        if (tail != &sig)
+            memcpy(&sig, tail, sizeof(sig));
+        if (sig.magic != PKT_SIG_MAGIC)
+            continue;
+
+        s = &rx->s[sig.stream % SIG_STREAMS];
+        if (unlikely(!s->active)) {
+            memset(s, 0, sizeof(*s));
+            s->active    = 1;
+            s->st.stream = sig.stream;
+            s->first     = sig.seq;
+            s->next      = sig.seq;
+        } else if (unlikely(s->st.stream != sig.stream)) {
+            rx->foreign++;
+            continue;
+        }
+
+        sig_stream_update(s, sig.seq);
+    }
+}
+
+void
+pktgen_sig_clear(port_info_t *pinfo)
+{
+    pinfo->sig_clear_gen++;
+}
+
+/* Add the counters of a stream to the total of the port */
+static inline void
+sig_stats_add(sig_stats_t *total, const sig_stats_t *st)
+{
+    total->pkts += st->pkts;
+    total->lost += st->lost;
+    total->reordered += st->reordered;
+    total->duplicates += st->duplicates;
+    total->late += st->late;
+    total->max_reorder = RTE_MAX(total->max_reorder, st->max_reorder);
+    total->rx_queues   = RTE_MAX(total->rx_queues, st->rx_queues);
+}
+
+/**
+ *
+ * sig_stream_merge - Merge the counters of a stream over the RX queues.
+ *
+ * DESCRIPTION
+ * Add the counters of the stream found on queue q0 and of the same stream on
+ * the later queues, which are marked done. On several RX queues each queue only
+ * sees part of the sequence numbers, so the lost packets are the numbers of the
+ * span of the stream received by no queue, and the reordered packets only those
+ * behind a later packet on the same queue.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+static void
+sig_stream_merge(const sig_rx_t *rx, uint16_t nb_rxq, uint16_t idx, uint16_t q0, bool *done,
+                 sig_stats_t *st)
+{
+    uint16_t stream = rx[q0].s[idx].st.stream;
+    uint64_t first  = UINT64_MAX, next = 0;
+
+    memset(st, 0, sizeof(*st));
+    st->stream = stream;
+
+    for (uint16_t q = q0; q < nb_rxq; q++) {
+        const sig_stream_t *s = &rx[q].s[idx];
+
+        if (done[q] || !s->active || s->st.stream != stream)
+            continue;
+        done[q] = true;
+
+        st->rx_queues++;
+        st->pkts += s->st.pkts;
+        st->lost += s->st.lost;
+        st->reordered += s->st.reordered;
+        st->duplicates += s->st.duplicates;
+        st->late += s->st.late;
+        st->max_reorder = RTE_MAX(st->max_reorder, s->st.max_reorder);
+        first           = RTE_MIN(first, s->first);
+        next            = RTE_MAX(next, s->next);
+    }
+
+    if (st->rx_queues > 1) {
+        uint64_t got = st->pkts - st->duplicates;
+
+        st->lost = (next - first > got) ? next - first - got : 0;
+    }
+}
+
+uint16_t
+pktgen_sig_stats(port_info_t *pinfo, sig_stats_t *total, sig_stats_t *streams)
+{
+    sig_rx_t *rx    = pinfo->sig_rx;
+    uint16_t nb_rxq = RTE_MIN(l2p_get_rxcnt(pinfo->pid), MAX_QUEUES_PER_PORT);
+    uint32_t gen    = pinfo->sig_clear_gen;
+    uint16_t nb     = 0;
+
+    memset(total, 0, sizeof(*total));
+    if (rx == NULL)
+        return 0;
+
+    for (uint16_t idx = 0; idx < SIG_STREAMS; idx++) {
+        bool done[MAX_QUEUES_PER_PORT];
+
+        /* The queues not reset since the last clear count nothing */
+        for (uint16_t q = 0; q < nb_rxq; q++)
+            done[q] = (rx[q].gen != gen);
+        rte_smp_rmb();
+
+        /* Queues may hold different streams in the same slot */
+        for (uint16_t q = 0; q < nb_rxq; q++) {
+            sig_stats_t st;
+
+            if (done[q] || !rx[q].s[idx].active)
+                continue;
+
+            sig_stream_merge(rx, nb_rxq, idx, q, done, &st);
+            sig_stats_add(total, &st);
+
+            if (nb < SIG_STREAMS) {
+                if (streams)
+                    streams[nb] = st;
+                nb++;
+            }
+        }
+    }
+
+    return nb;
+}
+
+void
+pktgen_sig_show(port_info_t *pinfo)
+{
+    sig_stats_t total, streams[SIG_STREAMS];
+    uint16_t nb_txq  = l2p_get_txcnt(pinfo->pid);
+    uint16_t nb_rxq  = l2p_get_rxcnt(pinfo->pid);
+    uint64_t foreign = 0;
+    uint16_t nb;
+
+    printf("Port %d signatures %s\n", pinfo->pid,
+           pktgen_tst_port_flags(pinfo, SIGNATURE_PKTS) ? "on" : "off");
+
+    for (uint16_t q = 0; q < nb_txq; q++) {
+        uint64_t sent, too_short;
+
+        pktgen_sig_tx_stats(pinfo, q, &sent, &too_short);
+        printf("  TX queue %2d stream %5u: %'" PRIu64 " signed, %'" PRIu64 " too short\n", q,
+               pinfo->pid * MAX_QUEUES_PER_PORT + q, sent, too_short);
+    }
+
+    nb = pktgen_sig_stats(pinfo, &total, streams);
+    if (nb == 0)
+        return;
+
+    printf("  %-15s %14s %12s %12s %8s %12s %12s\n", "RX stream", "Packets", "Lost",
+           "Reordered", "Depth", "Duplicates", "Late");
+    for (uint16_t i = 0; i < nb; i++) {
+        const sig_stats_t *st = &streams[i];
+        char name[32];
+
+        snprintf(name, sizeof(name), "%u (%u/%u)%s", st->stream,
+                 st->stream / MAX_QUEUES_PER_PORT, st->stream % MAX_QUEUES_PER_PORT,
+                 (st->rx_queues > 1) ? "*" : "");
+        printf("  %-15s %14" PRIu64 " %12" PRIu64 " %12" PRIu64 " %8" PRIu64 " %12" PRIu64
+               " %12" PRIu64 "\n",
+               name, st->pkts, st->lost, st->reordered, st->max_reorder, st->duplicates,
+               st->late);
+    }
+    printf("  %-15s %14" PRIu64 " %12" PRIu64 " %12" PRIu64 " %8" PRIu64 " %12" PRIu64
+           " %12" PRIu64 "\n",
+           "Total", total.pkts, total.lost, total.reordered, total.max_reorder, total.duplicates,
+           total.late);
+
+    if (total.rx_queues > 1)
+        printf("  * received on several RX queues, lost is from the span of the sequence "
+               "numbers and reordered only counts within each queue\n");
+
+    for (uint16_t q = 0; q < nb_rxq; q++)
+        if (pinfo->sig_rx[q].gen == pinfo->sig_clear_gen)
+            foreign += pinfo->sig_rx[q].foreign;
+    if (foreign)
+        printf("  %'" PRIu64 " packets of streams without a free slot were not followed\n",
+               foreign);
+}
@@ -0,0 +1,178 @@
+/*-
+ * Copyright(c) <2010-2026>, Intel Corporation. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PKTGEN_SIG_H_
+#define _PKTGEN_SIG_H_
+
+/**
+ * @file
+ *
+ * Payload signatures of data packets and their RX analysis.
+ *
+ * A port with signatures enabled writes a pkt_sig_t into the last bytes of
+ * every data packet it sends: the stream, one per sending port and TX queue,
+ * and a 64 bit sequence number of the stream. The signature carries a word
+ * that keeps the ones' complement sum of the bytes it replaces, so the TCP and
+ * UDP checksums of the packet stay valid without being computed again.
+ *
+ * On receive each RX queue follows the streams it sees in a window of the
+ * last SIG_WINDOW sequence numbers and counts the packets still missing, the
+ * packets arriving after a later one of their stream and how far behind they
+ * were, the duplicates, and the packets too old for the window. A stream is
+ * followed per RX queue, so its packets should reach a single RX queue. For a
+ * stream received on several RX queues the lost packets come from the span of
+ * its sequence numbers and the reordered packets are only those seen by each
+ * queue, rx_queues of its counters tells.
+ *
+ * A clear bumps sig_clear_gen of the port, the lcores reset the counters of
+ * their queues when they see it and the readers skip the queues not reset yet.
+ */
+
+#include <stdint.h>
+
+#include <rte_mbuf.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PKT_SIG_MAGIC    0x5349474eU       /**< Magic value identifying a signed packet */
+#define SIG_WINDOW       1024              /**< Sequence numbers followed behind the newest */
+#define SIG_WINDOW_WORDS (SIG_WINDOW / 64) /**< 64 bit words of the window bitmap */
+#define SIG_STREAMS      256               /**< Streams followed by an RX queue */
+
+/** Signature in the last bytes of a data packet, in host byte order. */
+typedef struct pkt_sig_s {
+    uint32_t magic;  /**< PKT_SIG_MAGIC */
+    uint16_t stream; /**< Sending port * MAX_QUEUES_PER_PORT + TX queue */
+    uint16_t adjust; /**< Keeps the ones' complement sum of the replaced bytes */
+    uint64_t seq;    /**< Sequence number in the stream */
+} pkt_sig_t;
+
+/** Counters of a signed stream. */
+typedef struct sig_stats_s {
+    uint64_t pkts;        /**< Signed packets received */
+    uint64_t lost;        /**< Sequence numbers skipped and not received since */
+    uint64_t reordered;   /**< Packets received after a later packet of the stream */
+    uint64_t max_reorder; /**< Largest distance of a reordered packet behind the newest */
+    uint64_t duplicates;  /**< Packets whose sequence number was received already */
+    uint64_t late;        /**< Packets older than the window, lost or duplicate is unknown */
+    uint16_t stream;      /**< Stream of the counters */
+    uint16_t rx_queues;   /**< RX queues the stream was received on */
+} sig_stats_t;
+
+/** Stream followed by an RX queue. */
+typedef struct sig_stream_s {
+    uint64_t first;                  /**< First sequence number received */
+    uint64_t next;                   /**< Newest sequence number received + 1 */
+    uint64_t bits[SIG_WINDOW_WORDS]; /**< Numbers received below next, indexed by seq % window */
+    sig_stats_t st;                  /**< Counters of the stream */
+    uint8_t active;                  /**< Non-zero once a packet of the stream was received */
+} sig_stream_t;
+
+/** Signature analyzer of an RX queue, written only by the lcore serving the queue. */
+typedef struct sig_rx_s {
+    uint64_t foreign;            /**< Packets of streams without a free slot */
+    uint32_t gen;                /**< sig_clear_gen of the port the analyzer follows */
+    sig_stream_t s[SIG_STREAMS]; /**< Streams by stream % SIG_STREAMS */
+} sig_rx_t __rte_cache_aligned;
+
+struct port_info_s;
+
+/**
+ * Allocate the signature analyzers of the RX queues of a port.
+ *
+ * @param pinfo
+ *   Port to set up, nothing is done when the analyzers exist.
+ * @return
+ *   0 on success or -1 when the memory is not available.
+ */
+int pktgen_sig_setup(struct port_info_s *pinfo);
+
+/**
+ * Sign a burst of data packets about to be sent.
+ *
+ * @param pinfo
+ *   Sending port.
+ * @param qid
+ *   TX queue the packets are sent on, it gives the stream.
+ * @param pkts
+ *   Single segment packets to sign.
+ * @param nb_pkts
+ *   Number of packets in pkts.
+ */
+void pktgen_sig_tx_bulk(struct port_info_s *pinfo, uint16_t qid, struct rte_mbuf **pkts,
+                        uint16_t nb_pkts);
+
+/**
+ * Return the signature counters of a TX queue.
+ *
+ * @param pinfo
+ *   Sending port.
+ * @param qid
+ *   TX queue to query.
+ * @param sent
+ *   Filled with the packets signed since the last clear.
+ * @param too_short
+ *   Filled with the packets too short to carry a signature since the last clear.
+ */
+void pktgen_sig_tx_stats(struct port_info_s *pinfo, uint16_t qid, uint64_t *sent,
+                         uint64_t *too_short);
+
+/**
+ * Follow the streams of the signed packets of a received burst.
+ *
+ * @param pinfo
+ *   Receiving port, its analyzers must exist.
+ * @param qid
+ *   RX queue the packets were received on.
+ * @param pkts
+ *   Received packets, the packets without a signature are ignored.
+ * @param nb_pkts
+ *   Number of packets in pkts.
+ */
+void pktgen_sig_rx_bulk(struct port_info_s *pinfo, uint16_t qid, struct rte_mbuf **pkts,
+                        uint16_t nb_pkts);
+
+/**
+ * Restart the signature counters of a port.
+ *
+ * The TX and RX lcores reset the counters of their queues at their next burst,
+ * so a clear never races with them.
+ *
+ * @param pinfo
+ *   Port to clear.
+ */
+void pktgen_sig_clear(struct port_info_s *pinfo);
+
+/**
+ * Merge the counters of the streams received by a port over its RX queues.
+ *
+ * @param pinfo
+ *   Port to query.
+ * @param total
+ *   Filled with the sum of all the streams, max_reorder and rx_queues are the
+ *   largest ones.
+ * @param streams
+ *   Filled with the counters of each stream, SIG_STREAMS entries, or NULL.
+ * @return
+ *   Number of streams placed in streams.
+ */
+uint16_t pktgen_sig_stats(struct port_info_s *pinfo, sig_stats_t *total, sig_stats_t *streams);
+
+/**
+ * Print the signature counters of a port.
+ *
+ * @param pinfo
+ *   Port to show.
+ */
+void pktgen_sig_show(struct port_info_s *pinfo);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PKTGEN_SIG_H_ */
@@ -557,14 +557,44 @@ pktgen_process_stats(void)
 
         process_xstats(pinfo);
 
+        /* The latency page, Lua and a paused screen all read the merged values */
+        pktgen_latency_merge(pinfo);
+        pktgen_latency_calibrate(pinfo);
+
         /* Snapshot per-queue counters written by worker lcores.
          * rte_smp_rmb() ensures all worker stores are visible before the copy.
          * snap_qstats is owned exclusively by this timer thread; the display
          * reads from snap_qstats so it never races with the worker hot path. */
         rte_smp_rmb();
         int nq = RTE_MAX(l2p_get_rxcnt(pid), l2p_get_txcnt(pid));
-        for (int q = 0; q < nq && q < MAX_QUEUES_PER_PORT; q++)
-            pinfo->stats.snap_qstats[q] = pinfo->stats.qstats[q];
+        for (int q = 0; q < nq && q < MAX_QUEUES_PER_PORT; q++) {
+            rx_qstats_t *rxq  = &pinfo->stats.rxq[q];
+            tx_qstats_t *txq  = &pinfo->stats.txq[q];
+            qstats_t *snap    = &pinfo->stats.snap_qstats[q];
+            uint64_t opackets = txq->q_opackets;
+
+            /* Achieved against requested TX rate, this runs once a second */
+            snap->q_tx_pps     = (opackets > snap->q_opackets) ? opackets - snap->q_opackets : 0;
+            snap->q_tx_req_pps = 0;
+            if (q < l2p_get_txcnt(pid) && pktgen_tst_port_flags(pinfo, SENDING_PACKETS)) {
+                /* With a rate profile the queue paces at the rate it last evaluated */
+                const tx_pace_cfg_t *cfg = pktgen_tst_port_flags(pinfo, TX_RATE_PROFILE)
+                                               ? &pinfo->tx_pace[q].cfg
+                                               : &pinfo->tx_pace_cfg;
+
+                snap->q_tx_req_pps = (uint64_t)(cfg->pps + 0.5);
+            }
+
+            snap->q_ipackets   = rxq->q_ipackets;
+            snap->q_ibytes     = rxq->q_ibytes;
+            snap->q_fpackets   = rxq->q_fpackets;
+            snap->q_fbytes     = rxq->q_fbytes;
+            snap->q_opackets   = opackets;
+            snap->q_obytes     = txq->q_obytes;
+            snap->q_tx_drops   = txq->q_tx_drops;
+            snap->q_no_txmbufs = txq->q_no_txmbufs;
+            snap->q_errors     = txq->q_tx_drops;
+        }
     }
 }
 
@@ -575,7 +605,8 @@ pktgen_page_qstats(uint16_t pid)
     struct rte_eth_stats *s, *r;
     struct rte_ether_addr ethaddr;
     char buff[128], mac_buf[32], dev_name[64];
-    uint64_t ipackets, opackets, errs;
+    uint64_t ipackets, opackets, ibytes, obytes, drops, nombufs;
+    uint64_t fpkts[MAX_QUEUES_PER_PORT], fbytes[MAX_QUEUES_PER_PORT];
     port_info_t *pinfo;
 
     pinfo = l2p_get_port_pinfo(pid);
@@ -625,11 +656,11 @@ pktgen_page_qstats(uint16_t pid)
     scrn_printf(row + 5, col, "%*s", width, buff);
 
     row += 6;
-    ipackets = opackets = errs = 0;
-    hdr                        = 0;
-    int nq                     = RTE_MAX(l2p_get_rxcnt(pid), l2p_get_txcnt(pid));
+    ipackets = opackets = ibytes = obytes = drops = nombufs = 0;
+    hdr                                                      = 0;
+    int nq = RTE_MAX(l2p_get_rxcnt(pid), l2p_get_txcnt(pid));
     for (q = 0; q < (unsigned int)nq; q++) {
-        uint64_t rxpkts, txpkts, errors;
+        uint64_t rxpkts, txpkts, rxbytes, txbytes, txdrops, txnombufs;
         qstats_t *qs      = &pinfo->stats.snap_qstats[q];
         qstats_t *prev_qs = &pinfo->stats.prev_qstats[q];
 
@@ -637,22 +668,64 @@ pktgen_page_qstats(uint16_t pid)
             hdr = 1;
             row++;
             pktgen_display_set_color("stats.port.status");
-            scrn_printf(row++, 1, "%-8s: %14s %14s %14s", "Rate/sec", "ipackets", "opackets",
-                        "errors");
+            scrn_printf(row++, 1, "%-8s: %14s %14s %14s %14s %14s %14s", "Rate/sec", "ipackets",
+                        "opackets", "ibytes", "obytes", "tx_drops", "no_txmbufs");
             pktgen_display_set_color("stats.stat.values");
         }
 
-        rxpkts   = qs->q_ipackets - prev_qs->q_ipackets;
-        txpkts   = qs->q_opackets - prev_qs->q_opackets;
-        errors   = qs->q_errors - prev_qs->q_errors;
-        *prev_qs = *qs;
-
-        scrn_printf(row++, 1, "  Q %2d  : %'14lu %'14lu %'14lu", q, rxpkts, txpkts, errors);
+        rxpkts    = qs->q_ipackets - prev_qs->q_ipackets;
+        txpkts    = qs->q_opackets - prev_qs->q_opackets;
+        rxbytes   = qs->q_ibytes - prev_qs->q_ibytes;
+        txbytes   = qs->q_obytes - prev_qs->q_obytes;
+        txdrops   = qs->q_tx_drops - prev_qs->q_tx_drops;
+        txnombufs = qs->q_no_txmbufs - prev_qs->q_no_txmbufs;
+        fpkts[q]  = qs->q_fpackets - prev_qs->q_fpackets;
+        fbytes[q] = qs->q_fbytes - prev_qs->q_fbytes;
+        *prev_qs  = *qs;
+
+        scrn_printf(row++, 1, "  Q %2d  : %'14lu %'14lu %'14lu %'14lu %'14lu %'14lu", q, rxpkts,
+                    txpkts, rxbytes, txbytes, txdrops, txnombufs);
         ipackets += rxpkts;
         opackets += txpkts;
-        errs += errors;
+        ibytes += rxbytes;
+        obytes += txbytes;
+        drops += txdrops;
+        nombufs += txnombufs;
+    }
+    scrn_printf(row++, 1, " %-7s: %'14lu %'14lu %'14lu %'14lu %'14lu %'14lu", "Totals", ipackets,
+                opackets, ibytes, obytes, drops, nombufs);
+
+    /* Requested against achieved TX rate of each queue over the last second */
+    row++;
+    pktgen_display_set_color("stats.port.status");
+    scrn_printf(row++, 1, "%-8s: %14s %14s %14s %14s", "Tx Pace", "requested", "achieved",
+                "error %", "burst");
+    pktgen_display_set_color("stats.stat.values");
+    for (q = 0; q < (unsigned int)l2p_get_txcnt(pid); q++) {
+        qstats_t *qs = &pinfo->stats.snap_qstats[q];
+        double err   = 0.0;
+        uint16_t burst;
+
+        if (qs->q_tx_req_pps)
+            err = (((double)qs->q_tx_pps - (double)qs->q_tx_req_pps) * 100.0) /
+                  (double)qs->q_tx_req_pps;
+
+        burst = pktgen_tst_port_flags(pinfo, TX_RATE_PROFILE) ? pinfo->tx_pace[q].cfg.burst
+                                                              : pinfo->tx_pace_cfg.burst;
+        scrn_printf(row++, 1, "  Q %2d  : %'14lu %'14lu %14.3f %14u", q, qs->q_tx_req_pps,
+                    qs->q_tx_pps, err, burst);
+    }
+
+    /* Received packets accepted by the RX filter over the last second */
+    if (pinfo->rx_filter) {
+        row++;
+        pktgen_display_set_color("stats.port.status");
+        scrn_printf(row++, 1, "%-8s: %14s %14s  %.60s", "Rx Filt", "ipackets", "ibytes",
+                    pktgen_rx_filter_expr(pinfo));
+        pktgen_display_set_color("stats.stat.values");
+        for (q = 0; q < (unsigned int)l2p_get_rxcnt(pid); q++)
+            scrn_printf(row++, 1, "  Q %2d  : %'14lu %'14lu", q, fpkts[q], fbytes[q]);
     }
-    scrn_printf(row++, 1, " %-7s: %'14lu %'14lu %'14lu", "Totals", ipackets, opackets, errs);
     pktgen_display_set_color(NULL);
     display_dashline(row + 2);
     scrn_eol();
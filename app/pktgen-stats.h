@@ -25,11 +25,35 @@ extern "C" {
 
 #define MAX_QUEUES_PER_PORT 32 /**< Maximum number of RX/TX queues per port */
 
-/** Per-queue packet counters. */
-typedef struct qstats_s {
+/** Per-queue RX counters, written only by the lcore serving the RX queue. */
+typedef struct rx_qstats_s {
     uint64_t q_ipackets; /**< Number of input packets */
-    uint64_t q_opackets; /**< Number of output packets */
-    uint64_t q_errors;   /**< Number of error packets */
+    uint64_t q_ibytes;   /**< Number of input bytes, not counting FCS */
+    uint64_t q_fpackets; /**< Number of input packets accepted by the RX filter */
+    uint64_t q_fbytes;   /**< Number of input bytes accepted by the RX filter */
+} rx_qstats_t __rte_cache_aligned;
+
+/** Per-queue TX counters, written only by the lcore serving the TX queue. */
+typedef struct tx_qstats_s {
+    uint64_t q_opackets;   /**< Number of output packets */
+    uint64_t q_obytes;     /**< Number of output bytes, not counting FCS */
+    uint64_t q_tx_drops;   /**< Packets freed without being sent */
+    uint64_t q_no_txmbufs; /**< Number of bursts skipped because the TX mempool was empty */
+} tx_qstats_t __rte_cache_aligned;
+
+/** Per-queue packet counters aggregated by the timer thread. */
+typedef struct qstats_s {
+    uint64_t q_ipackets;   /**< Number of input packets */
+    uint64_t q_opackets;   /**< Number of output packets */
+    uint64_t q_ibytes;     /**< Number of input bytes */
+    uint64_t q_obytes;     /**< Number of output bytes */
+    uint64_t q_tx_drops;   /**< Packets freed without being sent */
+    uint64_t q_no_txmbufs; /**< Number of bursts skipped because the TX mempool was empty */
+    uint64_t q_errors;     /**< Number of error packets (TX drops) */
+    uint64_t q_tx_pps;     /**< Packets sent in the last second */
+    uint64_t q_tx_req_pps; /**< Requested TX packets per second of the queue */
+    uint64_t q_fpackets;   /**< Number of input packets accepted by the RX filter */
+    uint64_t q_fbytes;     /**< Number of input bytes accepted by the RX filter */
 } qstats_t;
 
 /** Packet size histogram counters. */
@@ -65,7 +89,8 @@ typedef struct port_stats_s {
 
     size_stats_t sizes; /**< Packet size counters */
 
-    qstats_t qstats[MAX_QUEUES_PER_PORT];      /**< Hot-path: written only by worker lcores */
+    rx_qstats_t rxq[MAX_QUEUES_PER_PORT];      /**< Hot-path: written only by RX worker lcores */
+    tx_qstats_t txq[MAX_QUEUES_PER_PORT];      /**< Hot-path: written only by TX worker lcores */
     qstats_t snap_qstats[MAX_QUEUES_PER_PORT]; /**< Snapshot: written only by timer thread */
     qstats_t prev_qstats[MAX_QUEUES_PER_PORT]; /**< Previous snapshot for rate calculation */
 } port_stats_t;
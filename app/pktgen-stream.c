@@ -0,0 +1,482 @@
+/*-
+ * Copyright(c) <2010-2026>, Intel Corporation. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <rte_malloc.h>
+#include <rte_atomic.h>
+
+#include "pktgen.h"
+#include "pktgen-log.h"
+#include "pktgen-stream.h"
+
+static const char *model_names[] = {"periodic", "poisson"};
+
+/**
+ *
+ * stream_table - Return the stream table of a port, allocating it on first use.
+ *
+ * DESCRIPTION
+ * The table holds the streams, a frame buffer per stream and the schedule of
+ * every TX queue of the port. It stays allocated once created, so the TX lcores
+ * never see it go away.
+ *
+ * RETURNS: Stream table or NULL on error.
+ *
+ * SEE ALSO:
+ */
+static stream_table_t *
+stream_table(port_info_t *pinfo)
+{
+    stream_table_t *st = pinfo->streams;
+    uint16_t txcnt     = RTE_MAX(l2p_get_txcnt(pinfo->pid), 1);
+    int socket         = pg_eth_dev_socket_id(pinfo->pid);
+    uint8_t *data;
+
+    if (st)
+        return st;
+
+    st   = rte_zmalloc_socket("Streams", sizeof(stream_table_t) + (txcnt * sizeof(stream_queue_t)),
+                              RTE_CACHE_LINE_SIZE, socket);
+    data = rte_zmalloc_socket("StreamData", (size_t)STREAM_MAX * pinfo->fill_buf_len,
+                              RTE_CACHE_LINE_SIZE, socket);
+    if (st == NULL || data == NULL) {
+        pktgen_log_error("Unable to allocate port %d streams", pinfo->pid);
+        rte_free(st);
+        rte_free(data);
+        return NULL;
+    }
+
+    st->nb_queues = txcnt;
+    rte_atomic32_init(&st->busy);
+    for (uint16_t i = 0; i < STREAM_MAX; i++) {
+        st->streams[i].rate  = 100.0;
+        st->streams[i].model = TX_ARRIVAL_PERIODIC;
+        st->streams[i].data  = data + ((size_t)i * pinfo->fill_buf_len);
+    }
+    pinfo->streams = st;
+
+    return st;
+}
+
+/**
+ *
+ * stream_get - Return a stream of a port that can be changed.
+ *
+ * DESCRIPTION
+ * The TX lcores read the streams without a lock, so they are only changed while
+ * the port is not sending them.
+ *
+ * RETURNS: Stream or NULL on error.
+ *
+ * SEE ALSO:
+ */
+static stream_t *
+stream_get(port_info_t *pinfo, uint16_t sid)
+{
+    stream_table_t *st;
+
+    if (sid >= STREAM_MAX) {
+        pktgen_log_error("Stream %u must be 0 to %u", sid, STREAM_MAX - 1);
+        return NULL;
+    }
+    if (pktgen_tst_port_flags(pinfo, SEND_STREAM_PKTS) &&
+        pktgen_tst_port_flags(pinfo, SENDING_PACKETS)) {
+        pktgen_log_error("Port %d is sending streams, stop it before changing them", pinfo->pid);
+        return NULL;
+    }
+
+    st = stream_table(pinfo);
+
+    return (st == NULL) ? NULL : &st->streams[sid];
+}
+
+int
+pktgen_stream_enable(port_info_t *pinfo, uint16_t sid, bool on)
+{
+    stream_t *s = stream_get(pinfo, sid);
+
+    if (s == NULL)
+        return -1;
+    s->enabled = on;
+
+    return 0;
+}
+
+int
+pktgen_stream_rate(port_info_t *pinfo, uint16_t sid, double rate)
+{
+    stream_t *s;
+
+    if (rate <= 0.0 || rate > 100.0) {
+        pktgen_log_error("Stream rate %.4f must be above 0 and up to 100 percent", rate);
+        return -1;
+    }
+
+    s = stream_get(pinfo, sid);
+    if (s == NULL)
+        return -1;
+    s->rate = rate;
+
+    return 0;
+}
+
+int
+pktgen_stream_count(port_info_t *pinfo, uint16_t sid, uint64_t count)
+{
+    stream_t *s = stream_get(pinfo, sid);
+
+    if (s == NULL)
+        return -1;
+    s->count = count;
+
+    return 0;
+}
+
+int
+pktgen_stream_model(port_info_t *pinfo, uint16_t sid, uint32_t model)
+{
+    stream_t *s;
+
+    if (model != TX_ARRIVAL_PERIODIC && model != TX_ARRIVAL_POISSON) {
+        pktgen_log_error("Stream model must be periodic or poisson");
+        return -1;
+    }
+
+    s = stream_get(pinfo, sid);
+    if (s == NULL)
+        return -1;
+    s->model = model;
+
+    return 0;
+}
+
+int
+pktgen_stream_copy(port_info_t *pinfo, uint16_t sid)
+{
+    pkt_seq_t *pkt;
+    pkt_hdr_t *hdr;
+
+    if (stream_get(pinfo, sid) == NULL)
+        return -1;
+
+    /* Keep the frame buffer of the sequence packet, only the fields are copied */
+    pkt = &pinfo->seq_pkt[sid];
+    hdr = pkt->hdr;
+    memcpy(pkt, &pinfo->seq_pkt[SINGLE_PKT], sizeof(pkt_seq_t));
+    pkt->hdr = hdr;
+
+    pktgen_packet_ctor(pinfo, sid, -1);
+
+    return 0;
+}
+
+int
+pktgen_stream_clear(port_info_t *pinfo)
+{
+    stream_table_t *st;
+
+    if (stream_get(pinfo, 0) == NULL)
+        return -1;
+
+    st = pinfo->streams;
+    for (uint16_t i = 0; i < STREAM_MAX; i++) {
+        stream_t *s = &st->streams[i];
+
+        s->enabled = false;
+        s->rate    = 100.0;
+        s->count   = 0;
+        s->model   = TX_ARRIVAL_PERIODIC;
+    }
+
+    return 0;
+}
+
+bool
+pktgen_stream_ready(port_info_t *pinfo)
+{
+    if (pinfo->streams == NULL)
+        return false;
+
+    for (uint16_t i = 0; i < STREAM_MAX; i++)
+        if (pinfo->streams->streams[i].enabled)
+            return true;
+
+    return false;
+}
+
+int32_t
+pktgen_stream_setup(port_info_t *pinfo)
+{
+    stream_table_t *st = pinfo->streams;
+    double link        = (double)pinfo->link.link_speed * Million;
+    double hz          = (double)pktgen_get_timer_hz();
+    double total       = 0.0;
+    int32_t largest    = -1;
+
+    if (st == NULL)
+        return SINGLE_PKT;
+
+    for (uint16_t i = 0; i < STREAM_MAX; i++) {
+        stream_t *s    = &st->streams[i];
+        pkt_seq_t *pkt = &pinfo->seq_pkt[i];
+        double pps;
+
+        if (!s->enabled)
+            continue;
+
+        pktgen_packet_ctor(pinfo, i, -1);
+
+        s->pkt_size = pkt->pkt_size;
+        s->l2_len   = pkt->ether_hdr_size;
+        s->ol_flags = pktgen_tx_ol_flags(pinfo, pkt);
+        rte_memcpy(s->data, pkt->hdr, pkt->pkt_size);
+
+        /* Past the headers only the fill differs, unless the L4 checksum covers it */
+        s->copy_len = pkt->pkt_size;
+        if (s->ol_flags & RTE_MBUF_F_TX_L4_MASK)
+            s->copy_len = RTE_MIN(pkt->pkt_size, STREAM_HDR_SIZE);
+
+        pps = (link / (WIRE_SIZE(pkt->pkt_size, double) * 8.0)) * (s->rate / 100.0) /
+              st->nb_queues;
+        if (pps < 1.0)
+            pps = 1.0;
+
+        s->gap     = (uint64_t)(((hz / pps) * (double)(1ULL << STREAM_GAP_SHIFT)) + 0.5);
+        s->max_lag = (s->gap >> STREAM_GAP_SHIFT) * pinfo->tx_burst * TX_PACE_MAX_BURSTS;
+
+        total += s->rate;
+        if (largest < 0 || pkt->pkt_size > st->streams[largest].pkt_size)
+            largest = i;
+    }
+
+    if (largest < 0) {
+        pktgen_log_warning("Port %d has no enabled streams", pinfo->pid);
+        largest = SINGLE_PKT;
+    } else if (total > 100.0)
+        pktgen_log_warning("Port %d streams add up to %.2f%% of the link", pinfo->pid, total);
+
+    rte_atomic32_set(&st->busy, st->nb_queues);
+
+    /* Publish the streams before the TX queues see the new generation */
+    rte_smp_wmb();
+    st->gen++;
+
+    return largest;
+}
+
+static inline bool
+stream_before(const stream_queue_t *sq, uint8_t a, uint8_t b)
+{
+    return (int64_t)(sq->next[a] - sq->next[b]) < 0;
+}
+
+static inline void
+stream_sift_down(stream_queue_t *sq, uint16_t i)
+{
+    uint16_t n = sq->nb_heap;
+    uint8_t id = sq->heap[i];
+
+    for (;;) {
+        uint16_t c = (2 * i) + 1;
+
+        if (c >= n)
+            break;
+        if (c + 1 < n && stream_before(sq, sq->heap[c + 1], sq->heap[c]))
+            c++;
+        if (!stream_before(sq, sq->heap[c], id))
+            break;
+        sq->heap[i] = sq->heap[c];
+        i           = c;
+    }
+    sq->heap[i] = id;
+}
+
+/* Move a stream up the heap to its place */
+static inline void
+stream_sift_up(stream_queue_t *sq, uint16_t i)
+{
+    uint8_t id = sq->heap[i];
+
+    while (i > 0) {
+        uint16_t p = (i - 1) / 2;
+
+        if (!stream_before(sq, id, sq->heap[p]))
+            break;
+        sq->heap[i] = sq->heap[p];
+        i           = p;
+    }
+    sq->heap[i] = id;
+}
+
+/* The TX queue has nothing left to send, the port stops once all queues are done */
+static inline void
+stream_queue_done(port_info_t *pinfo, stream_table_t *st)
+{
+    if (rte_atomic32_dec_and_test(&st->busy))
+        pktgen_clr_port_flags(pinfo, SENDING_PACKETS);
+}
+
+/**
+ *
+ * stream_queue_reset - Restart the stream schedule of a TX queue.
+ *
+ * DESCRIPTION
+ * Give the queue its share of the packet count of every enabled stream and
+ * spread the first send times of the queues over one gap, so the queues do
+ * not send the same stream at the same time.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+static void
+stream_queue_reset(port_info_t *pinfo, stream_table_t *st, stream_queue_t *sq, uint16_t qid,
+                   uint64_t now)
+{
+    uint16_t nq = st->nb_queues;
+
+    sq->gen = st->gen;
+    rte_smp_rmb();
+
+    sq->nb_heap = 0;
+    sq->nb_ids  = 0;
+    for (uint16_t i = 0; i < STREAM_MAX; i++) {
+        const stream_t *s = &st->streams[i];
+        uint64_t left     = 0;
+
+        sq->sent[i] = 0;
+        if (!s->enabled)
+            continue;
+
+        if (s->count) {
+            left = (s->count / nq) + ((qid < (s->count % nq)) ? 1 : 0);
+            if (left == 0)
+                continue;
+        }
+        sq->left[i] = left;
+        sq->frac[i] = 0;
+        sq->next[i] = now + (((s->gap >> STREAM_GAP_SHIFT) * qid) / nq);
+
+        sq->heap[sq->nb_heap++] = i;
+    }
+
+    for (uint16_t i = sq->nb_heap / 2; i-- > 0;)
+        stream_sift_down(sq, i);
+
+    if (sq->nb_heap == 0)
+        stream_queue_done(pinfo, st);
+}
+
+/* Move the send time of a stream to its next packet */
+static inline void
+stream_advance(const stream_t *s, stream_queue_t *sq, uint8_t id, uint64_t now)
+{
+    uint64_t gap = s->gap, frac;
+
+    if (s->model == TX_ARRIVAL_POISSON)
+        gap = (uint64_t)(tx_arrival_exp() * (double)gap);
+
+    frac = sq->frac[id] + (gap & STREAM_GAP_MASK);
+    sq->next[id] += (gap >> STREAM_GAP_SHIFT) + (frac >> STREAM_GAP_SHIFT);
+    sq->frac[id] = frac & STREAM_GAP_MASK;
+
+    /* A queue that fell too far behind drops the backlog instead of bursting it */
+    if ((int64_t)(now - sq->next[id]) > (int64_t)s->max_lag)
+        sq->next[id] = now;
+}
+
+uint16_t
+pktgen_stream_due(port_info_t *pinfo, uint16_t qid, uint64_t now)
+{
+    stream_table_t *st = pinfo->streams;
+    stream_queue_t *sq = &st->q[qid];
+    uint16_t n = 0, burst = pinfo->tx_burst;
+
+    if (unlikely(sq->gen != st->gen))
+        stream_queue_reset(pinfo, st, sq, qid, now);
+    else if (unlikely(sq->nb_ids))
+        pktgen_stream_commit(pinfo, qid, 0);
+
+    while (sq->nb_heap && n < burst) {
+        uint8_t id = sq->heap[0];
+
+        if ((int64_t)(now - sq->next[id]) < 0)
+            break;
+
+        sq->ids[n++] = id;
+        if (sq->left[id] && --sq->left[id] == 0) {
+            /* Out of the heap for this burst, given back if the packet is not sent */
+            sq->heap[0] = sq->heap[--sq->nb_heap];
+            if (sq->nb_heap == 0)
+                break;
+        } else
+            stream_advance(&st->streams[id], sq, id, now);
+
+        stream_sift_down(sq, 0);
+    }
+    sq->nb_ids = n;
+
+    return n;
+}
+
+void
+pktgen_stream_commit(port_info_t *pinfo, uint16_t qid, uint16_t nb_sent)
+{
+    stream_table_t *st = pinfo->streams;
+    stream_queue_t *sq = &st->q[qid];
+    uint16_t n         = sq->nb_ids;
+
+    if (n == 0)
+        return;
+    sq->nb_ids = 0;
+
+    /* Packets without an mbuf do not count, a stream they finished is due again */
+    for (uint16_t i = nb_sent; i < n; i++) {
+        uint8_t id = sq->ids[i];
+
+        if (st->streams[id].count == 0)
+            continue;
+        if (sq->left[id]++ == 0) {
+            sq->heap[sq->nb_heap] = id;
+            stream_sift_up(sq, sq->nb_heap++);
+        }
+    }
+
+    if (sq->nb_heap == 0)
+        stream_queue_done(pinfo, st);
+}
+
+void
+pktgen_stream_show(port_info_t *pinfo)
+{
+    stream_table_t *st = pinfo->streams;
+
+    if (st == NULL) {
+        printf("Port %d has no streams\n", pinfo->pid);
+        return;
+    }
+
+    printf("Port %d streams %s\n", pinfo->pid,
+           pktgen_tst_port_flags(pinfo, SEND_STREAM_PKTS) ? "on" : "off");
+    printf("  %3s %4s %9s %20s %9s %5s %20s\n", "ID", "On", "Rate(%)", "Count", "Model", "Size",
+           "Sent");
+    for (uint16_t i = 0; i < STREAM_MAX; i++) {
+        const stream_t *s = &st->streams[i];
+        uint64_t sent     = 0;
+
+        if (!s->enabled && s->count == 0 && s->rate == 100.0 && s->model == TX_ARRIVAL_PERIODIC)
+            continue;
+
+        for (uint16_t q = 0; q < st->nb_queues; q++)
+            sent += st->q[q].sent[i];
+
+        printf("  %3u %4s %9.4f %20" PRIu64 " %9s %5u %20" PRIu64 "\n", i,
+               s->enabled ? "yes" : "no", s->rate, s->count, model_names[s->model],
+               pinfo->seq_pkt[i].pkt_size + RTE_ETHER_CRC_LEN, sent);
+    }
+}
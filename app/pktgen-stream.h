@@ -0,0 +1,231 @@
+/*-
+ * Copyright(c) <2010-2026>, Intel Corporation. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PKTGEN_STREAM_H_
+#define _PKTGEN_STREAM_H_
+
+/**
+ * @file
+ *
+ * Independent TX streams of a port.
+ *
+ * A stream sends the sequence packet of the same index at its own rate, for its
+ * own number of packets and with its own arrival model, so one port can carry
+ * background load and a measured stream at the same time. The rate of every
+ * stream is split over the TX queues of the port like the port rate is.
+ *
+ * Each TX queue keeps the next send time of its streams in a binary heap and
+ * fills a burst with the streams whose time has come, earliest first. The TX
+ * mbufs are built from the largest stream and the frame of the scheduled
+ * stream is copied into each mbuf before it is sent.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <rte_common.h>
+#include <rte_atomic.h>
+
+#include "pktgen-constants.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STREAM_MAX       16  /**< Streams per port, one per sequence packet */
+#define STREAM_HDR_SIZE  128 /**< Bytes copied per packet when the L4 checksum is offloaded */
+#define STREAM_GAP_SHIFT 24  /**< Fraction bits of the fixed point gap between packets */
+#define STREAM_GAP_MASK  ((1ULL << STREAM_GAP_SHIFT) - 1)
+
+/** Configuration of one stream, fixed while the port sends. */
+typedef struct stream_s {
+    double rate;       /**< Percent of the link rate */
+    uint64_t count;    /**< Packets to send, 0 to send until stopped */
+    uint32_t model;    /**< TX_ARRIVAL_PERIODIC or TX_ARRIVAL_POISSON */
+    bool enabled;      /**< Stream is sent in stream mode */
+    uint16_t pkt_size; /**< Frame size not counting the FCS */
+    uint16_t copy_len; /**< Bytes of the frame copied into each mbuf */
+    uint16_t l2_len;   /**< Ethernet header size of the frame */
+    uint64_t ol_flags; /**< mbuf TX offload flags of the frame */
+    uint64_t gap;      /**< Mean cycles between packets per TX queue, STREAM_GAP_SHIFT fraction */
+    uint64_t max_lag;  /**< Cycles a TX queue may fall behind before the backlog is dropped */
+    uint8_t *data;     /**< Frame copied from the sequence packet when the port starts */
+} stream_t;
+
+/** Per-TX-queue stream schedule, written only by the lcore serving the TX queue. */
+typedef struct stream_queue_s {
+    uint64_t next[STREAM_MAX];     /**< Time the next packet of each stream is due */
+    uint32_t frac[STREAM_MAX];     /**< Fraction of a cycle carried to the next send time */
+    uint64_t left[STREAM_MAX];     /**< Packets left to send, 0 for no limit */
+    uint64_t sent[STREAM_MAX];     /**< Packets scheduled for TX per stream */
+    uint8_t heap[STREAM_MAX];      /**< Streams ordered by send time, earliest first */
+    uint8_t ids[MAX_PKT_TX_BURST]; /**< Stream of each packet of the current burst */
+    uint16_t nb_heap;              /**< Streams in the heap */
+    uint16_t nb_ids;               /**< Packets of the burst not yet committed */
+    uint32_t gen;                  /**< Stream setup the schedule belongs to */
+} stream_queue_t __rte_cache_aligned;
+
+/** Streams of a port and the schedules of its TX queues. */
+typedef struct stream_table_s {
+    stream_t streams[STREAM_MAX]; /**< Stream configurations */
+    volatile uint32_t gen;        /**< Bumped by each setup, resets the TX queue schedules */
+    rte_atomic32_t busy;          /**< TX queues with streams left to send */
+    uint16_t nb_queues;           /**< Number of TX queues of the port */
+    stream_queue_t q[];           /**< Schedule of each TX queue */
+} stream_table_t;
+
+struct port_info_s;
+
+/**
+ * Enable or disable a stream.
+ *
+ * @param pinfo
+ *   Port of the stream.
+ * @param sid
+ *   Stream and sequence packet index, 0 to STREAM_MAX - 1.
+ * @param on
+ *   true to send the stream in stream mode.
+ * @return
+ *   0 on success or -1 on error.
+ */
+int pktgen_stream_enable(struct port_info_s *pinfo, uint16_t sid, bool on);
+
+/**
+ * Set the rate of a stream.
+ *
+ * @param pinfo
+ *   Port of the stream.
+ * @param sid
+ *   Stream index.
+ * @param rate
+ *   Percent of the link rate, above 0 and up to 100.
+ * @return
+ *   0 on success or -1 on error.
+ */
+int pktgen_stream_rate(struct port_info_s *pinfo, uint16_t sid, double rate);
+
+/**
+ * Set the number of packets of a stream.
+ *
+ * @param pinfo
+ *   Port of the stream.
+ * @param sid
+ *   Stream index.
+ * @param count
+ *   Packets to send each time the port starts, 0 to send until stopped.
+ * @return
+ *   0 on success or -1 on error.
+ */
+int pktgen_stream_count(struct port_info_s *pinfo, uint16_t sid, uint64_t count);
+
+/**
+ * Set the arrival model of a stream.
+ *
+ * @param pinfo
+ *   Port of the stream.
+ * @param sid
+ *   Stream index.
+ * @param model
+ *   TX_ARRIVAL_PERIODIC for evenly spaced packets or TX_ARRIVAL_POISSON for
+ *   exponentially distributed gaps.
+ * @return
+ *   0 on success or -1 on error.
+ */
+int pktgen_stream_model(struct port_info_s *pinfo, uint16_t sid, uint32_t model);
+
+/**
+ * Copy the single packet into the sequence packet of a stream.
+ *
+ * @param pinfo
+ *   Port of the stream.
+ * @param sid
+ *   Stream index.
+ * @return
+ *   0 on success or -1 on error.
+ */
+int pktgen_stream_copy(struct port_info_s *pinfo, uint16_t sid);
+
+/**
+ * Disable all streams of a port and reset them to the defaults.
+ *
+ * @param pinfo
+ *   Port to clear.
+ * @return
+ *   0 on success or -1 on error.
+ */
+int pktgen_stream_clear(struct port_info_s *pinfo);
+
+/**
+ * Test if a port has an enabled stream.
+ *
+ * @param pinfo
+ *   Port to test.
+ * @return
+ *   true when at least one stream is enabled.
+ */
+bool pktgen_stream_ready(struct port_info_s *pinfo);
+
+/**
+ * Snapshot the stream frames and rates when the port starts.
+ *
+ * Builds the sequence packet of every enabled stream and restarts the schedules
+ * of the TX queues.
+ *
+ * @param pinfo
+ *   Port to set up.
+ * @return
+ *   Sequence packet index of the largest enabled stream, used to build the TX mbufs.
+ */
+int32_t pktgen_stream_setup(struct port_info_s *pinfo);
+
+/**
+ * Pick the streams of the next burst of a TX queue.
+ *
+ * Only called by the lcore serving the TX queue. The stream of each packet is
+ * left in the ids[] array of the queue schedule. The burst must be settled with
+ * pktgen_stream_commit() once its mbufs were obtained or not, a burst left
+ * unsettled is given back by the next call.
+ *
+ * @param pinfo
+ *   Port of the TX queue.
+ * @param qid
+ *   TX queue index.
+ * @param now
+ *   Current time from pktgen_get_time().
+ * @return
+ *   Packets due now, at most the port TX burst size.
+ */
+uint16_t pktgen_stream_due(struct port_info_s *pinfo, uint16_t qid, uint64_t now);
+
+/**
+ * Settle the burst picked by pktgen_stream_due().
+ *
+ * The first nb_sent packets count against the stream packet counts, the rest
+ * of the burst is given back to the schedule. The TX queue is done once every
+ * stream sent its count.
+ *
+ * @param pinfo
+ *   Port of the TX queue.
+ * @param qid
+ *   TX queue index.
+ * @param nb_sent
+ *   Packets of the burst that got an mbuf, 0 when the mbuf allocation failed.
+ */
+void pktgen_stream_commit(struct port_info_s *pinfo, uint16_t qid, uint16_t nb_sent);
+
+/**
+ * Print the streams of a port.
+ *
+ * @param pinfo
+ *   Port to show.
+ */
+void pktgen_stream_show(struct port_info_s *pinfo);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PKTGEN_STREAM_H_ */
@@ -65,6 +65,9 @@ pktgen_wire_size(port_info_t *pinfo)
         pcap_info_t *pcap = l2p_get_pcap(pinfo->pid);
 
         size = WIRE_SIZE(pcap->avg_pkt_size, uint64_t);
+    } else if (pktgen_imix_active(pinfo)) {
+        /* Weighted mean of the mix in bits, not rounded to whole bytes */
+        return (uint64_t)((WIRE_SIZE(pinfo->imix->avg_size, double) * 8.0) + 0.5);
     } else {
         if (unlikely(pinfo->seqCnt > 0)) {
             for (i = 0; i < pinfo->seqCnt; i++)
@@ -76,12 +79,105 @@ pktgen_wire_size(port_info_t *pinfo)
     return (size * 8);
 }
 
+/**
+ *
+ * pktgen_tx_pace_burst - Return the burst size to pace a packet rate with.
+ *
+ * DESCRIPTION
+ * The burst shrinks at low rates so bursts are at least TX_PACE_GAP_NS apart,
+ * which keeps the traffic smooth instead of sending tx_burst sized microbursts.
+ *
+ * RETURNS: Burst size between 1 and tx_burst.
+ *
+ * SEE ALSO:
+ */
+uint16_t
+pktgen_tx_pace_burst(port_info_t *pinfo, double pps)
+{
+    uint64_t burst = (uint64_t)ceil((pps * TX_PACE_GAP_NS) / 1e9);
+
+    if (burst > pinfo->tx_burst)
+        burst = pinfo->tx_burst;
+
+    return (burst == 0) ? 1 : burst;
+}
+
+/**
+ *
+ * pktgen_tx_pace_cfg - Fill in TX pacing parameters for a packet rate.
+ *
+ * DESCRIPTION
+ * Convert a packet rate per TX queue into the fixed point packet credit a TX
+ * queue earns per timer cycle. A rate of zero turns pacing off, the queue then
+ * sends burst packets every time it is polled.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+void
+pktgen_tx_pace_cfg(tx_pace_cfg_t *cfg, double pps, uint16_t burst)
+{
+    uint64_t rate;
+
+    if (pps <= 0.0) {
+        cfg->credit_rate = 0;
+        cfg->pps         = 0.0;
+        cfg->burst       = burst;
+        return;
+    }
+
+    if (burst == 0)
+        burst = 1;
+
+    rate = (uint64_t)(((pps * (double)TX_PACE_ONE) / (double)pktgen_get_timer_hz()) + 0.5);
+    if (rate == 0)
+        rate = 1;
+
+    /* Bound the time credited at once, so elapsed * rate can not overflow */
+    cfg->credit_max  = (uint64_t)burst * TX_PACE_MAX_BURSTS * TX_PACE_ONE;
+    cfg->max_cycles  = cfg->credit_max / rate + 1;
+    cfg->burst       = burst;
+    cfg->pps         = pps;
+    cfg->credit_rate = rate;
+}
+
+/**
+ *
+ * pktgen_tx_pace_set - Set the TX pacing parameters of a port.
+ *
+ * DESCRIPTION
+ * Set the packet rate per TX queue of a port, a rate of zero turns pacing off,
+ * and the rate of one percent of the link the rate profile scales from. The
+ * parameters are computed aside and written between two increments of
+ * tx_pace_gen, the TX lcores copy them again until they see an even and
+ * unchanged generation, see tx_pace_load().
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+void
+pktgen_tx_pace_set(port_info_t *pinfo, double pps, uint16_t burst, double pps_per_pcnt)
+{
+    tx_pace_cfg_t cfg = pinfo->tx_pace_cfg;
+
+    pktgen_tx_pace_cfg(&cfg, pps, (burst == 0) ? 1 : burst);
+    cfg.pps_per_pcnt = pps_per_pcnt;
+
+    pinfo->tx_pace_gen++;
+    rte_smp_wmb();
+    pinfo->tx_pace_cfg = cfg;
+    rte_smp_wmb();
+    pinfo->tx_pace_gen++;
+}
+
 /**
  *
  * pktgen_packet_rate - Calculate the transmit rate.
  *
  * DESCRIPTION
- * Calculate the number of cycles to wait between sending bursts of traffic.
+ * Calculate the packet rate of each TX queue and the burst size to pace it with.
  *
  * RETURNS: N/A
  *
@@ -90,32 +186,48 @@ pktgen_wire_size(port_info_t *pinfo)
 void
 pktgen_packet_rate(port_info_t *port)
 {
-    uint64_t link_speed, pps, cpb, txcnt;
+    double link_speed, pps, pps_per_pcnt;
+    uint64_t txcnt;
+    uint16_t burst;
 
     if (!port)
         return;
 
+    txcnt = l2p_get_txcnt(port->pid);
+    if (txcnt == 0)
+        txcnt = 1;
+
+    /* A streamed pcap file is sent by the first TX queue alone */
+    if (pktgen_tst_port_flags(port, SEND_PCAP_PKTS) && l2p_get_pcap(port->pid) &&
+        l2p_get_pcap(port->pid)->stream)
+        txcnt = 1;
+
+    // total link speed in bits per second
+    link_speed = (double)port->link.link_speed * Million;
+
+    // packets per second per thread for one percent of the link, kept in double
+    // so the rate is not truncated to whole packets per second. The rate profile
+    // scales from this value, so it is set even when tx_rate is zero.
+    pps_per_pcnt = (link_speed / (double)pktgen_wire_size(port)) / 100.0 / txcnt;
+
     // link speed in Megabits per second and tx_rate in percentage
     if (port->link.link_speed == 0 || port->tx_rate == 0) {
         port->tx_cycles = 0;
         port->tx_pps    = 0;
+        pktgen_tx_pace_set(port, 0.0, port->tx_burst, pps_per_pcnt);
         return;
     }
 
-    // total link speed in bits per second
-    link_speed = (uint64_t)port->link.link_speed * Million;
+    pps = pps_per_pcnt * port->tx_rate;
+    if (pps < 1.0)
+        pps = 1.0;
 
-    txcnt = l2p_get_txcnt(port->pid);
+    burst = pktgen_tx_pace_burst(port, pps);
 
-    // packets per second per thread based on requested (tx_rate/txcnt)
-    pps = (((link_speed / pktgen_wire_size(port)) * (port->tx_rate / txcnt)) / 100);
-    pps = ((pps > 0) ? pps : 1);
+    pktgen_tx_pace_set(port, pps, burst, pps_per_pcnt);
 
-    // Do all multiplications first to reduce rounding errors.
-    // Add pps/2 to do rounding instead of truncation.
-    cpb             = (pps / 2 + (uint64_t)txcnt * port->tx_burst * rte_get_timer_hz()) / pps;
-    port->tx_cycles = cpb;
-    port->tx_pps    = pps;
+    port->tx_cycles = (uint64_t)((((double)burst * pktgen_get_timer_hz()) / pps) + 0.5);
+    port->tx_pps    = (uint64_t)(pps + 0.5);
 }
 
 /**
@@ -156,6 +268,29 @@ pktgen_fill_pattern(uint8_t *p, uint16_t len, uint32_t type, char *user)
     }
 }
 
+/**
+ *
+ * pktgen_fill_pattern_update - Rebuild the pre-built fill pattern of a port.
+ *
+ * DESCRIPTION
+ * The fill pattern is built once per port into fill_buf and copied into the
+ * packet templates, call this routine when the pattern type or user pattern
+ * changes.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+void
+pktgen_fill_pattern_update(port_info_t *pinfo)
+{
+    if (pinfo->fill_buf == NULL)
+        return;
+
+    pktgen_fill_pattern(pinfo->fill_buf, pinfo->fill_buf_len, pinfo->fill_pattern_type,
+                        pinfo->user_pattern);
+}
+
 /**
  *
  * pktgen_find_matching_ipsrc - Find the matching IP source address
@@ -241,43 +376,172 @@ pktgen_tstamp_pointer(port_info_t *pinfo __rte_unused, char *p)
     return (tstamp_t *)(p + offset);
 }
 
+/**
+ *
+ * pktgen_tstamp_inject - Place latency probes in a TX burst.
+ *
+ * DESCRIPTION
+ * When probes are due on the TX queue, replace the last data mbufs of the burst with
+ * copies of the latency template carrying the per-queue sequence. The TX time is
+ * written by tx_send_packets() right before the burst is handed to the NIC.
+ * Each TX queue keeps its own schedule, up to probes_per_burst probes are placed in a
+ * burst to catch up at high probe rates.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
 static inline void
-pktgen_tstamp_inject(port_info_t *pinfo, uint16_t qid)
+pktgen_tstamp_inject(port_info_t *pinfo, uint16_t qid, struct rte_mbuf **pkts, uint16_t nb_pkts)
 {
-    pkt_seq_t *pkt = &pinfo->seq_pkt[LATENCY_PKT];
-    rte_mbuf_t *mbuf;
-    l2p_port_t *port;
-    uint16_t sent;
+    pkt_seq_t *pkt    = &pinfo->seq_pkt[LATENCY_PKT];
+    latency_t *lat    = &pinfo->latency;
+    tx_latency_t *txl = &pinfo->tx_latency[qid];
+    struct rte_mbuf *probes[MAX_LATENCY_PROBES];
+    uint16_t pktsize = pkt->pkt_size;
+    uint64_t now     = pktgen_get_time();
+    uint32_t sport   = 0;
+    uint64_t due;
+    uint16_t nb_probes;
+
+    /* A clear restarts the counters, the schedule and the sequence numbers go on */
+    if (unlikely(txl->gen != pinfo->lat_clear_gen)) {
+        txl->num_tx_pkts = 0;
+        txl->no_mbufs    = 0;
+        rte_smp_wmb();
+        txl->gen = pinfo->lat_clear_gen;
+    }
 
-    uint64_t curr_ts = pktgen_get_time();
-    latency_t *lat   = &pinfo->latency;
+    if (now < txl->next_cycles)
+        return;
 
-    if (curr_ts >= lat->latency_timo_cycles) {
-        lat->latency_timo_cycles = curr_ts + lat->latency_rate_cycles;
+    /* Number of probe intervals elapsed, do not build a backlog past one burst */
+    due = (lat->latency_rate_cycles) ? ((now - txl->next_cycles) / lat->latency_rate_cycles) + 1
+                                     : 1;
+    if (due > lat->probes_per_burst) {
+        due              = lat->probes_per_burst;
+        txl->next_cycles = now + lat->latency_rate_cycles;
+    } else
+        txl->next_cycles += due * lat->latency_rate_cycles;
+    nb_probes = RTE_MIN((uint16_t)due, nb_pkts);
 
-        port = l2p_get_port(pinfo->pid);
-        if (rte_mempool_get(port->sp_mp[qid], (void **)&mbuf) == 0) {
-            uint16_t pktsize = pkt->pkt_size;
-            uint16_t to_send;
+    if (rte_pktmbuf_alloc_bulk(l2p_get_sp_mp(pinfo->pid, qid), probes, nb_probes)) {
+        txl->no_mbufs += nb_probes;
+        return;
+    }
 
-            mbuf->pkt_len  = pktsize;
-            mbuf->data_len = pktsize;
+    pkts += nb_pkts - nb_probes;
+    rte_pktmbuf_free_bulk(pkts, nb_probes);
 
-            /* IPv4 Header constructor */
-            pktgen_packet_ctor(pinfo, LATENCY_PKT, -2);
+    /* Only an IPv4 UDP template has no L4 checksum, the source port can change freely */
+    if (lat->latency_entropy > 1 && pkt->ethType == RTE_ETHER_TYPE_IPV4 &&
+        pkt->ipProto == PG_IPPROTO_UDP)
+        sport = pkt->ether_hdr_size + sizeof(struct rte_ipv4_hdr) +
+                offsetof(struct rte_udp_hdr, src_port);
 
-            rte_memcpy(rte_pktmbuf_mtod(mbuf, uint8_t *), (uint8_t *)pkt->hdr, pktsize);
+    for (uint16_t i = 0; i < nb_probes; i++) {
+        struct rte_mbuf *m = probes[i];
+        char *data         = rte_pktmbuf_mtod(m, char *);
+        uint32_t seq       = txl->next_index++ & TSTAMP_SEQ_MASK;
+        tstamp_t *tstamp;
 
-            to_send = 1;
-            do {
-                sent = rte_eth_tx_burst(pinfo->pid, qid, &mbuf, to_send);
-                to_send -= sent;
-            } while (to_send > 0);
+        rte_memcpy(data, (uint8_t *)pkt->hdr, pktsize);
+        m->pkt_len  = pktsize;
+        m->data_len = pktsize;
 
-            lat->num_latency_tx_pkts++;
-        } else
-            printf("*** No more latency buffers\n");
+        if (sport)
+            *(unaligned_uint16_t *)(data + sport) =
+                htons((uint16_t)(pkt->sport + (seq % lat->latency_entropy)));
+
+        tstamp        = pktgen_tstamp_pointer(pinfo, data);
+        tstamp->index = ((uint32_t)qid << TSTAMP_QID_SHIFT) | seq;
+
+        pkts[i] = m;
+    }
+    txl->pending = nb_probes;
+    txl->num_tx_pkts += nb_probes;
+}
+
+/**
+ *
+ * pktgen_imix_apply - Give a burst of packets their IMIX sizes.
+ *
+ * DESCRIPTION
+ * Copy the header template of the next scheduled size into each packet and set
+ * its length. The mbufs already hold the fill pattern up to the largest size.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+static inline void
+pktgen_imix_apply(port_info_t *pinfo, uint16_t qid, struct rte_mbuf **pkts, uint16_t nb_pkts)
+{
+    per_queue_t *pq    = &pinfo->per_queue[qid];
+    const imix_t *imix = pq->imix;
+    uint32_t idx       = pq->imix_idx;
+
+    for (uint16_t i = 0; i < nb_pkts; i++) {
+        struct rte_mbuf *m = pkts[i];
+        uint8_t c          = imix->sched[idx];
+
+        rte_memcpy(rte_pktmbuf_mtod(m, uint8_t *), imix->hdrs[c], imix->hdr_len);
+        m->pkt_len  = imix->tx_sizes[c];
+        m->data_len = imix->tx_sizes[c];
+
+        if (unlikely(++idx == imix->sched_len))
+            idx = 0;
     }
+    pq->imix_idx = idx;
+}
+
+/**
+ *
+ * pktgen_stream_apply - Turn the mbufs of a burst into the scheduled stream packets.
+ *
+ * DESCRIPTION
+ * Copy the frame of the stream pktgen_stream_due() picked for each packet into
+ * the mbuf and set its length and offload flags. The mbufs already hold the
+ * largest stream frame.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+static inline void
+pktgen_stream_apply(port_info_t *pinfo, uint16_t qid, struct rte_mbuf **pkts, uint16_t nb_pkts)
+{
+    stream_table_t *st = pinfo->streams;
+    stream_queue_t *sq = &st->q[qid];
+
+    for (uint16_t i = 0; i < nb_pkts; i++) {
+        struct rte_mbuf *m = pkts[i];
+        uint8_t id         = sq->ids[i];
+        const stream_t *s  = &st->streams[id];
+
+        rte_memcpy(rte_pktmbuf_mtod(m, uint8_t *), s->data, s->copy_len);
+        m->pkt_len  = s->pkt_size;
+        m->data_len = s->pkt_size;
+        m->l2_len   = s->l2_len;
+        m->ol_flags = s->ol_flags;
+
+        sq->sent[id]++;
+    }
+}
+
+/* Write the TX time into the probes at the end of the burst */
+static inline void
+pktgen_tstamp_stamp(port_info_t *pinfo, uint16_t qid, struct rte_mbuf **pkts, uint16_t nb_pkts)
+{
+    tx_latency_t *txl = &pinfo->tx_latency[qid];
+    uint16_t nb       = RTE_MIN(txl->pending, nb_pkts);
+    uint64_t now;
+
+    txl->pending = 0;
+
+    now = pktgen_get_time();
+    for (uint16_t i = nb_pkts - nb; i < nb_pkts; i++)
+        pktgen_tstamp_pointer(pinfo, rte_pktmbuf_mtod(pkts[i], char *))->timestamp = now;
 }
 
 void
@@ -285,40 +549,104 @@ tx_send_packets(port_info_t *pinfo, uint16_t qid, struct rte_mbuf **pkts, uint16
 {
     if (nb_pkts) {
         uint16_t sent, to_send = nb_pkts;
-        qstats_t *qs = &pinfo->stats.qstats[qid];
+        tx_qstats_t *qs = &pinfo->stats.txq[qid];
+        uint64_t bytes  = 0;
 
-        qs->q_opackets += nb_pkts;
-        if (pktgen_tst_port_flags(pinfo, SEND_RANDOM_PKTS))
-            pktgen_rnd_bits_apply(pinfo, pkts, to_send, NULL);
+        for (uint16_t i = 0; i < nb_pkts; i++)
+            bytes += rte_pktmbuf_pkt_len(pkts[i]);
+
+        if (unlikely(pinfo->tx_latency[qid].pending))
+            pktgen_tstamp_stamp(pinfo, qid, pkts, nb_pkts);
 
         do {
             sent = rte_eth_tx_burst(pinfo->pid, qid, pkts, to_send);
             to_send -= sent;
             pkts += sent;
+
+            /* Do not spin forever on a full TX ring once the port was stopped */
+            if (unlikely(sent == 0 && !pktgen_tst_port_flags(pinfo, SENDING_PACKETS))) {
+                for (uint16_t i = 0; i < to_send; i++)
+                    bytes -= rte_pktmbuf_pkt_len(pkts[i]);
+                rte_pktmbuf_free_bulk(pkts, to_send);
+                qs->q_tx_drops += to_send;
+                break;
+            }
         } while (to_send > 0);
 
-        if (qid == 0 && pktgen_tst_port_flags(pinfo, SEND_LATENCY_PKTS))
-            pktgen_tstamp_inject(pinfo, qid);
+        qs->q_opackets += (nb_pkts - to_send);
+        qs->q_obytes += bytes;
     }
 }
 
-/* Inserts a new value into the ring of latencies */
-static inline void
-latency_ring_insert(latency_ring_t *ring, uint64_t value)
+/**
+ *
+ * pktgen_probe_gap - Mark a latency probe in the window of its TX queue.
+ *
+ * DESCRIPTION
+ * With entropy the probes of a TX queue reach several RX queues, which share
+ * the window. Each probe marks its sequence number and checks the probe sent
+ * PROBE_WIN_LAG probes before it, which had time to arrive on any RX queue by
+ * then. The check starts PROBE_WIN_LAG probes after the first probe received.
+ *
+ * RETURNS: true when the older probe was never received.
+ *
+ * SEE ALSO:
+ */
+static inline bool
+pktgen_probe_gap(rx_probe_win_t *win, uint32_t seq)
 {
-    ring->data[ring->head] = value;
-    ring->head             = (ring->head + 1) % RING_SIZE;
-    if (ring->count < RING_SIZE)
-        ring->count++;
+    uint32_t first = win->first;
+    uint32_t old;
+    uint64_t bit, prev;
+
+    if (unlikely(first == 0)) {
+        rte_atomic32_cmpset(&win->first, 0, seq + 1);
+        first = win->first;
+    }
+    __atomic_fetch_or(&win->bits[(seq % PROBE_WIN_SIZE) / 64], 1ULL << (seq % 64),
+                      __ATOMIC_RELAXED);
+
+    if (((seq - (first - 1)) & TSTAMP_SEQ_MASK) < PROBE_WIN_LAG)
+        return false;
+
+    old  = (seq - PROBE_WIN_LAG) & TSTAMP_SEQ_MASK;
+    bit  = 1ULL << (old % 64);
+    prev = __atomic_fetch_and(&win->bits[(old % PROBE_WIN_SIZE) / 64], ~bit, __ATOMIC_RELAXED);
+
+    return (prev & bit) == 0;
 }
 
 static inline void
-pktgen_tstamp_check(port_info_t *pinfo, struct rte_mbuf **pkts, uint16_t nb_pkts)
+pktgen_tstamp_check(port_info_t *pinfo, uint16_t qid, struct rte_mbuf **pkts, uint16_t nb_pkts)
 {
-    int lid = rte_lcore_id();
-    int qid = l2p_get_rxqid(lid);
-    uint64_t cycles, jitter;
-    latency_t *lat = &pinfo->latency;
+    uint64_t cycles, jitter, rx_time;
+    uint64_t jitter_threshold  = pinfo->latency.jitter_threshold_cycles;
+    rx_latency_t *lat          = &pinfo->rx_latency[qid];
+    const hw_tstamp_t *hw      = &pinfo->hw_tstamp;
+    const hw_tstamp_cal_t *cal = NULL;
+    cap_ring_t *cr             = pinfo->cap_ring;
+    uint64_t trig_cycles       = UINT64_MAX;
+    bool trig_gap              = false;
+    bool gaps                  = pinfo->latency.latency_entropy <= 1;
+
+    /* Restart the counters of the queue after a clear */
+    if (unlikely(lat->gen != pinfo->lat_clear_gen)) {
+        uint32_t gen = pinfo->lat_clear_gen;
+
+        memset(lat, 0, sizeof(*lat));
+        rte_smp_wmb();
+        lat->gen = gen;
+    }
+
+    /* Triggers of a flight recorder capturing on this port */
+    if (unlikely(cr != NULL)) {
+        if (cr->triggers & CAP_TRIG_LATENCY)
+            trig_cycles = cr->lat_cycles;
+        trig_gap = (cr->triggers & CAP_TRIG_SEQ_GAP) != 0;
+    }
+
+    if (pinfo->latency.hw_tstamp)
+        cal = pktgen_rx_cal(hw);
 
     for (int i = 0; i < nb_pkts; i++) {
         tstamp_t *tstamp = pktgen_tstamp_pointer(pinfo, rte_pktmbuf_mtod(pkts[i], char *));
@@ -326,20 +654,41 @@ pktgen_tstamp_check(port_info_t *pinfo, struct rte_mbuf **pkts, uint16_t nb_pkts
         if (tstamp->magic != TSTAMP_MAGIC)
             continue;
 
-        cycles        = (pktgen_get_time() - tstamp->timestamp);
+        rx_time       = pktgen_rx_time(hw, cal, pkts[i]);
+        cycles        = (rx_time > tstamp->timestamp) ? rx_time - tstamp->timestamp : 0;
         tstamp->magic = 0UL; /* clear timestamp magic cookie */
 
-        if (tstamp->index != lat->expect_index) {
-            lat->expect_index = tstamp->index + 1;
+        /*
+         * Count sequence gaps per sending TX queue, the latency sample is still valid.
+         * The first probe of a TX queue only sets where its sequence starts. With
+         * entropy RSS spreads the probes of a TX queue over the RX queues, the gaps
+         * are then looked for in a window shared by the RX queues.
+         */
+        uint32_t txq = tstamp->index >> TSTAMP_QID_SHIFT;
+        uint32_t seq = tstamp->index & TSTAMP_SEQ_MASK;
+        bool gap;
+
+        if (txq >= MAX_QUEUES_PER_PORT)
+            continue;
+        if (gaps) {
+            gap = (lat->seen_txq & (1U << txq)) && seq != lat->expect_index[txq];
+            lat->seen_txq |= 1U << txq;
+            lat->expect_index[txq] = (seq + 1) & TSTAMP_SEQ_MASK;
+        } else
+            gap = pktgen_probe_gap(&pinfo->probe_win[txq], seq);
+        if (gap) {
             lat->num_skipped++;
-            continue; /* Skip this latency packet */
+            if (unlikely(trig_gap))
+                pktgen_capture_trigger(pinfo, CAP_TRIG_SEQ_GAP);
         }
-        lat->expect_index++;
+
+        if (unlikely(cycles > trig_cycles))
+            pktgen_capture_trigger(pinfo, CAP_TRIG_LATENCY);
 
         lat->num_latency_pkts++;
         lat->running_cycles += cycles;
 
-        latency_ring_insert(&lat->tail_latencies, cycles);
+        lat_hist_record(&lat->hist, cycles);
 
         if (lat->min_cycles == 0 || cycles < lat->min_cycles)
             lat->min_cycles = cycles;
@@ -348,7 +697,7 @@ pktgen_tstamp_check(port_info_t *pinfo, struct rte_mbuf **pkts, uint16_t nb_pkts
 
         jitter = (cycles > lat->prev_cycles) ? cycles - lat->prev_cycles
                                              : lat->prev_cycles - cycles;
-        if (jitter > lat->jitter_threshold_cycles)
+        if (jitter > jitter_threshold)
             lat->jitter_count++;
 
         lat->prev_cycles = cycles;
@@ -357,21 +706,25 @@ pktgen_tstamp_check(port_info_t *pinfo, struct rte_mbuf **pkts, uint16_t nb_pkts
             /* Record latency if it's time for sampling (seperately per queue) */
             latsamp_stats_t *stats = &pinfo->latsamp_stats[qid];
             uint64_t now           = pktgen_get_time();
-            uint64_t hz            = rte_get_tsc_hz();
+            uint64_t hz            = pktgen_get_timer_hz();
 
             if (stats->next == 0 || now >= stats->next) {
-                if (stats->idx < stats->num_samples) {
-                    stats->data[stats->idx] = (cycles * Billion) / hz;
-                    stats->idx++;
+                if (stats->count < stats->num_samples) {
+                    uint64_t ns = (uint64_t)(((double)cycles * (double)Billion) / (double)hz);
+
+                    /* The writer thread drains the ring, count a drop rather than stall RX */
+                    if (rte_ring_sp_enqueue_elem(stats->ring, &ns, sizeof(ns)) == 0)
+                        stats->count++;
+                    else
+                        stats->dropped++;
                 }
 
                 /* Calculate next sampling point */
-                if (pinfo->latsamp_type == LATSAMPLER_POISSON) {
-                    double next_possion_time_ns = next_poisson_time(pinfo->latsamp_rate);
-
-                    stats->next = (now + next_possion_time_ns) * (double)hz;
-                } else        // LATSAMPLER_SIMPLE or LATSAMPLER_UNSPEC
-                    stats->next = (now + hz) / pinfo->latsamp_rate;
+                if (pinfo->latsamp_type == LATSAMPLER_POISSON)
+                    stats->next = now + (uint64_t)(next_poisson_time(pinfo->latsamp_rate) *
+                                                   (double)hz);
+                else        // LATSAMPLER_SIMPLE or LATSAMPLER_UNSPEC
+                    stats->next = now + hz / pinfo->latsamp_rate;
             }
         }
     }
@@ -425,33 +778,31 @@ void
 pktgen_packet_ctor(port_info_t *pinfo, int32_t seq_idx, int32_t type)
 {
     pkt_seq_t *pkt            = &pinfo->seq_pkt[seq_idx];
-    uint16_t sport_entropy    = 0;
     struct rte_ether_hdr *eth = (struct rte_ether_hdr *)&pkt->hdr->eth;
     char *l3_hdr              = (char *)&eth[1]; /* Pointer to l3 hdr location for GRE header */
     uint16_t pktsz            = (pktgen.flags & JUMBO_PKTS_FLAG) ? RTE_ETHER_MAX_JUMBO_FRAME_LEN
                                                                  : RTE_ETHER_MAX_LEN;
-    struct rte_eth_dev_info dev_info = {0};
-    int ret;
+    tx_offload_t *ol          = &pinfo->tx_ol;
+    uint16_t len              = pkt->pkt_size;
 
-    ret = rte_eth_dev_info_get(pinfo->pid, &dev_info);
-    if (ret < 0)
-        printf("Error during getting device (port %u) info: %s\n", pinfo->pid, strerror(-ret));
+    /* Range packets are resized on the fly, keep the fill pattern up to the largest size */
+    if (seq_idx == RANGE_PKT)
+        len = RTE_MAX(len, pinfo->range.pkt_size_max);
+    len = RTE_MIN(len, pktsz);
 
-    /* Fill in the pattern for data space. */
-    pktgen_fill_pattern((uint8_t *)pkt->hdr, pktsz, pinfo->fill_pattern_type, pinfo->user_pattern);
+    /* Copy only the part of the pre-built fill pattern the packet uses. */
+    if (pinfo->fill_pattern_type != NO_FILL_PATTERN && pinfo->fill_buf)
+        rte_memcpy((uint8_t *)pkt->hdr, pinfo->fill_buf, len);
 
     if (seq_idx == LATENCY_PKT) {
-        latency_t *lat = &pinfo->latency;
         tstamp_t *tstamp;
 
+        /* Index and timestamp are filled per probe by pktgen_tstamp_inject() */
         tstamp = pktgen_tstamp_pointer(pinfo, (char *)pkt->hdr);
 
         tstamp->magic     = TSTAMP_MAGIC;
-        tstamp->timestamp = pktgen_get_time();
-        tstamp->index     = lat->next_index++;
-
-        if (lat->latency_entropy)
-            sport_entropy = (uint16_t)(pkt->sport + (tstamp->index % lat->latency_entropy));
+        tstamp->timestamp = 0;
+        tstamp->index     = 0;
     }
 
     /*
@@ -478,11 +829,10 @@ pktgen_packet_ctor(port_info_t *pinfo, int32_t seq_idx, int32_t type)
     else
         l3_hdr = pktgen_ether_hdr_ctor(pinfo, pkt);
 
-    uint64_t offload_capa = dev_info.tx_offload_capa;
     if (likely(pkt->ethType == RTE_ETHER_TYPE_IPV4)) {
-        bool ipv4_cksum_offload = offload_capa & RTE_ETH_TX_OFFLOAD_IPV4_CKSUM;
+        bool ipv4_cksum_offload = ol->ipv4_cksum;
         if (likely(pkt->ipProto == PG_IPPROTO_TCP)) {
-            bool tcp_cksum_offload = offload_capa & RTE_ETH_TX_OFFLOAD_TCP_CKSUM;
+            bool tcp_cksum_offload = ol->tcp_cksum;
             if (pkt->dport != PG_IPPROTO_L4_GTPU_PORT) {
                 /* Construct the TCP header */
                 pktgen_tcp_hdr_ctor(pkt, l3_hdr, RTE_ETHER_TYPE_IPV4, tcp_cksum_offload,
@@ -498,18 +848,12 @@ pktgen_packet_ctor(port_info_t *pinfo, int32_t seq_idx, int32_t type)
                 /* Construct the TCP header */
                 pktgen_tcp_hdr_ctor(pkt, l3_hdr, RTE_ETHER_TYPE_IPV4, tcp_cksum_offload,
                                     pinfo->cksum_requires_phdr);
-                if (sport_entropy != 0) {
-                    struct rte_ipv4_hdr *ipv4 = (struct rte_ipv4_hdr *)l3_hdr;
-                    struct rte_tcp_hdr *tcp   = (struct rte_tcp_hdr *)&ipv4[1];
-
-                    tcp->src_port = htons(sport_entropy & 0xFFFF);
-                }
 
                 /* IPv4 Header constructor */
                 pktgen_ipv4_ctor(pkt, l3_hdr, ipv4_cksum_offload);
             }
         } else if (pkt->ipProto == PG_IPPROTO_UDP) {
-            bool udp_cksum_offload = offload_capa & RTE_ETH_TX_OFFLOAD_UDP_CKSUM;
+            bool udp_cksum_offload = ol->udp_cksum;
             if (pktgen_tst_port_flags(pinfo, SEND_VXLAN_PACKETS)) {
                 /* Construct the UDP header */
                 pkt->dport = VXLAN_PORT_ID;
@@ -533,12 +877,6 @@ pktgen_packet_ctor(port_info_t *pinfo, int32_t seq_idx, int32_t type)
                 /* Construct the UDP header */
                 pktgen_udp_hdr_ctor(pkt, l3_hdr, RTE_ETHER_TYPE_IPV4, udp_cksum_offload,
                                     pinfo->cksum_requires_phdr);
-                if (sport_entropy != 0) {
-                    struct rte_ipv4_hdr *ipv4 = (struct rte_ipv4_hdr *)l3_hdr;
-                    struct rte_udp_hdr *udp   = (struct rte_udp_hdr *)&ipv4[1];
-
-                    udp->src_port = htons(sport_entropy & 0xFFFF);
-                }
 
                 /* IPv4 Header constructor */
                 pktgen_ipv4_ctor(pkt, l3_hdr, ipv4_cksum_offload);
@@ -592,30 +930,18 @@ pktgen_packet_ctor(port_info_t *pinfo, int32_t seq_idx, int32_t type)
         }
     } else if (pkt->ethType == RTE_ETHER_TYPE_IPV6) {
         if (pkt->ipProto == PG_IPPROTO_TCP) {
-            bool tcp_cksum_offload = offload_capa & RTE_ETH_TX_OFFLOAD_TCP_CKSUM;
+            bool tcp_cksum_offload = ol->tcp_cksum;
             /* Construct the TCP header */
             pktgen_tcp_hdr_ctor(pkt, l3_hdr, RTE_ETHER_TYPE_IPV6, tcp_cksum_offload,
                                 pinfo->cksum_requires_phdr);
-            if (sport_entropy != 0) {
-                struct rte_ipv6_hdr *ipv6 = (struct rte_ipv6_hdr *)l3_hdr;
-                struct rte_tcp_hdr *tcp   = (struct rte_tcp_hdr *)&ipv6[1];
-
-                tcp->src_port = htons(sport_entropy & 0xFFFF);
-            }
 
             /* IPv6 Header constructor */
             pktgen_ipv6_ctor(pkt, l3_hdr);
         } else if (pkt->ipProto == PG_IPPROTO_UDP) {
-            bool udp_cksum_offload = offload_capa & RTE_ETH_TX_OFFLOAD_UDP_CKSUM;
+            bool udp_cksum_offload = ol->udp_cksum;
             /* Construct the UDP header */
             pktgen_udp_hdr_ctor(pkt, l3_hdr, RTE_ETHER_TYPE_IPV6, udp_cksum_offload,
                                 pinfo->cksum_requires_phdr);
-            if (sport_entropy != 0) {
-                struct rte_ipv6_hdr *ipv6 = (struct rte_ipv6_hdr *)l3_hdr;
-                struct rte_udp_hdr *udp   = (struct rte_udp_hdr *)&ipv6[1];
-
-                udp->src_port = htons(sport_entropy & 0xFFFF);
-            }
 
             /* IPv6 Header constructor */
             pktgen_ipv6_ctor(pkt, l3_hdr);
@@ -789,52 +1115,25 @@ pktgen_send_special(port_info_t *pinfo)
     pktgen_clr_port_flags(pinfo, SEND_ARP_PING_REQUESTS);
 }
 
-struct pkt_setup_s {
-    int32_t seq_idx;
-    port_info_t *pinfo;
-};
-
-static inline void
-mempool_setup_cb(struct rte_mempool *mp __rte_unused, void *opaque, void *obj,
-                 unsigned obj_idx __rte_unused)
+/**
+ *
+ * pktgen_tx_ol_flags - Set the TX offload flags of a packet template.
+ *
+ * DESCRIPTION
+ * Request the checksums the port offloads for the protocols of the template.
+ *
+ * RETURNS: The mbuf ol_flags of the template.
+ *
+ * SEE ALSO:
+ */
+uint64_t
+pktgen_tx_ol_flags(port_info_t *pinfo, pkt_seq_t *pkt)
 {
-    struct rte_mbuf *m               = (struct rte_mbuf *)obj;
-    struct pkt_setup_s *s            = (struct pkt_setup_s *)opaque;
-    struct rte_eth_dev_info dev_info = {0};
-    port_info_t *pinfo               = s->pinfo;
-    int32_t idx, seq_idx = s->seq_idx;
-    pkt_seq_t *pkt;
-    int ret;
-
-    ret = rte_eth_dev_info_get(pinfo->pid, &dev_info);
-    if (ret != 0)
-        printf("Error during getting device (port %u) info: %s\n", pinfo->pid, strerror(-ret));
-
-    idx = seq_idx;
-    if (pktgen_tst_port_flags(pinfo, SEND_SEQ_PKTS)) {
-        idx = pinfo->seqIdx;
-
-        /* move to the next packet in the sequence. */
-        if (unlikely(++pinfo->seqIdx >= pinfo->seqCnt))
-            pinfo->seqIdx = 0;
-    }
-    pkt = &pinfo->seq_pkt[idx];
-
-    if (idx == RANGE_PKT)
-        pktgen_range_ctor(&pinfo->range, pkt);
-
-    pktgen_packet_ctor(pinfo, idx, -1);
-
-    rte_memcpy(rte_pktmbuf_mtod(m, uint8_t *), (uint8_t *)pkt->hdr, pkt->pkt_size);
-
-    m->pkt_len  = pkt->pkt_size;
-    m->data_len = pkt->pkt_size;
-    m->l2_len   = pkt->ether_hdr_size;
-    m->l3_len   = sizeof(struct rte_ipv4_hdr);
+    tx_offload_t *ol = &pinfo->tx_ol;
 
     switch (pkt->ethType) {
     case RTE_ETHER_TYPE_IPV4:
-        if (dev_info.tx_offload_capa & RTE_ETH_TX_OFFLOAD_IPV4_CKSUM)
+        if (ol->ipv4_cksum)
             pkt->ol_flags = RTE_MBUF_F_TX_IP_CKSUM | RTE_MBUF_F_TX_IPV4;
         break;
 
@@ -843,7 +1142,7 @@ mempool_setup_cb(struct rte_mempool *mp __rte_unused, void *opaque, void *obj,
         break;
 
     case RTE_ETHER_TYPE_VLAN:
-        if (dev_info.tx_offload_capa & RTE_ETH_TX_OFFLOAD_VLAN_INSERT) {
+        if (ol->offloads & RTE_ETH_TX_OFFLOAD_VLAN_INSERT) {
             /* TODO */
         }
         break;
@@ -853,17 +1152,61 @@ mempool_setup_cb(struct rte_mempool *mp __rte_unused, void *opaque, void *obj,
 
     switch (pkt->ipProto) {
     case PG_IPPROTO_UDP:
-        if (dev_info.tx_offload_capa & RTE_ETH_TX_OFFLOAD_UDP_CKSUM)
+        if (ol->udp_cksum)
             pkt->ol_flags |= RTE_MBUF_F_TX_UDP_CKSUM;
         break;
     case PG_IPPROTO_TCP:
-        if (dev_info.tx_offload_capa & RTE_ETH_TX_OFFLOAD_TCP_CKSUM)
+        if (ol->tcp_cksum)
             pkt->ol_flags |= RTE_MBUF_F_TX_TCP_CKSUM;
         break;
     default:
         break;
     }
-    m->ol_flags = pkt->ol_flags;
+    return pkt->ol_flags;
+}
+
+struct pkt_setup_s {
+    int32_t seq_idx;
+    port_info_t *pinfo;
+    bool rebuild; /* Construct the packet for every mbuf, e.g. random source IP or port */
+};
+
+static inline void
+mempool_setup_cb(struct rte_mempool *mp __rte_unused, void *opaque, void *obj,
+                 unsigned obj_idx __rte_unused)
+{
+    struct rte_mbuf *m    = (struct rte_mbuf *)obj;
+    struct pkt_setup_s *s = (struct pkt_setup_s *)opaque;
+    port_info_t *pinfo    = s->pinfo;
+    int32_t idx, seq_idx = s->seq_idx;
+    pkt_seq_t *pkt;
+    uint16_t len;
+
+    idx = seq_idx;
+    if (pktgen_tst_port_flags(pinfo, SEND_SEQ_PKTS)) {
+        idx = pinfo->seqIdx;
+
+        /* move to the next packet in the sequence. */
+        if (unlikely(++pinfo->seqIdx >= pinfo->seqCnt))
+            pinfo->seqIdx = 0;
+    }
+    pkt = &pinfo->seq_pkt[idx];
+    len = pkt->pkt_size;
+
+    if (s->rebuild)
+        pktgen_packet_ctor(pinfo, idx, -1);
+
+    /* Range packets are resized on the fly, keep the fill pattern up to the largest size */
+    if (idx == RANGE_PKT)
+        len = RTE_MAX(len, pinfo->range.pkt_size_max);
+
+    rte_memcpy(rte_pktmbuf_mtod(m, uint8_t *), (uint8_t *)pkt->hdr, len);
+
+    m->pkt_len  = pkt->pkt_size;
+    m->data_len = pkt->pkt_size;
+    m->l2_len   = pkt->ether_hdr_size;
+    m->l3_len   = sizeof(struct rte_ipv4_hdr);
+    m->ol_flags = pktgen_tx_ol_flags(pinfo, pkt);
 }
 
 /**
@@ -887,30 +1230,166 @@ pktgen_setup_packets(uint16_t pid)
         rte_exit(EXIT_FAILURE, "Invalid l2p port for %d\n", pid);
 
     if (pktgen_tst_port_flags(pinfo, SETUP_TRANSMIT_PKTS)) {
+        bool imix = pktgen_imix_active(pinfo);
+
         pktgen_clr_port_flags(pinfo, SETUP_TRANSMIT_PKTS);
 
+        for (uint16_t q = 0; q < l2p_get_txcnt(pid); q++)
+            pinfo->per_queue[q].imix = imix ? pinfo->imix : NULL;
+
         if (!pktgen_tst_port_flags(pinfo, SEND_PCAP_PKTS)) {
             struct pkt_setup_s s;
-            int32_t idx = SINGLE_PKT;
+            range_min_t range_min = {0};
+            int32_t idx           = SINGLE_PKT;
+            uint16_t pkt_size     = 0;
 
             if (pktgen_tst_port_flags(pinfo, SEND_RANGE_PKTS)) {
                 idx = RANGE_PKT;
             } else if (pktgen_tst_port_flags(pinfo, SEND_SEQ_PKTS))
                 idx = FIRST_SEQ_PKT;
+            else if (pktgen_tst_port_flags(pinfo, SEND_STREAM_PKTS))
+                idx = pktgen_stream_setup(pinfo); /* mbufs hold the largest stream */
             else if (pktgen_tst_port_flags(pinfo, (SEND_SINGLE_PKTS | SEND_RANDOM_PKTS)))
                 idx = SINGLE_PKT;
 
             s.pinfo   = pinfo;
             s.seq_idx = idx;
 
+            /* Randomized source IP or port needs a new packet per mbuf, see pktgen_packet_ctor */
+            s.rebuild = (idx == SINGLE_PKT && !pktgen_tst_port_flags(pinfo, PROCESS_INPUT_PKTS) &&
+                         pktgen_tst_port_flags(pinfo, RANDOMIZE_SRC_IP | RANDOMIZE_SRC_PT));
+
+            /* IMIX headers are copied in per packet, which would undo a per-mbuf rebuild */
+            if (imix) {
+                s.rebuild = false;
+                pkt_size  = pktgen_imix_setup(pinfo);
+            }
+
+            /* Load the first range values, the rest are patched in per burst */
+            if (idx == RANGE_PKT)
+                pktgen_range_ctor(&pinfo->range, &pinfo->seq_pkt[RANGE_PKT], &range_min);
+
+            /* Build the templates once, the mempool callback only copies them */
+            if (!s.rebuild && !imix) {
+                if (idx == FIRST_SEQ_PKT) {
+                    for (uint16_t i = 0; i < RTE_MAX(pinfo->seqCnt, 1); i++)
+                        pktgen_packet_ctor(pinfo, i, -1);
+                } else
+                    pktgen_packet_ctor(pinfo, idx, -1);
+            }
+
             for (uint16_t q = 0; q < l2p_get_txcnt(pid); q++) {
                 struct rte_mempool *tx_mp = l2p_get_tx_mp(pid, q);
                 if (unlikely(tx_mp == NULL))
                     rte_exit(EXIT_FAILURE, "Invalid TX mempool for port %d qid %u\n", pid, q);
                 rte_mempool_obj_iter(tx_mp, mempool_setup_cb, &s);
+
+                /* Queue q starts q values into the sequence and steps over the others */
+                if (idx == RANGE_PKT)
+                    pktgen_range_queue_setup(pinfo, q, &range_min);
             }
+
+            if (imix)
+                pktgen_imix_restore(pinfo, pkt_size);
+        } else if (pktgen_tst_port_flags(pinfo, SEND_PCAP_TIMED) && l2p_get_pcap(pid))
+            pktgen_pcap_replay_setup(l2p_get_pcap(pid));
+    }
+}
+
+/* Copy the port pacing parameters of a single pktgen_tx_pace_set() call */
+static __rte_noinline void
+tx_pace_load(port_info_t *pinfo, tx_pace_t *pace)
+{
+    uint32_t gen;
+
+    do {
+        gen = pinfo->tx_pace_gen;
+        rte_smp_rmb();
+        pace->port_cfg = pinfo->tx_pace_cfg;
+        rte_smp_rmb();
+    } while ((gen & 1) || gen != pinfo->tx_pace_gen);
+
+    pace->port_gen = gen;
+}
+
+/**
+ *
+ * pktgen_tx_pace - Return the number of packets a TX queue may send now.
+ *
+ * DESCRIPTION
+ * Add the packet credit earned since the last call and take one paced burst
+ * from it when there is enough. The fraction of a packet earned is kept, so the
+ * achieved rate does not drift from the requested one. When the port follows a
+ * rate profile the queue uses the pacing parameters of the profile instead.
+ * With a stochastic arrival model the queue sends the bursts drawn by
+ * tx_arrival_next() in pieces of at most tx_burst packets. In stream mode the
+ * stream schedule of the queue decides instead, and a timed pcap replay follows
+ * the capture times of the file.
+ *
+ * RETURNS: Packets to send, 0 when the queue has to wait.
+ *
+ * SEE ALSO:
+ */
+static inline uint16_t
+pktgen_tx_pace(port_info_t *pinfo, uint16_t qid, uint64_t now)
+{
+    tx_pace_t *pace          = &pinfo->tx_pace[qid];
+    const tx_pace_cfg_t *cfg = &pace->port_cfg;
+    uint64_t elapsed, credit, need;
+
+    if (unlikely(pace->port_gen != pinfo->tx_pace_gen))
+        tx_pace_load(pinfo, pace);
+
+    if (unlikely(pktgen_tst_port_flags(pinfo, SEND_STREAM_PKTS))) {
+        if (!pktgen_tst_port_flags(pinfo, SENDING_PACKETS))
+            return pinfo->tx_burst;
+        return pktgen_stream_due(pinfo, qid, now);
+    }
+
+    if (unlikely(pktgen_tst_port_flags(pinfo, SEND_PCAP_TIMED) &&
+                 pktgen_tst_port_flags(pinfo, SEND_PCAP_PKTS)))
+        return pinfo->tx_burst;
+
+    if (unlikely(pktgen_tst_port_flags(pinfo, TX_RATE_PROFILE))) {
+        if (now >= pace->next_eval || pace->gen != pinfo->rate_gen)
+            rate_profile_eval(pinfo, qid, now);
+        cfg = &pace->cfg;
+    }
+
+    if (unlikely(cfg->credit_rate == 0))
+        return cfg->burst;
+
+    if (unlikely(pinfo->tx_arrival.mode != TX_ARRIVAL_PERIODIC)) {
+        uint32_t n;
+
+        if (pace->pending == 0) {
+            if (likely(pace->arrival_gen == pinfo->tx_arrival.gen) &&
+                (int64_t)(now - pace->next) < 0)
+                return 0;
+            tx_arrival_next(pinfo, cfg, pace, now);
         }
+        n = RTE_MIN(pace->pending, (uint32_t)pinfo->tx_burst);
+        pace->pending -= n;
+        return n;
     }
+
+    elapsed    = now - pace->last;
+    pace->last = now;
+    if (elapsed > cfg->max_cycles)
+        elapsed = cfg->max_cycles;
+
+    credit = pace->credit + elapsed * cfg->credit_rate;
+    if (credit > cfg->credit_max)
+        credit = cfg->credit_max;
+
+    need = (uint64_t)cfg->burst << TX_PACE_SHIFT;
+    if (credit < need) {
+        pace->credit = credit;
+        return 0;
+    }
+    pace->credit = credit - need;
+
+    return cfg->burst;
 }
 
 /**
@@ -925,24 +1404,153 @@ pktgen_setup_packets(uint16_t pid)
  * SEE ALSO:
  */
 void
-pktgen_send_pkts(port_info_t *pinfo, uint16_t qid, struct rte_mempool *mp)
+pktgen_send_pkts(port_info_t *pinfo, uint16_t qid, struct rte_mempool *mp, uint16_t nb_pkts)
 {
     uint64_t txCnt;
     struct rte_mbuf **pkts = pinfo->per_queue[qid].tx_pkts;
 
     if (!pktgen_tst_port_flags(pinfo, SEND_FOREVER)) {
-        txCnt = pkt_atomic64_tx_count(&pinfo->current_tx_count, pinfo->tx_burst);
+        txCnt = pkt_atomic64_tx_count(&pinfo->current_tx_count, nb_pkts);
         if (txCnt == 0) {
+            if (pktgen_tst_port_flags(pinfo, SEND_STREAM_PKTS))
+                pktgen_stream_commit(pinfo, qid, 0);
             pktgen_clr_port_flags(pinfo, SENDING_PACKETS);
             return;
         }
-        if (txCnt > pinfo->tx_burst)
-            txCnt = pinfo->tx_burst;
+        if (txCnt > nb_pkts)
+            txCnt = nb_pkts;
     } else
-        txCnt = pinfo->tx_burst;
+        txCnt = nb_pkts;
+
+    if (rte_mempool_get_bulk(mp, (void **)pkts, txCnt) == 0) {
+        if (pktgen_tst_port_flags(pinfo, SEND_RANGE_PKTS))
+            pktgen_range_rewrite_bulk(pinfo, qid, pkts, txCnt);
+        else if (pinfo->per_queue[qid].imix && pktgen_tst_port_flags(pinfo, SEND_IMIX_PKTS))
+            pktgen_imix_apply(pinfo, qid, pkts, txCnt);
+        else if (pktgen_tst_port_flags(pinfo, SEND_STREAM_PKTS)) {
+            pktgen_stream_apply(pinfo, qid, pkts, txCnt);
+            pktgen_stream_commit(pinfo, qid, txCnt);
+        }
+
+        if (pktgen_tst_port_flags(pinfo, SEND_RANDOM_PKTS))
+            pktgen_rnd_bits_apply(pinfo, pkts, txCnt, NULL);
+
+        /* Probes replace data packets after the data packets were modified */
+        if (pktgen_tst_port_flags(pinfo, SEND_LATENCY_PKTS))
+            pktgen_tstamp_inject(pinfo, qid, pkts, txCnt);
+
+        /* Sign the data packets, the probes at the end of the burst are left alone */
+        if (pktgen_tst_port_flags(pinfo, SIGNATURE_PKTS))
+            pktgen_sig_tx_bulk(pinfo, qid, pkts, txCnt - pinfo->tx_latency[qid].pending);
 
-    if (rte_mempool_get_bulk(mp, (void **)pkts, txCnt) == 0)
         tx_send_packets(pinfo, qid, pkts, txCnt);
+    } else {
+        if (pktgen_tst_port_flags(pinfo, SEND_STREAM_PKTS))
+            pktgen_stream_commit(pinfo, qid, 0);
+        pinfo->stats.txq[qid].q_no_txmbufs++;
+    }
+}
+
+/**
+ *
+ * pktgen_pcap_replay - Send the pcap records whose capture time has come.
+ *
+ * DESCRIPTION
+ * Only the first TX queue replays the file, so the records leave in file order.
+ * The mbufs of the pcap mempool are sent again on each pass: a reference is
+ * taken for the driver, which drops it once the packet is sent, so the records
+ * are never modified and random bits and latency probes are not applied. Ports
+ * with a loaded pcap file are set up without MBUF_FAST_FREE for that reason.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+static inline void
+pktgen_pcap_replay(port_info_t *pinfo, uint16_t qid, uint16_t nb_pkts)
+{
+    struct rte_mbuf **pkts = pinfo->per_queue[qid].tx_pkts;
+    pcap_info_t *pcap      = l2p_get_pcap(pinfo->pid);
+    uint64_t txCnt;
+    uint16_t n;
+
+    if (qid != 0 || pcap == NULL)
+        return;
+
+    txCnt = nb_pkts;
+    if (!pktgen_tst_port_flags(pinfo, SEND_FOREVER)) {
+        txCnt = rte_atomic64_read(&pinfo->current_tx_count);
+        if (txCnt == 0) {
+            pktgen_clr_port_flags(pinfo, SENDING_PACKETS);
+            return;
+        }
+        if (txCnt > nb_pkts)
+            txCnt = nb_pkts;
+    }
+
+    n = pktgen_pcap_due(pcap, pktgen_get_time(), pkts, txCnt);
+    if (n == 0)
+        return;
+
+    if (!pktgen_tst_port_flags(pinfo, SEND_FOREVER))
+        rte_atomic64_sub(&pinfo->current_tx_count, n);
+
+    for (uint16_t i = 0; i < n; i++)
+        rte_mbuf_refcnt_update(pkts[i], 1);
+
+    tx_send_packets(pinfo, qid, pkts, n);
+}
+
+/**
+ *
+ * pktgen_pcap_stream_send - Send the records read ahead from a streamed pcap file.
+ *
+ * DESCRIPTION
+ * The reader thread hands the records to the first TX queue through a single
+ * consumer ring, so only that queue sends them and they leave in file order.
+ * A burst that finds the ring empty is counted, the reader is behind.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+static inline void
+pktgen_pcap_stream_send(port_info_t *pinfo, uint16_t qid, pcap_stream_t *st, uint16_t nb_pkts)
+{
+    struct rte_mbuf **pkts = pinfo->per_queue[qid].tx_pkts;
+    uint64_t txCnt;
+    uint16_t n;
+
+    if (qid != 0)
+        return;
+
+    txCnt = nb_pkts;
+    if (!pktgen_tst_port_flags(pinfo, SEND_FOREVER)) {
+        txCnt = rte_atomic64_read(&pinfo->current_tx_count);
+        if (txCnt == 0) {
+            pktgen_clr_port_flags(pinfo, SENDING_PACKETS);
+            return;
+        }
+        if (txCnt > nb_pkts)
+            txCnt = nb_pkts;
+    }
+
+    n = rte_ring_sc_dequeue_burst(st->ring, (void **)pkts, txCnt, NULL);
+    if (unlikely(n == 0)) {
+        st->ring_empty++;
+        return;
+    }
+
+    if (!pktgen_tst_port_flags(pinfo, SEND_FOREVER))
+        rte_atomic64_sub(&pinfo->current_tx_count, n);
+
+    if (pktgen_tst_port_flags(pinfo, SEND_RANDOM_PKTS))
+        pktgen_rnd_bits_apply(pinfo, pkts, n, NULL);
+
+    if (pktgen_tst_port_flags(pinfo, SEND_LATENCY_PKTS))
+        pktgen_tstamp_inject(pinfo, qid, pkts, n);
+
+    tx_send_packets(pinfo, qid, pkts, n);
 }
 
 /**
@@ -950,14 +1558,15 @@ pktgen_send_pkts(port_info_t *pinfo, uint16_t qid, struct rte_mempool *mp)
  * pktgen_main_transmit - Determine the next packet format to transmit.
  *
  * DESCRIPTION
- * Determine the next packet format to transmit for a given port.
+ * Determine the next packet format to transmit for a given port and send up to
+ * nb_pkts of it.
  *
  * RETURNS: N/A
  *
  * SEE ALSO:
  */
 static inline void
-pktgen_main_transmit(port_info_t *pinfo, uint16_t qid)
+pktgen_main_transmit(port_info_t *pinfo, uint16_t qid, uint16_t nb_pkts)
 {
     uint16_t pid = pinfo->pid;
 
@@ -968,13 +1577,106 @@ pktgen_main_transmit(port_info_t *pinfo, uint16_t qid)
     if (pktgen_tst_port_flags(pinfo, SENDING_PACKETS)) {
         struct rte_mempool *mp = l2p_get_tx_mp(pid, qid);
 
-        if (pktgen_tst_port_flags(pinfo, SEND_PCAP_PKTS))
+        if (pktgen_tst_port_flags(pinfo, SEND_PCAP_PKTS)) {
+            pcap_info_t *pcap = l2p_get_pcap(pid);
+
+            if (pktgen_tst_port_flags(pinfo, SEND_PCAP_TIMED)) {
+                pktgen_pcap_replay(pinfo, qid, nb_pkts);
+                return;
+            }
+            if (pcap && pcap->stream) {
+                pktgen_pcap_stream_send(pinfo, qid, pcap->stream, nb_pkts);
+                return;
+            }
             mp = l2p_get_pcap_mp(pid);
+        }
+
+        pktgen_send_pkts(pinfo, qid, mp, nb_pkts);
+    }
+}
+
+/**
+ *
+ * pktgen_main_rx_keep - Dump and capture received packets of a port.
+ *
+ * DESCRIPTION
+ * Hand the packets to the packet dump and the capture when they are active on
+ * the port. The capture sampling of the port picks the packets captured. The
+ * disk capture and the flight recorder take the packets of each RX queue
+ * separately, the memory capture of the socket takes those of all queues. The
+ * packets are not freed.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+static inline void
+pktgen_main_rx_keep(port_info_t *pinfo, uint16_t qid, struct rte_mbuf **pkts, uint16_t nb_pkts)
+{
+    uint16_t pid = pinfo->pid;
+
+    if (unlikely(pinfo->dump_count > 0))
+        pktgen_packet_dump_bulk(pkts, nb_pkts, pid);
+
+    if (unlikely(pktgen_tst_port_flags(pinfo, CAPTURE_PKTS))) {
+        struct rte_mbuf *keep[MAX_PKT_RX_BURST];
+        cap_ring_t *cr = pinfo->cap_ring;
+        cap_disk_t *cd = pinfo->cap_disk;
+        uint32_t rate  = pinfo->cap_sample.rate;
+
+        /* Sampling picks the packets to capture, the dump above still sees them all */
+        if (unlikely(rate > 1)) {
+            rte_smp_rmb();
+            nb_pkts = pktgen_capture_sample_bulk(pinfo, qid, rate, pkts, nb_pkts, keep);
+            if (nb_pkts == 0) {
+                if (cd)
+                    pktgen_packet_capture_disk_flush(cd, qid);
+                return;
+            }
+            pkts = keep;
+        }
 
-        pktgen_send_pkts(pinfo, qid, mp);
+        if (cr)
+            pktgen_packet_capture_ring(cr, qid, pkts, nb_pkts);
+        else if (cd)
+            pktgen_packet_capture_disk(cd, qid, pkts, nb_pkts);
+        else {
+            capture_t *capture = &pktgen.capture[pg_socket_id()];
+
+            if (unlikely(capture->port == pid))
+                pktgen_packet_capture_bulk(pkts, nb_pkts, capture);
+        }
+    }
+}
+
+/* Hand over an old disk capture block of an RX queue that got nothing to capture */
+static inline void
+pktgen_rx_capture_idle(port_info_t *pinfo, uint16_t qid)
+{
+    if (unlikely(pktgen_tst_port_flags(pinfo, CAPTURE_PKTS))) {
+        cap_disk_t *cd = pinfo->cap_disk;
+
+        if (cd)
+            pktgen_packet_capture_disk_flush(cd, qid);
     }
 }
 
+/* Report the quiescent states of an RX queue served by this lcore */
+static inline void
+pktgen_rx_online(port_info_t *pinfo, uint16_t qid)
+{
+    rte_rcu_qsbr_thread_register(pinfo->rx_qsv, qid);
+    rte_rcu_qsbr_thread_online(pinfo->rx_qsv, qid);
+}
+
+/* Stop reporting, pktgen_rx_quiesce() no longer waits for the RX queue */
+static inline void
+pktgen_rx_offline(port_info_t *pinfo, uint16_t qid)
+{
+    rte_rcu_qsbr_thread_offline(pinfo->rx_qsv, qid);
+    rte_rcu_qsbr_thread_unregister(pinfo->rx_qsv, qid);
+}
+
 /**
  *
  * pktgen_main_receive - Main receive routine for packets of a port.
@@ -991,9 +1693,12 @@ static inline void
 pktgen_main_receive(port_info_t *pinfo, uint16_t qid)
 {
     struct rte_mbuf **pkts = pinfo->per_queue[qid].rx_pkts;
-    qstats_t *qs           = &pinfo->stats.qstats[qid];
+    rx_qstats_t *qs        = &pinfo->stats.rxq[qid];
     uint16_t nb_rx, nb_pkts = pinfo->rx_burst, pid;
 
+    /* Nothing of the previous burst is used past this point */
+    rte_rcu_qsbr_quiescent(pinfo->rx_qsv, qid);
+
     if (unlikely(pktgen_tst_port_flags(pinfo, STOP_RECEIVING_PACKETS)))
         return;
 
@@ -1002,25 +1707,35 @@ pktgen_main_receive(port_info_t *pinfo, uint16_t qid)
     /* Read packets from RX queues and free the mbufs */
     if (likely((nb_rx = rte_eth_rx_burst(pid, qid, pkts, nb_pkts)) > 0)) {
         qs->q_ipackets += nb_rx;
+        for (uint16_t i = 0; i < nb_rx; i++)
+            qs->q_ibytes += rte_pktmbuf_pkt_len(pkts[i]);
 
         if (pktgen_tst_port_flags(pinfo, SEND_LATENCY_PKTS))
-            pktgen_tstamp_check(pinfo, pkts, nb_rx);
+            pktgen_tstamp_check(pinfo, qid, pkts, nb_rx);
+
+        /* The analyzers exist before the flag is set */
+        if (pktgen_tst_port_flags(pinfo, SIGNATURE_PKTS))
+            pktgen_sig_rx_bulk(pinfo, qid, pkts, nb_rx);
 
         /* classify the packets and update counters */
         pktgen_packet_classify_bulk(pkts, nb_rx, pid, qid);
 
-        if (unlikely(pinfo->dump_count > 0))
-            pktgen_packet_dump_bulk(pkts, nb_rx, pid);
-
-        if (unlikely(pktgen_tst_port_flags(pinfo, CAPTURE_PKTS))) {
-            capture_t *capture = &pktgen.capture[pg_socket_id()];
+        /* Only the packets accepted by the RX filter are dumped and captured */
+        rx_filter_t *flt = pinfo->rx_filter;
+        if (unlikely(flt != NULL)) {
+            struct rte_mbuf *match[MAX_PKT_RX_BURST];
+            uint16_t nb_match = pktgen_rx_filter_bulk(flt, pkts, nb_rx, match, qs);
 
-            if (unlikely(capture->port == pid))
-                pktgen_packet_capture_bulk(pkts, nb_rx, capture);
-        }
+            if (nb_match)
+                pktgen_main_rx_keep(pinfo, qid, match, nb_match);
+            else
+                pktgen_rx_capture_idle(pinfo, qid);
+        } else
+            pktgen_main_rx_keep(pinfo, qid, pkts, nb_rx);
 
         rte_pktmbuf_free_bulk(pkts, nb_rx);
-    }
+    } else
+        pktgen_rx_capture_idle(pinfo, qid);
 }
 
 /**
@@ -1039,8 +1754,8 @@ static void
 pktgen_main_rxtx_loop(void)
 {
     port_info_t *pinfo;
-    uint64_t curr_tsc, tx_next_cycle, tx_bond_cycle;
-    uint16_t pid, rx_qid, tx_qid, lid = rte_lcore_id();
+    uint64_t curr_tsc, tx_bond_cycle;
+    uint16_t pid, rx_qid, tx_qid, nb_pkts, lid = rte_lcore_id();
 
     if (lid == rte_get_main_lcore()) {
         printf("Using %d initial lcore for Rx/Tx\n", lid);
@@ -1050,7 +1765,6 @@ pktgen_main_rxtx_loop(void)
     pinfo = l2p_get_pinfo_by_lcore(lid);
 
     curr_tsc      = pktgen_get_time();
-    tx_next_cycle = curr_tsc;
     tx_bond_cycle = curr_tsc + (pktgen_get_timer_hz() / 10);
 
     pid    = pinfo->pid;
@@ -1062,21 +1776,19 @@ pktgen_main_rxtx_loop(void)
            l2p_get_rx_mp(pinfo->pid, rx_qid), l2p_get_tx_mp(pinfo->pid, tx_qid)->name,
            l2p_get_tx_mp(pinfo->pid, tx_qid));
 
+    pktgen_rx_online(pinfo, rx_qid);
+
     while (pktgen.force_quit == 0) {
         /* Process RX */
         pktgen_main_receive(pinfo, rx_qid);
 
         curr_tsc = pktgen_get_time();
 
-        /* Determine when is the next time to send packets */
-        const int64_t max_tx_lag =
-            DEFAULT_MAX_TX_LAG;        // Allow some lag, ideally make this configurable.
-        int64_t dt = curr_tsc - tx_next_cycle;
-        if (dt >= 0) {
-            tx_next_cycle = curr_tsc + pinfo->tx_cycles - (dt <= max_tx_lag ? dt : 0);
-            // Process TX
-            pktgen_main_transmit(pinfo, tx_qid);
-        }
+        /* Send when the queue has earned the credit for a burst */
+        nb_pkts = pktgen_tx_pace(pinfo, tx_qid, curr_tsc);
+        if (nb_pkts)
+            pktgen_main_transmit(pinfo, tx_qid, nb_pkts);
+
         if (curr_tsc >= tx_bond_cycle) {
             tx_bond_cycle = curr_tsc + (pktgen_get_timer_hz() / 10);
             if (pktgen_tst_port_flags(pinfo, BONDING_TX_PACKETS))
@@ -1084,6 +1796,8 @@ pktgen_main_rxtx_loop(void)
         }
     }
 
+    pktgen_rx_offline(pinfo, rx_qid);
+
     pktgen_log_debug("Exit %d", lid);
 
     pktgen_exit_cleanup(lid);
@@ -1103,9 +1817,9 @@ pktgen_main_rxtx_loop(void)
 static void
 pktgen_main_tx_loop(void)
 {
-    uint16_t tx_qid, lid = rte_lcore_id();
+    uint16_t tx_qid, nb_pkts, lid = rte_lcore_id();
     port_info_t *pinfo = l2p_get_pinfo_by_lcore(lid);
-    uint64_t curr_tsc, tx_next_cycle, tx_bond_cycle;
+    uint64_t curr_tsc, tx_bond_cycle;
 
     if (lid == rte_get_main_lcore()) {
         printf("Using %d initial lcore for Rx/Tx\n", lid);
@@ -1113,7 +1827,6 @@ pktgen_main_tx_loop(void)
     }
 
     curr_tsc      = pktgen_get_time();
-    tx_next_cycle = curr_tsc + pinfo->tx_cycles;
     tx_bond_cycle = curr_tsc + pktgen_get_timer_hz() / 10;
 
     tx_qid = l2p_get_txqid(lid);
@@ -1124,16 +1837,11 @@ pktgen_main_tx_loop(void)
     while (unlikely(pktgen.force_quit == 0)) {
         curr_tsc = pktgen_get_time();
 
-        /* Determine when is the next time to send packets */
-        const int64_t max_tx_lag =
-            DEFAULT_MAX_TX_LAG;        // Allow some lag, ideally make this configurable.
-        int64_t dt = curr_tsc - tx_next_cycle;
-        if (dt >= 0) {
-            tx_next_cycle = curr_tsc + pinfo->tx_cycles - (dt <= max_tx_lag ? dt : 0);
+        /* Send when the queue has earned the credit for a burst */
+        nb_pkts = pktgen_tx_pace(pinfo, tx_qid, curr_tsc);
+        if (nb_pkts)
+            pktgen_main_transmit(pinfo, tx_qid, nb_pkts);
 
-            // Process TX
-            pktgen_main_transmit(pinfo, tx_qid);
-        }
         if (unlikely(curr_tsc >= tx_bond_cycle)) {
             tx_bond_cycle = curr_tsc + pktgen_get_timer_hz() / 10;
             if (pktgen_tst_port_flags(pinfo, BONDING_TX_PACKETS))
@@ -1175,9 +1883,95 @@ pktgen_main_rx_loop(void)
     printf("RX lid %3d, pid %2d, qid %2d, RX-MP %-16s @ %p\n", lid, pinfo->pid, rx_qid,
            l2p_get_rx_mp(pinfo->pid, rx_qid)->name, l2p_get_rx_mp(pinfo->pid, rx_qid));
 
+    pktgen_rx_online(pinfo, rx_qid);
+
     while (pktgen.force_quit == 0)
         pktgen_main_receive(pinfo, rx_qid);
 
+    pktgen_rx_offline(pinfo, rx_qid);
+
+    pktgen_log_debug("Exit %d", lid);
+
+    pktgen_exit_cleanup(lid);
+}
+
+/**
+ *
+ * pktgen_main_work_loop - Poll a list of port/queue pairs on a single core.
+ *
+ * DESCRIPTION
+ * When a lcore is mapped to more then one port/queue pair this routine serves
+ * each pair in turn. Every TX queue keeps its own pacing credit, so the ports on
+ * the lcore are paced independently of each other.
+ *
+ * RETURNS: N/A
+ *
+ * SEE ALSO:
+ */
+static void
+pktgen_main_work_loop(void)
+{
+    uint16_t lid       = rte_lcore_id();
+    l2p_lport_t *lport = l2p_get_lport(lid);
+    uint64_t curr_tsc, tx_bond_cycle;
+    static const char *modes[] = {"??", "RX", "TX", "RX/TX"};
+
+    if (lid == rte_get_main_lcore()) {
+        printf("Using %d initial lcore for Rx/Tx\n", lid);
+        rte_exit(0, "using initial lcore for ports");
+    }
+
+    curr_tsc      = pktgen_get_time();
+    tx_bond_cycle = curr_tsc + (pktgen_get_timer_hz() / 10);
+
+    for (uint16_t i = 0; i < lport->num_work; i++) {
+        l2p_work_t *w = &lport->work[i];
+
+        printf("%-5s lid %3d, pid %2d, qids %2d/%2d\n", modes[w->mode & LCORE_MODE_BOTH], lid,
+               w->port->pid, w->rx_qid, w->tx_qid);
+        if (w->mode & LCORE_MODE_RX)
+            pktgen_rx_online(w->port->pinfo, w->rx_qid);
+    }
+
+    while (pktgen.force_quit == 0) {
+        for (uint16_t i = 0; i < lport->num_work; i++) {
+            l2p_work_t *w      = &lport->work[i];
+            port_info_t *pinfo = w->port->pinfo;
+
+            /* Make the per-lcore queue lookups return this port/queue pair */
+            lport->cur = i;
+
+            if (w->mode & LCORE_MODE_RX)
+                pktgen_main_receive(pinfo, w->rx_qid);
+
+            if (w->mode & LCORE_MODE_TX) {
+                uint16_t nb_pkts = pktgen_tx_pace(pinfo, w->tx_qid, pktgen_get_time());
+
+                if (nb_pkts)
+                    pktgen_main_transmit(pinfo, w->tx_qid, nb_pkts);
+            }
+        }
+
+        curr_tsc = pktgen_get_time();
+        if (unlikely(curr_tsc >= tx_bond_cycle)) {
+            tx_bond_cycle = curr_tsc + (pktgen_get_timer_hz() / 10);
+            for (uint16_t i = 0; i < lport->num_work; i++) {
+                l2p_work_t *w = &lport->work[i];
+
+                if ((w->mode & LCORE_MODE_TX) &&
+                    pktgen_tst_port_flags(w->port->pinfo, BONDING_TX_PACKETS))
+                    rte_eth_tx_burst(w->port->pid, w->tx_qid, NULL, 0);
+            }
+        }
+    }
+
+    for (uint16_t i = 0; i < lport->num_work; i++) {
+        l2p_work_t *w = &lport->work[i];
+
+        if (w->mode & LCORE_MODE_RX)
+            pktgen_rx_offline(w->port->pinfo, w->rx_qid);
+    }
+
     pktgen_log_debug("Exit %d", lid);
 
     pktgen_exit_cleanup(lid);
@@ -1204,6 +1998,11 @@ pktgen_launch_one_lcore(void *arg __rte_unused)
         return 0;
     }
 
+    if (l2p_get_work_cnt(lid) > 1) {
+        pktgen_main_work_loop();
+        return 0;
+    }
+
     switch (l2p_get_type(lid)) {
     case LCORE_MODE_RX:
         pktgen_main_rx_loop();
@@ -1321,8 +2120,11 @@ _timer_thread(void *arg)
 
         curr = pktgen_get_time();
 
+        /* Keep a fixed one second cadence, the latency intervals are cut here */
         if (curr >= process) {
-            process = curr + pktgen.stats_timeout;
+            process += pktgen.stats_timeout;
+            if (process <= curr)
+                process = curr + pktgen.stats_timeout;
             pktgen_process_stats();
             prev = curr;
         }
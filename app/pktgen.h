@@ -71,11 +71,13 @@
 #include <rte_ring.h>
 #include <rte_mempool.h>
 #include <rte_mbuf.h>
+#include <rte_mbuf_dyn.h>
 #include <rte_ip.h>
 #include <rte_udp.h>
 #include <rte_tcp.h>
 #include <rte_dev.h>
 #include <rte_time.h>
+#include <rte_rcu_qsbr.h>
 
 #include <l2p.h>
 #include <port_config.h>
@@ -96,6 +98,12 @@
 #include "pktgen-capture.h"
 #include "pktgen-log.h"
 #include "pktgen-latency.h"
+#include "pktgen-latsamp.h"
+#include "pktgen-rate.h"
+#include "pktgen-imix.h"
+#include "pktgen-stream.h"
+#include "pktgen-filter.h"
+#include "pktgen-sig.h"
 #include "pktgen-random.h"
 #include "pktgen-seq.h"
 #include "pktgen-version.h"
@@ -196,8 +204,6 @@ enum {
     COLUMN_WIDTH_1 = 24, /**< Width of display column 1 */
     COLUMN_WIDTH_3 = 24, /**< Width of display column 3 */
 
-    DEFAULT_MAX_TX_LAG = 20000, /**< Max TX lag cycles; ideally make configurable */
-
     /* Row locations for start of data */
     PAGE_TITLE_ROWS = 1,  /**< Number of rows for the page title */
     PORT_FLAGS_ROWS = 1,  /**< Number of rows for port flags */
@@ -323,6 +329,8 @@ typedef struct pktgen_s {
     uint32_t portdesc_cnt;                 /**< Number of ports in portdesc array */
     lscpu_t *lscpu;                        /**< CPU information */
     capture_t capture[RTE_MAX_NUMA_NODES]; /**< Packet capture, 1 struct per socket */
+    double lat_percentiles[MAX_LATENCY_PERCENTILES]; /**< Latency percentiles to report */
+    uint16_t nb_lat_percentiles;                     /**< Number of latency percentiles */
 } pktgen_t;
 
 enum {                                     /* Pktgen flags bits */
@@ -340,7 +348,7 @@ enum {                                     /* Pktgen flags bits */
        ENABLE_THEME_FLAG      = (1 << 11), /**< Enable theme or color support */
        CLOCK_GETTIME_FLAG     = (1 << 12), /**< Enable clock_gettime() instead of rdtsc() */
        JUMBO_PKTS_FLAG        = (1 << 13), /**< Enable Jumbo frames */
-       RESERVED_14            = (1 << 14), /**< Reserved */
+       HW_TSTAMP_FLAG         = (1 << 14), /**< Enable RX hardware timestamps when supported */
        MAIN_PAGE_FLAG         = (1 << 15), /**< Display the main page */
        CPU_PAGE_FLAG          = (1 << 16), /**< Display the CPU page */
        SEQUENCE_PAGE_FLAG     = (1 << 17), /**< Display the Packet sequence page */
@@ -384,12 +392,57 @@ void pktgen_page_display(void);
 void pktgen_packet_ctor(port_info_t *pinfo, int32_t seq_idx, int32_t type);
 
 /**
- * Recalculate the inter-burst TX cycle count for a port's target rate.
+ * Set the mbuf TX offload flags of a packet template from the port offloads.
+ *
+ * @param pinfo  Per-port state.
+ * @param pkt    Packet template, its ol_flags field is updated.
+ * @return       The mbuf ol_flags to send the packet with.
+ */
+uint64_t pktgen_tx_ol_flags(port_info_t *pinfo, pkt_seq_t *pkt);
+
+/**
+ * Rebuild the pre-built payload fill pattern after the pattern settings change.
+ *
+ * @param pinfo  Per-port state.
+ */
+void pktgen_fill_pattern_update(port_info_t *pinfo);
+
+/**
+ * Recalculate the TX pacing rate and burst size for a port's target rate.
  *
  * @param pinfo  Per-port state.
  */
 void pktgen_packet_rate(port_info_t *pinfo);
 
+/**
+ * Set the TX pacing parameters of a port.
+ *
+ * @param pinfo         Per-port state.
+ * @param pps           Packets per second per TX queue, 0 to send without pacing.
+ * @param burst         Packets sent per paced burst.
+ * @param pps_per_pcnt  Packets per second per TX queue for one percent of the link.
+ */
+void pktgen_tx_pace_set(port_info_t *pinfo, double pps, uint16_t burst, double pps_per_pcnt);
+
+/**
+ * Fill in TX pacing parameters for a packet rate.
+ *
+ * @param cfg    Pacing parameters to fill in.
+ * @param pps    Packets per second per TX queue, 0 to send burst packets without pacing.
+ * @param burst  Packets sent per paced burst.
+ */
+void pktgen_tx_pace_cfg(tx_pace_cfg_t *cfg, double pps, uint16_t burst);
+
+/**
+ * Return the burst size to pace a packet rate with, bursts are kept at least
+ * TX_PACE_GAP_NS apart up to tx_burst packets.
+ *
+ * @param pinfo  Per-port state.
+ * @param pps    Packets per second per TX queue.
+ * @return       Burst size between 1 and tx_burst.
+ */
+uint16_t pktgen_tx_pace_burst(port_info_t *pinfo, double pps);
+
 /**
  * Test whether an IPv4 address matches the port's source IP.
  *
@@ -470,6 +523,52 @@ pktgen_get_timer_hz(void)
         return rte_get_timer_hz();
 }
 
+/**
+ * Return the conversion of the RX hardware timestamps of a port to pktgen time.
+ *
+ * @param hw
+ *   Hardware RX timestamp state of the port.
+ * @return
+ *   The calibrated conversion, or NULL when the port has no RX timestamps or
+ *   they are not calibrated yet.
+ */
+static inline const hw_tstamp_cal_t *
+pktgen_rx_cal(const hw_tstamp_t *hw)
+{
+    const hw_tstamp_cal_t *cal;
+
+    if (!hw->rx_enabled)
+        return NULL;
+
+    cal = &hw->cal[hw->cal_idx];
+    rte_smp_rmb();
+
+    return (cal->time_per_tick == 0.0) ? NULL : cal;
+}
+
+/**
+ * Return the RX time of a packet, from its NIC timestamp when it has one.
+ *
+ * @param hw
+ *   Hardware RX timestamp state of the port.
+ * @param cal
+ *   Conversion from pktgen_rx_cal(), NULL to always read pktgen_get_time().
+ * @param m
+ *   Received packet.
+ * @return
+ *   RX time of the packet in pktgen_get_time() units.
+ */
+static inline uint64_t
+pktgen_rx_time(const hw_tstamp_t *hw, const hw_tstamp_cal_t *cal, struct rte_mbuf *m)
+{
+    if (cal && (m->ol_flags & hw->rx_flag)) {
+        uint64_t clock = *RTE_MBUF_DYNFIELD(m, hw->dynfield_offset, rte_mbuf_timestamp_t *);
+
+        return cal->time + (int64_t)((double)(int64_t)(clock - cal->clock) * cal->time_per_tick);
+    }
+    return pktgen_get_time();
+}
+
 /** Latency probe packet payload header. */
 typedef struct {
     uint32_t magic;     /**< Magic value (TSTAMP_MAGIC) for probe identification */
@@ -479,6 +578,10 @@ typedef struct {
 
 #define TSTAMP_MAGIC 0xf00dcafe /**< Magic value identifying a latency probe packet */
 
+/* tstamp_t.index holds the sending TX queue in the upper bits and its sequence below */
+#define TSTAMP_QID_SHIFT 24                              /**< Bit offset of the TX queue id */
+#define TSTAMP_SEQ_MASK  ((1U << TSTAMP_QID_SHIFT) - 1) /**< Mask of the per-queue sequence */
+
 /**
  * Atomically OR a set of flags into a port's port_flags atomic.
  *
@@ -29,6 +29,27 @@ extern "C" {
 /** Generator state (must be seeded with a non-zero value before first use). */
 extern uint64_t xor_state[1];
 
+/**
+ * Generate the next 64-bit pseudo-random value from a caller owned state.
+ *
+ * Used where each thread keeps its own generator, e.g. per lcore.
+ *
+ * @param state
+ *   Generator state, updated in place. Must be seeded with a non-zero value.
+ * @return
+ *   64-bit pseudo-random number.
+ */
+static inline uint64_t
+xorshift64star_r(uint64_t *state)
+{
+    uint64_t x = *state; /* The state must be seeded with a nonzero value. */
+    x ^= x >> 12;        // a
+    x ^= x << 25;        // b
+    x ^= x >> 27;        // c
+    *state = x;
+    return x * 0x2545F4914F6CDD1D;
+}
+
 /**
  * Generate the next 64-bit pseudo-random value using the xorshift64* algorithm.
  *
@@ -40,12 +61,7 @@ extern uint64_t xor_state[1];
 static inline uint64_t
 xorshift64star(void)
 {
-    uint64_t x = xor_state[0]; /* The state must be seeded with a nonzero value. */
-    x ^= x >> 12;              // a
-    x ^= x << 25;              // b
-    x ^= x >> 27;              // c
-    xor_state[0] = x;
-    return x * 0x2545F4914F6CDD1D;
+    return xorshift64star_r(&xor_state[0]);
 }
 
 #ifdef __cplusplus
@@ -0,0 +1,135 @@
+-- Round trip of a pcapng capture file.
+--
+-- Port 0 sends a known number of UDP packets to port 1, which captures them in
+-- pcapng format. The file is then read back here, independently of the Pktgen
+-- reader, and checked block by block.
+--
+-- Ports 0 and 1 must be cabled back to back:
+--   pktgen -l 1-5 -n 4 -- -P -m [2:3].0 -m [4:5].1 -f test/pcapng_roundtrip.lua
+package.path = package.path ..";?.lua;test/?.lua;app/?.lua;"
+
+require "Pktgen"
+
+local sendport  = "0";
+local recvport  = "1";
+local num_pkts  = 1000;
+local pkt_size  = 64;
+local dport     = 0x9988;
+local failures  = 0;
+
+local function check(ok, what)
+    if ok then
+        printf("PASS: %s\n", what);
+    else
+        printf("FAIL: %s\n", what);
+        failures = failures + 1;
+    end
+end
+
+-- Read the blocks of a pcapng file, returns the packet records and the if_tsresol
+local function read_pcapng(name)
+    local f = io.open(name, "rb");
+    if f == nil then
+        return nil;
+    end
+    local d = f:read("a");
+    f:close();
+
+    local e = "<";
+    if string.unpack("<I4", d, 9) ~= 0x1a2b3c4d then
+        e = ">";
+    end
+
+    local recs, tsresol, off = {}, nil, 1;
+    while off + 12 <= #d + 1 do
+        local btype, blen = string.unpack(e .. "I4I4", d, off);
+
+        if blen < 12 or blen % 4 ~= 0 or string.unpack(e .. "I4", d, off + blen - 4) ~= blen then
+            return nil, nil, "bad block length at offset " .. (off - 1);
+        end
+        if btype == 1 then
+            local o = off + 16;
+            while o < off + blen - 4 do
+                local code, len = string.unpack(e .. "I2I2", d, o);
+                if code == 0 then
+                    break;
+                end
+                if code == 9 then
+                    tsresol = string.byte(d, o + 4);
+                end
+                o = o + 4 + ((len + 3) & ~3);
+            end
+        elseif btype == 6 then
+            local _, hi, lo, caplen, origlen = string.unpack(e .. "I4I4I4I4I4", d, off + 8);
+            recs[#recs + 1] = {
+                ts   = (hi << 32) | lo,
+                len  = origlen,
+                data = d:sub(off + 28, off + 27 + caplen)
+            };
+        end
+        off = off + blen;
+    end
+    return recs, tsresol;
+end
+
+pktgen.set(sendport, "count", num_pkts);
+pktgen.set(sendport, "rate", 1);
+pktgen.set(sendport, "size", pkt_size);
+pktgen.set(sendport, "dport", dport);
+pktgen.set_proto(sendport, "udp");
+
+pktgen.pcap_format(recvport, "pcapng");
+pktgen.capture_mode(recvport, "memory");
+pktgen.capture(recvport, "enable");
+pktgen.delay(1000);
+
+local t0 = os.time();
+pktgen.start(sendport);
+pktgen.delay(3000);
+pktgen.stop(sendport);
+pktgen.delay(1000);
+pktgen.capture(recvport, "disable");
+local t1 = os.time();
+
+local ls   = io.popen("ls -t pktgen-*-" .. recvport .. ".pcapng 2>/dev/null");
+local name = ls:read("l");
+ls:close();
+check(name ~= nil, "capture file written");
+if name == nil then
+    return;
+end
+
+local recs, tsresol, err = read_pcapng(name);
+check(recs ~= nil, "blocks of " .. name .. " are well formed" .. (err and (", " .. err) or ""));
+if recs == nil then
+    return;
+end
+check(tsresol == 9, "interface has nanosecond timestamps");
+
+local found, in_order, in_run, sized = 0, true, true, true;
+local prev = 0;
+for _, r in ipairs(recs) do
+    if r.ts < prev then
+        in_order = false;
+    end
+    prev = r.ts;
+
+    -- IPv4 UDP to the destination port of the test
+    if #r.data >= 42 and string.unpack(">I2", r.data, 13) == 0x0800 and
+       string.byte(r.data, 24) == 17 and string.unpack(">I2", r.data, 37) == dport then
+        found = found + 1;
+        if r.len ~= pkt_size - 4 then
+            sized = false;
+        end
+        if r.ts // 1000000000 < t0 - 1 or r.ts // 1000000000 > t1 + 1 then
+            in_run = false;
+        end
+    end
+end
+
+check(found == num_pkts, string.format("%d of %d packets captured", found, num_pkts));
+check(in_order, "timestamps never go back");
+check(in_run, "timestamps fall inside the run");
+check(sized, "packets keep their length");
+
+printf("pcapng round trip: %d failures\n", failures);
@@ -0,0 +1,112 @@
+-- Signature analysis of a stream with known loss, reordering and duplicates.
+--
+-- The packets are signed here, written to a pcapng file and replayed by port 0
+-- with its own signatures off, so they reach port 1 exactly as written. Port 1
+-- must count what was injected.
+--
+-- Write the file first, outside of Pktgen:
+--   lua test/signature.lua
+-- then load it on port 0, with ports 0 and 1 cabled back to back:
+--   pktgen -l 1-5 -n 4 -- -P -m [2:3].0 -m [4:5].1 -s 0:/tmp/pktgen-signature.pcapng \
+--       -f test/signature.lua
+package.path = package.path ..";?.lua;test/?.lua;app/?.lua;"
+
+local filename  = "/tmp/pktgen-signature.pcapng";
+local sig_magic = 0x5349474e;
+local stream    = 1000;
+local frame_len = 128;
+
+-- Sequence numbers as sent: 5 is lost, 8 comes after 9 and 12 is sent twice
+local seqs = { 0, 1, 2, 3, 4, 6, 7, 9, 8, 10, 11, 12, 12, 13, 14, 15, 16, 17, 18, 19 };
+local expect = {
+    packets     = #seqs,
+    lost        = 1,
+    reordered   = 1,
+    max_reorder = 1,
+    duplicates  = 1,
+    late        = 0,
+};
+
+local function ip_cksum(hdr)
+    local sum = 0;
+    for i = 1, #hdr, 2 do
+        sum = sum + string.unpack(">I2", hdr, i);
+    end
+    while sum > 0xffff do
+        sum = (sum & 0xffff) + (sum >> 16);
+    end
+    return ~sum & 0xffff;
+end
+
+-- IPv4 UDP frame without FCS, the signature is its last 16 bytes in host order
+local function signed_frame(seq)
+    local udp_len = frame_len - 14 - 20;
+    local ip      = string.pack(">BBI2I2I2BBI2I4I4", 0x45, 0, udp_len + 20, seq, 0, 64, 17, 0,
+                                0x0a000001, 0x0a000002);
+
+    ip = ip:sub(1, 10) .. string.pack(">I2", ip_cksum(ip)) .. ip:sub(13);
+
+    local eth  = string.pack(">I6I6I2", 0xffffffffffff, 0x020000000001, 0x0800);
+    local udp  = string.pack(">I2I2I2I2", 1234, 5678, udp_len, 0);
+    local sig  = string.pack("=I4I2I2I8", sig_magic, stream, 0, seq);
+    local body = string.rep("\0", frame_len - #eth - #ip - #udp - #sig);
+
+    return eth .. ip .. udp .. body .. sig;
+end
+
+local function write_pcapng(name)
+    local f = assert(io.open(name, "wb"));
+
+    -- Section header, then one Ethernet interface with nanosecond timestamps
+    f:write(string.pack("=I4I4I4I2I2i8I4", 0x0a0d0d0a, 28, 0x1a2b3c4d, 1, 0, -1, 28));
+    f:write(string.pack("=I4I4I2I2I4I2I2BxxxI2I2I4", 1, 32, 1, 0, 65535, 9, 1, 9, 0, 0, 32));
+
+    for i, seq in ipairs(seqs) do
+        local data = signed_frame(seq);
+        local pad  = string.rep("\0", (4 - #data % 4) % 4);
+        local blen = 28 + #data + #pad + 4;
+        local ts   = 1000000000 + i * 10000;
+
+        f:write(string.pack("=I4I4I4I4I4I4I4", 6, blen, 0, ts >> 32, ts & 0xffffffff, #data,
+                            #data));
+        f:write(data, pad, string.pack("=I4", blen));
+    end
+    f:close();
+end
+
+if pktgen == nil then
+    write_pcapng(filename);
+    print("Wrote " .. #seqs .. " signed packets to " .. filename);
+    return;
+end
+
+require "Pktgen"
+
+local failures = 0;
+
+pktgen.signature("0", "disable");
+pktgen.signature("1", "enable");
+pktgen.clear("all");
+
+-- One timed pass over the file, the replayed packets are never signed again
+pktgen.set("0", "count", #seqs);
+pktgen.pcap_timing("0", "on", 1);
+pktgen.pcap("0", "on");
+pktgen.start("0");
+pktgen.delay(2000);
+pktgen.stop("0");
+pktgen.delay(1000);
+
+local s = pktgen.portStats("1")[1].signature;
+for _, k in ipairs({ "packets", "lost", "reordered", "max_reorder", "duplicates", "late" }) do
+    if s[k] == expect[k] then
+        printf("PASS: %s %d\n", k, s[k]);
+    else
+        printf("FAIL: %s %s, expected %d\n", k, tostring(s[k]), expect[k]);
+        failures = failures + 1;
+    end
+end
+
+pktgen.pcap("0", "off");
+pktgen.pcap_timing("0", "off");
+printf("signature: %d failures\n", failures);